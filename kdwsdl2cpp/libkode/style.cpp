@@ -91,6 +91,9 @@ QString Style::makeIdentifier( const QString &str )
   identifier.replace( "/", "_" );
   identifier.replace( ":", "_" ); // xsd:int -> xsd_int  (testcase: salesforce-partner.wsdl)
   identifier.replace( " ", "_" );
+  identifier.replace( "\"", "_" );
+  identifier.replace( "'", "_" );
+  identifier.replace( "\\", "_" );
 
   // Can't start with a number, either.
   const int firstNum = identifier.at(0).digitValue();
@@ -49,6 +49,7 @@ public:
     bool mHasSubstitutions;
     QString mDefaultValue;
     QString mFixedValue;
+    QString mExpectedContentTypes;
     int mOccurrence;
     QName mReference;
     Compositor mCompositor;
@@ -226,6 +227,16 @@ bool Element::hasSubstitutions() const
     return d->mHasSubstitutions;
 }
 
+void Element::setExpectedContentTypes(const QString &contentTypes)
+{
+    d->mExpectedContentTypes = contentTypes;
+}
+
+QString Element::expectedContentTypes() const
+{
+    return d->mExpectedContentTypes;
+}
+
 Element ElementList::element(const QName &qualifiedName) const
 {
     const_iterator it = constBegin();
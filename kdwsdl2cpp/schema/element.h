@@ -99,6 +99,13 @@ public:
      */
     bool hasSubstitutions() const;
 
+    /**
+     * Sets the xmime:expectedContentTypes attribute of this element, e.g. "image/png, image/jpeg".
+     * See http://www.w3.org/TR/xml-media-types/
+     */
+    void setExpectedContentTypes(const QString &contentTypes);
+    QString expectedContentTypes() const;
+
 private:
     class Private;
     Private *d;
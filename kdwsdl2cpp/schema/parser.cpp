@@ -38,6 +38,7 @@ static const QString XMLSchemaURI(QLatin1String("http://www.w3.org/2001/XMLSchem
 static const QString WSDLSchemaURI(QLatin1String("http://schemas.xmlsoap.org/wsdl/"));
 static const QString soapEncNs = QLatin1String("http://schemas.xmlsoap.org/soap/encoding/");
 static const QString soap12EncNs = QLatin1String("http://www.w3.org/2003/05/soap-encoding");
+static const QString xmimeNs = QLatin1String("http://www.w3.org/2005/05/xmlmime");
 
 namespace XSD
 {
@@ -485,6 +486,7 @@ Element Parser::parseElement(ParserContext *context,
     newElement.setDefaultValue(element.attribute(QLatin1String("default")));
     newElement.setFixedValue(element.attribute(QLatin1String("fixed")));
     newElement.setNillable(stringToBoolean(element.attribute(QLatin1String("nillable"))));
+    newElement.setExpectedContentTypes(element.attributeNS(xmimeNs, QLatin1String("expectedContentTypes")));
 
     if (element.hasAttribute(QLatin1String("type"))) {
         QName typeName(element.attribute(QLatin1String("type")).trimmed());
@@ -3,6 +3,7 @@
 #include "converter.h"
 #include <libkode/style.h>
 #include <QDebug>
+#include <QMap>
 
 using namespace KWSDL;
 
@@ -32,6 +33,117 @@ QString namespaceString(const QString &ns)
     return QLatin1String("QString::fromLatin1(\"") + ns + QLatin1String("\")");
 }
 
+QString escapeStringLiteral(const QString &str)
+{
+    QString escaped = str;
+    escaped.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+    escaped.replace(QLatin1Char('"'), QLatin1String("\\\""));
+    return escaped;
+}
+
+static QString charLiteral(QChar ch)
+{
+    const ushort u = ch.unicode();
+    if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_' || u == '-' || u == '.') {
+        return QLatin1Char('\'') + ch + QLatin1Char('\'');
+    }
+    return QString::number(u);
+}
+
+// Generates code which sets indexVar to the position of the string nameVar in names
+// (and leaves it untouched if there's no match), for dispatching on element names or enum values.
+// Instead of comparing against every name, it switches on the length, then on the character which
+// tells apart most names of that length, so that usually a single full comparison remains.
+// If isByteArray is true, nameVar is a QByteArray rather than a QString (e.g. the soap action).
+KODE::Code nameIndexSwitch(const QString &nameVar, const QStringList &names, const QString &indexVar, bool isByteArray)
+{
+    QMap<int, QList<int> > byLength;
+    QSet<QString> seen;
+    for (int i = 0; i < names.count(); ++i) {
+        if (seen.contains(names.at(i))) {
+            continue; // the first one wins, like in an if/else chain
+        }
+        seen.insert(names.at(i));
+        byLength[names.at(i).length()].append(i);
+    }
+
+    KODE::Code code;
+    code += QLatin1String("switch (") + nameVar + QLatin1String(".length()) {");
+    code.indent();
+    QMap<int, QList<int> >::const_iterator it = byLength.constBegin();
+    for (; it != byLength.constEnd(); ++it) {
+        const int length = it.key();
+        const QList<int> &indexes = it.value();
+        code += QLatin1String("case ") + QString::number(length) + QLatin1Char(':');
+        code.indent();
+
+        // Find the position with the most distinct characters
+        int bestPos = 0;
+        int bestCount = 0;
+        if (indexes.count() > 1) {
+            for (int pos = 0; pos < length; ++pos) {
+                QSet<QChar> chars;
+                Q_FOREACH (int idx, indexes) {
+                    chars.insert(names.at(idx).at(pos));
+                }
+                if (chars.count() > bestCount) {
+                    bestCount = chars.count();
+                    bestPos = pos;
+                }
+            }
+        }
+
+        QList<QChar> groupOrder;
+        QMap<QChar, QList<int> > groups;
+        Q_FOREACH (int idx, indexes) {
+            const QChar ch = bestCount > 1 ? names.at(idx).at(bestPos) : QChar();
+            if (!groups.contains(ch)) {
+                groupOrder.append(ch);
+            }
+            groups[ch].append(idx);
+        }
+
+        if (bestCount > 1) {
+            if (isByteArray) {
+                code += QLatin1String("switch (static_cast<uchar>(") + nameVar + QLatin1String(".at(") + QString::number(bestPos) + QLatin1String("))) {");
+            } else {
+                code += QLatin1String("switch (") + nameVar + QLatin1String(".at(") + QString::number(bestPos) + QLatin1String(").unicode()) {");
+            }
+            code.indent();
+        }
+        Q_FOREACH (const QChar &ch, groupOrder) {
+            if (bestCount > 1) {
+                code += QLatin1String("case ") + charLiteral(ch) + QLatin1Char(':');
+                code.indent();
+            }
+            bool first = true;
+            Q_FOREACH (int idx, groups.value(ch)) {
+                const QString name = escapeStringLiteral(names.at(idx));
+                const QString literal = isByteArray ? QLatin1Char('"') + name + QLatin1Char('"')
+                                                    : QLatin1String("QLatin1String(\"") + name + QLatin1String("\")");
+                code += QLatin1String(first ? "if (" : "else if (") + nameVar + QLatin1String(" == ") + literal + QLatin1Char(')');
+                code.indent();
+                code += indexVar + QLatin1String(" = ") + QString::number(idx) + QLatin1Char(';');
+                code.unindent();
+                first = false;
+            }
+            if (bestCount > 1) {
+                code += QLatin1String("break;");
+                code.unindent();
+            }
+        }
+        if (bestCount > 1) {
+            code.unindent();
+            code += QLatin1String("}");
+        }
+        code += QLatin1String("break;");
+        code.unindent();
+    }
+    code.unindent();
+    code += QLatin1String("}");
+    return code;
+}
+
 Converter::Converter()
     : mQObject(KODE::Class(QLatin1String("QObject"))),
       mKDSoapServerObjectInterface(KODE::Class(QLatin1String("KDSoapServerObjectInterface")))
@@ -404,3 +516,24 @@ KODE::Code Converter::serializePart(const Part &part, const QString &localVariab
     serializer.setOmitIfEmpty(false);   // Don't omit entire parts, this especially breaks the wrappers for RPC messages
     return serializer.generate();
 }
+
+// Helper for clientstub and serverstub, for -direct-writing: the message only carries the name
+// of the part's element, its contents are written by the generated writeTo() method.
+KODE::Code Converter::writePartDirectly(const Part &part, const QString &localVariableName, const QString &varName)
+{
+    bool qualified, nillable;
+    const QName elemName = elementNameForPart(part, &qualified, &nillable);
+    const QString typeName = mTypeMap.localType(part.type(), part.element());
+    const QString valueVarName = QLatin1String("_value") + upperlize(KODE::Style::makeIdentifier(elemName.localName()));
+    KODE::Code code;
+    code += QLatin1String("KDSoapValue ") + valueVarName + QLatin1String("(QString::fromLatin1(\"") + elemName.localName() + QLatin1String("\"), QVariant());") + COMMENT;
+    if (!elemName.nameSpace().isEmpty()) {
+        code += valueVarName + QLatin1String(".setNamespaceUri(") + namespaceString(elemName.nameSpace()) + QLatin1String(");");
+    }
+    if (qualified) {
+        code += valueVarName + QLatin1String(".setQualified(true);");
+    }
+    code += varName + QLatin1String(" = ") + valueVarName + QLatin1String(";");
+    code += varName + QLatin1String(".setBodyWriter(QSharedPointer<KDSoapBodyWriter>(new KDSoapTypedBodyWriter<") + typeName + QLatin1String(">(") + localVariableName + QLatin1String(")));") + COMMENT;
+    return code;
+}
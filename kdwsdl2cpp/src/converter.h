@@ -58,6 +58,10 @@ private:
 
     void convertComplexType(const XSD::ComplexType *);
     void createComplexTypeSerializer(KODE::Class &, const XSD::ComplexType *);
+    void createComplexTypeStreamDeserializer(KODE::Class &, const XSD::ComplexType *);
+    void createComplexTypeStreamSerializer(KODE::Class &, const XSD::ComplexType *);
+    bool isSerializedQualified(const XSD::Element &elem) const;
+    QString contentTypeMember(const XSD::Element &elem) const;
 
     void convertSimpleType(const XSD::SimpleType *, const XSD::SimpleType::List &simpleTypeList);
     void createSimpleTypeSerializer(KODE::Class &, const XSD::SimpleType *, const XSD::SimpleType::List &simpleTypeList);
@@ -75,6 +79,7 @@ private:
     void createHeader(const SoapBinding::Header &header, KODE::Class &newClass);
     void addJobResultMember(KODE::Class &jobClass, const Part &part, const QString &varName, const QStringList &inputGetters);
     KODE::Code serializePart(const Part &part, const QString &localVariableName, const QString &varName, bool append);
+    KODE::Code writePartDirectly(const Part &part, const QString &localVariableName, const QString &varName);
     KODE::Code demarshalVarHelper(const QName &type, const QName &elementType, const QString &variableName, const QString &qtTypeName, const QString &soapValueVarName, bool optional) const;
     KODE::Code demarshalVar(const QName &type, const QName &elementType, const QString &variableName, const QString &typeName, const QString &soapValueVarName, bool optional, bool usePointer) const;
     KODE::Code demarshalArrayVar(const QName &type, const QString &variableName, const QString &qtTypeName, bool optional) const;
@@ -82,13 +87,18 @@ private:
     QString generateMemberVariable(const QString &rawName, const QString &typeName, const QString &inputTypeName, KODE::Class &newClass, XSD::Attribute::AttributeUse, bool usePointer, bool polymorphic);
     QString listTypeFor(const QString &itemTypeName, KODE::Class &newClass);
     KODE::Code deserializeRetVal(const KWSDL::Part &part, const QString &replyMsgName, const QString &qtRetType, const QString &varName) const;
+    bool canParseDirectly(const Part::List &parts, const Binding &binding) const;
+    bool canWriteDirectly(const Part::List &parts, const Binding &binding) const;
     QName elementNameForPart(const Part &part, bool *qualified, bool *nillable) const;
     bool isQualifiedPart(const Part &part) const;
 
     // Server Stub
     void convertServerService();
-    void generateServerMethod(KODE::Code &code, const Binding &binding, const Operation &operation,
-                              KODE::Class &newClass, bool first);
+    QString generateServerMethod(const Binding &binding, const Operation &operation, KODE::Class &newClass);
+    QString soapActionForOperation(const Binding &binding, const Operation &operation) const;
+    void generateServerParseBody(KODE::Code &code, const Binding &binding, const Operation &operation, KODE::Class &newClass);
+    QString directRequestMember(const QString &elementName) const;
+    KODE::Code serverSerializeDocumentResponse(const Part &retPart, const Binding &binding, const QString &responseVarName);
     void generateDelayedReponseMethod(const QString &methodName, const QString &retInputType,
                                       const Part &retPart, KODE::Class &newClass, const Binding &binding, const Message &outputMessage);
 
@@ -112,6 +122,9 @@ private:
 QString upperlize(const QString &);
 QString lowerlize(const QString &);
 QString namespaceString(const QString &ns);
+// Escapes the quotes and backslashes in str, for use in a generated string literal
+QString escapeStringLiteral(const QString &str);
+KODE::Code nameIndexSwitch(const QString &nameVar, const QStringList &names, const QString &indexVar, bool isByteArray = false);
 
 static QName XmlAnyType(QLatin1String("http://www.w3.org/2001/XMLSchema"), QLatin1String("any"));
 
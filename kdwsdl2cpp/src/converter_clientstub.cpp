@@ -115,6 +115,15 @@ bool Converter::convertClientService()
             newClass.addInclude(QLatin1String("KDSoapClient/KDSoapValue.h"), QLatin1String("KDSoapValue"));
             newClass.addInclude(QLatin1String("KDSoapClient/KDSoapPendingCallWatcher.h"), QLatin1String("KDSoapPendingCallWatcher"));
             newClass.addInclude(QLatin1String("KDSoapClient/KDSoapNamespaceManager.h"));
+            newClass.addInclude(QLatin1String("KDSoapClient/KDSoapBinaryCodec.h"));
+            newClass.addInclude(QLatin1String("KDSoapClient/KDSoapNumericCodec.h"));
+            newClass.addInclude(QLatin1String("KDSoapClient/KDDateTime.h"));
+            if (Settings::self()->generateDirectParsing()) {
+                newClass.addInclude(QLatin1String("KDSoapClient/KDSoapBodyParser.h"));
+            }
+            if (Settings::self()->generateDirectWriting()) {
+                newClass.addInclude(QLatin1String("KDSoapClient/KDSoapBodyWriter.h"));
+            }
 
             // Variables (which will go into the d pointer)
             KODE::MemberVariable clientInterfaceVar(QLatin1String("m_clientInterface"), QLatin1String("KDSoapClientInterface*"));
@@ -284,7 +293,7 @@ bool Converter::convertClientService()
                 code += "}";
                 code += "return d_ptr->m_clientInterface;";
                 clientInterface.setBody(code);
-                clientInterface.setDocs(QLatin1String("Returns the underlying KDSoapClientInterface instance, which allows to access setCookieJar, lastResponseHeaders, etc."));
+                clientInterface.setDocs(QLatin1String("Returns the underlying KDSoapClientInterface instance, which allows to access setCookieJar, lastResponseHeaders, setEndPoints, etc."));
                 newClass.addFunction(clientInterface);
             }
             {
@@ -358,6 +367,15 @@ bool Converter::convertClientService()
                 }
                 jobClass.addInclude(QString(), fullyQualified(newClass));
                 jobClass.addHeaderInclude(QLatin1String("KDSoapClient/KDSoapJob.h"));
+                jobClass.addInclude(QLatin1String("KDSoapClient/KDSoapBinaryCodec.h"));
+                jobClass.addInclude(QLatin1String("KDSoapClient/KDSoapNumericCodec.h"));
+                jobClass.addInclude(QLatin1String("KDSoapClient/KDDateTime.h"));
+                if (Settings::self()->generateDirectParsing()) {
+                    jobClass.addInclude(QLatin1String("KDSoapClient/KDSoapBodyParser.h"));
+                }
+                if (Settings::self()->generateDirectWriting()) {
+                    jobClass.addInclude(QLatin1String("KDSoapClient/KDSoapBodyWriter.h"));
+                }
                 if (!Settings::self()->exportDeclaration().isEmpty()) {
                     jobClass.setExportDeclaration(Settings::self()->exportDeclaration());
                 }
@@ -424,6 +442,10 @@ bool Converter::convertClientService()
                 callLine += QLatin1String(", requestHeaders()");
                 callLine += QLatin1String(");");
                 doStartCode += callLine;
+                if (canParseDirectly(selectedParts(binding, outputMsg, operation, false /*output*/), binding)) {
+                    // slotFinished parses it with the body parser, not in the background beforehand
+                    doStartCode += QLatin1String("pendingCall.setBackgroundParsingEnabled(false);") + COMMENT;
+                }
 
                 doStartCode += "KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);";
                 doStartCode += "QObject::connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),\n"
@@ -435,9 +457,18 @@ bool Converter::convertClientService()
                 slot.addArgument(QLatin1String("KDSoapPendingCallWatcher* watcher"));
                 KODE::Code slotCode;
                 slotCode += QLatin1String("watcher->deleteLater();");
-                slotCode += QLatin1String("KDSoapMessage _reply = watcher->returnMessage();");
                 const Part::List outputParts = selectedParts(binding, outputMsg, operation, false /*input*/);
                 const SoapBinding::Headers outputHeaders = getOutputHeaders(binding, operationName);
+                const bool directParsing = canParseDirectly(outputParts, binding);
+                if (directParsing) {
+                    const Part &part = outputParts.first();
+                    const QString varName = mNameMapper.escape(QLatin1String("result") + upperlize(part.name()));
+                    const KODE::MemberVariable member(varName, QString());
+                    slotCode += QLatin1String("KDSoapTypedBodyParser<") + mTypeMap.localType(part.type(), part.element()) + QLatin1String("> _bodyParser(&")
+                                + member.name() + QLatin1String(");") + COMMENT;
+                    slotCode += QLatin1String("watcher->setBodyParser(&_bodyParser);");
+                }
+                slotCode += QLatin1String("KDSoapMessage _reply = watcher->returnMessage();");
 
                 if (!outputParts.isEmpty() || !outputHeaders.isEmpty()) {
                     slotCode += QLatin1String("if (!_reply.isFault()) {") + COMMENT;
@@ -461,7 +492,9 @@ bool Converter::convertClientService()
                         Q_FOREACH (const Part &part, outputParts) {
                             const QString varName = mNameMapper.escape(QLatin1String("result") + upperlize(part.name()));
                             const KODE::MemberVariable member(varName, QString());
-                            slotCode.addBlock(deserializeRetVal(part, QLatin1String("_reply"), mTypeMap.localType(part.type(), part.element()), member.name()));
+                            if (!directParsing) { // otherwise already filled by _bodyParser
+                                slotCode.addBlock(deserializeRetVal(part, QLatin1String("_reply"), mTypeMap.localType(part.type(), part.element()), member.name()));
+                            }
 
                             addJobResultMember(jobClass, part, varName, inputGetters);
                         }
@@ -586,10 +619,12 @@ void Converter::clientGenerateMessage(KODE::Code &code, const Binding &binding,
 {
     code += "KDSoapMessage message;";
 
+    bool encoded = false;
     if (binding.type() == Binding::SOAPBinding) {
         const SoapBinding soapBinding = binding.soapBinding();
         const SoapBinding::Operation op = soapBinding.operations().value(operation.name());
         if (op.input().use() == SoapBinding::EncodedUse) {
+            encoded = true;
             code += "message.setUse(KDSoapMessage::EncodedUse);";
         } else {
             code += "message.setUse(KDSoapMessage::LiteralUse);";
@@ -601,9 +636,17 @@ void Converter::clientGenerateMessage(KODE::Code &code, const Binding &binding,
         }
     }
 
+    const Part::List parts = selectedParts(binding, message, operation, true /*input*/);
+    if (!encoded && canWriteDirectly(parts, binding)) {
+        const QString partName = parts.first().name();
+        const QString localVariableName = varsAreMembers ? QLatin1Char('m') + upperlize(partName) : mNameMapper.escape(lowerlize(partName));
+        code.addBlock(writePartDirectly(parts.first(), localVariableName, QLatin1String("message")));
+        return;
+    }
+
     bool isBuiltin = false;
 
-    Q_FOREACH (const Part &part, selectedParts(binding, message, operation, true /*input*/)) {
+    Q_FOREACH (const Part &part, parts) {
         isBuiltin = isBuiltin || mTypeMap.isBuiltinType(part.type(), part.element());
         addMessageArgument(code, soapStyle(binding), part, part.name(), "message", varsAreMembers);
     }
@@ -636,6 +679,28 @@ KODE::Code Converter::deserializeRetVal(const KWSDL::Part &part, const QString &
     return code;
 }
 
+// With -direct-parsing, a document-style message made of a single complex element is parsed
+// by its generated deserialize(QXmlStreamReader&), through a KDSoapBodyParser.
+bool Converter::canParseDirectly(const Part::List &parts, const Binding &binding) const
+{
+    if (!Settings::self()->generateDirectParsing() || soapStyle(binding) != SoapBinding::DocumentStyle || parts.count() != 1) {
+        return false;
+    }
+    const Part &part = parts.first();
+    return part.type().isEmpty() && mTypeMap.isComplexType(part.type(), part.element()) && !mTypeMap.isPolymorphic(part.type(), part.element());
+}
+
+// With -direct-writing, a document-style message made of a single complex element is written
+// by its generated writeTo(QXmlStreamWriter&, KDSoapNamespacePrefixes&), through a KDSoapBodyWriter.
+bool Converter::canWriteDirectly(const Part::List &parts, const Binding &binding) const
+{
+    if (!Settings::self()->generateDirectWriting() || soapStyle(binding) != SoapBinding::DocumentStyle || parts.count() != 1) {
+        return false;
+    }
+    const Part &part = parts.first();
+    return part.type().isEmpty() && mTypeMap.isComplexType(part.type(), part.element()) && !mTypeMap.isPolymorphic(part.type(), part.element());
+}
+
 // Generate synchronous call
 bool Converter::convertClientCall(const Operation &operation, const Binding &binding, KODE::Class &newClass)
 {
@@ -651,17 +716,25 @@ bool Converter::convertClientCall(const Operation &operation, const Binding &bin
     KODE::Code code;
     const bool hasAction = clientAddAction(code, binding, operation.name());
     clientGenerateMessage(code, binding, inputMessage, operation);
+
+    // Return value(s) :
+    const Part::List outParts = selectedParts(binding, outputMessage, operation, false /*output*/);
+    const int numReturnValues = outParts.count();
+    const bool directParsing = canParseDirectly(outParts, binding);
+
     QString callLine = QLatin1String("d_ptr->m_lastReply = clientInterface()->call(QLatin1String(\"") + operation.name() + QLatin1String("\"), message");
-    if (hasAction) {
+    if (directParsing) {
+        const QString retType = mTypeMap.localType(outParts.first().type(), outParts.first().element());
+        code += retType + QLatin1String(" ret;"); // local var
+        code += QLatin1String("KDSoapTypedBodyParser<") + retType + QLatin1String("> _bodyParser(&ret);") + COMMENT;
+        callLine += hasAction ? QLatin1String(", action") : QLatin1String(", QString()");
+        callLine += QLatin1String(", KDSoapHeaders(), &_bodyParser");
+    } else if (hasAction) {
         callLine += QLatin1String(", action");
     }
     callLine += QLatin1String(");");
     code += callLine;
 
-    // Return value(s) :
-    const Part::List outParts = selectedParts(binding, outputMessage, operation, false /*output*/);
-    const int numReturnValues = outParts.count();
-
     if (numReturnValues == 1) {
         const Part retPart = outParts.first();
         const QString retType = mTypeMap.localType(retPart.type(), retPart.element());
@@ -680,7 +753,9 @@ bool Converter::convertClientCall(const Operation &operation, const Binding &bin
         // WARNING: if you change the logic below, also adapt the result parsing for async calls
 
         if (retType != QLatin1String("void")) {
-            if (soapStyle(binding) == SoapBinding::DocumentStyle /*no wrapper*/) {
+            if (directParsing) {
+                code += QLatin1String("return ret;") + COMMENT; // already filled by _bodyParser
+            } else if (soapStyle(binding) == SoapBinding::DocumentStyle /*no wrapper*/) {
                 code += retType + QLatin1String(" ret;"); // local var
                 code.addBlock(deserializeRetVal(retPart, QLatin1String("d_ptr->m_lastReply"), retType, QLatin1String("ret")));
                 code += QLatin1String("return ret;") + COMMENT;
@@ -754,6 +829,14 @@ void Converter::convertClientInputMessage(const Operation &operation,
     callLine += QLatin1String(");");
     code += callLine;
 
+    if (operation.operationType() == Operation::RequestResponseOperation) {
+        const Message outputMsg = mWSDL.findMessage(operation.output().message());
+        if (canParseDirectly(selectedParts(binding, outputMsg, operation, false /*output*/), binding)) {
+            // The finished slot parses it with the body parser, not in the background beforehand
+            code += QLatin1String("pendingCall.setBackgroundParsingEnabled(false);") + COMMENT;
+        }
+    }
+
     if (operation.operationType() == Operation::RequestResponseOperation ||
             operation.operationType() == Operation::OneWayOperation) {
         const QString finishedSlotName = QLatin1String("_kd_slot") + upperlize(operationName) + QLatin1String("Finished");
@@ -794,6 +877,18 @@ void Converter::convertClientOutputMessage(const Operation &operation,
     //  return;
 
     KODE::Code slotCode;
+    bool directParsing = false;
+    if (operation.operationType() != Operation::OneWayOperation) {
+        const Message message = mWSDL.findMessage(operation.output().message());
+        const Part::List parts = selectedParts(binding, message, operation, false /*output*/);
+        directParsing = canParseDirectly(parts, binding);
+        if (directParsing) {
+            const QString partType = mTypeMap.localType(parts.first().type(), parts.first().element());
+            slotCode += partType + QLatin1String(" ret;"); // local var
+            slotCode += QLatin1String("KDSoapTypedBodyParser<") + partType + QLatin1String("> _bodyParser(&ret);") + COMMENT;
+            slotCode += "watcher->setBodyParser(&_bodyParser);";
+        }
+    }
     slotCode += "const KDSoapMessage reply = watcher->returnMessage();";
     slotCode += "if (reply.isFault()) {";
     slotCode.indent();
@@ -825,7 +920,9 @@ void Converter::convertClientOutputMessage(const Operation &operation,
 
             // WARNING: if you change the logic below, also adapt the result parsing for sync calls, above
 
-            if (soapStyle(binding) == SoapBinding::DocumentStyle /*no wrapper*/) {
+            if (directParsing) {
+                partNames << QLatin1String("ret"); // already filled by _bodyParser
+            } else if (soapStyle(binding) == SoapBinding::DocumentStyle /*no wrapper*/) {
                 slotCode += partType + QLatin1String(" ret;"); // local var
                 slotCode.addBlock(deserializeRetVal(part, QLatin1String("reply"), partType, QLatin1String("ret")));
                 partNames << QLatin1String("ret");
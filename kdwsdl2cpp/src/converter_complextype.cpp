@@ -175,6 +175,16 @@ void Converter::convertComplexType(const XSD::ComplexType *type)
             const bool polymorphic = isElementPolymorphic(elemIt, mTypeMap, isList);
             const bool usePointer = usePointerForElement(elemIt, newClass, mTypeMap, isList);
             generateMemberVariable(KODE::Style::makeIdentifier(elemIt.name()), typeName, inputTypeName, newClass, use, usePointer, polymorphic);
+
+            if (!contentTypeMember(elemIt).isEmpty()) {
+                // xmime:expectedContentTypes: the MIME type of the data, used for MTOM attachments
+                generateMemberVariable(KODE::Style::makeIdentifier(elemIt.name()) + QLatin1String("ContentType"), QLatin1String("QString"),
+                                       QLatin1String("const QString&"), newClass, XSD::Attribute::Required, false, false);
+                KODE::Function expectedFunc(lowerlize(KODE::Style::makeIdentifier(elemIt.name())) + QLatin1String("ExpectedContentTypes"), QLatin1String("QString"));
+                expectedFunc.setStatic(true);
+                expectedFunc.setBody(QLatin1String("return QString::fromLatin1(\"") + elemIt.expectedContentTypes() + QLatin1String("\");"));
+                newClass.addFunction(expectedFunc);
+            }
         }
 
         // include header
@@ -206,6 +216,12 @@ void Converter::convertComplexType(const XSD::ComplexType *type)
     }
 
     createComplexTypeSerializer(newClass, type);
+    if (Settings::self()->generateDirectParsing()) {
+        createComplexTypeStreamDeserializer(newClass, type);
+    }
+    if (Settings::self()->generateDirectWriting()) {
+        createComplexTypeStreamSerializer(newClass, type);
+    }
 
     const QString newClassName = newClass.name();
 
@@ -411,16 +427,89 @@ QString Converter::generateMemberVariable(const QString &rawName, const QString
 }
 
 // Helper method for the generation of the deserialize() method
-static KODE::Code demarshalNameTest(const QName &type, const QString &tagName, bool *first)
+typedef QPair<QString, KODE::Code> NameBranch;
+typedef QList<NameBranch> NameBranches;
+
+// Returns the name to dispatch on in deserialize(), or an empty string for the xsd:any catch-all
+static QString dispatchName(const QName &type, const QString &tagName)
 {
-    KODE::Code demarshalCode;
     if (type.nameSpace() == XMLSchemaURI && (type.localName() == QLatin1String("any"))) {
-        demarshalCode += QString::fromLatin1(*first ? "" : "else ") + QLatin1String("{") + COMMENT;
-    } else {
-        demarshalCode += QString::fromLatin1(*first ? "" : "else ") + QLatin1String("if (_name == QLatin1String(\"") + tagName + QLatin1String("\")) {") + COMMENT;
+        return QString();
     }
-    *first = false;
-    return demarshalCode;
+    return tagName;
+}
+
+// Generates the dispatch on _name to the code of each branch; a branch with an empty name is the catch-all.
+// fallback (which can be empty) is used when nothing matched and there's no catch-all.
+// Types with few elements get an if/else chain, larger ones (100+ elements isn't unusual)
+// use nameIndexSwitch so that the cost doesn't grow with the number of elements.
+static KODE::Code nameDispatch(const NameBranches &branches, const KODE::Code &fallback)
+{
+    QStringList names;
+    bool hasCatchAll = false;
+    KODE::Code catchAll;
+    Q_FOREACH (const NameBranch &branch, branches) {
+        if (!branch.first.isEmpty()) {
+            names.append(branch.first);
+        } else if (!hasCatchAll) {
+            hasCatchAll = true;
+            catchAll = branch.second;
+        }
+    }
+
+    KODE::Code code;
+    if (names.count() < 8) {
+        bool first = true;
+        Q_FOREACH (const NameBranch &branch, branches) {
+            if (branch.first.isEmpty()) {
+                code += QString::fromLatin1(first ? "" : "else ") + QLatin1String("{") + COMMENT;
+            } else {
+                code += QString::fromLatin1(first ? "" : "else ") + QLatin1String("if (_name == QLatin1String(\"") + branch.first + QLatin1String("\")) {") + COMMENT;
+            }
+            first = false;
+            code.indent();
+            code.addBlock(branch.second);
+            code.unindent();
+            code += "}";
+        }
+        if (!hasCatchAll && !fallback.isEmpty()) {
+            code += QString::fromLatin1(first ? "{" : "else {");
+            code.indent();
+            code.addBlock(fallback);
+            code.unindent();
+            code += "}";
+        }
+        return code;
+    }
+
+    code += QLatin1String("int _nameIndex = -1;") + COMMENT;
+    code.addBlock(nameIndexSwitch(QLatin1String("_name"), names, QLatin1String("_nameIndex")));
+    code += "switch (_nameIndex) {";
+    code.indent();
+    int index = 0;
+    Q_FOREACH (const NameBranch &branch, branches) {
+        if (branch.first.isEmpty()) {
+            continue;
+        }
+        code += QLatin1String("case ") + QString::number(index++) + QLatin1String(": {");
+        code.indent();
+        code.addBlock(branch.second);
+        code += "break;";
+        code.unindent();
+        code += "}";
+    }
+    const KODE::Code defaultCode = hasCatchAll ? catchAll : fallback;
+    if (!defaultCode.isEmpty()) {
+        code += "default: {";
+        code.indent();
+        code.addBlock(defaultCode);
+        code += "break;";
+        code.unindent();
+        code += "}";
+    }
+    code.unindent();
+    code += "}";
+    return code;
 }
 
 // Low-level helper for demarshalVar, doesn't handle the polymorphic case (so it can be called for lists of polymorphics)
@@ -494,6 +583,9 @@ KODE::Code Converter::demarshalArrayVar(const QName &type, const QString &variab
 void Converter::createComplexTypeSerializer(KODE::Class &newClass, const XSD::ComplexType *type)
 {
     newClass.addInclude(QLatin1String("KDSoapClient/KDSoapNamespaceManager.h"));
+    newClass.addInclude(QLatin1String("KDSoapClient/KDSoapBinaryCodec.h"));
+    newClass.addInclude(QLatin1String("KDSoapClient/KDSoapNumericCodec.h"));
+    newClass.addInclude(QLatin1String("KDSoapClient/KDDateTime.h"));
 
     KODE::Function serializeFunc(QLatin1String("serialize"), QLatin1String("KDSoapValue"));
     serializeFunc.addArgument(QLatin1String("const QString& valueName"));
@@ -596,7 +688,7 @@ void Converter::createComplexTypeSerializer(KODE::Class &newClass, const XSD::Co
 
         demarshalCode.addBlock(demarshalArrayVar(arrayType, variableName, typeName, isElementOptional(elem)));
     } else {
-        bool first = true;
+        NameBranches branches;
         Q_FOREACH (const XSD::Element &elem, elements) {
 
             const QString elemName = elem.name();
@@ -606,8 +698,7 @@ void Converter::createComplexTypeSerializer(KODE::Class &newClass, const XSD::Co
 
             const QString variableName = QLatin1String("d_ptr->") + KODE::MemberVariable::memberVariableName(elemName);
 
-            demarshalCode.addBlock(demarshalNameTest(elem.type(), elemName, &first));
-            demarshalCode.indent();
+            KODE::Code branchCode;
 
             ElementArgumentSerializer serializer(mTypeMap, elem.type(), QName(), variableName);
             serializer.setOutputVariable("args", true);
@@ -637,7 +728,7 @@ void Converter::createComplexTypeSerializer(KODE::Class &newClass, const XSD::Co
                 marshalCode.unindent();
                 marshalCode += '}';
 
-                demarshalCode.addBlock(demarshalArrayVar(elem.type(), variableName, typeName, isElementOptional(elem)));
+                branchCode.addBlock(demarshalArrayVar(elem.type(), variableName, typeName, isElementOptional(elem)));
             } else {
                 const bool optional = isElementOptional(elem);
                 if (elem.hasSubstitutions())
@@ -650,14 +741,19 @@ void Converter::createComplexTypeSerializer(KODE::Class &newClass, const XSD::Co
                 serializer.setOmitIfEmpty(optional);
                 const bool usePointer = usePointerForElement(elem, newClass, mTypeMap, false);
                 serializer.setUsePointer(usePointer);
+                const QString contentTypeVariable = contentTypeMember(elem);
+                serializer.setContentTypeVariable(contentTypeVariable);
                 marshalCode.addBlock(serializer.generate());
 
-                demarshalCode.addBlock(demarshalVar(elem.type(), QName(), variableName, typeName, "val", optional, usePointer));
+                branchCode.addBlock(demarshalVar(elem.type(), QName(), variableName, typeName, "val", optional, usePointer));
+                if (!contentTypeVariable.isEmpty()) {
+                    branchCode += contentTypeVariable + QLatin1String(" = val.contentType();");
+                }
             }
 
-            demarshalCode.unindent();
-            demarshalCode += "}";
+            branches.append(qMakePair(dispatchName(elem.type(), elemName), branchCode));
         } // end: for each element
+        demarshalCode.addBlock(nameDispatch(branches, KODE::Code()));
     }
 
     if (!elements.isEmpty()) {
@@ -675,7 +771,7 @@ void Converter::createComplexTypeSerializer(KODE::Class &newClass, const XSD::Co
         demarshalCode += "const KDSoapValue& val = attribs.at(attrNr);";
         demarshalCode += "const QString _name = val.name();";
 
-        bool first = true;
+        NameBranches branches;
         Q_FOREACH (const XSD::Attribute &attribute, attributes) {
             const QString attrName = attribute.name();
             if (attrName.isEmpty()) {
@@ -683,9 +779,6 @@ void Converter::createComplexTypeSerializer(KODE::Class &newClass, const XSD::Co
             }
             const QString variableName = QLatin1String("d_ptr->") + KODE::MemberVariable::memberVariableName(attrName);
 
-            demarshalCode.addBlock(demarshalNameTest(attribute.type(), attrName, &first));
-            demarshalCode.indent();
-
             ElementArgumentSerializer serializer(mTypeMap, attribute.type(), QName(), variableName);
             serializer.setElementName(attribute.qualifiedName());
             serializer.setOutputVariable("attribs", true);
@@ -696,11 +789,10 @@ void Converter::createComplexTypeSerializer(KODE::Class &newClass, const XSD::Co
 
             const QString typeName = mTypeMap.localType(attribute.type());
             Q_ASSERT(!typeName.isEmpty());
-            demarshalCode.addBlock(demarshalVar(attribute.type(), QName(), variableName, typeName, "val", attribute.attributeUse() == XSD::Attribute::Optional, false));
-
-            demarshalCode.unindent();
-            demarshalCode += "}";
+            const KODE::Code branchCode = demarshalVar(attribute.type(), QName(), variableName, typeName, "val", attribute.attributeUse() == XSD::Attribute::Optional, false);
+            branches.append(qMakePair(dispatchName(attribute.type(), attrName), branchCode));
         }
+        demarshalCode.addBlock(nameDispatch(branches, KODE::Code()));
         marshalCode += QLatin1String("mainValue.childValues().attributes() += attribs;") + COMMENT;
 
         demarshalCode.unindent();
@@ -715,3 +807,355 @@ void Converter::createComplexTypeSerializer(KODE::Class &newClass, const XSD::Co
     deserializeFunc.setBody(demarshalCode);
     newClass.addFunction(deserializeFunc);
 }
+
+// Generates deserialize(QXmlStreamReader&), the counterpart of deserialize(const KDSoapValue&)
+// which fills the members straight from the XML stream, for -direct-parsing.
+// Anything that isn't a plain builtin or complex type falls back to a KDSoapValue for that element only.
+void Converter::createComplexTypeStreamDeserializer(KODE::Class &newClass, const XSD::ComplexType *type)
+{
+    newClass.addHeaderInclude(QLatin1String("QtCore/QXmlStreamReader"));
+    newClass.addInclude(QLatin1String("KDSoapClient/KDSoapBodyParser.h"));
+
+    KODE::Function deserializeFunc(QLatin1String("deserialize"), QLatin1String("void"));
+    deserializeFunc.addArgument(QLatin1String("QXmlStreamReader& reader"));
+    if (!type->derivedTypes().isEmpty()) {
+        deserializeFunc.setVirtualMode(KODE::Function::Virtual);
+    }
+
+    KODE::Code code;
+
+    if ((type->baseTypeName() != XmlAnyType && !type->baseTypeName().isEmpty()) || type->isArray()) {
+        // Derived types and soap-enc arrays: not worth duplicating that logic here
+        code += QLatin1String("deserialize(KDSoapBodyParser::readValue(reader));") + COMMENT;
+        deserializeFunc.setBody(code);
+        newClass.addFunction(deserializeFunc);
+        return;
+    }
+
+    XSD::Element::List elements = type->elements();
+    QMutableListIterator<XSD::Element> itElem(elements);
+    while (itElem.hasNext()) {
+        const XSD::Element &elem = itElem.next();
+        if (mTypeMap.localType(elem.type()) == QLatin1String("void")) {
+            itElem.remove();
+        }
+    }
+    const XSD::Attribute::List attributes = type->attributes();
+
+    if (!attributes.isEmpty()) {
+        code += "const QXmlStreamAttributes attribs = reader.attributes();";
+        code += "for (int attrNr = 0; attrNr < attribs.count(); ++attrNr) {";
+        code.indent();
+        code += "const QXmlStreamAttribute& attr = attribs.at(attrNr);";
+        code += "const QStringRef _name = attr.name();";
+
+        NameBranches branches;
+        Q_FOREACH (const XSD::Attribute &attribute, attributes) {
+            const QString attrName = attribute.name();
+            if (attrName.isEmpty()) {
+                continue;
+            }
+            const QString variableName = QLatin1String("d_ptr->") + KODE::MemberVariable::memberVariableName(attrName);
+            const QString typeName = mTypeMap.localType(attribute.type());
+            const bool optional = attribute.attributeUse() == XSD::Attribute::Optional;
+
+            KODE::Code branch;
+            QString fromText;
+            if (mTypeMap.isBuiltinType(attribute.type())) {
+                fromText = mTypeMap.deserializeBuiltinFromText(attribute.type(), QName(), QLatin1String("attr.value().toString()"), typeName);
+            }
+            if (!fromText.isEmpty()) {
+                branch += variableName + QLatin1String(" = ") + fromText + QLatin1String(";") + COMMENT;
+                if (optional) {
+                    branch += variableName + QLatin1String("_nil = false;") + COMMENT;
+                }
+            } else {
+                branch += QLatin1String("const KDSoapValue val(_name.toString(), attr.value().toString());") + COMMENT;
+                branch.addBlock(demarshalVar(attribute.type(), QName(), variableName, typeName, "val", optional, false));
+            }
+            branches.append(qMakePair(dispatchName(attribute.type(), attrName), branch));
+        }
+        code.addBlock(nameDispatch(branches, KODE::Code()));
+
+        code.unindent();
+        code += "}";
+    }
+
+    if (elements.isEmpty()) {
+        code += QLatin1String("reader.skipCurrentElement();") + COMMENT;
+    } else {
+        code += "while (reader.readNextStartElement()) {";
+        code.indent();
+        code += "const QStringRef _name = reader.name();";
+
+        NameBranches branches;
+        Q_FOREACH (const XSD::Element &elem, elements) {
+            const QString typeName = mTypeMap.localType(elem.type());
+            const QString variableName = QLatin1String("d_ptr->") + KODE::MemberVariable::memberVariableName(elem.name());
+            const bool isList = elem.maxOccurs() > 1 || elem.compositor().maxOccurs() > 1;
+            const bool optional = isElementOptional(elem);
+            const bool usePointer = !isList && usePointerForElement(elem, newClass, mTypeMap, false);
+            const bool isAny = mTypeMap.isTypeAny(elem.type());
+
+            KODE::Code branch;
+            QString fromText;
+            if (!isAny && mTypeMap.isBase64Binary(elem.type())) {
+                // Also handles MTOM attachments
+                const QString contentTypeVariable = contentTypeMember(elem);
+                fromText = QLatin1String("KDSoapBodyParser::readBase64Binary(reader")
+                           + (contentTypeVariable.isEmpty() ? QString() : QLatin1String(", &") + contentTypeVariable) + QLatin1String(")");
+            } else if (!isAny && mTypeMap.isBuiltinType(elem.type())) {
+                fromText = mTypeMap.deserializeBuiltinFromReader(elem.type(), QName(), QLatin1String("reader"), typeName);
+            }
+            const bool streamComplex = !isAny && !usePointer && !elem.hasSubstitutions()
+                                       && mTypeMap.isComplexType(elem.type()) && !mTypeMap.isPolymorphic(elem.type());
+
+            if (!fromText.isEmpty()) {
+                if (isList) {
+                    branch += variableName + QLatin1String(".append(") + fromText + QLatin1String(");") + COMMENT;
+                } else {
+                    branch += variableName + QLatin1String(" = ") + fromText + QLatin1String(";") + COMMENT;
+                }
+                if (optional) {
+                    branch += variableName + QLatin1String("_nil = false;") + COMMENT;
+                }
+            } else if (streamComplex) {
+                if (isList) {
+                    const QString tempVar = variableName.mid(7) + QLatin1String("Temp");
+                    branch += typeName + QLatin1String(" ") + tempVar + QLatin1String(";") + COMMENT;
+                    branch += tempVar + QLatin1String(".deserialize(reader);");
+                    branch += variableName + QLatin1String(".append(") + tempVar + QLatin1String(");");
+                } else {
+                    branch += variableName + QLatin1String(".deserialize(reader);") + COMMENT;
+                }
+                if (optional) {
+                    branch += variableName + QLatin1String("_nil = false;") + COMMENT;
+                }
+            } else {
+                branch += QLatin1String("const KDSoapValue val = KDSoapBodyParser::readValue(reader);") + COMMENT;
+                if (isList) {
+                    branch.addBlock(demarshalArrayVar(elem.type(), variableName, typeName, optional));
+                } else {
+                    branch.addBlock(demarshalVar(elem.type(), QName(), variableName, typeName, "val", optional, usePointer));
+                }
+            }
+            branches.append(qMakePair(dispatchName(elem.type(), elem.name()), branch));
+        }
+        KODE::Code skip;
+        skip += QLatin1String("reader.skipCurrentElement();") + COMMENT;
+        code.addBlock(nameDispatch(branches, skip));
+
+        code.unindent();
+        code += "}";
+    }
+
+    deserializeFunc.setBody(code);
+    newClass.addFunction(deserializeFunc);
+}
+
+// For a base64Binary element with xmime:expectedContentTypes, the member variable holding the MIME type
+// of its data (e.g. "d_ptr->mPhotoContentType"), or an empty string
+QString Converter::contentTypeMember(const XSD::Element &elem) const
+{
+    if (elem.expectedContentTypes().isEmpty() || !mTypeMap.isBase64Binary(elem.type())
+            || elem.maxOccurs() > 1 || elem.compositor().maxOccurs() > 1) {
+        return QString();
+    }
+    return QLatin1String("d_ptr->") + KODE::MemberVariable::memberVariableName(KODE::Style::makeIdentifier(elem.name()) + QLatin1String("ContentType"));
+}
+
+// serialize() marks the value of a complex type as qualified when its first element is qualified,
+// on top of the element's own form, so writeTo() has to do the same
+bool Converter::isSerializedQualified(const XSD::Element &elem) const
+{
+    if (elem.isQualified()) {
+        return true;
+    }
+    if (!mTypeMap.isComplexType(elem.type())) {
+        return false;
+    }
+    const XSD::ComplexType ctype = mWSDL.findComplexType(elem.type());
+    Q_FOREACH (const XSD::Element &child, ctype.elements()) {
+        if (mTypeMap.localType(child.type()) != QLatin1String("void")) {
+            return child.isQualified();
+        }
+    }
+    return false;
+}
+
+// Generates writeTo(QXmlStreamWriter&, KDSoapNamespacePrefixes&), the counterpart of serialize()
+// which writes the attributes and child elements straight to the XML stream, for -direct-writing.
+// Anything that isn't a plain builtin or complex type falls back to a KDSoapValue for that element only.
+void Converter::createComplexTypeStreamSerializer(KODE::Class &newClass, const XSD::ComplexType *type)
+{
+    newClass.addHeaderInclude(QLatin1String("QtCore/QXmlStreamWriter"));
+    newClass.addInclude(QLatin1String("KDSoapClient/KDSoapBodyWriter.h"), QLatin1String("KDSoapNamespacePrefixes"));
+
+    KODE::Function writeFunc(QLatin1String("writeTo"), QLatin1String("void"));
+    writeFunc.addArgument(QLatin1String("QXmlStreamWriter& writer"));
+    writeFunc.addArgument(QLatin1String("KDSoapNamespacePrefixes& namespacePrefixes"));
+    writeFunc.setConst(true);
+    if (!type->derivedTypes().isEmpty()) {
+        writeFunc.setVirtualMode(KODE::Function::Virtual);
+    }
+
+    KODE::Code code;
+
+    if ((type->baseTypeName() != XmlAnyType && !type->baseTypeName().isEmpty()) || type->isArray()) {
+        // Derived types and soap-enc arrays: not worth duplicating that logic here
+        code += QLatin1String("KDSoapBodyWriter::writeValueContents(writer, namespacePrefixes, serialize(QString()));") + COMMENT;
+        writeFunc.setBody(code);
+        newClass.addFunction(writeFunc);
+        return;
+    }
+
+    XSD::Element::List elements = type->elements();
+    QMutableListIterator<XSD::Element> itElem(elements);
+    while (itElem.hasNext()) {
+        const XSD::Element &elem = itElem.next();
+        if (mTypeMap.localType(elem.type()) == QLatin1String("void")) {
+            itElem.remove();
+        }
+    }
+    const XSD::Attribute::List attributes = type->attributes();
+
+    if (elements.isEmpty()) {
+        code += QLatin1String("Q_UNUSED(namespacePrefixes);") + COMMENT;
+        if (attributes.isEmpty()) {
+            code += QLatin1String("Q_UNUSED(writer);");
+        }
+    }
+
+    Q_FOREACH (const XSD::Attribute &attribute, attributes) {
+        const QString attrName = attribute.name();
+        if (attrName.isEmpty()) {
+            continue;
+        }
+        const QString variableName = QLatin1String("d_ptr->") + KODE::MemberVariable::memberVariableName(attrName);
+        const QName attrType = attribute.type();
+        const bool omitIfEmpty = attribute.attributeUse() == XSD::Attribute::Optional || attribute.attributeUse() == XSD::Attribute::Prohibited;
+
+        QString value;
+        if (mTypeMap.isBuiltinType(attrType)) {
+            value = mTypeMap.serializeBuiltinValue(attrType, QName(), variableName);
+        }
+        if (value.isEmpty()) {
+            // QName and simple types: get the value from their KDSoapValue
+            const QString nameArg = QLatin1String("QString::fromLatin1(\"") + attrName + QLatin1String("\")");
+            if (mTypeMap.isBuiltinType(attrType)) {
+                value = mTypeMap.serializeBuiltin(attrType, QName(), variableName, nameArg, attrType.nameSpace(), attrType.localName()) + QLatin1String(".value()");
+            } else {
+                value = variableName + QLatin1String(".serialize(") + nameArg + QLatin1String(").value()");
+            }
+        }
+        const QString text = QLatin1String("KDSoapBodyWriter::textValue(") + value + QLatin1String(", ") + namespaceString(attrType.nameSpace())
+                             + QLatin1String(", QString::fromLatin1(\"") + attrType.localName() + QLatin1String("\"))");
+
+        if (omitIfEmpty) {
+            code += QLatin1String("if (!") + variableName + QLatin1String("_nil) {");
+            code.indent();
+        }
+        if (attribute.isQualified()) {
+            code += QLatin1String("writer.writeAttribute(") + namespaceString(attribute.qualifiedName().nameSpace()) + QLatin1String(", QString::fromLatin1(\"") + attrName + QLatin1String("\"), ") + text + QLatin1String(");") + COMMENT;
+        } else {
+            code += QLatin1String("writer.writeAttribute(QString::fromLatin1(\"") + attrName + QLatin1String("\"), ") + text + QLatin1String(");") + COMMENT;
+        }
+        if (omitIfEmpty) {
+            code.unindent();
+            code += "}";
+        }
+    }
+
+    bool usesFallback = false;
+    KODE::Code elementsCode;
+    Q_FOREACH (const XSD::Element &elem, elements) {
+        const QString elemName = elem.name();
+        const QName elemType = elem.type();
+        const QString variableName = QLatin1String("d_ptr->") + KODE::MemberVariable::memberVariableName(elemName);
+        const bool isList = elem.maxOccurs() > 1 || elem.compositor().maxOccurs() > 1;
+        const bool optional = isElementOptional(elem);
+        const bool usePointer = !isList && usePointerForElement(elem, newClass, mTypeMap, false);
+        const bool isAny = mTypeMap.isTypeAny(elemType);
+        const QString localVariableName = isList ? variableName + QLatin1String(".at(i)") : variableName;
+
+        QString value;
+        if (!isAny && !elem.nillable() && mTypeMap.isBuiltinType(elemType)) {
+            value = mTypeMap.serializeBuiltinValue(elemType, QName(), localVariableName);
+        }
+        const bool writeComplex = value.isEmpty() && !isAny && !usePointer && !elem.nillable() && !elem.hasSubstitutions()
+                                  && mTypeMap.isComplexType(elemType) && !mTypeMap.isPolymorphic(elemType)
+                                  && !NSManager::soapEncNamespaces().contains(elemType.nameSpace());
+
+        if (value.isEmpty() && !writeComplex) {
+            // Same as in serialize(), into a KDSoapValueList which is then written out
+            usesFallback = true;
+            const QName qualName = elem.qualifiedName();
+            ElementArgumentSerializer serializer(mTypeMap, elemType, QName(), variableName);
+            serializer.setOutputVariable("_fallbackValues", true);
+            serializer.setIsQualified(elem.isQualified());
+            serializer.setNillable(elem.nillable());
+            serializer.setContentTypeVariable(contentTypeMember(elem));
+            if (isList) {
+                elementsCode += QLatin1String("for (int i = 0; i < ") + variableName + QLatin1String(".count(); ++i) {") + COMMENT;
+                elementsCode.indent();
+                serializer.setLocalVariableName(localVariableName);
+                serializer.setOmitIfEmpty(false);
+            } else {
+                serializer.setOmitIfEmpty(optional);
+                serializer.setUsePointer(usePointer);
+            }
+            if (elem.hasSubstitutions()) {
+                serializer.setDynamicElementName(localVariableName + "->_kd_substitutionElementName()",
+                                                 localVariableName + "->_kd_substitutionElementNameSpace()",
+                                                 qualName);
+            } else {
+                serializer.setElementName(qualName);
+            }
+            elementsCode.addBlock(serializer.generate());
+            if (isList) {
+                elementsCode.unindent();
+                elementsCode += "}";
+            }
+            elementsCode += QLatin1String("KDSoapBodyWriter::writeValues(writer, namespacePrefixes, _fallbackValues);") + COMMENT;
+            elementsCode += "_fallbackValues.clear();";
+            continue;
+        }
+
+        if (isList) {
+            elementsCode += QLatin1String("for (int i = 0; i < ") + variableName + QLatin1String(".count(); ++i) {") + COMMENT;
+            elementsCode.indent();
+        } else if (optional) {
+            elementsCode += QLatin1String("if (!") + variableName + QLatin1String("_nil) {");
+            elementsCode.indent();
+        }
+        const QString qualified = isSerializedQualified(elem) ? QLatin1String("true") : QLatin1String("false");
+        elementsCode += QLatin1String("KDSoapBodyWriter::writeStartElement(writer, namespacePrefixes, ") + namespaceString(elem.qualifiedName().nameSpace())
+                        + QLatin1String(", QString::fromLatin1(\"") + elemName + QLatin1String("\"), ") + qualified + QLatin1String(");") + COMMENT;
+        const QString encoded = writeComplex ? QString() : mTypeMap.encodeBinaryBuiltin(elemType, QName(), localVariableName);
+        if (writeComplex) {
+            elementsCode += localVariableName + QLatin1String(".writeTo(writer, namespacePrefixes);");
+        } else if (mTypeMap.isBase64Binary(elemType)) {
+            const QString contentTypeVariable = contentTypeMember(elem);
+            elementsCode += QLatin1String("KDSoapBodyWriter::writeBase64Binary(writer, ") + localVariableName
+                            + (contentTypeVariable.isEmpty() ? QString() : QLatin1String(", ") + contentTypeVariable) + QLatin1String(");");
+        } else if (!encoded.isEmpty()) {
+            elementsCode += QLatin1String("KDSoapBodyWriter::writeEncodedBinary(writer, ") + encoded + QLatin1String(");");
+        } else {
+            elementsCode += QLatin1String("KDSoapBodyWriter::writeText(writer, ") + value + QLatin1String(", ") + namespaceString(elemType.nameSpace())
+                            + QLatin1String(", QString::fromLatin1(\"") + elemType.localName() + QLatin1String("\"));");
+        }
+        elementsCode += "writer.writeEndElement();";
+        if (isList || optional) {
+            elementsCode.unindent();
+            elementsCode += "}";
+        }
+    }
+
+    if (usesFallback) {
+        code += QLatin1String("KDSoapValueList _fallbackValues;") + COMMENT;
+    }
+    code.addBlock(elementsCode);
+
+    writeFunc.setBody(code);
+    newClass.addFunction(writeFunc);
+}
@@ -38,9 +38,39 @@ void Converter::convertServerService()
             serverClass.addHeaderInclude("QtCore/QObject");
             serverClass.addHeaderInclude("KDSoapServer/KDSoapServerObjectInterface.h");
 
+            serverClass.addInclude("KDSoapClient/KDSoapBinaryCodec.h");
+            serverClass.addInclude("KDSoapClient/KDSoapNumericCodec.h");
+            serverClass.addInclude("KDSoapClient/KDDateTime.h");
+
             serverClass.addDeclarationMacro("Q_OBJECT");
             serverClass.addDeclarationMacro("Q_INTERFACES(KDSoapServerObjectInterface)");
 
+            if (Settings::self()->generateDirectWriting()) {
+                serverClass.addInclude("KDSoapClient/KDSoapBodyWriter.h");
+            }
+
+            const bool directParsing = Settings::self()->generateDirectParsing();
+            KODE::Code parseBodyCode;
+            if (directParsing) {
+                // The request is parsed by parseBody() into mDirectRequest<Element>, then used by processRequest()
+                serverClass.addBaseClass(KODE::Class(QLatin1String("KDSoapBodyParser")));
+                serverClass.addHeaderInclude("KDSoapClient/KDSoapBodyParser.h");
+                serverClass.addInclude("QtCore/QXmlStreamReader");
+                serverClass.addMemberVariable(KODE::MemberVariable("directParsedElement", "QString"));
+
+                KODE::Function requestBodyParserMethod(QString::fromLatin1("requestBodyParser"), QString::fromLatin1("KDSoapBodyParser *"));
+                requestBodyParserMethod.addArgument("const QByteArray& _soapAction");
+                KODE::Code code;
+                code += "Q_UNUSED(_soapAction);";
+                code += "mDirectParsedElement.clear();";
+                code += "return this;";
+                requestBodyParserMethod.setBody(code);
+                serverClass.addFunction(requestBodyParserMethod);
+
+                parseBodyCode += "const QStringRef _name = _reader.name();";
+                parseBodyCode += "const QStringRef _namespaceUri = _reader.namespaceUri();";
+            }
+
             KODE::Function processRequestMethod(QString::fromLatin1("processRequest"), QString::fromLatin1("void"));
             processRequestMethod.addArgument("const KDSoapMessage &_request");
             processRequestMethod.addArgument("KDSoapMessage &_response");
@@ -49,11 +79,13 @@ void Converter::convertServerService()
             KODE::Code body;
             const QString responseNs = mWSDL.definitions().targetNamespace();
             body.addLine("setResponseNamespace(QLatin1String(\"" + responseNs + "\"));" + COMMENT);
-            body.addLine("const QByteArray method = _request.name().toLatin1();");
 
             PortType portType = mWSDL.findPortType(binding.portTypeName());
             //qDebug() << portType.name();
-            bool first = true;
+            QStringList operationNames;
+            QStringList soapActions;
+            QStringList handlers;
+            bool hasSoapActions = false;
             const Operation::List operations = portType.operations();
             Q_FOREACH (const Operation &operation, operations) {
                 const Operation::OperationType opType = operation.operationType();
@@ -62,32 +94,76 @@ void Converter::convertServerService()
                 case Operation::RequestResponseOperation: // the standard case
                 case Operation::SolicitResponseOperation:
                 case Operation::NotificationOperation:
-                    generateServerMethod(body, binding, operation, serverClass, first);
+                    handlers += generateServerMethod(binding, operation, serverClass);
+                    operationNames += operation.name();
+                    soapActions += soapActionForOperation(binding, operation);
+                    hasSoapActions = hasSoapActions || !soapActions.last().isEmpty();
+                    if (directParsing) {
+                        generateServerParseBody(parseBodyCode, binding, operation, serverClass);
+                    }
                     break;
                 }
-                first = false;
             }
 
-            if (!first) {
-                body += "else {";
+            if (!handlers.isEmpty()) {
+                // Lookup table built at compile time, indexed by the position of the operation name
+                // (or of the soap action) found by the switches below.
+                body += "typedef void (" + className + "::*RequestMethod)(const KDSoapMessage &, KDSoapMessage &);";
+                body += "static const RequestMethod s_requestMethods[" + QString::number(handlers.count()) + "] = {";
                 body.indent();
-            }
-            body += "KDSoapServerObjectInterface::processRequest(_request, _response, _soapAction);"  + COMMENT;
-            if (!first) {
+                for (int i = 0; i < handlers.count(); ++i) {
+                    body += "&" + className + "::" + handlers.at(i) + (i < handlers.count() - 1 ? "," : "");
+                }
+                body.unindent();
+                body += "};";
+                body += "const QString method = _request.name();";
+                body += "int _index = -1;";
+                body.addBlock(nameIndexSwitch(QLatin1String("method"), operationNames, QLatin1String("_index")));
+                if (hasSoapActions) {
+                    body += "if (_index == -1 && !_soapAction.isEmpty()) {";
+                    body.indent();
+                    body.addBlock(nameIndexSwitch(QLatin1String("_soapAction"), soapActions, QLatin1String("_index"), true));
+                    body.unindent();
+                    body += "}";
+                }
+                body += "if (_index != -1) {";
+                body.indent();
+                body += "(this->*s_requestMethods[_index])(_request, _response);" + COMMENT;
+                body += "return;";
                 body.unindent();
                 body += "}";
             }
+            body += "KDSoapServerObjectInterface::processRequest(_request, _response, _soapAction);"  + COMMENT;
             processRequestMethod.setBody(body);
 
             serverClass.addFunction(processRequestMethod);
 
+            if (directParsing) {
+                KODE::Function parseBodyMethod(QString::fromLatin1("parseBody"), QString::fromLatin1("bool"));
+                parseBodyMethod.addArgument("QXmlStreamReader& _reader");
+                parseBodyCode += "return false;" + COMMENT; // not handled, parse into a KDSoapMessage
+                parseBodyMethod.setBody(parseBodyCode);
+                serverClass.addFunction(parseBodyMethod);
+            }
+
             mServerClasses.addClass(serverClass);
         }
     }
 }
 
-void Converter::generateServerMethod(KODE::Code &code, const Binding &binding, const Operation &operation, KODE::Class &newClass, bool first)
+QString Converter::soapActionForOperation(const Binding &binding, const Operation &operation) const
 {
+    if (binding.type() == Binding::SOAPBinding) {
+        const SoapBinding soapBinding(binding.soapBinding());
+        return soapBinding.operations().value(operation.name()).action();
+    }
+    return QString();
+}
+
+// Generates the private method which handles requests for this operation, and returns its name
+QString Converter::generateServerMethod(const Binding &binding, const Operation &operation, KODE::Class &newClass)
+{
+    KODE::Code code;
     const QString requestVarName = "_request";
     const QString responseVarName = "_response";
 
@@ -103,17 +179,6 @@ void Converter::generateServerMethod(KODE::Code &code, const Binding &binding, c
     KODE::Function virtualMethod(methodName);
     virtualMethod.setVirtualMode(KODE::Function::PureVirtual);
 
-    QString condition = "method == \"" + operationName + "\"";
-    if (binding.type() == Binding::SOAPBinding) {
-        const SoapBinding soapBinding(binding.soapBinding());
-        const SoapBinding::Operation op = soapBinding.operations().value(operation.name());
-        if (!op.action().isEmpty()) {
-            condition += " || _soapAction == \"" + op.action() + "\"";
-        }
-    }
-    code += QString(first ? "" : "else ") + "if (" + condition + ") {";
-    code.indent();
-
     QStringList inputVars;
     const Part::List parts = message.parts();
     for (int partNum = 0; partNum < parts.count(); ++partNum) {
@@ -126,6 +191,25 @@ void Converter::generateServerMethod(KODE::Code &code, const Binding &binding, c
 
             code += argType + ' ' + varName + ";" + COMMENT;
 
+            if (canParseDirectly(parts, binding)) {
+                const QString directElement = part.element().localName();
+                code += "if (mDirectParsedElement == QLatin1String(\"" + directElement + "\")) {";
+                code.indent();
+                code += varName + " = " + directRequestMember(directElement) + ";" + COMMENT;
+                code += directRequestMember(directElement) + " = " + argType + "();";
+                code += "mDirectParsedElement.clear();";
+                code.unindent();
+                code += "} else {";
+                code.indent();
+                code.addBlock(demarshalVar(part.type(), part.element(), varName, argType, requestVarName, false, false));
+                code.unindent();
+                code += "}";
+                inputVars += varName;
+                newClass.addIncludes(mTypeMap.headerIncludes(part.type()), mTypeMap.forwardDeclarationsForElement(part.element()));
+                virtualMethod.addArgument(mTypeMap.localInputType(part.type(), part.element()) + ' ' + varName);
+                continue;
+            }
+
             QString soapValueVarName = requestVarName;
             if (soapStyle(binding) == SoapBinding::RPCStyle) {
                 // RPC comes with a wrapper element, dig into it here
@@ -177,7 +261,7 @@ void Converter::generateServerMethod(KODE::Code &code, const Binding &binding, c
 
         // TODO factorize with same code in next method
         if (soapStyle(binding) == SoapBinding::DocumentStyle) {
-            code.addBlock(serializePart(retPart, "ret", responseVarName, false));
+            code.addBlock(serverSerializeDocumentResponse(retPart, binding, responseVarName));
         } else {
             code += QString("KDSoapValue wrapper(\"%1\", QVariant(), \"%2\");").arg(outputMessage.name()).arg(outputMessage.nameSpace());
             code.addBlock(serializePart(retPart, "ret", "wrapper.childValues()", true));
@@ -193,10 +277,80 @@ void Converter::generateServerMethod(KODE::Code &code, const Binding &binding, c
 
         generateDelayedReponseMethod(methodName, retInputType, retPart, newClass, binding, outputMessage);
     }
+
+    newClass.addFunction(virtualMethod);
+
+    // Not processRequest<Op>: an operation named "withPath" would clash with processRequestWithPath()
+    const QString handlerName = QLatin1String("_kd_process") + upperlize(methodName);
+    KODE::Function handler(handlerName, QLatin1String("void"), KODE::Function::Private);
+    handler.addArgument("const KDSoapMessage &" + requestVarName);
+    handler.addArgument("KDSoapMessage &" + responseVarName);
+    KODE::Code handlerCode;
+    if (inputVars.isEmpty()) {
+        handlerCode += "Q_UNUSED(" + requestVarName + ");";
+    }
+    if (outParts.count() != 1) {
+        handlerCode += "Q_UNUSED(" + responseVarName + ");";
+    }
+    handlerCode.addBlock(code);
+    handler.setBody(handlerCode);
+    newClass.addFunction(handler);
+    return handlerName;
+}
+
+QString Converter::directRequestMember(const QString &elementName) const
+{
+    return KODE::MemberVariable::memberVariableName(QLatin1String("directRequest") + upperlize(elementName));
+}
+
+// For -direct-parsing: generates the part of parseBody() which fills the request of this operation
+void Converter::generateServerParseBody(KODE::Code &code, const Binding &binding, const Operation &operation, KODE::Class &newClass)
+{
+    const Message message = mWSDL.findMessage(operation.input().message());
+    const Part::List parts = message.parts();
+    if (!canParseDirectly(parts, binding)) {
+        return;
+    }
+    const Part part = parts.first();
+    const QString argType = mTypeMap.localType(part.type(), part.element());
+    const QString directElement = part.element().localName();
+    const QString member = directRequestMember(directElement);
+    Q_FOREACH (const KODE::MemberVariable &var, newClass.memberVariables()) {
+        if (var.name() == member) {
+            return; // another operation takes the same element
+        }
+    }
+    newClass.addMemberVariable(KODE::MemberVariable(QLatin1String("directRequest") + upperlize(directElement), argType));
+
+    // Same element from another namespace: not this one, as in KDSoapMessageReader
+    code += "if (_name == QLatin1String(\"" + directElement + "\") && _namespaceUri == QLatin1String(\"" + part.element().nameSpace() + "\")) {";
+    code.indent();
+    code += member + " = " + argType + "();";
+    code += member + ".deserialize(_reader);" + COMMENT;
+    code += "mDirectParsedElement = QLatin1String(\"" + directElement + "\");";
+    code += "return true;";
     code.unindent();
     code += "}";
+}
 
-    newClass.addFunction(virtualMethod);
+// With -direct-writing, the response is written by the generated writeTo(), unless the server
+// was configured to use KDSoapMessage::EncodedUse, which needs the KDSoapValue tree for the xsi:type attributes.
+KODE::Code Converter::serverSerializeDocumentResponse(const Part &retPart, const Binding &binding, const QString &responseVarName)
+{
+    if (!canWriteDirectly(Part::List() << retPart, binding)) {
+        return serializePart(retPart, "ret", responseVarName, false);
+    }
+    KODE::Code code;
+    code += "if (" + responseVarName + ".use() == KDSoapMessage::LiteralUse) {";
+    code.indent();
+    code.addBlock(writePartDirectly(retPart, "ret", responseVarName));
+    code.unindent();
+    code += "} else {";
+    code.indent();
+    code.addBlock(serializePart(retPart, "ret", responseVarName, false));
+    code.unindent();
+    code += "}";
+    return code;
 }
 
 void Converter::generateDelayedReponseMethod(const QString &methodName, const QString &retInputType, const Part &retPart, KODE::Class &newClass,
@@ -212,7 +366,7 @@ void Converter::generateDelayedReponseMethod(const QString &methodName, const QS
     code.addLine("KDSoapMessage _response;");
 
     if (soapStyle(binding) == SoapBinding::DocumentStyle) {
-        code.addBlock(serializePart(retPart, "ret", "_response", false));
+        code.addBlock(serverSerializeDocumentResponse(retPart, binding, "_response"));
     } else {
         code += QString("KDSoapValue wrapper(\"%1\", QVariant(), \"%2\");").arg(outputMessage.name()).arg(outputMessage.nameSpace());
         code.addBlock(serializePart(retPart, "ret", "wrapper.childValues()", true));
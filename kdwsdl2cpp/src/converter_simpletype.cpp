@@ -64,6 +64,7 @@ void Converter::convertSimpleType(const XSD::SimpleType *type, const XSD::Simple
             classDocumentation = "This class is a wrapper for an enumeration.\n";
             NameMapper nameMapper;
             QStringList enums = type->facetEnums();
+            enums.removeDuplicates(); // a repeated value would give a repeated enumerator
             for (int i = 0; i < enums.count(); ++i) {
                 enums[ i ] = nameMapper.escape(escapeEnum(enums[ i ]));
             }
@@ -279,6 +280,9 @@ void Converter::convertSimpleType(const XSD::SimpleType *type, const XSD::Simple
 void Converter::createSimpleTypeSerializer(KODE::Class &newClass, const XSD::SimpleType *type, const XSD::SimpleType::List &simpleTypeList)
 {
     const QString typeName = mTypeMap.localType(type->qualifiedName());
+    newClass.addInclude(QLatin1String("KDSoapClient/KDSoapBinaryCodec.h"));
+    newClass.addInclude(QLatin1String("KDSoapClient/KDSoapNumericCodec.h"));
+    newClass.addInclude(QLatin1String("KDSoapClient/KDDateTime.h"));
 
     KODE::Function serializeFunc(QLatin1String("serialize"), QLatin1String("KDSoapValue"));
     serializeFunc.addArgument(QLatin1String("const QString& valueName"));
@@ -291,7 +295,8 @@ void Converter::createSimpleTypeSerializer(KODE::Class &newClass, const XSD::Sim
     case XSD::SimpleType::TypeRestriction:
         // is an enumeration
         if (type->facetType() & XSD::SimpleType::ENUM) {
-            const QStringList enums = type->facetEnums();
+            QStringList enums = type->facetEnums();
+            enums.removeDuplicates(); // as in the class declaration
             NameMapper nameMapper;
             QStringList escapedEnums;
             for (int i = 0; i < enums.count(); ++i) {
@@ -307,7 +312,7 @@ void Converter::createSimpleTypeSerializer(KODE::Class &newClass, const XSD::Sim
                 for (int i = 0; i < enums.count(); ++i) {
                     code += "case " + typeName + "::" + escapedEnums[ i ] + ':';
                     code.indent();
-                    code += "return KDSoapValue(valueName, \"" + enums[i] + "\", " + namespaceString(type->nameSpace()) + ", QString::fromLatin1(\"" + type->name() + "\"));";
+                    code += "return KDSoapValue(valueName, \"" + escapeStringLiteral(enums[i]) + "\", " + namespaceString(type->nameSpace()) + ", QString::fromLatin1(\"" + type->name() + "\"));";
                     code.unindent();
                     /* add a hack for msvc because that one cannot parse switch statements
                        longer than a certain length, so start a new switch statement */
@@ -334,22 +339,20 @@ void Converter::createSimpleTypeSerializer(KODE::Class &newClass, const XSD::Sim
             }
             {
                 KODE::Code code;
-                code += "static const struct { const char* name; Type value; } s_values[" + QString::number(enums.count()) + "] = {";
+                code += "static const Type s_values[" + QString::number(enums.count()) + "] = {";
                 for (int i = 0; i < enums.count(); ++i) {
-                    code += "{ \"" + enums[ i ] + "\", " + typeName + "::" + escapedEnums[ i ] + " }" + (i < enums.count() - 1 ? "," : "");
+                    code += typeName + "::" + escapedEnums[ i ] + (i < enums.count() - 1 ? "," : "");
                 }
                 code += "};";
                 code += "const QString str = mainValue.value().toString();";
-                code += "for ( int i = 0; i < " + QString::number(enums.count()) + "; ++i ) {";
-                code.indent();
-                code += "if (str == QLatin1String(s_values[i].name)) {";
+                code += "int _index = -1;";
+                code.addBlock(nameIndexSwitch(QLatin1String("str"), enums, QLatin1String("_index")));
+                code += "if (_index != -1) {";
                 code.indent();
-                code += variableName + " = s_values[i].value;";
+                code += variableName + " = s_values[_index];";
                 code += "return;";
                 code.unindent();
                 code += "}";
-                code.unindent();
-                code += "}";
                 code += "qDebug(\"Unknown enum value '%s' passed to '" + newClass.name() + "'.\", qPrintable(str) );";
                 deserializeFunc.setBody(code);
             }
@@ -396,6 +399,8 @@ void Converter::createSimpleTypeSerializer(KODE::Class &newClass, const XSD::Sim
             code.unindent();
             if (itemTypeName == "QString") { // special but common case, no conversion needed
                 code += "str += " + variableName + ".at(i);";
+            } else if (!mTypeMap.encodeBinaryBuiltin(baseName, QName(), variableName + ".at(i)").isEmpty()) {
+                code += "str += " + mTypeMap.serializeBuiltinValue(baseName, QName(), variableName + ".at(i)") + ";";
             } else {
                 if (mTypeMap.isBuiltinType(baseName)) { // serialize from int, float, bool, etc.
                     code += "KDSoapValue subValue = " + mTypeMap.serializeBuiltin(baseName, QName(), variableName + ".at(i)", "QString()", QString(), QString()) + ";";
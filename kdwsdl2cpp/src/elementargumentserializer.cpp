@@ -63,6 +63,11 @@ void ElementArgumentSerializer::setUsePointer(bool usePointer)
     mUsePointer = usePointer;
 }
 
+void ElementArgumentSerializer::setContentTypeVariable(const QString &contentTypeVarName)
+{
+    mContentTypeVarName = contentTypeVarName;
+}
+
 KODE::Code ElementArgumentSerializer::generate() const
 {
     Q_ASSERT(!mLocalVarName.isEmpty());
@@ -117,6 +122,9 @@ KODE::Code ElementArgumentSerializer::generate() const
         if (mNillable) {
             block += mValueVarName + QLatin1String(".setNillable(true);");
         }
+        if (!mContentTypeVarName.isEmpty()) {
+            block += mValueVarName + QLatin1String(".setContentType(") + mContentTypeVarName + QLatin1String(");");
+        }
         block += varAndMethodBefore + mValueVarName + varAndMethodAfter + QLatin1String(";") + COMMENT;
 
         if (mAppend && mOmitIfEmpty) {
@@ -78,6 +78,13 @@ public:
      */
     void setUsePointer(bool usePointer);
 
+    /**
+     * @brief sets the variable holding the MIME type of binary data, see KDSoapValue::setContentType()
+     * @param contentTypeVarName the name of a QString variable
+     * The default is empty, i.e. no content type.
+     */
+    void setContentTypeVariable(const QString &contentTypeVarName);
+
     /**
      * The main method: generate!
      * @return the generated code
@@ -93,6 +100,7 @@ private:
     QString mLocalVarName;
     QString mOutputVarName;
     QString mValueVarName;
+    QString mContentTypeVarName;
     bool mAppend;
     bool mIsQualified;
     bool mNillable;
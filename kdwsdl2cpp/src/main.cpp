@@ -58,6 +58,12 @@ static void showHelp(const char *appName)
             "                            use <type> as the getter return value for optional elements.\n"
             "                            <type> can be either raw-pointer, boost-optional or std-optional\n"
             "  -keep-unused-types        keep the wsdl unused types to the cpp generation step\n"
+            "  -direct-parsing           generate deserialize(QXmlStreamReader&) methods, used by the\n"
+            "                            client and server stubs to parse messages without creating\n"
+            "                            intermediate KDSoapValues\n"
+            "  -direct-writing           generate writeTo(QXmlStreamWriter&, ...) methods, used by the\n"
+            "                            client and server stubs to write messages without creating\n"
+            "                            intermediate KDSoapValues\n"
             "  -import-path <importpath> search for files first in this path before\n"
             "                            downloading them. may be specified multiple times.\n"
             "                            the file needs to be located at:\n"
@@ -87,6 +93,8 @@ int main(int argc, char **argv)
     Settings::NSMapping nsmapping; // XML mappings from URL to short code
     Settings::OptionalElementType optionalElementType = Settings::ENone;
     bool keepUnusedTypes = false;
+    bool directParsing = false;
+    bool directWriting = false;
     QStringList importPathList;
     bool useLocalFilesOnly = false;
     bool helpOnMissing = false;
@@ -196,6 +204,10 @@ int main(int argc, char **argv)
             }
         } else if (opt == QLatin1String("-keep-unused-types")) {
             keepUnusedTypes = true;
+        } else if (opt == QLatin1String("-direct-parsing")) {
+            directParsing = true;
+        } else if (opt == QLatin1String("-direct-writing")) {
+            directWriting = true;
         } else if (opt == QLatin1String("-import-path")) {
             ++arg;
             if (!argv[arg]) {
@@ -257,6 +269,8 @@ int main(int argc, char **argv)
     Settings::self()->setNamespaceMapping(nsmapping);
     Settings::self()->setOptionalElementType(optionalElementType);
     Settings::self()->setKeepUnusedTypes(keepUnusedTypes);
+    Settings::self()->setGenerateDirectParsing(directParsing);
+    Settings::self()->setGenerateDirectWriting(directWriting);
     Settings::self()->setImportPathList(importPathList);
     Settings::self()->setUseLocalFilesOnly(useLocalFilesOnly);
     Settings::self()->setHelpOnMissing(helpOnMissing);
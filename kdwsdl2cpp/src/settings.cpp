@@ -44,6 +44,8 @@ Settings::Settings()
     mImpl = false;
     mServer = false;
     mKeepUnusedTypes = false;
+    mGenerateDirectParsing = false;
+    mGenerateDirectWriting = false;
     mOptionalElementType = Settings::ENone;
 }
 
@@ -146,6 +148,26 @@ bool Settings::keepUnusedTypes() const
     return mKeepUnusedTypes;
 }
 
+void Settings::setGenerateDirectParsing(bool b)
+{
+    mGenerateDirectParsing = b;
+}
+
+bool Settings::generateDirectParsing() const
+{
+    return mGenerateDirectParsing;
+}
+
+void Settings::setGenerateDirectWriting(bool b)
+{
+    mGenerateDirectWriting = b;
+}
+
+bool Settings::generateDirectWriting() const
+{
+    return mGenerateDirectWriting;
+}
+
 void Settings::setNamespaceMapping(const NSMapping &namespaceMapping)
 {
     mNamespaceMapping = namespaceMapping;
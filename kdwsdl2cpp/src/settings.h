@@ -63,6 +63,12 @@ public:
     void setKeepUnusedTypes(bool b);
     bool keepUnusedTypes() const;
 
+    void setGenerateDirectParsing(bool b);
+    bool generateDirectParsing() const;
+
+    void setGenerateDirectWriting(bool b);
+    bool generateDirectWriting() const;
+
     // UNUSED
     void setNamespaceMapping(const NSMapping &namespaceMapping);
     NSMapping namespaceMapping() const;
@@ -103,6 +109,8 @@ private:
     bool mServer;
     OptionalElementType mOptionalElementType;
     bool mKeepUnusedTypes;
+    bool mGenerateDirectParsing;
+    bool mGenerateDirectWriting;
     bool mUseLocalFilesOnly;
     bool mHelpOnMissing;
 };
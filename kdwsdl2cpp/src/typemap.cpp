@@ -569,44 +569,138 @@ QString KWSDL::TypeMap::Entry::dumpBools() const
     return lst.join(",");
 }
 
+// Types for which KDSoapNumericCodec has a parse() overload
+static bool isNumericQtType(const QString &qtTypeName)
+{
+    static const char *const s_numericTypes[] = {
+        "int", "unsigned int", "qint64", "quint64", "signed char", "unsigned char", "float", "double", "bool"
+    };
+    static const int s_numTypes = sizeof(s_numericTypes) / sizeof(*s_numericTypes);
+    for (int i = 0; i < s_numTypes; ++i) {
+        if (qtTypeName == QLatin1String(s_numericTypes[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
 QString KWSDL::TypeMap::deserializeBuiltin(const QName &typeName, const QName &elementName, const QString &var, const QString &qtTypeName) const
 {
     const QName type = typeName.isEmpty() ? baseTypeForElement(elementName) : typeName;
     if (type.nameSpace() == XMLSchemaURI && type.localName() == "hexBinary") {
-        return "QByteArray::fromHex(" + var + ".value().toString().toLatin1())";
+        return "KDSoapBinaryCodec::fromHexValue(" + var + ")";
     } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "base64Binary") {
-        return "QByteArray::fromBase64(" + var + ".value().toString().toLatin1())";
+        return "KDSoapBinaryCodec::fromBase64Value(" + var + ")";
     } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "dateTime") {
         Q_ASSERT(qtTypeName == QLatin1String("KDDateTime"));
         return "KDDateTime::fromDateString(" + var + ".value().toString())";
+    } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "date") {
+        return "KDDateTime::dateFromString(" + var + ".value().toString())";
+    } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "time") {
+        return "KDDateTime::timeFromString(" + var + ".value().toString())";
     } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "QName") {
         Q_ASSERT(qtTypeName == QLatin1String("KDQName"));
         return "KDQName::fromSoapValue(" + var + ")";
     } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "anySimpleType") {
         return var + ".value()";
+    } else if (isNumericQtType(qtTypeName)) {
+        return "KDSoapNumericCodec::fromVariant<" + qtTypeName + ">(" + var + ".value())";
     } else {
         return var + ".value().value<" + qtTypeName + ">()";
     }
 }
 
+QString KWSDL::TypeMap::deserializeBuiltinFromText(const QName &typeName, const QName &elementName, const QString &text, const QString &qtTypeName) const
+{
+    // Same conversions as deserializeBuiltin, minus the KDSoapValue
+    const QName type = typeName.isEmpty() ? baseTypeForElement(elementName) : typeName;
+    if (type.nameSpace() == XMLSchemaURI && type.localName() == "hexBinary") {
+        return "KDSoapBinaryCodec::fromHex(" + text + ")";
+    } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "base64Binary") {
+        return "KDSoapBinaryCodec::fromBase64(" + text + ")";
+    } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "dateTime") {
+        Q_ASSERT(qtTypeName == QLatin1String("KDDateTime"));
+        return "KDDateTime::fromDateString(" + text + ")";
+    } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "date") {
+        return "KDDateTime::dateFromString(" + text + ")";
+    } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "time") {
+        return "KDDateTime::timeFromString(" + text + ")";
+    } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "QName") {
+        return QString(); // needs the namespace declarations
+    } else if (type.nameSpace() == XMLSchemaURI && type.localName() == "anySimpleType") {
+        return "QVariant(" + text + ")";
+    } else if (qtTypeName == QLatin1String("QString")) {
+        return text;
+    } else if (isNumericQtType(qtTypeName)) {
+        return "KDSoapNumericCodec::fromText<" + qtTypeName + ">(" + text + ")";
+    } else {
+        return "QVariant(" + text + ").value<" + qtTypeName + ">()";
+    }
+}
+
+QString KWSDL::TypeMap::deserializeBuiltinFromReader(const QName &typeName, const QName &elementName, const QString &reader, const QString &qtTypeName) const
+{
+    const QName type = typeName.isEmpty() ? baseTypeForElement(elementName) : typeName;
+    if (type.nameSpace() == XMLSchemaURI && isNumericQtType(qtTypeName)) {
+        return "KDSoapBodyParser::readNumber<" + qtTypeName + ">(" + reader + ")";
+    }
+    return deserializeBuiltinFromText(typeName, elementName, "KDSoapBodyParser::readText(" + reader + ")", qtTypeName);
+}
+
 QString KWSDL::TypeMap::serializeBuiltin(const QName &baseTypeName, const QName &elementName, const QString &var, const QString &name, const QString &typeNameSpace, const QString &typeName) const
 {
-    QString value;
+    const QName baseType = baseTypeName.isEmpty() ? baseTypeForElement(elementName) : baseTypeName;
+    if (baseType.nameSpace() == XMLSchemaURI && baseType.localName() == "QName") {
+        return var + ".toSoapValue(" + name + ", " + namespaceString(typeNameSpace) + ", QString::fromLatin1(\"" + typeName + "\"))";
+    }
+    if (isBase64Binary(baseTypeName, elementName)) {
+        // Raw bytes: KDSoapValue encodes them while writing, unless they're sent as an MTOM attachment
+        return "KDSoapValue(" + name + ", QVariant(" + var + "), " + namespaceString(typeNameSpace) + ", QString::fromLatin1(\"" + typeName + "\"))";
+    }
+    const QString encoded = encodeBinaryBuiltin(baseTypeName, elementName, var);
+    if (!encoded.isEmpty()) {
+        return "KDSoapValue::fromEncodedBinary(" + name + ", " + encoded + ", " + namespaceString(typeNameSpace) + ", QString::fromLatin1(\"" + typeName + "\"))";
+    }
+    const QString value = serializeBuiltinValue(baseTypeName, elementName, var);
+    return "KDSoapValue(" + name + ", " + value + ", " + namespaceString(typeNameSpace) + ", QString::fromLatin1(\"" + typeName + "\"))";
+}
+
+bool KWSDL::TypeMap::isBase64Binary(const QName &baseTypeName, const QName &elementName) const
+{
+    const QName baseType = baseTypeName.isEmpty() ? baseTypeForElement(elementName) : baseTypeName;
+    return baseType.nameSpace() == XMLSchemaURI && baseType.localName() == "base64Binary";
+}
+
+QString KWSDL::TypeMap::encodeBinaryBuiltin(const QName &baseTypeName, const QName &elementName, const QString &var) const
+{
     const QName baseType = baseTypeName.isEmpty() ? baseTypeForElement(elementName) : baseTypeName;
     // variantToTextValue also has support for calling toHex/toBase64 at runtime, but this fails
     // when the type derives from hexBinary and is named differently, see Telegram testcase.
     if (baseType.nameSpace() == XMLSchemaURI && baseType.localName() == "hexBinary") {
-        value = "QString::fromLatin1(" + var + ".toHex().constData())";
+        return "KDSoapBinaryCodec::toHex(" + var + ")";
     } else if (baseType.nameSpace() == XMLSchemaURI && baseType.localName() == "base64Binary") {
-        value = "QString::fromLatin1(" + var + ".toBase64().constData())";
+        return "KDSoapBinaryCodec::toBase64(" + var + ")";
+    }
+    return QString();
+}
+
+QString KWSDL::TypeMap::serializeBuiltinValue(const QName &baseTypeName, const QName &elementName, const QString &var) const
+{
+    const QName baseType = baseTypeName.isEmpty() ? baseTypeForElement(elementName) : baseTypeName;
+    const QString encoded = encodeBinaryBuiltin(baseTypeName, elementName, var);
+    if (!encoded.isEmpty()) {
+        return "QString::fromLatin1(" + encoded + ".constData())";
     } else if (baseType.nameSpace() == XMLSchemaURI && baseType.localName() == "dateTime") {
-        value = var + ".toDateString()";
+        return var + ".toDateString()";
+    } else if (baseType.nameSpace() == XMLSchemaURI && baseType.localName() == "date") {
+        return "KDDateTime::dateToString(" + var + ")";
+    } else if (baseType.nameSpace() == XMLSchemaURI && baseType.localName() == "time") {
+        return "KDDateTime::timeToString(" + var + ")";
     } else if (baseType.nameSpace() == XMLSchemaURI && baseType.localName() == "QName") {
-        return var + ".toSoapValue(" + name + ", " + namespaceString(typeNameSpace) + ", QString::fromLatin1(\"" + typeName + "\"))";
+        return QString(); // needs a KDSoapValue, see serializeBuiltin
     } else if (baseType.nameSpace() == XMLSchemaURI && baseType.localName() == "anySimpleType") {
-        value = var;
+        return var;
     } else {
-        value = "QVariant::fromValue(" + var + ")";
+        return "QVariant::fromValue(" + var + ")";
     }
-    return "KDSoapValue(" + name + ", " + value + ", " + namespaceString(typeNameSpace) + ", QString::fromLatin1(\"" + typeName + "\"))";
 }
@@ -108,7 +108,32 @@ public:
      * Return C++ code for converting the variant in "var" into the right type.
      */
     QString deserializeBuiltin(const QName &typeName, const QName &elementName, const QString &var, const QString &qtTypeName) const;
+    /**
+     * Return C++ code for converting the XML text in "text" (a QString) into the right type,
+     * or an empty string if this builtin type can't be parsed from text alone (e.g. QName).
+     */
+    QString deserializeBuiltinFromText(const QName &typeName, const QName &elementName, const QString &text, const QString &qtTypeName) const;
+    /**
+     * Return C++ code reading the element the QXmlStreamReader "reader" is positioned on, and converting
+     * its text into the right type, or an empty string if this builtin type can't be parsed from text alone.
+     */
+    QString deserializeBuiltinFromReader(const QName &typeName, const QName &elementName, const QString &reader, const QString &qtTypeName) const;
     QString serializeBuiltin(const QName &baseTypeName, const QName &elementName, const QString &var, const QString &name, const QString &typeNameSpace, const QString &typeName) const;
+    /**
+     * Return C++ code for the QVariant (or QString) holding the value of "var", as put into a KDSoapValue
+     * by serializeBuiltin, or an empty string if this builtin type can't be written as text alone (e.g. QName).
+     * For binary types this is the encoded text as a QString, while serializeBuiltin keeps it as bytes.
+     */
+    QString serializeBuiltinValue(const QName &baseTypeName, const QName &elementName, const QString &var) const;
+    /**
+     * Return C++ code for the QByteArray holding "var" encoded as base64 or hex,
+     * or an empty string if the type isn't based on base64Binary or hexBinary.
+     */
+    QString encodeBinaryBuiltin(const QName &baseTypeName, const QName &elementName, const QString &var) const;
+    /**
+     * Return true if the type is based on base64Binary, whose values can be sent as MTOM attachments.
+     */
+    bool isBase64Binary(const QName &baseTypeName, const QName &elementName = QName()) const;
 
     QString localTypeForAttribute(const QName &typeName) const;
     QStringList headersForAttribute(const QName &typeName) const;
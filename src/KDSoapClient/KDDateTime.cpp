@@ -89,7 +89,99 @@ void KDDateTime::setTimeZone(const QString &timeZone)
     }
 }
 
-KDDateTime KDDateTime::fromDateString(const QString &s)
+// The canonical lexical forms of xsd:dateTime, xsd:date and xsd:time, as written by toDateString and by
+// most other SOAP stacks, are parsed and written by hand, working on the characters directly. Anything else
+// (other fraction lengths, 24:00:00, lenient forms accepted by Qt...) goes through QDateTime, QDate or QTime,
+// as in previous versions.
+
+static inline bool readDigits(const ushort *&p, int count, int *value)
+{
+    int result = 0;
+    for (int i = 0; i < count; ++i, ++p) {
+        const unsigned int digit = unsigned(*p) - '0';
+        if (digit > 9) {
+            return false;
+        }
+        result = result * 10 + int(digit);
+    }
+    *value = result;
+    return true;
+}
+
+// yyyy-MM-dd
+static bool parseDate(const ushort *&p, const ushort *end, QDate *date)
+{
+    int year, month, day;
+    if (end - p < 10 || !readDigits(p, 4, &year) || *p++ != '-' || !readDigits(p, 2, &month) || *p++ != '-' || !readDigits(p, 2, &day)) {
+        return false;
+    }
+    if (!QDate::isValid(year, month, day)) {
+        return false;
+    }
+    *date = QDate(year, month, day);
+    return true;
+}
+
+// hh:mm:ss[.z[z[z]]]
+static bool parseTime(const ushort *&p, const ushort *end, QTime *time)
+{
+    int hour, minute, second;
+    if (end - p < 8 || !readDigits(p, 2, &hour) || *p++ != ':' || !readDigits(p, 2, &minute) || *p++ != ':' || !readDigits(p, 2, &second)) {
+        return false;
+    }
+    int msec = 0;
+    if (p != end && *p == '.') {
+        ++p;
+        int digits = 0;
+        while (p != end && unsigned(*p) - '0' <= 9) {
+            if (++digits > 3) {
+                return false; // rounding is up to Qt
+            }
+            msec = msec * 10 + (*p++ - '0');
+        }
+        if (digits == 0) {
+            return false;
+        }
+        for (; digits < 3; ++digits) {
+            msec *= 10;
+        }
+    }
+    if (!QTime::isValid(hour, minute, second, msec)) {
+        return false; // including 24:00:00
+    }
+    *time = QTime(hour, minute, second, msec);
+    return true;
+}
+
+// Z|(+|-)hh:mm, or nothing
+static bool parseTimeZone(const ushort *p, const ushort *end)
+{
+    if (p == end) {
+        return true;
+    }
+    int offset;
+    if (*p == 'Z') {
+        ++p;
+    } else if ((*p == '+' || *p == '-') && end - p == 6) {
+        ++p;
+        if (!readDigits(p, 2, &offset) || *p++ != ':' || !readDigits(p, 2, &offset)) {
+            return false;
+        }
+    }
+    return p == end;
+}
+
+// yyyy-MM-ddThh:mm:ss[.z[z[z]]][Z|(+|-)hh:mm]
+static bool parseDateTime(const ushort *p, const ushort *end, QDate *date, QTime *time, const ushort **timeZone)
+{
+    if (!parseDate(p, end, date) || p == end || *p++ != 'T' || !parseTime(p, end, time)) {
+        return false;
+    }
+    *timeZone = p;
+    return parseTimeZone(p, end);
+}
+
+static KDDateTime fromDateStringWithQDateTime(const QString &s)
 {
     KDDateTime kdt;
     QString tz;
@@ -110,7 +202,99 @@ KDDateTime KDDateTime::fromDateString(const QString &s)
     return kdt;
 }
 
+KDDateTime KDDateTime::fromDateString(const QString &s)
+{
+    return fromDateString(s.constData(), s.size());
+}
+
+KDDateTime KDDateTime::fromDateString(const QChar *text, int length)
+{
+    const ushort *begin = reinterpret_cast<const ushort *>(text);
+    const ushort *end = begin + length;
+    QDate date;
+    QTime time;
+    const ushort *timeZone;
+    if (!parseDateTime(begin, end, &date, &time, &timeZone)) {
+        return fromDateStringWithQDateTime(QString(text, length));
+    }
+    if (timeZone == end) {
+        KDDateTime kdt(QDateTime(date, time));
+        kdt.setTimeZone(QString());
+        return kdt;
+    }
+    if (*timeZone == 'Z') {
+        KDDateTime kdt(QDateTime(date, time, Qt::UTC));
+        kdt.setTimeZone(QString(QLatin1Char('Z')));
+        return kdt;
+    }
+    KDDateTime kdt(QDateTime(date, time));
+    kdt.setTimeZone(QString(reinterpret_cast<const QChar *>(timeZone), int(end - timeZone)));
+    return kdt;
+}
+
+static inline char *writeDigits(char *p, int value, int count)
+{
+    for (int i = count - 1; i >= 0; --i) {
+        p[i] = char('0' + value % 10);
+        value /= 10;
+    }
+    return p + count;
+}
+
 QString KDDateTime::toDateString() const
+{
+    const QDate date = this->date();
+    const QTime time = this->time();
+    if (!isValid() || date.year() < 1 || date.year() > 9999) {
+        return toDateStringWithQDateTime();
+    }
+    char buffer[32];
+    char *p = writeDigits(buffer, date.year(), 4);
+    *p++ = '-';
+    p = writeDigits(p, date.month(), 2);
+    *p++ = '-';
+    p = writeDigits(p, date.day(), 2);
+    *p++ = 'T';
+    p = writeDigits(p, time.hour(), 2);
+    *p++ = ':';
+    p = writeDigits(p, time.minute(), 2);
+    *p++ = ':';
+    p = writeDigits(p, time.second(), 2);
+    if (time.msec()) {
+        // include milli-seconds
+        *p++ = '.';
+        p = writeDigits(p, time.msec(), 3);
+        return QString::fromLatin1(buffer, int(p - buffer)) + d->mTimeZone;
+    }
+#if QT_VERSION < 0x040800
+    return QString::fromLatin1(buffer, int(p - buffer)) + d->mTimeZone;
+#else
+    // Like Qt::ISODate, which adds the timezone based on the time spec
+    switch (timeSpec()) {
+    case Qt::LocalTime:
+        break;
+    case Qt::UTC:
+        *p++ = 'Z';
+        break;
+#if QT_VERSION >= 0x050200
+    case Qt::OffsetFromUTC: {
+        const int offset = offsetFromUtc();
+        *p++ = offset < 0 ? '-' : '+';
+        const int minutes = qAbs(offset) / 60;
+        p = writeDigits(p, minutes / 60, 2);
+        *p++ = ':';
+        p = writeDigits(p, minutes % 60, 2);
+        break;
+    }
+#endif
+    default:
+        return toDateStringWithQDateTime();
+    }
+    return QString::fromLatin1(buffer, int(p - buffer));
+#endif
+}
+
+QString KDDateTime::toDateStringWithQDateTime() const
 {
     QString str;
     if (time().msec()) {
@@ -125,3 +309,69 @@ QString KDDateTime::toDateString() const
     }
     return str;
 }
+
+QDate KDDateTime::dateFromString(const QString &s)
+{
+    return dateFromString(s.constData(), s.size());
+}
+
+QDate KDDateTime::dateFromString(const QChar *text, int length)
+{
+    const ushort *p = reinterpret_cast<const ushort *>(text);
+    const ushort *end = p + length;
+    QDate date;
+    // The time zone is ignored, as by QDate::fromString
+    if (parseDate(p, end, &date) && parseTimeZone(p, end)) {
+        return date;
+    }
+    return QDate::fromString(QString(text, length), Qt::ISODate);
+}
+
+QString KDDateTime::dateToString(const QDate &date)
+{
+    if (!date.isValid() || date.year() < 1 || date.year() > 9999) {
+        return date.toString(Qt::ISODate);
+    }
+    char buffer[10];
+    char *p = writeDigits(buffer, date.year(), 4);
+    *p++ = '-';
+    p = writeDigits(p, date.month(), 2);
+    *p++ = '-';
+    p = writeDigits(p, date.day(), 2);
+    return QString::fromLatin1(buffer, int(p - buffer));
+}
+
+QTime KDDateTime::timeFromString(const QString &s)
+{
+    return timeFromString(s.constData(), s.size());
+}
+
+QTime KDDateTime::timeFromString(const QChar *text, int length)
+{
+    const ushort *p = reinterpret_cast<const ushort *>(text);
+    const ushort *end = p + length;
+    QTime time;
+    if (parseTime(p, end, &time) && p == end) {
+        return time;
+    }
+    return QTime::fromString(QString(text, length), Qt::ISODate);
+}
+
+QString KDDateTime::timeToString(const QTime &time)
+{
+    if (!time.isValid()) {
+        return time.toString(Qt::ISODate);
+    }
+    char buffer[12];
+    char *p = writeDigits(buffer, time.hour(), 2);
+    *p++ = ':';
+    p = writeDigits(p, time.minute(), 2);
+    *p++ = ':';
+    p = writeDigits(p, time.second(), 2);
+    if (time.msec()) {
+        // include milli-seconds
+        *p++ = '.';
+        p = writeDigits(p, time.msec(), 3);
+    }
+    return QString::fromLatin1(buffer, int(p - buffer));
+}
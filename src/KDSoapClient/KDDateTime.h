@@ -72,12 +72,55 @@ public:
      */
     static KDDateTime fromDateString(const QString &s);
 
+    /**
+     * \overload
+     * Creates a KDDateTime from the \p length characters at \p text, e.g. taken from a QStringRef.
+     * \since 1.8
+     */
+    static KDDateTime fromDateString(const QChar *text, int length);
+
     /**
      * Returns a SOAP-compliant string representation of the date/time object.
      */
     QString toDateString() const;
 
+    /**
+     * Creates a QDate from its xsd:date string representation, e.g. "2011-03-15".
+     * Like QDate::fromString() with Qt::ISODate, which gives the same result, a time zone is ignored.
+     * \since 1.8
+     */
+    static QDate dateFromString(const QString &s);
+    /**
+     * \overload
+     * \since 1.8
+     */
+    static QDate dateFromString(const QChar *text, int length);
+    /**
+     * Returns the xsd:date string representation of \p date, the same as QDate::toString() with Qt::ISODate.
+     * \since 1.8
+     */
+    static QString dateToString(const QDate &date);
+
+    /**
+     * Creates a QTime from its xsd:time string representation, e.g. "12:34:56" or "12:34:56.789".
+     * Gives the same result as QTime::fromString() with Qt::ISODate.
+     * \since 1.8
+     */
+    static QTime timeFromString(const QString &s);
+    /**
+     * \overload
+     * \since 1.8
+     */
+    static QTime timeFromString(const QChar *text, int length);
+    /**
+     * Returns the xsd:time string representation of \p time, with milliseconds if they aren't 0.
+     * \since 1.8
+     */
+    static QString timeToString(const QTime &time);
+
 private:
+    QString toDateStringWithQDateTime() const;
+
     QSharedDataPointer<KDDateTimeData> d;
 };
 
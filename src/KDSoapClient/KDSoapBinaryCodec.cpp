@@ -0,0 +1,587 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+
+#include "KDSoapBinaryCodec.h"
+#include "KDSoapValue.h"
+#include "KDSoapRequestDevice_p.h"
+
+#include <QVariant>
+#include <QAtomicInt>
+
+#include <string.h>
+
+// SSE2 is part of x86-64, AVX2 needs to be checked for at runtime.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define KDSOAP_HAVE_SSE2
+#  include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || __GNUC__ >= 5)
+#  define KDSOAP_HAVE_AVX2
+#  define KDSOAP_AVX2_FUNCTION __attribute__((target("avx2")))
+#  include <cpuid.h>
+#  include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1700 && (defined(_M_X64) || defined(_M_IX86))
+#  define KDSOAP_HAVE_AVX2
+#  define KDSOAP_AVX2_FUNCTION
+#  include <intrin.h>
+#  include <immintrin.h>
+#endif
+
+static const char s_base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char s_hexDigits[] = "0123456789abcdef";
+
+// -1 for characters which are skipped
+static const signed char s_base64Values[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+static const signed char s_hexValues[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+template <typename Char>
+static inline int charValue(const signed char *table, Char ch)
+{
+    const unsigned int c = ch;
+    return c < 256 ? table[c] : -1;
+}
+
+#ifdef KDSOAP_HAVE_AVX2
+
+static bool detectAvx2()
+{
+#if defined(__GNUC__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    const unsigned int osxsaveAndAvx = (1 << 27) | (1 << 28);
+    if ((ecx & osxsaveAndAvx) != osxsaveAndAvx) {
+        return false;
+    }
+    unsigned int xcr0, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+    if ((xcr0 & 6) != 6) { // the OS saves the YMM registers
+        return false;
+    }
+    if (__get_cpuid_max(0, 0) < 7) {
+        return false;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & (1 << 5)) != 0;
+#else
+    int info[4];
+    __cpuid(info, 1);
+    const int osxsaveAndAvx = (1 << 27) | (1 << 28);
+    if ((info[2] & osxsaveAndAvx) != osxsaveAndAvx) {
+        return false;
+    }
+    if ((_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+static QBasicAtomicInt s_avx2 = Q_BASIC_ATOMIC_INITIALIZER(-1); // unknown yet
+
+static bool hasAvx2()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    int avx2 = s_avx2.loadAcquire();
+#else
+    int avx2 = s_avx2;
+#endif
+    if (avx2 == -1) {
+        // Several threads might detect it at first, they all store the same value
+        avx2 = detectAvx2() ? 1 : 0;
+        s_avx2.fetchAndStoreRelease(avx2);
+    }
+    return avx2 == 1;
+}
+
+KDSOAP_AVX2_FUNCTION static inline __m256i loadChars32(const unsigned char *in)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in));
+}
+
+// Characters above 255 saturate to 0 or 255, which are invalid in base64 and hex anyway
+KDSOAP_AVX2_FUNCTION static inline __m256i loadChars32(const unsigned short *in)
+{
+    const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in));
+    const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + 16));
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xD8);
+}
+
+// Base64 with AVX2, following Wojciech Muła and Daniel Lemire,
+// "Faster Base64 Encoding and Decoding using AVX2 Instructions" (2018).
+
+// Encodes 24 bytes into 32 characters at a time, as long as 28 bytes can be read.
+// Returns the number of bytes consumed.
+KDSOAP_AVX2_FUNCTION static int encodeBase64Avx2(const unsigned char *in, int length, char *out)
+{
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                             1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i lut = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+                                         65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    int i = 0;
+    for (; length - i >= 28; i += 24) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 12));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        // Spread each group of 3 bytes over 4 bytes of 6 bits
+        v = _mm256_shuffle_epi8(v, shuffle);
+        const __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        v = _mm256_or_si256(t1, t3);
+        // Translate the 6 bit values to the alphabet
+        __m256i indices = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        indices = _mm256_sub_epi8(indices, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut, indices));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i / 3 * 4), v);
+    }
+    return i;
+}
+
+// Decodes 32 characters into 24 bytes at a time (writing 32 bytes), until a chunk contains
+// a character outside of the alphabet. Returns the number of characters consumed.
+template <typename Char>
+KDSOAP_AVX2_FUNCTION static int decodeBase64Avx2(const Char *in, int length, unsigned char *out)
+{
+    const __m256i lutLow = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lutHigh = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                             0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask2F = _mm256_set1_epi8(0x2f);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    int i = 0;
+    for (; length - i >= 32; i += 32) {
+        __m256i v = loadChars32(in + i);
+        // Validate and translate the characters to 6 bit values
+        __m256i highNibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask2F);
+        const __m256i low = _mm256_shuffle_epi8(lutLow, _mm256_and_si256(v, mask2F));
+        const __m256i high = _mm256_shuffle_epi8(lutHigh, highNibbles);
+        if (!_mm256_testz_si256(low, high)) {
+            break;
+        }
+        const __m256i eq2F = _mm256_cmpeq_epi8(v, mask2F);
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, highNibbles)));
+        // Pack 4 values of 6 bits into 3 bytes
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, pack);
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i / 4 * 3), v);
+    }
+    return i;
+}
+
+// Encodes 32 bytes into 64 digits at a time. Returns the number of bytes consumed.
+KDSOAP_AVX2_FUNCTION static int encodeHexAvx2(const unsigned char *in, int length, char *out)
+{
+    const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                            '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m256i mask0F = _mm256_set1_epi8(0x0f);
+    int i = 0;
+    for (; length - i >= 32; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        const __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask0F));
+        const __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, mask0F));
+        // unpack works within each 128 bit lane
+        const __m256i first = _mm256_unpacklo_epi8(high, low);
+        const __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return i;
+}
+
+// Decodes 32 digits into 16 bytes at a time, until a chunk contains something else than
+// a hexadecimal digit. Returns the number of digits consumed.
+template <typename Char>
+KDSOAP_AVX2_FUNCTION static int decodeHexAvx2(const Char *in, int length, unsigned char *out)
+{
+    int i = 0;
+    for (; length - i >= 32; i += 32) {
+        const __m256i v = loadChars32(in + i);
+        const __m256i digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+        const __m256i letter = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+        if (_mm256_movemask_epi8(_mm256_or_si256(isDigit, isLetter)) != -1) {
+            break;
+        }
+        const __m256i nibbles = _mm256_or_si256(_mm256_and_si256(isDigit, digit),
+                                                _mm256_and_si256(isLetter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+        // Each 16 bit word holds two nibbles, the first one in the low byte
+        const __m256i bytes = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi16(nibbles, 4), _mm256_set1_epi16(0xf0)),
+                                              _mm256_srli_epi16(nibbles, 8));
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(bytes, bytes), 0xD8);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i / 2), _mm256_castsi256_si128(packed));
+    }
+    return i;
+}
+
+#endif // KDSOAP_HAVE_AVX2
+
+#ifdef KDSOAP_HAVE_SSE2
+
+static inline __m128i loadChars16(const unsigned char *in)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+}
+
+static inline __m128i loadChars16(const unsigned short *in)
+{
+    const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 8));
+    return _mm_packus_epi16(first, second);
+}
+
+// SSE2 has no byte shuffle, which base64 needs; hex only needs arithmetic.
+static int encodeHexSse2(const unsigned char *in, int length, char *out)
+{
+    const __m128i mask0F = _mm_set1_epi8(0x0f);
+    int i = 0;
+    for (; length - i >= 16; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), mask0F);
+        __m128i low = _mm_and_si128(v, mask0F);
+        // '0' + n, plus 'a' - '0' - 10 for n > 9
+        high = _mm_add_epi8(_mm_add_epi8(high, _mm_set1_epi8('0')), _mm_and_si128(_mm_cmpgt_epi8(high, _mm_set1_epi8(9)), _mm_set1_epi8(39)));
+        low = _mm_add_epi8(_mm_add_epi8(low, _mm_set1_epi8('0')), _mm_and_si128(_mm_cmpgt_epi8(low, _mm_set1_epi8(9)), _mm_set1_epi8(39)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+    }
+    return i;
+}
+
+template <typename Char>
+static int decodeHexSse2(const Char *in, int length, unsigned char *out)
+{
+    int i = 0;
+    for (; length - i >= 16; i += 16) {
+        const __m128i v = loadChars16(in + i);
+        const __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+        const __m128i letter = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+        if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff) {
+            break;
+        }
+        const __m128i nibbles = _mm_or_si128(_mm_and_si128(isDigit, digit),
+                                             _mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+        const __m128i bytes = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(nibbles, 4), _mm_set1_epi16(0xf0)),
+                                           _mm_srli_epi16(nibbles, 8));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i / 2), _mm_packus_epi16(bytes, bytes));
+    }
+    return i;
+}
+
+#endif // KDSOAP_HAVE_SSE2
+
+// The output buffers have this much room after the actual output, for the SIMD stores
+static const int s_slack = 32;
+
+static int encodeBase64(const unsigned char *in, int length, char *out)
+{
+    int i = 0;
+#ifdef KDSOAP_HAVE_AVX2
+    if (length >= 28 && hasAvx2()) {
+        i = encodeBase64Avx2(in, length, out);
+    }
+#endif
+    char *o = out + i / 3 * 4;
+    for (; length - i >= 3; i += 3) {
+        const unsigned int v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+        *o++ = s_base64Alphabet[v >> 18];
+        *o++ = s_base64Alphabet[(v >> 12) & 0x3f];
+        *o++ = s_base64Alphabet[(v >> 6) & 0x3f];
+        *o++ = s_base64Alphabet[v & 0x3f];
+    }
+    if (length - i == 1) {
+        const unsigned int v = in[i] << 16;
+        *o++ = s_base64Alphabet[v >> 18];
+        *o++ = s_base64Alphabet[(v >> 12) & 0x3f];
+        *o++ = '=';
+        *o++ = '=';
+    } else if (length - i == 2) {
+        const unsigned int v = (in[i] << 16) | (in[i + 1] << 8);
+        *o++ = s_base64Alphabet[v >> 18];
+        *o++ = s_base64Alphabet[(v >> 12) & 0x3f];
+        *o++ = s_base64Alphabet[(v >> 6) & 0x3f];
+        *o++ = '=';
+    }
+    return o - out;
+}
+
+// Same as QByteArray::fromBase64: characters outside of the alphabet (including '=') are skipped.
+template <typename Char>
+static int decodeBase64(const Char *in, int length, unsigned char *out)
+{
+    unsigned char *o = out;
+    unsigned int buffer = 0;
+    int bits = 0;
+    int i = 0;
+#ifdef KDSOAP_HAVE_AVX2
+    const bool avx2 = length >= 32 && hasAvx2();
+    int nextVectorized = 0;
+#endif
+    while (i < length) {
+#ifdef KDSOAP_HAVE_AVX2
+        // Only at a boundary between groups of 4 characters
+        if (avx2 && bits == 0 && i >= nextVectorized && length - i >= 32) {
+            const int done = decodeBase64Avx2(in + i, length - i, o);
+            i += done;
+            o += done / 4 * 3;
+            // The next chunk has something else in it (e.g. a line break), go past it first
+            nextVectorized = i + 32;
+            if (i == length) {
+                break;
+            }
+        }
+#endif
+        const int value = charValue(s_base64Values, in[i++]);
+        if (value < 0) {
+            continue;
+        }
+        buffer = (buffer << 6) | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            *o++ = static_cast<unsigned char>(buffer >> bits);
+            buffer &= (1 << bits) - 1;
+        }
+    }
+    return o - out;
+}
+
+static int encodeHex(const unsigned char *in, int length, char *out)
+{
+    int i = 0;
+#ifdef KDSOAP_HAVE_AVX2
+    if (length >= 32 && hasAvx2()) {
+        i = encodeHexAvx2(in, length, out);
+    }
+#endif
+#ifdef KDSOAP_HAVE_SSE2
+    i += encodeHexSse2(in + i, length - i, out + 2 * i);
+#endif
+    for (; i < length; ++i) {
+        out[2 * i] = s_hexDigits[in[i] >> 4];
+        out[2 * i + 1] = s_hexDigits[in[i] & 0xf];
+    }
+    return 2 * length;
+}
+
+// Same as QByteArray::fromHex: other characters are skipped, and the digits are paired
+// starting from the end, so an odd number of digits gives a first byte from a single digit.
+// That only makes a difference for unusual input, so the common case of an even number of
+// digits and nothing else is decoded from the start, with SIMD. Returns the position of the
+// first byte in out, and sets *size.
+template <typename Char>
+static int decodeHex(const Char *in, int length, unsigned char *out, int *size)
+{
+    if (length % 2 == 0) {
+        int i = 0;
+#ifdef KDSOAP_HAVE_AVX2
+        if (length >= 32 && hasAvx2()) {
+            i = decodeHexAvx2(in, length, out);
+        }
+#endif
+#ifdef KDSOAP_HAVE_SSE2
+        i += decodeHexSse2(in + i, length - i, out + i / 2);
+#endif
+        for (; i < length; i += 2) {
+            const int high = charValue(s_hexValues, in[i]);
+            const int low = charValue(s_hexValues, in[i + 1]);
+            if (high < 0 || low < 0) {
+                break;
+            }
+            out[i / 2] = static_cast<unsigned char>((high << 4) | low);
+        }
+        if (i == length) {
+            *size = length / 2;
+            return 0;
+        }
+    }
+
+    const int end = (length + 1) / 2;
+    int start = end;
+    bool oddDigit = true;
+    for (int i = length - 1; i >= 0; --i) {
+        const int value = charValue(s_hexValues, in[i]);
+        if (value < 0) {
+            continue;
+        }
+        if (oddDigit) {
+            out[--start] = static_cast<unsigned char>(value);
+            oddDigit = false;
+        } else {
+            out[start] |= static_cast<unsigned char>(value << 4);
+            oddDigit = true;
+        }
+    }
+    *size = end - start;
+    return start;
+}
+
+QByteArray KDSoapBinaryCodec::toBase64(const QByteArray &data)
+{
+    QByteArray result;
+    result.resize((data.size() + 2) / 3 * 4 + s_slack);
+    const int size = encodeBase64(reinterpret_cast<const unsigned char *>(data.constData()), data.size(), result.data());
+    result.resize(size);
+    return result;
+}
+
+template <typename Char>
+static QByteArray decodeBase64Chars(const Char *text, int length)
+{
+    QByteArray result;
+    result.resize(length * 3 / 4 + s_slack);
+    const int size = decodeBase64(text, length, reinterpret_cast<unsigned char *>(result.data()));
+    result.resize(size);
+    return result;
+}
+
+QByteArray KDSoapBinaryCodec::fromBase64(const QByteArray &text)
+{
+    return decodeBase64Chars(reinterpret_cast<const unsigned char *>(text.constData()), text.size());
+}
+
+QByteArray KDSoapBinaryCodec::fromBase64(const QString &text)
+{
+    return decodeBase64Chars(reinterpret_cast<const unsigned short *>(text.constData()), text.size());
+}
+
+QByteArray KDSoapBinaryCodec::fromBase64Value(const QVariant &value)
+{
+    if (value.userType() == QVariant::ByteArray) {
+        return fromBase64(value.toByteArray());
+    }
+    return fromBase64(value.toString());
+}
+
+QByteArray KDSoapBinaryCodec::fromBase64Value(const KDSoapValue &value)
+{
+    if (value.binaryDevice()) {
+        return KDSoapRequestDevice::readDevice(value.binaryDevice());
+    }
+    if (value.value().userType() == QVariant::ByteArray && !value.isEncodedBinaryValue()) {
+        return value.value().toByteArray(); // raw bytes, e.g. an MTOM attachment
+    }
+    return fromBase64Value(value.value());
+}
+
+QByteArray KDSoapBinaryCodec::toHex(const QByteArray &data)
+{
+    QByteArray result;
+    result.resize(data.size() * 2 + s_slack);
+    const int size = encodeHex(reinterpret_cast<const unsigned char *>(data.constData()), data.size(), result.data());
+    result.resize(size);
+    return result;
+}
+
+template <typename Char>
+static QByteArray decodeHexChars(const Char *text, int length)
+{
+    QByteArray result;
+    result.resize((length + 1) / 2 + s_slack);
+    int size = 0;
+    const int start = decodeHex(text, length, reinterpret_cast<unsigned char *>(result.data()), &size);
+    if (start > 0) {
+        memmove(result.data(), result.constData() + start, size);
+    }
+    result.resize(size);
+    return result;
+}
+
+QByteArray KDSoapBinaryCodec::fromHex(const QByteArray &text)
+{
+    return decodeHexChars(reinterpret_cast<const unsigned char *>(text.constData()), text.size());
+}
+
+QByteArray KDSoapBinaryCodec::fromHex(const QString &text)
+{
+    return decodeHexChars(reinterpret_cast<const unsigned short *>(text.constData()), text.size());
+}
+
+QByteArray KDSoapBinaryCodec::fromHexValue(const QVariant &value)
+{
+    if (value.userType() == QVariant::ByteArray) {
+        return fromHex(value.toByteArray());
+    }
+    return fromHex(value.toString());
+}
+
+QByteArray KDSoapBinaryCodec::fromHexValue(const KDSoapValue &value)
+{
+    if (value.binaryDevice()) {
+        return KDSoapRequestDevice::readDevice(value.binaryDevice());
+    }
+    if (value.value().userType() == QVariant::ByteArray && !value.isEncodedBinaryValue()) {
+        return value.value().toByteArray();
+    }
+    return fromHexValue(value.value());
+}
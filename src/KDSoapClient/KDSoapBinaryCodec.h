@@ -0,0 +1,100 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPBINARYCODEC_H
+#define KDSOAPBINARYCODEC_H
+
+#include "KDSoapGlobal.h"
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+QT_BEGIN_NAMESPACE
+class QVariant;
+QT_END_NAMESPACE
+class KDSoapValue;
+
+/**
+ * \brief KDSoapBinaryCodec encodes and decodes the base64Binary and hexBinary XML Schema types.
+ *
+ * The results are the same as with QByteArray::toBase64(), QByteArray::fromBase64(),
+ * QByteArray::toHex() and QByteArray::fromHex(): invalid characters (such as line breaks)
+ * are skipped when decoding. However, large payloads are processed with SIMD instructions
+ * when the CPU supports them (SSE2, and AVX2 which is detected at runtime), and the text
+ * can be decoded straight from a QString, without converting it to a QByteArray first.
+ *
+ * This is used by KDSoapValue and by the code generated by kdwsdl2cpp.
+ *
+ * \since 1.8
+ */
+class KDSOAP_EXPORT KDSoapBinaryCodec
+{
+public:
+    /**
+     * Returns \p data encoded as base64, with padding.
+     */
+    static QByteArray toBase64(const QByteArray &data);
+    /**
+     * Returns the data encoded as base64 in \p text.
+     */
+    static QByteArray fromBase64(const QByteArray &text);
+    /**
+     * \overload
+     */
+    static QByteArray fromBase64(const QString &text);
+    /**
+     * Returns the data encoded as base64 in \p value, which can hold a QString or a QByteArray
+     * (see KDSoapValue::isEncodedBinaryValue()).
+     */
+    static QByteArray fromBase64Value(const QVariant &value);
+    /**
+     * Returns the data held by \p value: decoded if it holds base64 text, or as is
+     * if it holds raw bytes (set with KDSoapValue::setValue(), or received as an MTOM attachment).
+     * For a value with a binary device (see KDSoapValue::setBinaryDevice()), the device's data is read into memory.
+     */
+    static QByteArray fromBase64Value(const KDSoapValue &value);
+
+    /**
+     * Returns \p data encoded as lowercase hexadecimal digits.
+     */
+    static QByteArray toHex(const QByteArray &data);
+    /**
+     * Returns the data encoded as hexadecimal digits in \p text.
+     */
+    static QByteArray fromHex(const QByteArray &text);
+    /**
+     * \overload
+     */
+    static QByteArray fromHex(const QString &text);
+    /**
+     * Returns the data encoded as hexadecimal digits in \p value, which can hold a QString or a QByteArray.
+     */
+    static QByteArray fromHexValue(const QVariant &value);
+    /**
+     * Returns the data held by \p value: decoded if it holds hexadecimal text, or as is if it holds raw bytes.
+     */
+    static QByteArray fromHexValue(const KDSoapValue &value);
+
+private:
+    KDSoapBinaryCodec(); // only static methods
+};
+
+#endif // KDSOAPBINARYCODEC_H
@@ -0,0 +1,586 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapBinaryEncoding_p.h"
+#include "KDSoapNamespaceManager.h"
+#include "KDSoapRequestDevice_p.h"
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QXmlStreamReader>
+
+#include <string.h>
+
+static const char s_magic[] = { 'K', 'D', 'S', 'B' };
+static const char s_formatVersion = 1;
+
+enum MessageFlags {
+    FaultFlag = 1,
+    Soap12Flag = 2
+};
+
+enum ValueTag {
+    NullTag = 0,
+    StringTag,
+    Int32Tag,
+    Int64Tag,
+    UInt32Tag,
+    UInt64Tag,
+    FalseTag,
+    TrueTag,
+    DoubleTag,
+    FloatTag,
+    BytesTag,        // raw bytes, then the content type
+    EncodedBytesTag  // base64 or hex text, as in KDSoapValue::setEncodedBinaryValue
+};
+
+// Deeper messages are rejected when reading, rather than overflowing the stack
+static const int s_maxDepth = 512;
+
+static inline quint64 zigzag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+static inline qint64 unzigzag(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+static QString soapEnvelopeNamespace(KDSoap::SoapVersion version)
+{
+    return version == KDSoap::SOAP1_2 ? KDSoapNamespaceManager::soapEnvelope200305() : KDSoapNamespaceManager::soapEnvelope();
+}
+
+class KDSoapBinaryWriter
+{
+public:
+    KDSoapBinaryWriter()
+    {
+        m_strings.insert(QString(), 0); // index 0 is the empty string
+    }
+
+    void writeByte(char byte)
+    {
+        m_data.append(byte);
+    }
+
+    void writeVarint(quint64 value)
+    {
+        char buffer[10];
+        int length = 0;
+        while (value >= 0x80) {
+            buffer[length++] = char((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        buffer[length++] = char(value);
+        m_data.append(buffer, length);
+    }
+
+    void writeFixed(quint64 bits, int size)
+    {
+        char buffer[8];
+        for (int i = 0; i < size; ++i) {
+            buffer[i] = char(bits >> (8 * i));
+        }
+        m_data.append(buffer, size);
+    }
+
+    void writeBytes(const QByteArray &bytes)
+    {
+        writeVarint(bytes.size());
+        m_data.append(bytes);
+    }
+
+    void writeString(const QString &text)
+    {
+        writeBytes(text.toUtf8());
+    }
+
+    // Names, namespaces, types: 0 and the string for new ones, otherwise 1 + the index in the table
+    void writeStringRef(const QString &text)
+    {
+        QHash<QString, int>::const_iterator it = m_strings.constFind(text);
+        if (it != m_strings.constEnd()) {
+            writeVarint(it.value() + 1);
+        } else {
+            writeVarint(0);
+            writeString(text);
+            m_strings.insert(text, m_strings.size());
+        }
+    }
+
+    void writeElement(const KDSoapValue &value, KDSoapValue::Use use, const QString &messageNamespace, bool forceQualified);
+    void writeContents(const KDSoapValue &value, KDSoapValue::Use use, const QString &messageNamespace);
+    void writeVariant(const KDSoapValue &value);
+
+    QByteArray m_data;
+
+private:
+    QHash<QString, int> m_strings;
+};
+
+// Same namespace rules as KDSoapValue::writeElement
+void KDSoapBinaryWriter::writeElement(const KDSoapValue &value, KDSoapValue::Use use, const QString &messageNamespace, bool forceQualified)
+{
+    const QString nameNamespace = value.namespaceUri();
+    if (!nameNamespace.isEmpty() && nameNamespace != messageNamespace) {
+        forceQualified = true;
+    }
+    writeStringRef(value.name());
+    if (value.isQualified() || forceQualified) {
+        writeStringRef(nameNamespace.isEmpty() ? messageNamespace : nameNamespace);
+    } else {
+        writeStringRef(QString());
+    }
+    writeContents(value, use, messageNamespace);
+}
+
+void KDSoapBinaryWriter::writeContents(const KDSoapValue &value, KDSoapValue::Use use, const QString &messageNamespace)
+{
+    // The type is only transmitted where XML would have an xsi:type attribute
+    if (use == KDSoapValue::EncodedUse) {
+        const bool bytes = value.binaryDevice() || (value.value().userType() == QVariant::ByteArray && !value.isEncodedBinaryValue());
+        if (value.type().isEmpty() && bytes) {
+            // The fallback type XML would write, so that both are read back the same way
+            writeStringRef(KDSoapNamespaceManager::xmlSchema2001());
+            writeStringRef(QString::fromLatin1("base64Binary"));
+        } else {
+            writeStringRef(value.typeNs());
+            writeStringRef(value.type());
+        }
+    } else {
+        writeStringRef(QString());
+        writeStringRef(QString());
+    }
+
+    const QXmlStreamNamespaceDeclarations declarations = value.namespaceDeclarations();
+    writeVarint(declarations.count());
+    Q_FOREACH (const QXmlStreamNamespaceDeclaration &declaration, declarations) {
+        writeStringRef(declaration.prefix().toString());
+        writeStringRef(declaration.namespaceUri().toString());
+    }
+
+    writeVariant(value);
+
+    const KDSoapValueList &children = value.childValues();
+    const QList<KDSoapValue> &attributes = children.attributes();
+    writeVarint(attributes.count());
+    Q_FOREACH (const KDSoapValue &attribute, attributes) {
+        writeStringRef(attribute.name());
+        writeString(attribute.textValue());
+    }
+    writeVarint(children.count());
+    Q_FOREACH (const KDSoapValue &child, children) {
+        writeElement(child, use, messageNamespace, false);
+    }
+}
+
+void KDSoapBinaryWriter::writeVariant(const KDSoapValue &value)
+{
+    if (value.binaryDevice()) {
+        writeByte(BytesTag);
+        writeBytes(KDSoapRequestDevice::readDevice(value.binaryDevice()));
+        writeStringRef(value.contentType());
+        return;
+    }
+    const QVariant variant = value.value();
+    if (variant.isNull()) {
+        writeByte(NullTag);
+        return;
+    }
+    if (value.isEncodedBinaryValue()) {
+        writeByte(EncodedBytesTag);
+        writeBytes(variant.toByteArray());
+        return;
+    }
+    switch (variant.userType()) {
+    case QVariant::Int:
+        writeByte(Int32Tag);
+        writeVarint(zigzag(variant.toInt()));
+        return;
+    case QVariant::LongLong:
+        writeByte(Int64Tag);
+        writeVarint(zigzag(variant.toLongLong()));
+        return;
+    case QVariant::UInt:
+        writeByte(UInt32Tag);
+        writeVarint(variant.toUInt());
+        return;
+    case QVariant::ULongLong:
+        writeByte(UInt64Tag);
+        writeVarint(variant.toULongLong());
+        return;
+    case QVariant::Bool:
+        writeByte(variant.toBool() ? TrueTag : FalseTag);
+        return;
+    case QVariant::Double: {
+        const double number = variant.toDouble();
+        quint64 bits;
+        memcpy(&bits, &number, sizeof(bits));
+        writeByte(DoubleTag);
+        writeFixed(bits, 8);
+        return;
+    }
+    case QMetaType::Float: {
+        const float number = variant.value<float>();
+        quint32 bits;
+        memcpy(&bits, &number, sizeof(bits));
+        writeByte(FloatTag);
+        writeFixed(bits, 4);
+        return;
+    }
+    case QVariant::ByteArray:
+        writeByte(BytesTag);
+        writeBytes(variant.toByteArray());
+        writeStringRef(value.contentType());
+        return;
+    default:
+        break;
+    }
+    // Strings, dates, URLs...: the same text as in XML. Empty text gives a null value there.
+    const QString text = KDSoapValue::variantToTextValue(variant, value.typeNs(), value.type());
+    if (text.isEmpty()) {
+        writeByte(NullTag);
+    } else {
+        writeByte(StringTag);
+        writeString(text);
+    }
+}
+
+class KDSoapBinaryReader
+{
+public:
+    KDSoapBinaryReader(const char *data, int size)
+        : m_pos(reinterpret_cast<const uchar *>(data)),
+          m_end(m_pos + size),
+          m_ok(true)
+    {
+        m_strings.append(QString());
+    }
+
+    bool atEnd() const
+    {
+        return m_pos == m_end;
+    }
+
+    bool ok() const
+    {
+        return m_ok;
+    }
+
+    bool fail()
+    {
+        m_ok = false;
+        m_pos = m_end;
+        return false;
+    }
+
+    uchar readByte()
+    {
+        if (m_pos == m_end) {
+            fail();
+            return 0;
+        }
+        return *m_pos++;
+    }
+
+    quint64 readVarint()
+    {
+        quint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uchar byte = readByte();
+            value |= quint64(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        fail();
+        return 0;
+    }
+
+    // For counts: each item takes at least one byte, anything larger than what's left is invalid
+    int readCount()
+    {
+        const quint64 count = readVarint();
+        if (count > quint64(m_end - m_pos)) {
+            fail();
+            return 0;
+        }
+        return int(count);
+    }
+
+    quint64 readFixed(int size)
+    {
+        if (m_end - m_pos < size) {
+            fail();
+            return 0;
+        }
+        quint64 bits = 0;
+        for (int i = 0; i < size; ++i) {
+            bits |= quint64(m_pos[i]) << (8 * i);
+        }
+        m_pos += size;
+        return bits;
+    }
+
+    QByteArray readBytes()
+    {
+        const int size = readCount();
+        const QByteArray bytes(reinterpret_cast<const char *>(m_pos), size);
+        m_pos += size;
+        return bytes;
+    }
+
+    QString readString()
+    {
+        const int size = readCount();
+        const QString text = QString::fromUtf8(reinterpret_cast<const char *>(m_pos), size);
+        m_pos += size;
+        return text;
+    }
+
+    QString readStringRef()
+    {
+        const quint64 ref = readVarint();
+        if (ref == 0) {
+            const QString text = readString();
+            m_strings.append(text);
+            return text;
+        }
+        if (ref > quint64(m_strings.size())) {
+            fail();
+            return QString();
+        }
+        return m_strings.at(int(ref - 1));
+    }
+
+    bool readElement(KDSoapValue *value, const QXmlStreamNamespaceDeclarations &environment, int depth);
+    bool readVariant(KDSoapValue *value);
+
+private:
+    const uchar *m_pos;
+    const uchar *m_end;
+    QVector<QString> m_strings;
+    bool m_ok;
+};
+
+bool KDSoapBinaryReader::readElement(KDSoapValue *value, const QXmlStreamNamespaceDeclarations &environment, int depth)
+{
+    if (depth > s_maxDepth) {
+        return fail();
+    }
+    const QString name = readStringRef();
+    const QString nameNamespace = readStringRef();
+    const QString typeNs = readStringRef();
+    const QString type = readStringRef();
+    *value = KDSoapValue(name, QVariant());
+    value->setNamespaceUri(nameNamespace);
+    if (!type.isEmpty()) {
+        value->setType(typeNs, type);
+    }
+
+    QXmlStreamNamespaceDeclarations declarations;
+    const int declarationCount = readCount();
+    for (int i = 0; i < declarationCount && m_ok; ++i) {
+        const QString prefix = readStringRef();
+        const QString namespaceUri = readStringRef();
+        declarations.append(QXmlStreamNamespaceDeclaration(prefix, namespaceUri));
+    }
+    const QXmlStreamNamespaceDeclarations combinedDeclarations = environment + declarations;
+    value->setNamespaceDeclarations(declarations);
+    value->setEnvironmentNamespaceDeclarations(combinedDeclarations);
+
+    if (!readVariant(value)) {
+        return false;
+    }
+
+    KDSoapValueList &children = value->childValues();
+    const int attributeCount = readCount();
+    for (int i = 0; i < attributeCount && m_ok; ++i) {
+        const QString attributeName = readStringRef();
+        children.attributes().append(KDSoapValue(attributeName, readString()));
+    }
+    const int childCount = readCount();
+    for (int i = 0; i < childCount && m_ok; ++i) {
+        KDSoapValue child;
+        if (!readElement(&child, combinedDeclarations, depth + 1)) {
+            return false;
+        }
+        children.append(child);
+    }
+    return m_ok;
+}
+
+bool KDSoapBinaryReader::readVariant(KDSoapValue *value)
+{
+    switch (readByte()) {
+    case NullTag:
+        break;
+    case StringTag:
+        value->setValue(readString());
+        break;
+    case Int32Tag:
+        value->setValue(int(unzigzag(readVarint())));
+        break;
+    case Int64Tag:
+        value->setValue(qint64(unzigzag(readVarint())));
+        break;
+    case UInt32Tag:
+        value->setValue(uint(readVarint()));
+        break;
+    case UInt64Tag:
+        value->setValue(quint64(readVarint()));
+        break;
+    case FalseTag:
+        value->setValue(false);
+        break;
+    case TrueTag:
+        value->setValue(true);
+        break;
+    case DoubleTag: {
+        const quint64 bits = readFixed(8);
+        double number;
+        memcpy(&number, &bits, sizeof(number));
+        value->setValue(number);
+        break;
+    }
+    case FloatTag: {
+        const quint32 bits = quint32(readFixed(4));
+        float number;
+        memcpy(&number, &bits, sizeof(number));
+        value->setValue(QVariant::fromValue(number));
+        break;
+    }
+    case BytesTag:
+        // Kept raw: KDSoapBinaryCodec::fromBase64Value()/fromHexValue() return the bytes as is,
+        // and the text is only made where it's needed, e.g. when writing the value as XML
+        value->setValue(readBytes());
+        value->setContentType(readStringRef());
+        break;
+    case EncodedBytesTag:
+        value->setEncodedBinaryValue(readBytes());
+        break;
+    default:
+        return fail();
+    }
+    return m_ok;
+}
+
+QByteArray KDSoapBinaryEncoding::contentType()
+{
+    return QByteArray("application/x-kdsoap-binary");
+}
+
+bool KDSoapBinaryEncoding::isBinaryContentType(const QByteArray &contentType)
+{
+    return contentType.startsWith(KDSoapBinaryEncoding::contentType()); //krazy:exclude=strings
+}
+
+bool KDSoapBinaryEncoding::acceptsBinary(const QByteArray &acceptHeader)
+{
+    return acceptHeader.contains(contentType());
+}
+
+bool KDSoapBinaryEncoding::canEncode(const KDSoapMessage &message)
+{
+    return !message.bodyWriter() && !message.hasMessageAddressingProperties();
+}
+
+QByteArray KDSoapBinaryEncoding::encode(const KDSoapMessage &message, const QString &elementName, const QString &messageNamespace,
+                                        const KDSoapHeaders &headers, const QMap<QString, KDSoapMessage> &persistentHeaders,
+                                        KDSoap::SoapVersion version)
+{
+    KDSoapBinaryWriter writer;
+    writer.m_data.append(s_magic, sizeof(s_magic));
+    writer.writeByte(s_formatVersion);
+    writer.writeByte(char((message.isFault() ? FaultFlag : 0) | (version == KDSoap::SOAP1_2 ? Soap12Flag : 0)));
+    writer.writeStringRef(messageNamespace);
+
+    // Like in XML, the header elements are the children of the header messages
+    int headerCount = 0;
+    Q_FOREACH (const KDSoapMessage &header, persistentHeaders) {
+        headerCount += header.childValues().count();
+    }
+    Q_FOREACH (const KDSoapMessage &header, headers) {
+        headerCount += header.childValues().count();
+    }
+    writer.writeVarint(headerCount);
+    Q_FOREACH (const KDSoapMessage &header, persistentHeaders) {
+        Q_FOREACH (const KDSoapValue &child, header.childValues()) {
+            writer.writeElement(child, header.use(), messageNamespace, true);
+        }
+    }
+    Q_FOREACH (const KDSoapMessage &header, headers) {
+        Q_FOREACH (const KDSoapValue &child, header.childValues()) {
+            writer.writeElement(child, header.use(), messageNamespace, true);
+        }
+    }
+
+    if (elementName.isEmpty()) {
+        writer.writeByte(0); // no body element
+    } else {
+        writer.writeByte(1);
+        writer.writeStringRef(elementName);
+        // The message itself is always qualified, see KDSoapMessageWriter
+        writer.writeStringRef(message.isFault() ? soapEnvelopeNamespace(version) : messageNamespace);
+        writer.writeContents(message, message.use(), messageNamespace);
+    }
+    return writer.m_data;
+}
+
+bool KDSoapBinaryEncoding::decode(const QByteArray &data, KDSoapMessage *message, KDSoapHeaders *headers, KDSoap::SoapVersion *version)
+{
+    if (data.size() < int(sizeof(s_magic)) + 2 || memcmp(data.constData(), s_magic, sizeof(s_magic)) != 0
+            || data.at(sizeof(s_magic)) != s_formatVersion) {
+        return false;
+    }
+    KDSoapBinaryReader reader(data.constData() + sizeof(s_magic) + 1, data.size() - int(sizeof(s_magic)) - 1);
+    const uchar flags = reader.readByte();
+    *version = (flags & Soap12Flag) ? KDSoap::SOAP1_2 : KDSoap::SOAP1_1;
+    reader.readStringRef(); // the message namespace, also the namespace of the body element
+
+    // What the XML reader would get from the Envelope element
+    QXmlStreamNamespaceDeclarations environment;
+    environment.append(QXmlStreamNamespaceDeclaration(QString::fromLatin1("soap"), soapEnvelopeNamespace(*version)));
+    environment.append(QXmlStreamNamespaceDeclaration(QString::fromLatin1("soap-enc"), *version == KDSoap::SOAP1_2 ? KDSoapNamespaceManager::soapEncoding200305() : KDSoapNamespaceManager::soapEncoding()));
+    environment.append(QXmlStreamNamespaceDeclaration(QString::fromLatin1("xsd"), KDSoapNamespaceManager::xmlSchema2001()));
+    environment.append(QXmlStreamNamespaceDeclaration(QString::fromLatin1("xsi"), KDSoapNamespaceManager::xmlSchemaInstance2001()));
+
+    const int headerCount = reader.readCount();
+    for (int i = 0; i < headerCount && reader.ok(); ++i) {
+        KDSoapMessage header;
+        if (!reader.readElement(&header, environment, 0)) {
+            return false;
+        }
+        headers->append(header);
+    }
+    const uchar hasBody = reader.readByte();
+    if (hasBody) {
+        if (!reader.readElement(message, environment, 0)) {
+            return false;
+        }
+        if (flags & FaultFlag) {
+            message->setFault(true);
+        }
+    }
+    return reader.ok() && reader.atEnd();
+}
@@ -0,0 +1,68 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPBINARYENCODING_P_H
+#define KDSOAPBINARYENCODING_P_H
+
+#include "KDSoapMessage.h"
+#include "KDSoapClientInterface.h"
+#include <QtCore/QByteArray>
+#include <QtCore/QMap>
+
+/**
+ * \internal
+ * A compact binary alternative to the XML envelope, for messages between KDSoap clients and KDSoap servers.
+ *
+ * Layout: the magic bytes "KDSB", a format version, flags (fault, SOAP version), the message namespace,
+ * the header elements, then the body element, if any. Each element is stored as its name, namespace,
+ * xsi:type and namespace declarations, a typed value, its attributes and its child elements.
+ * Names, namespaces and types are strings from a table built while writing: the first occurrence is written
+ * inline, later ones as varint indexes into the table. Integers are zigzag varints, floating-point values
+ * are little-endian IEEE, binary values are raw bytes.
+ *
+ * The values read back are those the XML reader would give for the same message, except that
+ * numbers and binary data keep their type instead of becoming text.
+ *
+ * Only exported for the server lib.
+ */
+class KDSOAP_EXPORT KDSoapBinaryEncoding
+{
+public:
+    /// The Content-Type of binary messages, also listed in the Accept header of clients supporting it
+    static QByteArray contentType();
+    static bool isBinaryContentType(const QByteArray &contentType);
+    static bool acceptsBinary(const QByteArray &acceptHeader);
+
+    /// False if \p message needs XML: a body writer, WS-Addressing properties
+    static bool canEncode(const KDSoapMessage &message);
+
+    static QByteArray encode(const KDSoapMessage &message, const QString &elementName, const QString &messageNamespace,
+                             const KDSoapHeaders &headers, const QMap<QString, KDSoapMessage> &persistentHeaders,
+                             KDSoap::SoapVersion version);
+    /// \return false if \p data isn't a valid binary message
+    static bool decode(const QByteArray &data, KDSoapMessage *message, KDSoapHeaders *headers, KDSoap::SoapVersion *version);
+
+private:
+    KDSoapBinaryEncoding();
+};
+
+#endif // KDSOAPBINARYENCODING_P_H
@@ -0,0 +1,96 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+
+#include "KDSoapBodyParser.h"
+#include "KDSoapMessageReader_p.h"
+#include "KDSoapBinaryCodec.h"
+
+#include <QXmlStreamReader>
+
+KDSoapBodyParser::~KDSoapBodyParser()
+{
+}
+
+KDSoapValue KDSoapBodyParser::readValue(QXmlStreamReader &reader)
+{
+    return KDSoapMessageReader::parseBodyElement(reader);
+}
+
+QString KDSoapBodyParser::readText(QXmlStreamReader &reader)
+{
+#if QT_VERSION >= 0x040600
+    return reader.readElementText(QXmlStreamReader::SkipChildElements);
+#else
+    QString text;
+    int depth = 1;
+    while (depth > 0 && reader.readNext() != QXmlStreamReader::Invalid) {
+        if (reader.isStartElement()) {
+            ++depth;
+        } else if (reader.isEndElement()) {
+            --depth;
+        } else if (depth == 1 && reader.isCharacters()) {
+            text += reader.text();
+        }
+    }
+    return text;
+#endif
+}
+
+void KDSoapBodyParser::readText(QXmlStreamReader &reader, QVarLengthArray<QChar, 64> &text)
+{
+    // The text of a simple element is usually a single token, which the reader
+    // exposes without a copy: only the array gets filled in.
+    int depth = 1;
+    while (depth > 0 && reader.readNext() != QXmlStreamReader::Invalid) {
+        if (reader.isStartElement()) {
+            ++depth;
+        } else if (reader.isEndElement()) {
+            --depth;
+        } else if (depth == 1 && reader.isCharacters()) {
+            const QStringRef chars = reader.text();
+            text.append(chars.unicode(), chars.size());
+        }
+    }
+}
+
+QByteArray KDSoapBodyParser::readBase64Binary(QXmlStreamReader &reader, QString *contentType)
+{
+    QString text;
+    QByteArray data;
+    bool isAttachment = false;
+    int depth = 1;
+    while (depth > 0 && reader.readNext() != QXmlStreamReader::Invalid) {
+        if (reader.isStartElement()) {
+            if (depth == 1 && KDSoapMessageReader::readBodyXopInclude(reader, &data, contentType)) {
+                isAttachment = true; // positioned on the end of xop:Include
+            } else {
+                ++depth;
+            }
+        } else if (reader.isEndElement()) {
+            --depth;
+        } else if (depth == 1 && reader.isCharacters()) {
+            text += reader.text();
+        }
+    }
+    return isAttachment ? data : KDSoapBinaryCodec::fromBase64(text);
+}
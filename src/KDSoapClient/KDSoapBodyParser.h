@@ -0,0 +1,133 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPBODYPARSER_H
+#define KDSOAPBODYPARSER_H
+
+#include "KDSoapGlobal.h"
+#include "KDSoapValue.h"
+#include "KDSoapNumericCodec.h"
+#include <QtCore/QVarLengthArray>
+
+QT_BEGIN_NAMESPACE
+class QXmlStreamReader;
+QT_END_NAMESPACE
+
+/**
+ * \brief KDSoapBodyParser allows to parse the body of a SOAP message directly from the XML stream.
+ *
+ * By default, the body of every SOAP message is parsed into a tree of KDSoapValue objects,
+ * which the code generated by kdwsdl2cpp then copies into its own typed classes.
+ * A body parser skips that intermediate tree: it is handed the QXmlStreamReader positioned
+ * on the start element of the body contents, and fills its own objects from the token stream.
+ *
+ * kdwsdl2cpp generates code using this class when called with the \c -direct-parsing option.
+ * Faults are never handed to a body parser, they are always parsed into a KDSoapMessage.
+ *
+ * \see KDSoapPendingCall::setBodyParser(), KDSoapClientInterface::call()
+ * \since 1.8
+ */
+class KDSOAP_EXPORT KDSoapBodyParser
+{
+public:
+    virtual ~KDSoapBodyParser();
+
+    /**
+     * Called with \p reader positioned on the start element of the body contents
+     * (e.g. the response element of a document/literal operation).
+     *
+     * An implementation which handles this element must consume it entirely, leaving \p reader
+     * on the matching end element, and return \c true.
+     * An implementation which doesn't handle this element must not read anything from \p reader
+     * and return \c false, the element is then parsed into a KDSoapMessage as usual.
+     */
+    virtual bool parseBody(QXmlStreamReader &reader) = 0;
+
+    /**
+     * Helper for generated code: parses the element \p reader is positioned on into a KDSoapValue,
+     * exactly like the regular message parser would have done.
+     * This is used as a fallback for the parts of a message which are not parsed directly
+     * (polymorphic types, xsd:any, etc.).
+     * On return, \p reader is positioned on the matching end element.
+     */
+    static KDSoapValue readValue(QXmlStreamReader &reader);
+
+    /**
+     * Helper for generated code: returns the text contents of the element \p reader is positioned on,
+     * ignoring any child element. On return, \p reader is positioned on the matching end element.
+     */
+    static QString readText(QXmlStreamReader &reader);
+
+    /**
+     * Helper for generated code: appends the text contents of the element \p reader is positioned on
+     * to \p text, ignoring any child element. Unlike readText(), this doesn't allocate memory
+     * for short values. On return, \p reader is positioned on the matching end element.
+     */
+    static void readText(QXmlStreamReader &reader, QVarLengthArray<QChar, 64> &text);
+
+    /**
+     * Helper for generated code: returns the contents of the element \p reader is positioned on,
+     * converted to the numeric type T (int, qint64, double, bool...) with KDSoapNumericCodec.
+     * On return, \p reader is positioned on the matching end element.
+     */
+    template <typename T> static T readNumber(QXmlStreamReader &reader)
+    {
+        QVarLengthArray<QChar, 64> text;
+        readText(reader, text);
+        return KDSoapNumericCodec::fromText<T>(text.constData(), text.size());
+    }
+
+    /**
+     * Helper for generated code: returns the base64Binary contents of the element \p reader is positioned on,
+     * decoded, or the data of the MTOM attachment it refers to. In that case, \p contentType is set
+     * to the MIME type of the attachment. On return, \p reader is positioned on the matching end element.
+     */
+    static QByteArray readBase64Binary(QXmlStreamReader &reader, QString *contentType = 0);
+};
+
+/**
+ * A KDSoapBodyParser which calls deserialize(QXmlStreamReader &) on an object of type \p T,
+ * typically a class generated by kdwsdl2cpp with the \c -direct-parsing option.
+ * The target object must stay alive until the message has been parsed.
+ * \since 1.8
+ */
+template <typename T>
+class KDSoapTypedBodyParser : public KDSoapBodyParser
+{
+public:
+    explicit KDSoapTypedBodyParser(T *target)
+        : m_target(target)
+    {
+    }
+
+    bool parseBody(QXmlStreamReader &reader)
+    {
+        *m_target = T(); // in case the message is parsed again after a recoverable error
+        m_target->deserialize(reader);
+        return true;
+    }
+
+private:
+    T *m_target;
+};
+
+#endif // KDSOAPBODYPARSER_H
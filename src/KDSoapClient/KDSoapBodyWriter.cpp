@@ -0,0 +1,94 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+
+#include "KDSoapBodyWriter.h"
+#include "KDSoapNamespacePrefixes_p.h"
+#include "KDSoapBinaryCodec.h"
+#include "KDSoapMtom_p.h"
+#include "KDSoapRequestDevice_p.h"
+
+#include <QXmlStreamWriter>
+
+KDSoapBodyWriter::~KDSoapBodyWriter()
+{
+}
+
+void KDSoapBodyWriter::writeStartElement(QXmlStreamWriter &writer, const KDSoapNamespacePrefixes &namespacePrefixes,
+        const QString &nameSpace, const QString &name, bool qualified)
+{
+    // Same logic as KDSoapValue::writeElement
+    const QString messageNamespace = namespacePrefixes.messageNamespace();
+    if (!nameSpace.isEmpty() && nameSpace != messageNamespace) {
+        qualified = true;
+    }
+    if (qualified) {
+        writer.writeStartElement(nameSpace.isEmpty() ? messageNamespace : nameSpace, name);
+    } else {
+        writer.writeStartElement(name);
+    }
+}
+
+void KDSoapBodyWriter::writeText(QXmlStreamWriter &writer, const QVariant &value, const QString &typeNameSpace, const QString &typeName)
+{
+    if (!value.isNull() && !KDSoapValue::writeNumericText(writer, value)) {
+        KDSoapValue::writeText(writer, KDSoapValue::variantToTextValue(value, typeNameSpace, typeName));
+    }
+}
+
+void KDSoapBodyWriter::writeEncodedBinary(QXmlStreamWriter &writer, const QByteArray &encodedData)
+{
+    KDSoapValue::writeEncodedText(writer, encodedData);
+}
+
+void KDSoapBodyWriter::writeBase64Binary(QXmlStreamWriter &writer, const QByteArray &data, const QString &contentType)
+{
+    KDSoapMtomPackage *mtomPackage = KDSoapMtomPackage::current();
+    if (mtomPackage) {
+        mtomPackage->writeInclude(writer, data, contentType);
+    } else {
+        KDSoapValue::writeEncodedText(writer, KDSoapBinaryCodec::toBase64(data));
+    }
+}
+
+void KDSoapBodyWriter::writeBase64Binary(QXmlStreamWriter &writer, QIODevice *device, const QString &contentType)
+{
+    KDSoapRequestDevice::writeBase64Device(writer, device, contentType);
+}
+
+QString KDSoapBodyWriter::textValue(const QVariant &value, const QString &typeNameSpace, const QString &typeName)
+{
+    return KDSoapValue::variantToTextValue(value, typeNameSpace, typeName);
+}
+
+void KDSoapBodyWriter::writeValues(QXmlStreamWriter &writer, KDSoapNamespacePrefixes &namespacePrefixes, const KDSoapValueList &values)
+{
+    const QString messageNamespace = namespacePrefixes.messageNamespace();
+    Q_FOREACH (const KDSoapValue &value, values) {
+        value.writeElement(namespacePrefixes, writer, KDSoapValue::LiteralUse, messageNamespace, false);
+    }
+}
+
+void KDSoapBodyWriter::writeValueContents(QXmlStreamWriter &writer, KDSoapNamespacePrefixes &namespacePrefixes, const KDSoapValue &value)
+{
+    value.writeElementContents(namespacePrefixes, writer, KDSoapValue::LiteralUse, namespacePrefixes.messageNamespace());
+}
@@ -0,0 +1,137 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPBODYWRITER_H
+#define KDSOAPBODYWRITER_H
+
+#include "KDSoapGlobal.h"
+#include "KDSoapValue.h"
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+class QXmlStreamWriter;
+QT_END_NAMESPACE
+class KDSoapNamespacePrefixes;
+
+/**
+ * \brief KDSoapBodyWriter allows to write the body of a SOAP message directly to the XML stream.
+ *
+ * By default, the code generated by kdwsdl2cpp converts its typed classes into a tree of
+ * KDSoapValue objects, which is then written out as XML. A body writer skips that intermediate
+ * tree: once the start element of the body contents has been written, it is handed the
+ * QXmlStreamWriter and writes the attributes and child elements itself.
+ *
+ * A body writer is attached to a message with KDSoapMessage::setBodyWriter().
+ * The name and namespace of the body element are still taken from the KDSoapMessage.
+ *
+ * kdwsdl2cpp generates code using this class when called with the \c -direct-writing option.
+ *
+ * \since 1.8
+ */
+class KDSOAP_EXPORT KDSoapBodyWriter
+{
+public:
+    virtual ~KDSoapBodyWriter();
+
+    /**
+     * Called with the start element of the body contents already written to \p writer.
+     * An implementation writes the attributes and the children of that element,
+     * but not the matching end element.
+     */
+    virtual void writeBody(QXmlStreamWriter &writer, KDSoapNamespacePrefixes &namespacePrefixes) const = 0;
+
+    /**
+     * Helper for generated code: writes the start element of a child element called \p name
+     * in namespace \p nameSpace, qualified the same way KDSoapValue would be.
+     */
+    static void writeStartElement(QXmlStreamWriter &writer, const KDSoapNamespacePrefixes &namespacePrefixes,
+                                  const QString &nameSpace, const QString &name, bool qualified);
+
+    /**
+     * Helper for generated code: writes \p value as the text contents of the current element,
+     * using the same conversion as KDSoapValue. Null values write nothing.
+     */
+    static void writeText(QXmlStreamWriter &writer, const QVariant &value, const QString &typeNameSpace, const QString &typeName);
+
+    /**
+     * Helper for generated code: writes \p encodedData (base64 or hex text) as the text
+     * contents of the current element, without converting it to a QString first.
+     */
+    static void writeEncodedBinary(QXmlStreamWriter &writer, const QByteArray &encodedData);
+
+    /**
+     * Helper for generated code: writes \p data as the base64Binary contents of the current element,
+     * or as an MTOM attachment of type \p contentType when the message is sent with MTOM.
+     */
+    static void writeBase64Binary(QXmlStreamWriter &writer, const QByteArray &data, const QString &contentType = QString());
+
+    /**
+     * Same as above, for data read from \p device, which is streamed when the request is sent.
+     * \sa KDSoapValue::setBinaryDevice()
+     */
+    static void writeBase64Binary(QXmlStreamWriter &writer, QIODevice *device, const QString &contentType = QString());
+
+    /**
+     * Helper for generated code: returns the text representation of \p value,
+     * e.g. for writing an attribute.
+     */
+    static QString textValue(const QVariant &value, const QString &typeNameSpace, const QString &typeName);
+
+    /**
+     * Helper for generated code: writes each value of \p values as a child element,
+     * exactly like the regular message writer would have done.
+     * This is used as a fallback for the parts of a message which are not written directly
+     * (polymorphic types, xsd:any, nillable elements, etc.).
+     */
+    static void writeValues(QXmlStreamWriter &writer, KDSoapNamespacePrefixes &namespacePrefixes, const KDSoapValueList &values);
+
+    /**
+     * Helper for generated code: writes the attributes, children and text of \p value
+     * into the current element, ignoring the name of \p value.
+     */
+    static void writeValueContents(QXmlStreamWriter &writer, KDSoapNamespacePrefixes &namespacePrefixes, const KDSoapValue &value);
+};
+
+/**
+ * A KDSoapBodyWriter which calls writeTo(QXmlStreamWriter &, KDSoapNamespacePrefixes &) on a copy
+ * of an object of type \p T, typically a class generated by kdwsdl2cpp with the \c -direct-writing option.
+ * \since 1.8
+ */
+template <typename T>
+class KDSoapTypedBodyWriter : public KDSoapBodyWriter
+{
+public:
+    explicit KDSoapTypedBodyWriter(const T &source)
+        : m_source(source)
+    {
+    }
+
+    void writeBody(QXmlStreamWriter &writer, KDSoapNamespacePrefixes &namespacePrefixes) const
+    {
+        m_source.writeTo(writer, namespacePrefixes);
+    }
+
+private:
+    const T m_source;
+};
+
+#endif // KDSOAPBODYWRITER_H
@@ -0,0 +1,134 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapCallMetrics_p.h"
+#include <QtNetwork/QNetworkReply>
+
+KDSoapCallTimer::KDSoapCallTimer(QNetworkReply *reply)
+    : QObject(reply),
+      m_requestSent(-1),
+      m_firstByte(-1),
+      m_finished(-1)
+{
+    m_clock.start();
+    connect(reply, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(slotUploadProgress(qint64,qint64)));
+    // The headers, or the first data, whichever comes first
+    connect(reply, SIGNAL(metaDataChanged()), this, SLOT(slotFirstByte()));
+    connect(reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(slotFirstByte()));
+    connect(reply, SIGNAL(readyRead()), this, SLOT(slotFirstByte()));
+    connect(reply, SIGNAL(finished()), this, SLOT(markFinished()));
+    if (reply->isFinished()) {
+        markFinished();
+    }
+}
+
+qint64 KDSoapCallTimer::elapsed() const
+{
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+void KDSoapCallTimer::slotUploadProgress(qint64 bytesSent, qint64 bytesTotal)
+{
+    if (m_requestSent < 0 && m_firstByte < 0 && bytesTotal > 0 && bytesSent == bytesTotal) {
+        m_requestSent = elapsed();
+    }
+}
+
+void KDSoapCallTimer::slotFirstByte()
+{
+    if (m_firstByte < 0) {
+        m_firstByte = elapsed();
+    }
+}
+
+void KDSoapCallTimer::markFinished()
+{
+    if (m_finished < 0) {
+        slotFirstByte();
+        m_finished = elapsed();
+    }
+}
+
+static qint64 KDSoapPendingCall::Timings::*const s_timingFields[] = {
+    &KDSoapPendingCall::Timings::serializationTime,
+    &KDSoapPendingCall::Timings::queueTime,
+    &KDSoapPendingCall::Timings::timeToFirstByte,
+    &KDSoapPendingCall::Timings::downloadTime,
+    &KDSoapPendingCall::Timings::parseTime,
+    &KDSoapPendingCall::Timings::requestSize,
+    &KDSoapPendingCall::Timings::responseSize
+};
+
+KDSoapCallStatistics::Aggregate::Aggregate()
+    : calls(0), faults(0)
+{
+    for (int i = 0; i < TimingCount; ++i) {
+        sums[i] = 0;
+        counts[i] = 0;
+    }
+}
+
+void KDSoapCallStatistics::record(const QString &method, const KDSoapPendingCall::Timings &timings, bool fault)
+{
+    QMutexLocker locker(&m_mutex);
+    Aggregate &aggregate = m_aggregates[method];
+    ++aggregate.calls;
+    if (fault) {
+        ++aggregate.faults;
+    }
+    for (int i = 0; i < TimingCount; ++i) {
+        const qint64 value = timings.*s_timingFields[i];
+        if (value >= 0) {
+            aggregate.sums[i] += value;
+            ++aggregate.counts[i];
+            aggregate.maximum.*s_timingFields[i] = qMax(aggregate.maximum.*s_timingFields[i], value);
+        }
+    }
+}
+
+KDSoapClientInterface::CallStatistics KDSoapCallStatistics::statistics(const QString &method) const
+{
+    KDSoapClientInterface::CallStatistics statistics;
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, Aggregate>::ConstIterator it = m_aggregates.constFind(method);
+    if (it == m_aggregates.constEnd()) {
+        return statistics;
+    }
+    const Aggregate &aggregate = it.value();
+    statistics.calls = aggregate.calls;
+    statistics.faults = aggregate.faults;
+    statistics.maximumTimings = aggregate.maximum;
+    for (int i = 0; i < TimingCount; ++i) {
+        if (aggregate.counts[i] > 0) {
+            statistics.averageTimings.*s_timingFields[i] = aggregate.sums[i] / aggregate.counts[i];
+        }
+    }
+    return statistics;
+}
+
+void KDSoapCallStatistics::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_aggregates.clear();
+}
+
+#include "moc_KDSoapCallMetrics_p.cpp"
@@ -0,0 +1,106 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPCALLMETRICS_P_H
+#define KDSOAPCALLMETRICS_P_H
+
+#include "KDSoapClientInterface.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+
+QT_BEGIN_NAMESPACE
+class QNetworkReply;
+QT_END_NAMESPACE
+
+/**
+ * \internal
+ * Records when the request of a call was uploaded, and when the response started and finished
+ * to arrive, from the signals of its reply. A child object of the reply.
+ * The times are in microseconds since the request was sent, -1 when not known (yet).
+ */
+class KDSoapCallTimer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit KDSoapCallTimer(QNetworkReply *reply);
+
+    qint64 requestSentTime() const
+    {
+        return m_requestSent;
+    }
+    qint64 firstByteTime() const
+    {
+        return m_firstByte;
+    }
+    qint64 finishedTime() const
+    {
+        return m_finished;
+    }
+
+public Q_SLOTS:
+    // Also called when reading the timings, in case the finished() signal of the reply wasn't delivered to us yet
+    void markFinished();
+
+private Q_SLOTS:
+    void slotUploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void slotFirstByte();
+
+private:
+    qint64 elapsed() const;
+
+    QElapsedTimer m_clock;
+    qint64 m_requestSent;
+    qint64 m_firstByte;
+    qint64 m_finished;
+};
+
+/**
+ * \internal
+ * The timings of the calls, aggregated per method.
+ *
+ * Thread-safe: used by asynchronous calls and by the thread of blocking calls.
+ */
+class KDSoapCallStatistics
+{
+public:
+    void record(const QString &method, const KDSoapPendingCall::Timings &timings, bool fault);
+    KDSoapClientInterface::CallStatistics statistics(const QString &method) const;
+    void clear();
+
+private:
+    enum { TimingCount = 7 };
+    struct Aggregate {
+        Aggregate();
+        int calls;
+        int faults;
+        qint64 sums[TimingCount];
+        int counts[TimingCount]; // the calls where it was measured
+        KDSoapPendingCall::Timings maximum;
+    };
+
+    mutable QMutex m_mutex;
+    QHash<QString, Aggregate> m_aggregates;
+};
+
+#endif // KDSOAPCALLMETRICS_P_H
@@ -18,20 +18,38 @@ INSTALLHEADERS = KDSoapMessage.h \
     KDSoapValue.h \
     KDSoapGlobal.h \
     KDSoapJob.h \
+    KDSoapJobQueue.h \
     KDSoapAuthentication.h \
     KDSoapNamespaceManager.h \
     KDSoapSslHandler.h \
     KDDateTime.h \
     KDSoapFaultException.h \
     KDSoapMessageAddressingProperties.cpp \
-    KDSoapEndpointReference.cpp
+    KDSoapEndpointReference.cpp \
+    KDSoapBodyParser.h \
+    KDSoapBodyWriter.h \
+    KDSoapBinaryCodec.h \
+    KDSoapNumericCodec.h
 PRIVATEHEADERS = KDSoapPendingCall_p.h \
     KDSoapPendingCallWatcher_p.h \
     KDSoapClientInterface_p.h \
     KDSoapClientThread_p.h \
     KDSoapMessageReader_p.h \
     KDSoapMessageWriter_p.h \
-    KDSoapNamespacePrefixes_p.h
+    KDSoapNamespacePrefixes_p.h \
+    KDSoapMtom_p.h \
+    KDSoapRequestDevice_p.h \
+    KDSoapBinaryEncoding_p.h \
+    KDSoapInProcess_p.h \
+    KDSoapHttpResponseParser_p.h \
+    KDSoapLocalSocketReply_p.h \
+    KDSoapHttpClient_p.h \
+    KDSoapTimeoutWheel_p.h \
+    KDSoapReplyParser_p.h \
+    KDSoapResponseCache_p.h \
+    KDSoapLoadBalancer_p.h \
+    KDSoapRetry_p.h \
+    KDSoapCallMetrics_p.h
 HEADERS = $$INSTALLHEADERS \
     $$PRIVATEHEADERS \
     KDSoapReplySslHandler_p.h \
@@ -50,12 +68,30 @@ SOURCES = KDSoapMessage.cpp \
     KDSoapNamespacePrefixes.cpp \
     KDDateTime.cpp \
     KDSoapJob.cpp \
+    KDSoapJobQueue.cpp \
     KDSoapSslHandler.cpp \
     KDSoapReplySslHandler.cpp \
     KDSoapFaultException.cpp \
     KDSoapMessageAddressingProperties.cpp \
     KDSoapEndpointReference.cpp \
     KDQName.cpp \
+    KDSoapBodyParser.cpp \
+    KDSoapBodyWriter.cpp \
+    KDSoapBinaryCodec.cpp \
+    KDSoapNumericCodec.cpp \
+    KDSoapMtom.cpp \
+    KDSoapRequestDevice.cpp \
+    KDSoapBinaryEncoding.cpp \
+    KDSoapInProcess.cpp \
+    KDSoapHttpResponseParser.cpp \
+    KDSoapLocalSocketReply.cpp \
+    KDSoapHttpClient.cpp \
+    KDSoapTimeoutWheel.cpp \
+    KDSoapReplyParser.cpp \
+    KDSoapResponseCache.cpp \
+    KDSoapLoadBalancer.cpp \
+    KDSoapRetry.cpp \
+    KDSoapCallMetrics.cpp \
 
 
 DEFINES += KDSOAP_BUILD_KDSOAP_LIB
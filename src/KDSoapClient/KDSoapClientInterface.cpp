@@ -24,6 +24,17 @@
 #include "KDSoapClientInterface_p.h"
 #include "KDSoapNamespaceManager.h"
 #include "KDSoapMessageWriter_p.h"
+#include "KDSoapMtom_p.h"
+#include "KDSoapBinaryEncoding_p.h"
+#include "KDSoapInProcess_p.h"
+#include "KDSoapLocalSocketReply_p.h"
+#include "KDSoapHttpClient_p.h"
+#include "KDSoapTimeoutWheel_p.h"
+#include "KDSoapResponseCache_p.h"
+#include "KDSoapLoadBalancer_p.h"
+#include "KDSoapRetry_p.h"
+#include "KDSoapCallMetrics_p.h"
+#include "KDSoapRequestDevice_p.h"
 #ifndef QT_NO_OPENSSL
 #include "KDSoapSslHandler.h"
 #include "KDSoapReplySslHandler_p.h"
@@ -36,7 +47,8 @@
 #include <QDebug>
 #include <QBuffer>
 #include <QNetworkProxy>
-#include <QTimer>
+#include <QThread>
+#include <QElapsedTimer>
 
 KDSoapClientInterface::KDSoapClientInterface(const QString &endPoint, const QString &messageNamespace)
     : d(new KDSoapClientInterfacePrivate)
@@ -69,7 +81,18 @@ KDSoapClientInterfacePrivate::KDSoapClientInterfacePrivate()
       m_version(KDSoap::SOAP1_1),
       m_style(KDSoapClientInterface::RPCStyle),
       m_ignoreSslErrors(false),
-      m_timeout(30 * 60 * 1000) // 30 minutes, as documented
+      m_timeout(30 * 60 * 1000), // 30 minutes, as documented
+      m_mtomEnabled(false),
+      m_binaryEncodingEnabled(false),
+      m_binaryPeer(0),
+      m_http2Enabled(false),
+      m_httpEngine(KDSoapClientInterface::QNetworkAccessManagerEngine),
+      m_httpConnectionPool(0),
+      m_backgroundParsingEnabled(false),
+      m_responseCache(KDSoapResponseCache::create()),
+      m_loadBalancer(new KDSoapLoadBalancer),
+      m_retryPolicies(new KDSoapRetryPolicies),
+      m_callStatistics(new KDSoapCallStatistics)
 {
 #ifndef QT_NO_OPENSSL
     m_sslHandler = 0;
@@ -93,10 +116,20 @@ QNetworkAccessManager *KDSoapClientInterfacePrivate::accessManager()
     return m_accessManager;
 }
 
-QNetworkRequest KDSoapClientInterfacePrivate::prepareRequest(const QString &method, const QString &action)
+bool KDSoapClientInterfacePrivate::useBinaryEncoding(const KDSoapMessage &message) const
 {
-    QNetworkRequest request(QUrl(this->m_endPoint));
+    if (!m_binaryEncodingEnabled || !KDSoapBinaryEncoding::canEncode(message) || m_authentication.hasWSUsernameTokenHeader()) {
+        return false;
+    }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return m_binaryPeer.loadAcquire();
+#else
+    return m_binaryPeer;
+#endif
+}
 
+QString KDSoapClientInterfacePrivate::soapAction(const QString &method, const QString &action) const
+{
     QString soapAction = action;
 
     if (soapAction.isNull()) {
@@ -110,6 +143,14 @@ QNetworkRequest KDSoapClientInterfacePrivate::prepareRequest(const QString &meth
         soapAction += method;
     }
     //qDebug() << "soapAction=" << soapAction;
+    return soapAction;
+}
+
+QNetworkRequest KDSoapClientInterfacePrivate::prepareRequest(const QString &method, const QString &action, const KDSoapMtomPackage *mtomPackage, bool binary)
+{
+    QNetworkRequest request(QUrl(this->m_endPoint));
+
+    const QString soapAction = this->soapAction(method, action);
 
     QString soapHeader;
     if (m_version == KDSoap::SOAP1_1) {
@@ -119,7 +160,19 @@ QNetworkRequest KDSoapClientInterfacePrivate::prepareRequest(const QString &meth
         soapHeader += QString::fromLatin1("application/soap+xml;charset=utf-8;action=") + soapAction;
     }
 
-    request.setHeader(QNetworkRequest::ContentTypeHeader, soapHeader.toUtf8());
+    if (binary) {
+        // No envelope to carry the SOAP version or the action, so they go into HTTP headers
+        request.setHeader(QNetworkRequest::ContentTypeHeader, KDSoapBinaryEncoding::contentType());
+        request.setRawHeader("SoapAction", '\"' + soapAction.toUtf8() + '\"');
+    } else if (mtomPackage && mtomPackage->hasAttachments()) {
+        request.setHeader(QNetworkRequest::ContentTypeHeader, mtomPackage->contentType(m_version, soapAction));
+    } else {
+        request.setHeader(QNetworkRequest::ContentTypeHeader, soapHeader.toUtf8());
+    }
+    if (m_binaryEncodingEnabled) {
+        // Lets a KDSoap server reply in the binary encoding, which tells us it can read it too
+        request.setRawHeader("Accept", KDSoapBinaryEncoding::contentType() + ", text/xml, application/soap+xml, multipart/related");
+    }
 
     // FIXME need to find out which version of Qt this is no longer necessary
     // without that the server might respond with gzip compressed data and
@@ -139,41 +192,262 @@ QNetworkRequest KDSoapClientInterfacePrivate::prepareRequest(const QString &meth
     }
 #endif
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    if (m_http2Enabled) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+        request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#else
+        request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif
+        // Without TLS there is no negotiation: the server has to support h2c
+        if (request.url().scheme() == QLatin1String("http")) {
+            request.setAttribute(QNetworkRequest::Http2DirectAttribute, true);
+        }
+    }
+#endif
+
     return request;
 }
 
-QBuffer *KDSoapClientInterfacePrivate::prepareRequestBuffer(const QString &method, const KDSoapMessage &message, const KDSoapHeaders &headers)
+QIODevice *KDSoapClientInterfacePrivate::prepareRequestBuffer(const QString &method, const KDSoapMessage &message, const KDSoapHeaders &headers, KDSoapMtomPackage *mtomPackage, bool binary,
+                                                              qint64 *serializationTime)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QIODevice *buffer = writeRequestBuffer(method, message, headers, mtomPackage, binary);
+    if (serializationTime) {
+        *serializationTime = timer.nsecsElapsed() / 1000;
+    }
+    return buffer;
+}
+
+QIODevice *KDSoapClientInterfacePrivate::writeRequestBuffer(const QString &method, const KDSoapMessage &message, const KDSoapHeaders &headers, KDSoapMtomPackage *mtomPackage, bool binary)
 {
     KDSoapMessageWriter msgWriter;
     msgWriter.setMessageNamespace(m_messageNamespace);
     msgWriter.setVersion(m_version);
-    const QByteArray data = msgWriter.messageToXml(message, (m_style == KDSoapClientInterface::RPCStyle) ? method : QString(), headers, m_persistentHeaders, m_authentication);
+    if (binary) {
+        QBuffer *buffer = new QBuffer;
+        buffer->setData(msgWriter.messageToBinary(message, (m_style == KDSoapClientInterface::RPCStyle) ? method : QString(), headers, m_persistentHeaders));
+        buffer->open(QIODevice::ReadOnly);
+        return buffer;
+    }
+    KDSoapRequestDevice *requestDevice = new KDSoapRequestDevice;
+    if (m_mtomEnabled) {
+        msgWriter.setMtomPackage(mtomPackage);
+    }
+    msgWriter.setRequestDevice(requestDevice);
+    QByteArray data = msgWriter.messageToXml(message, (m_style == KDSoapClientInterface::RPCStyle) ? method : QString(), headers, m_persistentHeaders, m_authentication);
+    if (mtomPackage && mtomPackage->hasAttachments()) {
+        mtomPackage->appendTo(requestDevice, data, m_version);
+    } else {
+        requestDevice->appendXml(data);
+    }
+    if (requestDevice->hasDevices()) {
+        // Binary values from devices: generate the request while it's being sent
+        requestDevice->open(QIODevice::ReadOnly);
+        return requestDevice;
+    }
+    delete requestDevice;
+    if (mtomPackage && mtomPackage->hasAttachments()) {
+        data = mtomPackage->toMultipart(data, m_version);
+    }
     QBuffer *buffer = new QBuffer;
     buffer->setData(data);
     buffer->open(QIODevice::ReadOnly);
     return buffer;
 }
 
+QNetworkReply *KDSoapClientInterfacePrivate::inProcessCall(const QString &method, const KDSoapMessage &message, const QString &action, const KDSoapHeaders &headers)
+{
+    QString messageNamespace = m_messageNamespace;
+    if (!message.namespaceUri().isEmpty()) {
+        messageNamespace = message.namespaceUri();
+    }
+    const QString elementName = (m_style == KDSoapClientInterface::RPCStyle && !method.isEmpty()) ? method : message.name();
+    const KDSoapInProcessCallPtr call(new KDSoapInProcessCall(message, elementName, messageNamespace, headers, m_persistentHeaders,
+                                                              soapAction(method, action).toUtf8(), m_version));
+    return new KDSoapInProcessReply(m_endPoint, call);
+}
+
+QNetworkReply *KDSoapClientInterfacePrivate::post(QNetworkAccessManager *manager, const QNetworkRequest &request, QIODevice *buffer)
+{
+    qint64 ticket = -1;
+    const QString endPoint = m_loadBalancer->startRequest(&ticket);
+    if (ticket < 0) {
+        return post(manager, m_endPoint, request, buffer);
+    }
+    QNetworkRequest balancedRequest = request;
+    balancedRequest.setUrl(QUrl(endPoint));
+    QNetworkReply *reply = post(manager, endPoint, balancedRequest, buffer);
+    new KDSoapLoadBalancerTracker(reply, m_loadBalancer, ticket);
+    return reply;
+}
+
+QNetworkReply *KDSoapClientInterfacePrivate::post(QNetworkAccessManager *manager, const QString &endPoint, const QNetworkRequest &request, QIODevice *buffer)
+{
+    if (KDSoapLocalSocketReply::isLocalSocketEndPoint(endPoint)) {
+        return new KDSoapLocalSocketReply(endPoint, request, buffer);
+    }
+    if (useNativeHttpEngine(endPoint)) {
+        if (!m_httpConnectionPool) {
+            m_httpConnectionPool = new KDSoapHttpConnectionPool(this);
+        }
+        KDSoapHttpReply *reply = new KDSoapHttpReply(m_httpConnectionPool, request, buffer);
+        reply->setAuthentication(m_authentication);
+        return reply;
+    }
+    return manager->post(request, buffer);
+}
+
+QNetworkReply *KDSoapClientInterfacePrivate::cachedPost(QNetworkAccessManager *manager, const QString &method, const QNetworkRequest &request, QIODevice *buffer, bool eventLoop)
+{
+    const int timeToLive = m_responseCache->timeToLive(method);
+    QBuffer *requestBuffer = qobject_cast<QBuffer *>(buffer);
+    // Not for requests with attachments, the MIME boundary is different every time
+    if (timeToLive <= 0 || !requestBuffer || KDSoapMtomPackage::isMultipart(request.header(QNetworkRequest::ContentTypeHeader).toByteArray())) {
+        return retryingPost(manager, method, request, buffer, eventLoop);
+    }
+    const QByteArray key = KDSoapResponseCache::cacheKey(request, requestBuffer->data());
+    bool watch;
+    if (QNetworkReply *reply = m_responseCache->lookup(key, request, eventLoop, &watch)) {
+        return reply;
+    }
+    QNetworkReply *reply = retryingPost(manager, method, request, buffer, eventLoop);
+    if (watch) {
+        m_responseCache->watch(reply, key, timeToLive);
+    }
+    return reply;
+}
+
+QNetworkReply *KDSoapClientInterfacePrivate::retryingPost(QNetworkAccessManager *manager, const QString &method, const QNetworkRequest &request, QIODevice *buffer, bool eventLoop)
+{
+    const KDSoapClientInterface::RetryPolicy policy = m_retryPolicies->policy(method);
+    QBuffer *requestBuffer = qobject_cast<QBuffer *>(buffer);
+    // The request is sent again from its data, so not when it's read from devices
+    if (!eventLoop || !requestBuffer || !policy.idempotent || (policy.maxRetries <= 0 && !policy.hedging)) {
+        return post(manager, request, buffer);
+    }
+    return new KDSoapRetryingReply(this, manager, request, requestBuffer->data(), method, m_retryPolicies);
+}
+
+bool KDSoapClientInterfacePrivate::useNativeHttpEngine(const QString &endPoint) const
+{
+    // The connections belong to this thread
+    return m_httpEngine == KDSoapClientInterface::NativeHttpEngine && QThread::currentThread() == thread()
+           && KDSoapHttpReply::isHttpEndPoint(QUrl(endPoint));
+}
+
+bool KDSoapClientInterfacePrivate::useNativeHttpEngine() const
+{
+    const QStringList balancedEndPoints = m_loadBalancer->endPoints();
+    if (balancedEndPoints.isEmpty()) {
+        return useNativeHttpEngine(m_endPoint);
+    }
+    // Whichever one post() picks
+    Q_FOREACH (const QString &endPoint, balancedEndPoints) {
+        if (!useNativeHttpEngine(endPoint)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray KDSoapClientInterfacePrivate::requestData(QIODevice *device)
+{
+    if (QBuffer *buffer = qobject_cast<QBuffer *>(device)) {
+        return buffer->data();
+    }
+    return static_cast<KDSoapRequestDevice *>(device)->debugData();
+}
+
 KDSoapPendingCall KDSoapClientInterface::asyncCall(const QString &method, const KDSoapMessage &message, const QString &soapAction, const KDSoapHeaders &headers)
 {
-    QBuffer *buffer = d->prepareRequestBuffer(method, message, headers);
-    QNetworkRequest request = d->prepareRequest(method, soapAction);
-    QNetworkReply *reply = d->accessManager()->post(request, buffer);
+    if (KDSoapInProcessReply::isInProcessEndPoint(d->m_endPoint)) {
+        QNetworkReply *reply = d->inProcessCall(method, message, soapAction, headers);
+        d->setupReply(reply);
+        KDSoapPendingCall call(reply, 0);
+        call.d->soapVersion = d->m_version;
+        call.d->startTimings(method, -1, d->m_callStatistics);
+        return call;
+    }
+    KDSoapMtomPackage mtomPackage;
+    const bool binary = d->useBinaryEncoding(message);
+    qint64 serializationTime;
+    QIODevice *buffer = d->prepareRequestBuffer(method, message, headers, &mtomPackage, binary, &serializationTime);
+    QNetworkRequest request = d->prepareRequest(method, soapAction, &mtomPackage, binary);
+    QNetworkReply *reply = d->cachedPost(d->accessManager(), method, request, buffer, true);
     d->setupReply(reply);
-    maybeDebugRequest(buffer->data(), reply->request(), reply);
+    maybeDebugRequest(KDSoapClientInterfacePrivate::requestData(buffer), reply->request(), reply);
     KDSoapPendingCall call(reply, buffer);
     call.d->soapVersion = d->m_version;
+    call.d->startTimings(method, serializationTime, d->m_callStatistics);
+    call.d->clientInterface = d;
+    call.d->parseInBackground = d->m_backgroundParsingEnabled;
     return call;
 }
 
 KDSoapMessage KDSoapClientInterface::call(const QString &method, const KDSoapMessage &message, const QString &soapAction, const KDSoapHeaders &headers)
 {
+    return call(method, message, soapAction, headers, 0);
+}
+
+KDSoapMessage KDSoapClientInterface::call(const QString &method, const KDSoapMessage &message, const QString &soapAction, const KDSoapHeaders &headers,
+                                          KDSoapBodyParser *bodyParser)
+{
+    if (KDSoapInProcessReply::isInProcessEndPoint(d->m_endPoint)
+            && KDSoapInProcessHandler::threadOf(KDSoapInProcessReply::serverName(d->m_endPoint)) == QThread::currentThread()) {
+        // The server would only process the call once this thread is back in its event loop
+        KDSoapMessage ret;
+        ret.createFaultMessage(QString::fromLatin1("Client.Deadlock"),
+                               QString::fromLatin1("Blocking call to an in-process server living in the same thread, use asyncCall()"), d->m_version);
+        d->m_lastResponseHeaders = KDSoapHeaders();
+        return ret;
+    }
+    if (d->useNativeHttpEngine()) {
+        // No secondary thread: the request is sent, and the response read, by blocking on the socket
+        KDSoapHeaders qualifiedHeaders = headers;
+        for (KDSoapHeaders::Iterator it = qualifiedHeaders.begin(); it != qualifiedHeaders.end(); ++it) {
+            it->setQualified(true);
+        }
+        KDSoapMtomPackage mtomPackage;
+        const bool binary = d->useBinaryEncoding(message);
+        qint64 serializationTime;
+        QIODevice *buffer = d->prepareRequestBuffer(method, message, qualifiedHeaders, &mtomPackage, binary, &serializationTime);
+        QNetworkRequest request = d->prepareRequest(method, soapAction, &mtomPackage, binary);
+        // Not waiting for an identical asynchronous call, it would need the event loop
+        QNetworkReply *reply = d->cachedPost(d->accessManager(), method, request, buffer, false);
+        KDSoapHttpReply *httpReply = qobject_cast<KDSoapHttpReply *>(reply);
+        KDSoapCachedReply *cachedReply = qobject_cast<KDSoapCachedReply *>(reply);
+        if (httpReply || cachedReply) {
+            d->setupReply(reply);
+            maybeDebugRequest(KDSoapClientInterfacePrivate::requestData(buffer), reply->request(), reply);
+            KDSoapPendingCall pendingCall(reply, buffer);
+            pendingCall.d->soapVersion = d->m_version;
+            pendingCall.d->clientInterface = d;
+            pendingCall.d->startTimings(method, serializationTime, d->m_callStatistics);
+            if (httpReply) {
+                httpReply->waitForFinished();
+            } else {
+                cachedReply->waitForFinished();
+            }
+            pendingCall.setBodyParser(bodyParser);
+            const KDSoapMessage ret = pendingCall.returnMessage();
+            d->m_lastResponseHeaders = pendingCall.returnHeaders();
+            return ret;
+        }
+        // Any other reply needs the event loop: cancel it, and send the request from the secondary thread instead
+        reply->abort();
+        delete reply;
+        delete buffer;
+    }
     d->accessManager()->cookieJar(); // create it in the right thread, the secondary thread will use it
     // Problem is: I don't want a nested event loop here. Too dangerous for GUI programs.
     // I wanted a socket->waitFor... but we don't have access to the actual socket in QNetworkAccess.
     // So the only option that remains is a thread and acquiring a semaphore...
     KDSoapThreadTaskData *task = new KDSoapThreadTaskData(this, method, message, soapAction, headers);
     task->m_authentication = d->m_authentication;
+    task->m_bodyParser = bodyParser;
     d->m_thread.enqueue(task);
     if (!d->m_thread.isRunning()) {
         d->m_thread.start();
@@ -187,11 +461,18 @@ KDSoapMessage KDSoapClientInterface::call(const QString &method, const KDSoapMes
 
 void KDSoapClientInterface::callNoReply(const QString &method, const KDSoapMessage &message, const QString &soapAction, const KDSoapHeaders &headers)
 {
-    QBuffer *buffer = d->prepareRequestBuffer(method, message, headers);
-    QNetworkRequest request = d->prepareRequest(method, soapAction);
-    QNetworkReply *reply = d->accessManager()->post(request, buffer);
+    if (KDSoapInProcessReply::isInProcessEndPoint(d->m_endPoint)) {
+        QNetworkReply *reply = d->inProcessCall(method, message, soapAction, headers);
+        QObject::connect(reply, SIGNAL(finished()), reply, SLOT(deleteLater()));
+        return;
+    }
+    KDSoapMtomPackage mtomPackage;
+    const bool binary = d->useBinaryEncoding(message);
+    QIODevice *buffer = d->prepareRequestBuffer(method, message, headers, &mtomPackage, binary);
+    QNetworkRequest request = d->prepareRequest(method, soapAction, &mtomPackage, binary);
+    QNetworkReply *reply = d->post(d->accessManager(), request, buffer);
     d->setupReply(reply);
-    maybeDebugRequest(buffer->data(), reply->request(), reply);
+    maybeDebugRequest(KDSoapClientInterfacePrivate::requestData(buffer), reply->request(), reply);
     QObject::connect(reply, SIGNAL(finished()), reply, SLOT(deleteLater()));
     QObject::connect(reply, SIGNAL(finished()), buffer, SLOT(deleteLater()));
 }
@@ -214,6 +495,57 @@ QString KDSoapClientInterface::endPoint() const
 void KDSoapClientInterface::setEndPoint(const QString &endPoint)
 {
     d->m_endPoint = endPoint;
+    d->m_loadBalancer->setEndPoints(QStringList());
+    d->m_binaryPeer.fetchAndStoreRelaxed(0); // might not be a KDSoap server anymore
+}
+
+void KDSoapClientInterface::setEndPoints(const QStringList &endPoints)
+{
+    if (endPoints.isEmpty()) {
+        return;
+    }
+    setEndPoint(endPoints.first());
+    if (endPoints.count() > 1) {
+        d->m_loadBalancer->setEndPoints(endPoints);
+    }
+}
+
+QStringList KDSoapClientInterface::endPoints() const
+{
+    if (d->m_loadBalancer->count() > 0) {
+        return d->m_loadBalancer->endPoints();
+    }
+    return QStringList() << d->m_endPoint;
+}
+
+void KDSoapClientInterface::setLoadBalancing(LoadBalancing strategy)
+{
+    d->m_loadBalancer->setStrategy(strategy);
+}
+
+KDSoapClientInterface::LoadBalancing KDSoapClientInterface::loadBalancing() const
+{
+    return d->m_loadBalancer->strategy();
+}
+
+void KDSoapClientInterface::setEndPointEjection(int consecutiveFailures, int msecs)
+{
+    d->m_loadBalancer->setEjection(consecutiveFailures, msecs);
+}
+
+QStringList KDSoapClientInterface::ejectedEndPoints() const
+{
+    return d->m_loadBalancer->ejectedEndPoints();
+}
+
+void KDSoapClientInterface::setRetryPolicy(const QString &method, const RetryPolicy &policy)
+{
+    d->m_retryPolicies->setPolicy(method, policy);
+}
+
+KDSoapClientInterface::RetryPolicy KDSoapClientInterface::retryPolicy(const QString &method) const
+{
+    return d->m_retryPolicies->policy(method);
 }
 
 void KDSoapClientInterface::setHeader(const QString &name, const KDSoapMessage &header)
@@ -234,35 +566,7 @@ void KDSoapClientInterface::ignoreSslErrors(const QList<QSslError> &errors)
 }
 #endif
 
-// Workaround for lack of connect-to-lambdas in Qt4
-// The pure Qt5 code could read like
-/*
-    QTimer *timeoutTimer = new QTimer(reply);
-    timeoutTimer->setSingleShot(true);
-    connect(timeoutTimer, &QTimer::timeout, reply, [reply]() { contents_of_the_slot });
-*/
-class TimeoutHandler : public QTimer // this way a single QObject is needed
-{
-    Q_OBJECT
-public:
-    TimeoutHandler(QNetworkReply *reply)
-        : QTimer(reply)
-    {
-        setSingleShot(true);
-    }
-public Q_SLOTS:
-    void replyTimeout()
-    {
-        QNetworkReply *reply = qobject_cast<QNetworkReply *>(parent());
-        Q_ASSERT(reply);
-
-        // contents_of_the_slot:
-        reply->setProperty("kdsoap_reply_timed_out", true); // see KDSoapPendingCall.cpp
-        reply->abort();
-    }
-};
-
-void KDSoapClientInterfacePrivate::setupReply(QNetworkReply *reply)
+void KDSoapClientInterfacePrivate::setupReply(QNetworkReply *reply, bool withTimeout)
 {
     if (m_ignoreSslErrors) {
         QObject::connect(reply, SIGNAL(sslErrors(QList<QSslError>)), reply, SLOT(ignoreSslErrors()));
@@ -277,10 +581,12 @@ void KDSoapClientInterfacePrivate::setupReply(QNetworkReply *reply)
         }
 #endif
     }
-    if (m_timeout >= 0) {
-        TimeoutHandler *timeoutHandler = new TimeoutHandler(reply);
-        connect(timeoutHandler, SIGNAL(timeout()), timeoutHandler, SLOT(replyTimeout()));
-        timeoutHandler->start(m_timeout);
+    if (m_timeout >= 0 && withTimeout) {
+        // One timer per thread for all the pending calls
+        KDSoapTimeoutWheel::instance()->add(reply, m_timeout);
+        if (KDSoapHttpReply *httpReply = qobject_cast<KDSoapHttpReply *>(reply)) {
+            httpReply->setTimeout(m_timeout); // for blocking calls, which don't run the event loop
+        }
     }
 }
 
@@ -336,6 +642,96 @@ void KDSoapClientInterface::setTimeout(int msecs)
     d->m_timeout = msecs;
 }
 
+void KDSoapClientInterface::setMtomEnabled(bool enabled)
+{
+    d->m_mtomEnabled = enabled;
+}
+
+bool KDSoapClientInterface::isMtomEnabled() const
+{
+    return d->m_mtomEnabled;
+}
+
+void KDSoapClientInterface::setBinaryEncodingEnabled(bool enabled)
+{
+    d->m_binaryEncodingEnabled = enabled;
+}
+
+bool KDSoapClientInterface::isBinaryEncodingEnabled() const
+{
+    return d->m_binaryEncodingEnabled;
+}
+
+void KDSoapClientInterface::setHttp2Enabled(bool enabled)
+{
+    d->m_http2Enabled = enabled;
+}
+
+bool KDSoapClientInterface::isHttp2Enabled() const
+{
+    return d->m_http2Enabled;
+}
+
+void KDSoapClientInterface::setHttpEngine(HttpEngine engine)
+{
+    d->m_httpEngine = engine;
+}
+
+KDSoapClientInterface::HttpEngine KDSoapClientInterface::httpEngine() const
+{
+    return d->m_httpEngine;
+}
+
+void KDSoapClientInterface::setBackgroundParsingEnabled(bool enabled)
+{
+    d->m_backgroundParsingEnabled = enabled;
+}
+
+bool KDSoapClientInterface::isBackgroundParsingEnabled() const
+{
+    return d->m_backgroundParsingEnabled;
+}
+
+void KDSoapClientInterface::setResponseCacheTimeToLive(const QString &method, int msecs)
+{
+    d->m_responseCache->setTimeToLive(method, msecs);
+}
+
+int KDSoapClientInterface::responseCacheTimeToLive(const QString &method) const
+{
+    return d->m_responseCache->timeToLive(method);
+}
+
+void KDSoapClientInterface::setResponseCacheMaxSize(int bytes)
+{
+    d->m_responseCache->setMaxSize(bytes);
+}
+
+int KDSoapClientInterface::responseCacheMaxSize() const
+{
+    return d->m_responseCache->maxSize();
+}
+
+void KDSoapClientInterface::clearResponseCache()
+{
+    d->m_responseCache->clear();
+}
+
+KDSoapClientInterface::ResponseCacheStatistics KDSoapClientInterface::responseCacheStatistics() const
+{
+    return d->m_responseCache->statistics();
+}
+
+KDSoapClientInterface::CallStatistics KDSoapClientInterface::callStatistics(const QString &method) const
+{
+    return d->m_callStatistics->statistics(method);
+}
+
+void KDSoapClientInterface::resetCallStatistics()
+{
+    d->m_callStatistics->clear();
+}
+
 #ifndef QT_NO_OPENSSL
 QSslConfiguration KDSoapClientInterface::sslConfiguration() const
 {
@@ -357,4 +753,3 @@ KDSoapSslHandler *KDSoapClientInterface::sslHandler() const
 #endif
 
 #include "moc_KDSoapClientInterface_p.cpp"
-#include "KDSoapClientInterface.moc"
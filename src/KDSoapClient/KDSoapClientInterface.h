@@ -25,11 +25,13 @@
 
 #include <QtCore/QtGlobal>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 #include "KDSoapMessage.h"
 #include "KDSoapPendingCall.h"
 
 class KDSoapAuthentication;
 class KDSoapSslHandler;
+class KDSoapBodyParser;
 class KDSoapClientInterfacePrivate;
 QT_BEGIN_NAMESPACE
 class QSslError;
@@ -157,6 +159,20 @@ public:
                        const QString &soapAction = QString(),
                        const KDSoapHeaders &headers = KDSoapHeaders());
 
+    /**
+     * Blocking call, like the above, but hands the contents of the body of the response
+     * to \p bodyParser instead of parsing them into the returned message.
+     * The returned message is either a fault, or an empty message named after the response element.
+     *
+     * This is used by code generated with kdwsdl2cpp -direct-parsing, in order to fill
+     * the generated classes directly from the XML stream.
+     * \see KDSoapBodyParser, KDSoapPendingCall::setBodyParser()
+     * \since 1.8
+     */
+    KDSoapMessage call(const QString &method, const KDSoapMessage &message,
+                       const QString &soapAction, const KDSoapHeaders &headers,
+                       KDSoapBodyParser *bodyParser);
+
     /**
      * Calls the method \p method on this interface and passes the parameters specified in \p message
      * to the method.
@@ -209,10 +225,120 @@ public:
      * Sets the end point of the SOAP service.
      * \param endPoint the URL of the SOAP service, including http or https scheme, port number
      *                 if needed, and path. Example: http://server/path/soap.php
+     *
+     * Since KDSoap 1.8, the endpoint can also be "inproc://name", to call the KDSoapServer of
+     * the same process registered with KDSoapServer::setInProcessName(name). The messages are then
+     * handed over directly, without sockets, HTTP or XML.
+     *
+     * Since KDSoap 1.8, the endpoint can also be "unix://" followed by the path of a Unix domain socket,
+     * optionally followed by ":" and the HTTP path, e.g. "unix:///run/myservice.sock:/soap"
+     * (see KDSoapServer::listenOnLocalSocket). Such requests don't go through QNetworkAccessManager:
+     * the cookie jar, the proxy, SSL and HTTP authentication don't apply to them.
      * \since 1.2
      */
     void setEndPoint(const QString &endPoint);
 
+    /**
+     * Spreads the requests over several replicas of the SOAP service, \p endPoints,
+     * using the strategy set with setLoadBalancing().
+     *
+     * An endpoint failing several requests in a row (see setEndPointEjection()) is ejected:
+     * it doesn't get requests anymore until the ejection time has passed. A single request then
+     * checks it again: it's back if that request succeeds, and ejected again, for twice as long
+     * (up to 16 times the ejection time), otherwise. A request fails if it can't reach the server
+     * (connection refused, timeout, etc.) or gets a 502, 503 or 504 HTTP status. SOAP faults
+     * and other HTTP errors come from a working server and are not failures.
+     * When all the endpoints are ejected, the requests go to the one which comes back first.
+     *
+     * The endpoints must all be http(s):// URLs, or all be unix:// paths. inproc:// endpoints are not supported.
+     * endPoint() returns the first endpoint, and setEndPoint() goes back to a single endpoint.
+     * \since 1.8
+     */
+    void setEndPoints(const QStringList &endPoints);
+
+    /**
+     * Returns the endpoints set with setEndPoints(), or the end point, if there's only one.
+     * \since 1.8
+     */
+    QStringList endPoints() const;
+
+    /**
+     * How setEndPoints() picks the endpoint of each request.
+     * \since 1.8
+     */
+    enum LoadBalancing {
+        RoundRobin,               ///< each endpoint in turn (default)
+        LeastOutstandingRequests, ///< the endpoint with the fewest requests in progress
+        LatencyEwma               ///< the endpoint with the lowest moving average of its response time, weighted by its requests in progress
+    };
+
+    /**
+     * Sets how the endpoint of each request is picked, when there are several endpoints.
+     * \since 1.8
+     */
+    void setLoadBalancing(LoadBalancing strategy);
+
+    /**
+     * Returns how the endpoint of each request is picked.
+     * \since 1.8
+     */
+    LoadBalancing loadBalancing() const;
+
+    /**
+     * Ejects an endpoint after \p consecutiveFailures failed requests in a row, for \p msecs
+     * milliseconds at first. The default is 3 failures and 10 seconds.
+     * \since 1.8
+     */
+    void setEndPointEjection(int consecutiveFailures, int msecs);
+
+    /**
+     * Returns the endpoints which are currently ejected, or being checked again.
+     * \since 1.8
+     */
+    QStringList ejectedEndPoints() const;
+
+    /**
+     * How the calls of a method are sent again, see setRetryPolicy().
+     * \since 1.8
+     */
+    struct RetryPolicy {
+        RetryPolicy()
+            : idempotent(false), maxRetries(0), initialBackoff(100), maxBackoff(5000), hedging(false), hedgingPercentile(95)
+        {
+        }
+
+        bool idempotent;       ///< the method can safely run more than once on the server; nothing is sent again otherwise
+        int maxRetries;        ///< how many times a call is sent again when it fails
+        int initialBackoff;    ///< the delay before the first retry, in milliseconds; it doubles at each retry
+        int maxBackoff;        ///< the longest delay between two retries, in milliseconds
+        bool hedging;          ///< whether a second copy of slow calls is sent, the first response wins
+        int hedgingPercentile; ///< a call is slow once it takes longer than this percentile of the recent calls
+    };
+
+    /**
+     * Sets how the calls of \p method are sent again, when they fail or take unusually long.
+     *
+     * A call is retried when it can't reach the server (connection refused, timeout, etc.)
+     * or gets a 502, 503 or 504 HTTP status, after a random delay between half and all of
+     * the backoff, which doubles at each retry. SOAP faults and other HTTP errors are not retried.
+     * With hedging, a call which takes longer than the hedgingPercentile of the recent successful
+     * calls of the method is sent a second time (to the next endpoint, with setEndPoints()),
+     * and the first response is used. Hedging starts once 20 calls have succeeded.
+     * The timeout set with setTimeout() applies to the call as a whole.
+     *
+     * Nothing is sent twice unless \p policy is marked as idempotent.
+     * Requests with values read from devices (see KDSoapValue::setBinaryDevice) and blocking calls made
+     * with the native HTTP engine are sent only once.
+     * \since 1.8
+     */
+    void setRetryPolicy(const QString &method, const RetryPolicy &policy);
+
+    /**
+     * Returns the retry policy of \p method, see setRetryPolicy().
+     * \since 1.8
+     */
+    RetryPolicy retryPolicy(const QString &method) const;
+
     /**
      * Returns the cookie jar to use for the HTTP requests.
      * If no cookie jar was set by setCookieJar previously, a default
@@ -346,6 +472,202 @@ public:
       */
     void setTimeout(int msecs);
 
+    /**
+      * Enables MTOM (SOAP Message Transmission Optimization Mechanism, http://www.w3.org/TR/soap12-mtom/)
+      * for future requests: binary values (KDSoapValue holding a QByteArray, except for hexBinary)
+      * are then sent as raw bytes, in MIME parts of a multipart/related request, rather than being
+      * inlined as base64 text in the envelope. This saves the size overhead of base64, as well as
+      * the time spent encoding and decoding it on both ends.
+      * The MIME type of each part is taken from KDSoapValue::contentType().
+      *
+      * Replies using MTOM are always supported, whether this is enabled or not.
+      * KDSoapServer replies with MTOM to requests which use MTOM.
+      * \since 1.8
+      */
+    void setMtomEnabled(bool enabled);
+
+    /**
+      * Returns true if MTOM is enabled for requests.
+      * \since 1.8
+      */
+    bool isMtomEnabled() const;
+
+    /**
+      * Enables a compact binary encoding of the messages, instead of XML, when talking to a KDSoap server.
+      * Requests then announce it in their Accept header; a KDSoap server replies in the binary encoding,
+      * after which the following requests are sent in it as well. Other servers ignore the header,
+      * and keep getting XML. Numbers and binary values are sent without conversion to and from text,
+      * and names and namespaces are only sent once per message. Binary values are therefore received as raw bytes,
+      * like MTOM attachments: use KDSoapBinaryCodec::fromBase64Value() or fromHexValue() to read them
+      * whichever encoding the peer picked.
+      *
+      * Messages using WS-Addressing, a KDSoapBodyWriter or a WS-Security username token are always sent as XML.
+      * Calling setEndPoint() goes back to XML until the new server replied.
+      * \since 1.8
+      */
+    void setBinaryEncodingEnabled(bool enabled);
+
+    /**
+      * Returns true if the binary encoding is enabled.
+      * \since 1.8
+      */
+    bool isBinaryEncodingEnabled() const;
+
+    /**
+      * Sends the requests using HTTP/2, so that concurrent asynchronous calls share a single connection.
+      * For http:// endpoints, the server must support HTTP/2 without TLS (h2c) with prior knowledge,
+      * as KDSoapServer does with the KDSoapServer::Http2 feature. For https:// endpoints, HTTP/2 is
+      * used if the server agrees to it during the TLS handshake, and HTTP/1.1 otherwise.
+      *
+      * This requires Qt 5.11 or later, and does nothing with earlier versions.
+      * \since 1.8
+      */
+    void setHttp2Enabled(bool enabled);
+
+    /**
+      * Returns true if HTTP/2 is enabled.
+      * \since 1.8
+      */
+    bool isHttp2Enabled() const;
+
+    /**
+     * The implementation of HTTP used to send the requests.
+     * \since 1.8
+     */
+    enum HttpEngine {
+        QNetworkAccessManagerEngine, ///< QNetworkAccessManager (default)
+        NativeHttpEngine             ///< a lightweight HTTP/1.1 client with its own keep-alive connections
+    };
+
+    /**
+     * Sets the implementation of HTTP used for http:// and https:// endpoints.
+     *
+     * With NativeHttpEngine, each call costs less than with QNetworkAccessManager, and blocking calls
+     * made from the thread of this KDSoapClientInterface read the response from the socket directly,
+     * instead of using a secondary thread. Blocking calls from other threads still use QNetworkAccessManager.
+     *
+     * The native engine doesn't support proxies, cookies, HTTP/2 or compressed responses, and only supports
+     * basic HTTP authentication. The timeout, the SSL configuration and the handling of SSL errors apply as usual.
+     * \since 1.8
+     */
+    void setHttpEngine(HttpEngine engine);
+
+    /**
+     * Returns the implementation of HTTP used to send the requests.
+     * \since 1.8
+     */
+    HttpEngine httpEngine() const;
+
+    /**
+     * Parses the responses of asynchronous calls on a thread of QThreadPool::globalInstance(),
+     * instead of parsing them in the thread calling KDSoapPendingCall::returnMessage().
+     * This keeps large responses from blocking the event loop of the calling thread.
+     *
+     * This applies to the calls watched by a KDSoapPendingCallWatcher (and so to the asynchronous
+     * calls of the code generated by kdwsdl2cpp): the watcher emits finished() once the response is parsed.
+     * A body parser set with KDSoapPendingCall::setBodyParser() still runs in the calling thread,
+     * so this is of no use for code generated with the \c -direct-parsing option.
+     *
+     * Disabled by default.
+     * \since 1.8
+     */
+    void setBackgroundParsingEnabled(bool enabled);
+
+    /**
+     * Returns true if the responses of asynchronous calls are parsed on a thread pool.
+     * \since 1.8
+     */
+    bool isBackgroundParsingEnabled() const;
+
+    /**
+     * Caches the responses to calls of \p method for \p msecs milliseconds. This is meant for
+     * idempotent operations (lookups, reference data...) which are called repeatedly with the same arguments.
+     *
+     * A call is answered from the cache when a call with the same endpoint, SoapAction and request
+     * (as generated from the message, its headers and the persistent headers) was answered less than
+     * \p msecs ago. Only successful responses are cached. Asynchronous calls, and blocking calls made
+     * through the secondary thread, identical to a call in progress don't send a request:
+     * they get the response of that call.
+     *
+     * Requests with MTOM attachments or with data read from devices are never cached.
+     * A time to live of 0, the default, disables the cache for \p method.
+     * \since 1.8
+     */
+    void setResponseCacheTimeToLive(const QString &method, int msecs);
+
+    /**
+     * Returns the time to live of the cached responses to calls of \p method, 0 if they are not cached.
+     * \since 1.8
+     */
+    int responseCacheTimeToLive(const QString &method) const;
+
+    /**
+     * Sets the maximum size of the cached responses, in bytes. The least recently used responses are
+     * removed from the cache to stay below that size. The default is 10 MB.
+     * \since 1.8
+     */
+    void setResponseCacheMaxSize(int bytes);
+
+    /**
+     * Returns the maximum size of the cached responses, in bytes.
+     * \since 1.8
+     */
+    int responseCacheMaxSize() const;
+
+    /**
+     * Removes all the responses from the cache.
+     * \since 1.8
+     */
+    void clearResponseCache();
+
+    /**
+     * Statistics about the response cache, for the calls of the methods with a time to live.
+     * \since 1.8
+     */
+    struct ResponseCacheStatistics {
+        int hits;      ///< the calls answered from the cache
+        int misses;    ///< the calls sent to the server
+        int coalesced; ///< the calls which got the response of an identical call in progress
+        int entries;   ///< the number of cached responses
+        int size;      ///< the size of the cached responses, in bytes
+    };
+
+    /**
+     * Returns statistics about the response cache.
+     * \since 1.8
+     */
+    ResponseCacheStatistics responseCacheStatistics() const;
+
+    /**
+     * The timings of the calls of a method, see callStatistics().
+     * \since 1.8
+     */
+    struct CallStatistics {
+        CallStatistics() : calls(0), faults(0) {}
+
+        int calls;                                 ///< the calls whose response was read
+        int faults;                                ///< the calls which returned a fault, or failed with a network error
+        KDSoapPendingCall::Timings averageTimings; ///< -1 for what was never measured
+        KDSoapPendingCall::Timings maximumTimings; ///< -1 for what was never measured
+    };
+
+    /**
+     * Returns the aggregated timings of the calls of \p method (see KDSoapPendingCall::timings()),
+     * to find out where the time goes: writing the request, connecting, the server, downloading
+     * or reading the response.
+     *
+     * A call is counted once its response was read, e.g. by KDSoapPendingCall::returnMessage(),
+     * which the generated code and the blocking calls always do.
+     * \since 1.8
+     */
+    CallStatistics callStatistics(const QString &method) const;
+
+    /**
+     * Resets the statistics returned by callStatistics(), for all the methods.
+     * \since 1.8
+     */
+    void resetCallStatistics();
+
 private:
     friend class KDSoapThreadTask;
 
@@ -27,15 +27,23 @@
 #include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkCookieJar>
 #include <QtCore/QXmlStreamWriter>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSharedPointer>
 
 #include "KDSoapClientInterface.h"
 #include "KDSoapClientThread_p.h"
 #include "KDSoapAuthentication.h"
 QT_BEGIN_NAMESPACE
-class QBuffer;
+class QIODevice;
 QT_END_NAMESPACE
 class KDSoapMessage;
 class KDSoapNamespacePrefixes;
+class KDSoapMtomPackage;
+class KDSoapHttpConnectionPool;
+class KDSoapResponseCache;
+class KDSoapLoadBalancer;
+class KDSoapRetryPolicies;
+class KDSoapCallStatistics;
 
 class KDSoapClientInterfacePrivate : public QObject
 {
@@ -63,14 +71,55 @@ public:
     KDSoapSslHandler *m_sslHandler;
 #endif
     int m_timeout;
+    bool m_mtomEnabled;
+    bool m_binaryEncodingEnabled;
+    // Set once the server replied in the binary encoding, i.e. it is a KDSoap server supporting it.
+    // Written from the thread of blocking calls as well.
+    QAtomicInt m_binaryPeer;
+    bool m_http2Enabled;
+    KDSoapClientInterface::HttpEngine m_httpEngine;
+    KDSoapHttpConnectionPool *m_httpConnectionPool;
+    bool m_backgroundParsingEnabled;
+    QSharedPointer<KDSoapResponseCache> m_responseCache; // shared with the replies, which can outlive us
+    QSharedPointer<KDSoapLoadBalancer> m_loadBalancer; // for setEndPoints(), shared with the replies as well
+    QSharedPointer<KDSoapRetryPolicies> m_retryPolicies;
+    QSharedPointer<KDSoapCallStatistics> m_callStatistics;
 
     QNetworkAccessManager *accessManager();
-    QNetworkRequest prepareRequest(const QString &method, const QString &action);
-    QBuffer *prepareRequestBuffer(const QString &method, const KDSoapMessage &message, const KDSoapHeaders &headers);
+    // The SoapAction for \p method, if \p action is null
+    QString soapAction(const QString &method, const QString &action) const;
+    // For inproc:// endpoints: hands the messages to the server, the returned reply has no data
+    QNetworkReply *inProcessCall(const QString &method, const KDSoapMessage &message, const QString &action, const KDSoapHeaders &headers);
+    // Posts \p buffer with \p manager, with the native HTTP engine, or over a Unix domain socket for unix:// endpoints.
+    // With several endpoints, the load balancer picks the endpoint and replaces the URL of \p request.
+    QNetworkReply *post(QNetworkAccessManager *manager, const QNetworkRequest &request, QIODevice *buffer);
+    QNetworkReply *post(QNetworkAccessManager *manager, const QString &endPoint, const QNetworkRequest &request, QIODevice *buffer);
+    // post(), unless the response to \p method is in the cache, or an identical call is in progress.
+    // \p eventLoop: whether the reply is waited for with an event loop. Otherwise, calls in progress
+    // are not waited for, and the retry policy doesn't apply.
+    QNetworkReply *cachedPost(QNetworkAccessManager *manager, const QString &method, const QNetworkRequest &request, QIODevice *buffer, bool eventLoop);
+    // post(), retrying and hedging the request as the retry policy of \p method says
+    QNetworkReply *retryingPost(QNetworkAccessManager *manager, const QString &method, const QNetworkRequest &request, QIODevice *buffer, bool eventLoop);
+    // Whether post() uses the native HTTP engine for \p endPoint, when called from the current thread
+    bool useNativeHttpEngine(const QString &endPoint) const;
+    // Same, for all the endpoints post() can pick
+    bool useNativeHttpEngine() const;
+    // True if \p message can be sent in the binary encoding
+    bool useBinaryEncoding(const KDSoapMessage &message) const;
+    // mtomPackage: the package filled by prepareRequestBuffer, if any
+    QNetworkRequest prepareRequest(const QString &method, const QString &action, const KDSoapMtomPackage *mtomPackage = 0, bool binary = false);
+    // Returns a QBuffer, or a KDSoapRequestDevice if the message has values read from devices
+    // \p serializationTime: set to the time it took, in microseconds
+    QIODevice *prepareRequestBuffer(const QString &method, const KDSoapMessage &message, const KDSoapHeaders &headers, KDSoapMtomPackage *mtomPackage = 0, bool binary = false,
+                                    qint64 *serializationTime = 0);
+    QIODevice *writeRequestBuffer(const QString &method, const KDSoapMessage &message, const KDSoapHeaders &headers, KDSoapMtomPackage *mtomPackage, bool binary);
+    // The request data, for KDSOAP_DEBUG
+    static QByteArray requestData(QIODevice *device);
     void writeElementContents(KDSoapNamespacePrefixes &namespacePrefixes, QXmlStreamWriter &writer, const KDSoapValue &element, KDSoapMessage::Use use);
     void writeChildren(KDSoapNamespacePrefixes &namespacePrefixes, QXmlStreamWriter &writer, const KDSoapValueList &args, KDSoapMessage::Use use);
     void writeAttributes(QXmlStreamWriter &writer, const QList<KDSoapValue> &attributes);
-    void setupReply(QNetworkReply *reply);
+    // \p withTimeout: false for the requests of a KDSoapRetryingReply, which has the timeout
+    void setupReply(QNetworkReply *reply, bool withTimeout = true);
 
 private Q_SLOTS:
     void _kd_slotAuthenticationRequired(QNetworkReply *reply, QAuthenticator *authenticator);
@@ -28,9 +28,10 @@
 #include "KDSoapClientInterface_p.h"
 #include "KDSoapPendingCall.h"
 #include "KDSoapPendingCall_p.h"
+#include "KDSoapMtom_p.h"
+#include "KDSoapInProcess_p.h"
 #include <QNetworkRequest>
 #include <QNetworkProxy>
-#include <QBuffer>
 #include <QEventLoop>
 #include <QAuthenticator>
 
@@ -100,12 +101,23 @@ void KDSoapThreadTask::process(QNetworkAccessManager &accessManager)
 
     accessManager.setProxy(m_data->m_iface->d->accessManager()->proxy());
 
-    QBuffer *buffer = m_data->m_iface->d->prepareRequestBuffer(m_data->m_method, m_data->m_message, m_data->m_headers);
-    QNetworkRequest request = m_data->m_iface->d->prepareRequest(m_data->m_method, m_data->m_action);
-    QNetworkReply *reply = accessManager.post(request, buffer);
+    QNetworkReply *reply;
+    QIODevice *buffer = 0;
+    qint64 serializationTime = -1;
+    if (KDSoapInProcessReply::isInProcessEndPoint(m_data->m_iface->d->m_endPoint)) {
+        reply = m_data->m_iface->d->inProcessCall(m_data->m_method, m_data->m_message, m_data->m_action, m_data->m_headers);
+    } else {
+        KDSoapMtomPackage mtomPackage;
+        const bool binary = m_data->m_iface->d->useBinaryEncoding(m_data->m_message);
+        buffer = m_data->m_iface->d->prepareRequestBuffer(m_data->m_method, m_data->m_message, m_data->m_headers, &mtomPackage, binary, &serializationTime);
+        QNetworkRequest request = m_data->m_iface->d->prepareRequest(m_data->m_method, m_data->m_action, &mtomPackage, binary);
+        reply = m_data->m_iface->d->cachedPost(&accessManager, m_data->m_method, request, buffer, true);
+    }
     m_data->m_iface->d->setupReply(reply);
     KDSoapPendingCall pendingCall(reply, buffer);
     pendingCall.d->soapVersion = m_data->m_iface->d->m_version;
+    pendingCall.d->clientInterface = m_data->m_iface->d;
+    pendingCall.d->startTimings(m_data->m_method, serializationTime, m_data->m_iface->d->m_callStatistics);
 
     KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);
     connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
@@ -114,6 +126,7 @@ void KDSoapThreadTask::process(QNetworkAccessManager &accessManager)
 
 void KDSoapThreadTask::slotFinished(KDSoapPendingCallWatcher *watcher)
 {
+    watcher->setBodyParser(m_data->m_bodyParser);
     m_data->m_response = watcher->returnMessage();
     m_data->m_responseHeaders = watcher->returnHeaders();
     m_data->m_semaphore.release();
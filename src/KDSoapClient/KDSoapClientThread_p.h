@@ -35,6 +35,7 @@
 
 class KDSoapPendingCallWatcher;
 class KDSoapClientInterface;
+class KDSoapBodyParser;
 QT_BEGIN_NAMESPACE
 class QEventLoop;
 QT_END_NAMESPACE
@@ -43,7 +44,7 @@ class KDSoapThreadTaskData
 {
 public:
     KDSoapThreadTaskData(KDSoapClientInterface *iface, const QString &method, const KDSoapMessage &message, const QString &action, const KDSoapHeaders &headers)
-        : m_iface(iface), m_method(method), m_message(message), m_action(action), m_headers(headers) {}
+        : m_iface(iface), m_method(method), m_message(message), m_action(action), m_bodyParser(0), m_headers(headers) {}
 
     void waitForCompletion()
     {
@@ -63,6 +64,7 @@ public:
     QString m_method;
     KDSoapMessage m_message;
     QString m_action;
+    KDSoapBodyParser *m_bodyParser; // owned by the caller, who is blocked until completion
     QSemaphore m_semaphore;
     KDSoapMessage m_response;
     KDSoapHeaders m_responseHeaders;
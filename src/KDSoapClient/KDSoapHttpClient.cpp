@@ -0,0 +1,552 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapHttpClient_p.h"
+#include <QtCore/QTimerEvent>
+#include <QtNetwork/QNetworkAccessManager>
+
+// Enough to keep the socket busy, without reading the whole request device into memory
+static const int s_uploadChunkSize = 64 * 1024;
+// Servers usually close idle connections after 5 to 60 seconds, we don't know when exactly:
+// a request on a connection closed meanwhile is sent again on a new one
+static const int s_maxIdleTime = 30 * 1000;
+static const int s_maxIdleConnections = 16;
+
+KDSoapHttpConnectionPool::KDSoapHttpConnectionPool(QObject *parent)
+    : QObject(parent)
+{
+}
+
+// The idle sockets are children of the pool
+KDSoapHttpConnectionPool::~KDSoapHttpConnectionPool()
+{
+}
+
+QString KDSoapHttpConnectionPool::hostKey(const QUrl &url)
+{
+    const QString scheme = url.scheme().toLower();
+    const int port = url.port(scheme == QLatin1String("https") ? 443 : 80);
+    return scheme + QLatin1String("://") + url.host().toLower() + QLatin1Char(':') + QString::number(port);
+}
+
+QTcpSocket *KDSoapHttpConnectionPool::takeIdleConnection(const QUrl &url)
+{
+    const QString key = hostKey(url);
+    for (int i = m_idleConnections.count() - 1; i >= 0; --i) { // most recently used first
+        if (m_idleConnections.at(i).hostKey != key) {
+            continue;
+        }
+        QTcpSocket *socket = m_idleConnections.takeAt(i).socket;
+        socket->disconnect(this);
+        if (socket->state() == QAbstractSocket::ConnectedState && socket->bytesAvailable() == 0) {
+            socket->setParent(0);
+            return socket;
+        }
+        socket->deleteLater();
+    }
+    return 0;
+}
+
+void KDSoapHttpConnectionPool::releaseConnection(const QUrl &url, QTcpSocket *socket)
+{
+    if (socket->state() != QAbstractSocket::ConnectedState) {
+        socket->deleteLater();
+        return;
+    }
+    socket->setParent(this);
+    // Closed by the server, or unexpected data: not usable anymore
+    connect(socket, SIGNAL(disconnected()), this, SLOT(slotIdleConnectionClosed()));
+    connect(socket, SIGNAL(readyRead()), this, SLOT(slotIdleConnectionClosed()));
+    IdleConnection connection;
+    connection.socket = socket;
+    connection.hostKey = hostKey(url);
+    connection.idleTime.start();
+    m_idleConnections.append(connection);
+    if (m_idleConnections.count() > s_maxIdleConnections) {
+        m_idleConnections.takeFirst().socket->deleteLater();
+    }
+    if (!m_expiryTimer.isActive()) {
+        m_expiryTimer.start(s_maxIdleTime / 6, this);
+    }
+}
+
+int KDSoapHttpConnectionPool::idleConnectionCount() const
+{
+    return m_idleConnections.count();
+}
+
+bool KDSoapHttpConnectionPool::usesBasicAuth(const QUrl &url) const
+{
+    return m_basicAuthHosts.contains(hostKey(url));
+}
+
+void KDSoapHttpConnectionPool::setUsesBasicAuth(const QUrl &url)
+{
+    m_basicAuthHosts.insert(hostKey(url));
+}
+
+void KDSoapHttpConnectionPool::slotIdleConnectionClosed()
+{
+    QObject *socket = sender();
+    for (int i = 0; i < m_idleConnections.count(); ++i) {
+        if (m_idleConnections.at(i).socket == socket) {
+            m_idleConnections.removeAt(i);
+            socket->disconnect(this);
+            socket->deleteLater();
+            return;
+        }
+    }
+}
+
+void KDSoapHttpConnectionPool::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != m_expiryTimer.timerId()) {
+        QObject::timerEvent(event);
+        return;
+    }
+    for (int i = m_idleConnections.count() - 1; i >= 0; --i) {
+        if (m_idleConnections.at(i).idleTime.elapsed() > s_maxIdleTime) {
+            m_idleConnections.takeAt(i).socket->deleteLater();
+        }
+    }
+    if (m_idleConnections.isEmpty()) {
+        m_expiryTimer.stop();
+    }
+}
+
+KDSoapHttpReply::KDSoapHttpReply(KDSoapHttpConnectionPool *pool, const QNetworkRequest &request, QIODevice *outgoingData, QObject *parent)
+    : QNetworkReply(parent),
+      m_pool(pool),
+      m_socket(0),
+      m_outgoingData(outgoingData),
+      m_bodyPos(0),
+      m_timeout(-1),
+      m_started(false),
+      m_reusedConnection(false),
+      m_responseStarted(false),
+      m_bytesReceived(0),
+      m_sendBasicAuth(false)
+#ifndef QT_NO_OPENSSL
+      , m_ignoreAllSslErrors(false)
+#endif
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(QNetworkAccessManager::PostOperation);
+    open(QIODevice::ReadOnly);
+    // Queued, like QNetworkAccessManager: the caller connects to finished() after this.
+    // Not needed if waitForFinished() is called first.
+    QMetaObject::invokeMethod(this, "slotStart", Qt::QueuedConnection);
+}
+
+// The socket in use, if any, is a child of the reply
+KDSoapHttpReply::~KDSoapHttpReply()
+{
+}
+
+bool KDSoapHttpReply::isHttpEndPoint(const QUrl &url)
+{
+    const QString scheme = url.scheme().toLower();
+#ifndef QT_NO_OPENSSL
+    if (scheme == QLatin1String("https")) {
+        return true;
+    }
+#endif
+    return scheme == QLatin1String("http");
+}
+
+void KDSoapHttpReply::setAuthentication(const KDSoapAuthentication &authentication)
+{
+    m_authentication = authentication;
+    m_sendBasicAuth = m_pool && m_authentication.hasAuth() && m_pool->usesBasicAuth(url());
+}
+
+void KDSoapHttpReply::setTimeout(int msecs)
+{
+    m_timeout = msecs;
+}
+
+void KDSoapHttpReply::timeout()
+{
+    setProperty("kdsoap_reply_timed_out", true); // see KDSoapPendingCall.cpp
+    abort();
+}
+
+bool KDSoapHttpReply::waitForFinished()
+{
+    if (!m_started && !isFinished()) {
+        startRequest();
+    }
+    QElapsedTimer elapsed;
+    elapsed.start();
+    while (!isFinished()) {
+        int remaining = -1;
+        if (m_timeout >= 0) {
+            remaining = m_timeout - int(elapsed.elapsed());
+            if (remaining <= 0) {
+                timeout();
+                break;
+            }
+        }
+        // Each of these emits the socket signals, which drive the request as usual
+        QTcpSocket *socket = m_socket;
+#ifndef QT_NO_OPENSSL
+        QSslSocket *sslSocket = static_cast<QSslSocket *>(socket);
+#endif
+        bool ok;
+        if (socket->state() != QAbstractSocket::ConnectedState) {
+            ok = socket->waitForConnected(remaining);
+#ifndef QT_NO_OPENSSL
+        } else if (sslSocket->mode() != QSslSocket::UnencryptedMode && !sslSocket->isEncrypted()) {
+            ok = sslSocket->waitForEncrypted(remaining);
+#endif
+        } else if (socket->bytesToWrite() > 0) {
+            ok = socket->waitForBytesWritten(remaining);
+        } else {
+            ok = socket->waitForReadyRead(remaining);
+        }
+        if (!ok && !isFinished() && socket == m_socket && socket->error() != QAbstractSocket::SocketTimeoutError) {
+            // Not reported by a signal, e.g. the connection was closed already
+            slotError(socket->error());
+        }
+    }
+    return isFinished();
+}
+
+void KDSoapHttpReply::slotStart()
+{
+    if (!m_started && !isFinished()) { // not aborted, nor started by waitForFinished() meanwhile
+        startRequest();
+    }
+}
+
+void KDSoapHttpReply::startRequest()
+{
+    m_started = true;
+    QTcpSocket *socket = m_pool ? m_pool->takeIdleConnection(url()) : 0;
+    m_reusedConnection = socket != 0;
+    if (m_reusedConnection) {
+        connectSocket(socket);
+        sendRequest();
+        return;
+    }
+    const bool encrypted = url().scheme().toLower() == QLatin1String("https");
+    const quint16 port = quint16(url().port(encrypted ? 443 : 80));
+#ifndef QT_NO_OPENSSL
+    QSslSocket *sslSocket = new QSslSocket;
+    connectSocket(sslSocket);
+    if (encrypted) {
+        sslSocket->setSslConfiguration(request().sslConfiguration());
+        if (!m_ignoredSslErrors.isEmpty()) {
+            sslSocket->ignoreSslErrors(m_ignoredSslErrors);
+        }
+        sslSocket->connectToHostEncrypted(url().host(), port);
+        return;
+    }
+    socket = sslSocket;
+#else
+    socket = new QTcpSocket;
+    connectSocket(socket);
+#endif
+    socket->connectToHost(url().host(), port);
+}
+
+void KDSoapHttpReply::connectSocket(QTcpSocket *socket)
+{
+    m_socket = socket;
+    m_responseStarted = false;
+    m_bytesReceived = 0;
+    socket->setParent(this);
+    connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(slotBytesWritten()));
+    connect(socket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(slotDisconnected()));
+    connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(slotError(QAbstractSocket::SocketError)));
+    if (m_reusedConnection) {
+        return;
+    }
+#ifndef QT_NO_OPENSSL
+    if (url().scheme().toLower() == QLatin1String("https")) {
+        connect(socket, SIGNAL(encrypted()), this, SLOT(slotConnected()));
+        connect(socket, SIGNAL(sslErrors(QList<QSslError>)), this, SLOT(slotSslErrors(QList<QSslError>)));
+        return;
+    }
+#endif
+    connect(socket, SIGNAL(connected()), this, SLOT(slotConnected()));
+}
+
+void KDSoapHttpReply::releaseSocket(bool keepAlive)
+{
+    QTcpSocket *socket = m_socket;
+    if (!socket) {
+        return;
+    }
+    m_socket = 0;
+    socket->disconnect(this);
+    if (keepAlive && m_pool) {
+        m_pool->releaseConnection(url(), socket);
+    } else {
+        socket->abort();
+        socket->deleteLater(); // might be emitting a signal right now
+    }
+}
+
+void KDSoapHttpReply::slotConnected()
+{
+    sendRequest();
+}
+
+void KDSoapHttpReply::sendRequest()
+{
+    m_parser = KDSoapHttpResponseParser();
+    const QNetworkRequest req = request();
+    QByteArray path = url().toEncoded(QUrl::RemoveScheme | QUrl::RemoveAuthority | QUrl::RemoveFragment);
+    if (path.isEmpty()) {
+        path = "/";
+    }
+    QByteArray header = "POST " + path + " HTTP/1.1\r\n"
+                        "Host: " + QUrl::toAce(url().host());
+    if (url().port() != -1) {
+        header += ':' + QByteArray::number(url().port());
+    }
+    header += "\r\nContent-Length: " + QByteArray::number(m_outgoingData ? m_outgoingData->size() : 0) + "\r\n";
+    if (m_sendBasicAuth && !req.hasRawHeader("Authorization")) {
+        const QString userPass = m_authentication.user() + QLatin1Char(':') + m_authentication.password();
+        header += "Authorization: Basic " + userPass.toUtf8().toBase64() + "\r\n";
+    }
+    Q_FOREACH (const QByteArray &name, req.rawHeaderList()) {
+        header += name + ": " + req.rawHeader(name) + "\r\n";
+    }
+    header += "\r\n";
+    m_socket->write(header);
+    sendMoreData();
+}
+
+void KDSoapHttpReply::slotBytesWritten()
+{
+    sendMoreData();
+    if (m_socket->bytesToWrite() == 0 && m_outgoingData && m_outgoingData->atEnd()) {
+        // Like QNetworkAccessManager, used for the timings of the call
+        emit uploadProgress(m_outgoingData->size(), m_outgoingData->size());
+    }
+}
+
+void KDSoapHttpReply::sendMoreData()
+{
+    if (!m_outgoingData) {
+        return;
+    }
+    while (m_socket->bytesToWrite() < s_uploadChunkSize && !m_outgoingData->atEnd()) {
+        const QByteArray chunk = m_outgoingData->read(s_uploadChunkSize);
+        if (chunk.isEmpty()) {
+            break;
+        }
+        m_socket->write(chunk);
+    }
+}
+
+// Sends the request again, on a new connection unless \p keepAlive. Needs to read the request data again.
+bool KDSoapHttpReply::retry(bool keepAlive)
+{
+    if (m_outgoingData && !m_outgoingData->reset()) {
+        return false;
+    }
+    releaseSocket(keepAlive);
+    startRequest();
+    return true;
+}
+
+void KDSoapHttpReply::slotReadyRead()
+{
+    const QByteArray data = m_socket->readAll();
+    if (data.isEmpty()) {
+        return;
+    }
+    m_responseStarted = true;
+    m_bytesReceived += data.size();
+    emit downloadProgress(m_bytesReceived, -1);
+    if (!m_parser.feed(data.constData(), data.size())) {
+        fail(QNetworkReply::ProtocolFailure, QString::fromLatin1("Invalid HTTP response"));
+    } else if (m_parser.isComplete()) {
+        handleResponse();
+    }
+}
+
+void KDSoapHttpReply::slotDisconnected()
+{
+    if (isFinished() || !m_socket) {
+        return;
+    }
+    const QByteArray data = m_socket->readAll();
+    if (data.isEmpty() && !m_responseStarted && m_reusedConnection && retry(false)) {
+        return; // closed by the server while idle
+    }
+    if (!m_parser.feed(data.constData(), data.size())) {
+        fail(QNetworkReply::ProtocolFailure, QString::fromLatin1("Invalid HTTP response"));
+    } else if (m_parser.isComplete() || m_parser.finishAtEndOfStream()) {
+        handleResponse();
+    } else {
+        fail(QNetworkReply::RemoteHostClosedError, QString::fromLatin1("Connection closed"));
+    }
+}
+
+void KDSoapHttpReply::slotError(QAbstractSocket::SocketError socketError)
+{
+    if (isFinished() || !m_socket) {
+        return;
+    }
+    if (socketError == QAbstractSocket::RemoteHostClosedError) {
+        slotDisconnected();
+        return;
+    }
+    if (!m_responseStarted && m_reusedConnection && retry(false)) {
+        return; // e.g. reset by the server while idle
+    }
+    QNetworkReply::NetworkError errorCode;
+    switch (socketError) {
+    case QAbstractSocket::ConnectionRefusedError:
+        errorCode = QNetworkReply::ConnectionRefusedError;
+        break;
+    case QAbstractSocket::HostNotFoundError:
+        errorCode = QNetworkReply::HostNotFoundError;
+        break;
+    case QAbstractSocket::SocketTimeoutError:
+        errorCode = QNetworkReply::TimeoutError;
+        break;
+    case QAbstractSocket::SslHandshakeFailedError:
+        errorCode = QNetworkReply::SslHandshakeFailedError;
+        break;
+    default:
+        errorCode = QNetworkReply::UnknownNetworkError;
+        break;
+    }
+    fail(errorCode, m_socket->errorString());
+}
+
+#ifndef QT_NO_OPENSSL
+void KDSoapHttpReply::slotSslErrors(const QList<QSslError> &errors)
+{
+    emit sslErrors(errors); // can call ignoreSslErrors()
+    if (m_ignoreAllSslErrors && m_socket) {
+        static_cast<QSslSocket *>(m_socket)->ignoreSslErrors();
+    }
+}
+#endif
+
+void KDSoapHttpReply::handleResponse()
+{
+    const bool keepAlive = m_parser.isKeepAlive() && m_socket->state() == QAbstractSocket::ConnectedState
+                           && m_socket->bytesAvailable() == 0;
+    // Like QNetworkAccessManager, send the credentials once the server asks for them
+    if (m_parser.statusCode() == 401 && !m_sendBasicAuth && m_authentication.hasAuth()
+            && m_parser.header("WWW-Authenticate").toLower().startsWith("basic")) {
+        m_sendBasicAuth = true;
+        if (m_pool) {
+            m_pool->setUsesBasicAuth(url());
+        }
+        if (retry(keepAlive)) {
+            return;
+        }
+    }
+    releaseSocket(keepAlive);
+    finishResponse();
+}
+
+void KDSoapHttpReply::finishResponse()
+{
+    m_body = m_parser.takeBody();
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, m_parser.statusCode());
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, m_parser.reasonPhrase());
+    Q_FOREACH (const KDSoapHttpResponseParser::RawHeaderPair &header, m_parser.headers()) {
+        setRawHeader(header.first, header.second);
+    }
+    const QNetworkReply::NetworkError errorCode = KDSoapHttpResponseParser::errorForStatusCode(m_parser.statusCode());
+    if (errorCode != QNetworkReply::NoError) {
+        setError(errorCode, QString::fromLatin1("Error transferring %1 - server replied: %2")
+                 .arg(url().toString(), QString::fromLatin1(m_parser.reasonPhrase())));
+    }
+    setFinished(true);
+    emit metaDataChanged();
+    if (!m_body.isEmpty()) {
+        emit readyRead();
+    }
+    emit finished();
+}
+
+void KDSoapHttpReply::fail(QNetworkReply::NetworkError errorCode, const QString &errorString)
+{
+    releaseSocket(false);
+    setError(errorCode, errorString);
+    setFinished(true);
+    emit finished();
+}
+
+void KDSoapHttpReply::abort()
+{
+    if (isFinished()) {
+        return;
+    }
+    fail(QNetworkReply::OperationCanceledError, QString::fromLatin1("Operation canceled"));
+}
+
+void KDSoapHttpReply::ignoreSslErrors()
+{
+#ifndef QT_NO_OPENSSL
+    m_ignoreAllSslErrors = true;
+    if (m_socket) {
+        static_cast<QSslSocket *>(m_socket)->ignoreSslErrors();
+    }
+#endif
+}
+
+#ifndef QT_NO_OPENSSL
+void KDSoapHttpReply::ignoreSslErrorsImplementation(const QList<QSslError> &errors)
+{
+    m_ignoredSslErrors = errors;
+    if (m_socket) {
+        static_cast<QSslSocket *>(m_socket)->ignoreSslErrors(errors);
+    }
+}
+#endif
+
+qint64 KDSoapHttpReply::bytesAvailable() const
+{
+    return QNetworkReply::bytesAvailable() + m_body.size() - m_bodyPos;
+}
+
+bool KDSoapHttpReply::isSequential() const
+{
+    return true;
+}
+
+qint64 KDSoapHttpReply::readData(char *data, qint64 maxSize)
+{
+    const int bytes = int(qMin<qint64>(maxSize, m_body.size() - m_bodyPos));
+    if (bytes == 0 && isFinished()) {
+        return -1;
+    }
+    memcpy(data, m_body.constData() + m_bodyPos, bytes);
+    m_bodyPos += bytes;
+    return bytes;
+}
+
+#include "moc_KDSoapHttpClient_p.cpp"
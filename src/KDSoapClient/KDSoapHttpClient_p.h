@@ -0,0 +1,159 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPHTTPCLIENT_P_H
+#define KDSOAPHTTPCLIENT_P_H
+
+#include "KDSoapAuthentication.h"
+#include "KDSoapHttpResponseParser_p.h"
+#include <QtCore/QBasicTimer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QPointer>
+#include <QtCore/QSet>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QTcpSocket> // may define QT_NO_OPENSSL
+#ifndef QT_NO_OPENSSL
+#include <QtNetwork/QSslSocket>
+#endif
+
+/**
+ * \internal
+ * Keep-alive connections of the native HTTP engine, per host.
+ * Used from the thread of the KDSoapClientInterface only.
+ */
+class KDSoapHttpConnectionPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit KDSoapHttpConnectionPool(QObject *parent = 0);
+    ~KDSoapHttpConnectionPool();
+
+    // An idle connection to the host of \p url, or 0. The caller owns it.
+    QTcpSocket *takeIdleConnection(const QUrl &url);
+    // Keeps \p socket, connected to the host of \p url, for the next requests
+    void releaseConnection(const QUrl &url, QTcpSocket *socket);
+    int idleConnectionCount() const;
+
+    // Hosts which asked for basic authentication once get it with the next requests right away
+    bool usesBasicAuth(const QUrl &url) const;
+    void setUsesBasicAuth(const QUrl &url);
+
+protected:
+    /*! \reimp */ void timerEvent(QTimerEvent *event);
+
+private Q_SLOTS:
+    void slotIdleConnectionClosed();
+
+private:
+    static QString hostKey(const QUrl &url);
+
+    struct IdleConnection {
+        QTcpSocket *socket;
+        QString hostKey;
+        QElapsedTimer idleTime;
+    };
+    QList<IdleConnection> m_idleConnections; // least recently used first
+    QSet<QString> m_basicAuthHosts;
+    QBasicTimer m_expiryTimer;
+};
+
+/**
+ * \internal
+ * A HTTP/1.1 POST request sent by the native HTTP engine, over a connection of a KDSoapHttpConnectionPool.
+ * Compared to QNetworkAccessManager, this doesn't support proxies, cookies, or authentication methods
+ * other than basic, but each request only needs this object (and a socket, for new connections).
+ *
+ * Besides the usual asynchronous operation, waitForFinished() sends the request and reads the response
+ * in the calling thread, blocking on the socket, without an event loop.
+ */
+class KDSoapHttpReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    // Takes the headers from \p request, and sends the contents of \p outgoingData, which must have a known size
+    KDSoapHttpReply(KDSoapHttpConnectionPool *pool, const QNetworkRequest &request, QIODevice *outgoingData, QObject *parent = 0);
+    ~KDSoapHttpReply();
+
+    // Basic authentication, when the server asks for it
+    void setAuthentication(const KDSoapAuthentication &authentication);
+    // The timeout of waitForFinished(); otherwise the timeout is handled by KDSoapTimeoutWheel
+    void setTimeout(int msecs);
+    // Blocks until the response is complete, or the timeout expired, after which the request is aborted,
+    // flagged with the "kdsoap_reply_timed_out" property. \return isFinished()
+    bool waitForFinished();
+
+    /*! \reimp */ void abort();
+    /*! \reimp */ qint64 bytesAvailable() const;
+    /*! \reimp */ bool isSequential() const;
+    /*! \reimp */ void ignoreSslErrors();
+
+    static bool isHttpEndPoint(const QUrl &url);
+
+protected:
+    /*! \reimp */ qint64 readData(char *data, qint64 maxSize);
+#ifndef QT_NO_OPENSSL
+    /*! \reimp */ void ignoreSslErrorsImplementation(const QList<QSslError> &errors);
+#endif
+
+private Q_SLOTS:
+    void slotStart();
+    void slotConnected();
+    void slotBytesWritten();
+    void slotReadyRead();
+    void slotDisconnected();
+    void slotError(QAbstractSocket::SocketError socketError);
+#ifndef QT_NO_OPENSSL
+    void slotSslErrors(const QList<QSslError> &errors);
+#endif
+
+private:
+    void startRequest();
+    void connectSocket(QTcpSocket *socket);
+    void releaseSocket(bool keepAlive);
+    void sendRequest();
+    void sendMoreData();
+    bool retry(bool keepAlive);
+    void handleResponse();
+    void finishResponse();
+    void fail(QNetworkReply::NetworkError errorCode, const QString &errorString);
+    void timeout();
+
+    QPointer<KDSoapHttpConnectionPool> m_pool;
+    QTcpSocket *m_socket;
+    QIODevice *m_outgoingData;
+    KDSoapAuthentication m_authentication;
+    KDSoapHttpResponseParser m_parser;
+    QByteArray m_body;
+    int m_bodyPos;
+    int m_timeout;
+    bool m_started;
+    bool m_reusedConnection; // a stale keep-alive connection is retried on a new one
+    bool m_responseStarted;
+    qint64 m_bytesReceived; // for downloadProgress()
+    bool m_sendBasicAuth;
+#ifndef QT_NO_OPENSSL
+    bool m_ignoreAllSslErrors;
+    QList<QSslError> m_ignoredSslErrors;
+#endif
+};
+
+#endif // KDSOAPHTTPCLIENT_P_H
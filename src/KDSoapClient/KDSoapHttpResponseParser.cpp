@@ -0,0 +1,333 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapHttpResponseParser_p.h"
+
+// Longest status or header line accepted, so that garbage doesn't fill the memory
+static const int s_maxLineLength = 64 * 1024;
+
+KDSoapHttpResponseParser::KDSoapHttpResponseParser()
+    : m_state(StatusLine),
+      m_bufferPos(0),
+      m_statusCode(0),
+      m_http10(false),
+      m_remaining(0)
+{
+}
+
+void KDSoapHttpResponseParser::reset()
+{
+    if (m_state == Invalid) {
+        return;
+    }
+    m_state = StatusLine;
+    m_statusCode = 0;
+    m_reasonPhrase.clear();
+    m_http10 = false;
+    m_headers.clear();
+    m_body.clear();
+    m_remaining = 0;
+    parse();
+}
+
+bool KDSoapHttpResponseParser::feed(const char *data, int size)
+{
+    if (m_state == Invalid) {
+        return false;
+    }
+    if (m_state == Body && m_bufferPos == m_buffer.size()) {
+        // Common case: more of the body, no need to go through m_buffer
+        const int bytes = m_remaining < 0 ? size : int(qMin<qint64>(size, m_remaining));
+        m_body.append(data, bytes);
+        if (m_remaining >= 0) {
+            m_remaining -= bytes;
+            if (m_remaining == 0) {
+                m_state = Done;
+            }
+        }
+        data += bytes;
+        size -= bytes;
+        if (size == 0) {
+            return true;
+        }
+    }
+    m_buffer.append(data, size);
+    parse();
+    if (m_bufferPos > 0) {
+        m_buffer.remove(0, m_bufferPos);
+        m_bufferPos = 0;
+    }
+    return m_state != Invalid;
+}
+
+bool KDSoapHttpResponseParser::finishAtEndOfStream()
+{
+    if (m_state == Body && m_remaining < 0) {
+        m_state = Done;
+    }
+    return m_state == Done;
+}
+
+bool KDSoapHttpResponseParser::headersComplete() const
+{
+    return m_state != StatusLine && m_state != Headers && m_state != Invalid;
+}
+
+bool KDSoapHttpResponseParser::isComplete() const
+{
+    return m_state == Done;
+}
+
+int KDSoapHttpResponseParser::statusCode() const
+{
+    return m_statusCode;
+}
+
+QByteArray KDSoapHttpResponseParser::reasonPhrase() const
+{
+    return m_reasonPhrase;
+}
+
+QList<KDSoapHttpResponseParser::RawHeaderPair> KDSoapHttpResponseParser::headers() const
+{
+    return m_headers;
+}
+
+QByteArray KDSoapHttpResponseParser::header(const QByteArray &name) const
+{
+    Q_FOREACH (const RawHeaderPair &header, m_headers) {
+        if (qstricmp(header.first.constData(), name.constData()) == 0) {
+            return header.second;
+        }
+    }
+    return QByteArray();
+}
+
+bool KDSoapHttpResponseParser::isKeepAlive() const
+{
+    const QByteArray connection = header("Connection").toLower();
+    if (m_http10) {
+        return connection == "keep-alive";
+    }
+    return connection != "close";
+}
+
+QByteArray KDSoapHttpResponseParser::takeBody()
+{
+    const QByteArray body = m_body;
+    m_body.clear();
+    return body;
+}
+
+bool KDSoapHttpResponseParser::readLine(QByteArray *line)
+{
+    const int end = m_buffer.indexOf('\n', m_bufferPos);
+    if (end == -1) {
+        if (m_buffer.size() - m_bufferPos > s_maxLineLength) {
+            m_state = Invalid;
+        }
+        return false;
+    }
+    int length = end - m_bufferPos;
+    if (length > 0 && m_buffer.at(end - 1) == '\r') {
+        --length;
+    }
+    *line = m_buffer.mid(m_bufferPos, length);
+    m_bufferPos = end + 1;
+    return true;
+}
+
+bool KDSoapHttpResponseParser::parseStatusLine(const QByteArray &line)
+{
+    // HTTP/1.1 200 OK
+    if (!line.startsWith("HTTP/")) {
+        return false;
+    }
+    const int firstSpace = line.indexOf(' ');
+    if (firstSpace == -1) {
+        return false;
+    }
+    const int secondSpace = line.indexOf(' ', firstSpace + 1);
+    bool ok;
+    m_statusCode = line.mid(firstSpace + 1, secondSpace == -1 ? -1 : secondSpace - firstSpace - 1).toInt(&ok);
+    if (!ok || m_statusCode < 100 || m_statusCode > 999) {
+        return false;
+    }
+    m_reasonPhrase = secondSpace == -1 ? QByteArray() : line.mid(secondSpace + 1);
+    m_http10 = line.startsWith("HTTP/1.0");
+    return true;
+}
+
+bool KDSoapHttpResponseParser::parseHeaderLine(const QByteArray &line)
+{
+    const int colon = line.indexOf(':');
+    if (colon <= 0) {
+        return false;
+    }
+    if (line.at(0) == ' ' || line.at(0) == '\t') { // obsolete line folding
+        if (m_headers.isEmpty()) {
+            return false;
+        }
+        m_headers.last().second += ' ' + line.trimmed();
+        return true;
+    }
+    m_headers.append(qMakePair(line.left(colon), line.mid(colon + 1).trimmed()));
+    return true;
+}
+
+void KDSoapHttpResponseParser::headersDone()
+{
+    if (m_statusCode < 200 && m_statusCode != 101) {
+        // Interim response, e.g. 100 Continue: the actual response follows
+        m_statusCode = 0;
+        m_headers.clear();
+        m_state = StatusLine;
+        return;
+    }
+    if (m_statusCode < 200 || m_statusCode == 204 || m_statusCode == 304) {
+        m_state = Done;
+        return;
+    }
+    if (header("Transfer-Encoding").toLower().contains("chunked")) {
+        m_state = ChunkSize;
+        return;
+    }
+    const QByteArray contentLength = header("Content-Length");
+    if (contentLength.isEmpty()) {
+        m_remaining = -1;
+        m_state = Body;
+        return;
+    }
+    bool ok;
+    m_remaining = contentLength.toLongLong(&ok);
+    if (!ok || m_remaining < 0) {
+        m_state = Invalid;
+    } else {
+        m_state = m_remaining == 0 ? Done : Body;
+    }
+}
+
+// Reads the body, or the current chunk, and goes to \p nextState at its end
+bool KDSoapHttpResponseParser::readBody(State nextState)
+{
+    const int available = m_buffer.size() - m_bufferPos;
+    if (available == 0) {
+        return false;
+    }
+    const int bytes = m_remaining < 0 ? available : int(qMin<qint64>(available, m_remaining));
+    m_body.append(m_buffer.constData() + m_bufferPos, bytes);
+    m_bufferPos += bytes;
+    if (m_remaining >= 0) {
+        m_remaining -= bytes;
+        if (m_remaining == 0) {
+            m_state = nextState;
+        }
+    }
+    return true;
+}
+
+void KDSoapHttpResponseParser::parse()
+{
+    QByteArray line;
+    bool progress = true;
+    while (progress) {
+        switch (m_state) {
+        case StatusLine:
+            progress = readLine(&line);
+            if (progress && !line.isEmpty()) { // tolerate empty lines before the response
+                m_state = parseStatusLine(line) ? Headers : Invalid;
+            }
+            break;
+        case Headers:
+            progress = readLine(&line);
+            if (progress) {
+                if (line.isEmpty()) {
+                    headersDone();
+                } else if (!parseHeaderLine(line)) {
+                    m_state = Invalid;
+                }
+            }
+            break;
+        case Body:
+            progress = readBody(Done);
+            break;
+        case ChunkSize:
+            progress = readLine(&line);
+            if (progress) {
+                const int semicolon = line.indexOf(';'); // chunk extensions are ignored
+                bool ok;
+                m_remaining = line.left(semicolon).trimmed().toLongLong(&ok, 16);
+                if (!ok || m_remaining < 0) {
+                    m_state = Invalid;
+                } else {
+                    m_state = m_remaining == 0 ? Trailers : ChunkData;
+                }
+            }
+            break;
+        case ChunkData:
+            progress = readBody(ChunkDataEnd);
+            break;
+        case ChunkDataEnd:
+            progress = readLine(&line);
+            if (progress) {
+                m_state = line.isEmpty() ? ChunkSize : Invalid;
+            }
+            break;
+        case Trailers:
+            progress = readLine(&line);
+            if (progress && line.isEmpty()) {
+                m_state = Done;
+            }
+            break;
+        case Done:
+        case Invalid:
+            progress = false;
+            break;
+        }
+    }
+}
+
+QNetworkReply::NetworkError KDSoapHttpResponseParser::errorForStatusCode(int statusCode)
+{
+    switch (statusCode) {
+    case 401:
+        return QNetworkReply::AuthenticationRequiredError;
+    case 403:
+        return QNetworkReply::ContentAccessDenied;
+    case 404:
+        return QNetworkReply::ContentNotFoundError;
+    case 405:
+        return QNetworkReply::ContentOperationNotPermittedError;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 3, 0)
+    case 500:
+        return QNetworkReply::InternalServerError;
+#endif
+    default:
+        break;
+    }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 3, 0)
+    if (statusCode >= 500) {
+        return QNetworkReply::UnknownServerError;
+    }
+#endif
+    return statusCode >= 400 ? QNetworkReply::UnknownContentError : QNetworkReply::NoError;
+}
@@ -0,0 +1,105 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPHTTPRESPONSEPARSER_P_H
+#define KDSOAPHTTPRESPONSEPARSER_P_H
+
+#include "KDSoapGlobal.h"
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtNetwork/QNetworkReply>
+
+/**
+ * \internal
+ * Incremental parser for HTTP/1.1 responses, for the transports which don't go through
+ * QNetworkAccessManager. Handles Content-Length, chunked transfer encoding, and bodies
+ * ending with the connection. Interim (1xx) responses are skipped.
+ *
+ * Internal class -- only exported for the server lib
+ */
+class KDSOAP_EXPORT KDSoapHttpResponseParser
+{
+public:
+    typedef QPair<QByteArray, QByteArray> RawHeaderPair;
+
+    KDSoapHttpResponseParser();
+
+    // Prepares for the next response on the same connection. Data received after the end
+    // of the previous response is kept, and parsed.
+    void reset();
+
+    // Parses \p size more bytes of the response.
+    // \return false if the data isn't a valid HTTP response
+    bool feed(const char *data, int size);
+
+    // To be called when the connection is closed. \return true if this ends the response,
+    // i.e. the body had no length
+    bool finishAtEndOfStream();
+
+    bool headersComplete() const;
+    bool isComplete() const;
+
+    int statusCode() const;
+    QByteArray reasonPhrase() const;
+    QList<RawHeaderPair> headers() const;
+    // The value of the header \p name, case-insensitive
+    QByteArray header(const QByteArray &name) const;
+    // False for HTTP/1.0 responses and "Connection: close"
+    bool isKeepAlive() const;
+
+    QByteArray takeBody();
+
+    // The error QNetworkAccessManager reports for the HTTP status \p statusCode
+    static QNetworkReply::NetworkError errorForStatusCode(int statusCode);
+
+private:
+    enum State {
+        StatusLine,
+        Headers,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkDataEnd,
+        Trailers,
+        Done,
+        Invalid
+    };
+    bool readLine(QByteArray *line);
+    bool parseStatusLine(const QByteArray &line);
+    bool parseHeaderLine(const QByteArray &line);
+    void headersDone();
+    bool readBody(State nextState);
+    void parse();
+
+    State m_state;
+    QByteArray m_buffer; // received data not parsed yet
+    int m_bufferPos;
+    int m_statusCode;
+    QByteArray m_reasonPhrase;
+    bool m_http10;
+    QList<RawHeaderPair> m_headers;
+    QByteArray m_body;
+    qint64 m_remaining; // bytes left in the body or in the current chunk, -1 if until the end of the stream
+};
+
+#endif // KDSOAPHTTPRESPONSEPARSER_P_H
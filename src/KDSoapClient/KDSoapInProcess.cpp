@@ -0,0 +1,286 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapInProcess_p.h"
+#include "KDSoapMessageReader_p.h"
+#include "KDSoapMessageWriter_p.h"
+#include "KDSoapNamespaceManager.h"
+#include <QtCore/QHash>
+#include <QtCore/QMutexLocker>
+#include <QtNetwork/QNetworkAccessManager>
+
+class KDSoapInProcessRegistry
+{
+public:
+    QMutex m_mutex;
+    QHash<QString, KDSoapInProcessHandler *> m_handlers;
+};
+
+Q_GLOBAL_STATIC(KDSoapInProcessRegistry, s_registry)
+
+static const char s_scheme[] = "inproc://";
+
+// KDSoapMessageWriter writes the children of each header message, KDSoapMessageReader reads back one message per element
+static void appendHeaderElements(const KDSoapMessage &header, const QString &messageNamespace, KDSoapHeaders *elements)
+{
+    Q_FOREACH (const KDSoapValue &child, header.childValues()) {
+        KDSoapMessage element;
+        static_cast<KDSoapValue &>(element) = child;
+        if (element.namespaceUri().isEmpty()) {
+            element.setNamespaceUri(messageNamespace); // headers are written qualified
+        }
+        elements->append(element);
+    }
+}
+
+KDSoapInProcessCall::KDSoapInProcessCall(const KDSoapMessage &request, const QString &elementName, const QString &messageNamespace,
+        const KDSoapHeaders &requestHeaders, const QMap<QString, KDSoapMessage> &persistentHeaders,
+        const QByteArray &soapAction, KDSoap::SoapVersion version)
+    : m_request(request),
+      m_soapAction(soapAction),
+      m_version(version),
+      m_reply(0)
+{
+    if (!elementName.isEmpty()) {
+        m_request.setName(elementName);
+    }
+    if (m_request.namespaceUri().isEmpty()) {
+        m_request.setNamespaceUri(messageNamespace);
+    }
+    Q_FOREACH (const KDSoapMessage &header, persistentHeaders) {
+        appendHeaderElements(header, messageNamespace, &m_requestHeaders);
+    }
+    Q_FOREACH (const KDSoapMessage &header, requestHeaders) {
+        appendHeaderElements(header, messageNamespace, &m_requestHeaders);
+    }
+}
+
+KDSoapMessage KDSoapInProcessCall::request() const
+{
+    return m_request;
+}
+
+KDSoapHeaders KDSoapInProcessCall::requestHeaders() const
+{
+    return m_requestHeaders;
+}
+
+QByteArray KDSoapInProcessCall::soapAction() const
+{
+    return m_soapAction;
+}
+
+KDSoap::SoapVersion KDSoapInProcessCall::soapVersion() const
+{
+    return m_version;
+}
+
+void KDSoapInProcessCall::finish(const KDSoapMessage &response, const KDSoapHeaders &responseHeaders, const QString &responseNamespace)
+{
+    // Same name and namespace as KDSoapServerSocket::sendReply would give the response element
+    KDSoapMessage message = response;
+    if (message.isFault()) {
+        message.setName(QString::fromLatin1("Fault"));
+        message.setNamespaceUri(m_version == KDSoap::SOAP1_2 ? KDSoapNamespaceManager::soapEnvelope200305() : KDSoapNamespaceManager::soapEnvelope());
+    } else {
+        if (message.name().isEmpty()) {
+            message.setName(m_request.name());
+        }
+        if (message.namespaceUri().isEmpty()) {
+            message.setNamespaceUri(responseNamespace);
+        }
+    }
+    KDSoapHeaders headerElements;
+    Q_FOREACH (const KDSoapMessage &header, responseHeaders) {
+        appendHeaderElements(header, responseNamespace, &headerElements);
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_response = message;
+    m_responseHeaders = headerElements;
+    if (m_reply) {
+        // The reply can't be deleted before this is delivered, or the event is discarded with it
+        QMetaObject::invokeMethod(m_reply, "slotFinished", Qt::QueuedConnection);
+    }
+}
+
+KDSoapInProcessHandler::~KDSoapInProcessHandler()
+{
+}
+
+bool KDSoapInProcessHandler::registerHandler(const QString &name, KDSoapInProcessHandler *handler)
+{
+    KDSoapInProcessRegistry *registry = s_registry();
+    QMutexLocker lock(&registry->m_mutex);
+    if (registry->m_handlers.contains(name)) {
+        return false;
+    }
+    registry->m_handlers.insert(name, handler);
+    return true;
+}
+
+void KDSoapInProcessHandler::unregisterHandler(KDSoapInProcessHandler *handler)
+{
+    KDSoapInProcessRegistry *registry = s_registry();
+    if (!registry) { // during static destruction
+        return;
+    }
+    QMutexLocker lock(&registry->m_mutex);
+    const QString name = registry->m_handlers.key(handler);
+    if (!name.isNull()) {
+        registry->m_handlers.remove(name);
+    }
+}
+
+bool KDSoapInProcessHandler::dispatch(const QString &name, const KDSoapInProcessCallPtr &call)
+{
+    KDSoapInProcessRegistry *registry = s_registry();
+    // Locked during handleCall, so that the handler can't be unregistered and deleted meanwhile
+    QMutexLocker lock(&registry->m_mutex);
+    KDSoapInProcessHandler *handler = registry->m_handlers.value(name);
+    if (!handler) {
+        return false;
+    }
+    handler->handleCall(call);
+    return true;
+}
+
+QThread *KDSoapInProcessHandler::threadOf(const QString &name)
+{
+    KDSoapInProcessRegistry *registry = s_registry();
+    QMutexLocker lock(&registry->m_mutex);
+    KDSoapInProcessHandler *handler = registry->m_handlers.value(name);
+    return handler ? handler->handlerThread() : 0;
+}
+
+KDSoapInProcessReply::KDSoapInProcessReply(const QString &endPoint, const KDSoapInProcessCallPtr &call, QObject *parent)
+    : QNetworkReply(parent),
+      m_call(call)
+{
+    setUrl(QUrl(endPoint));
+    setOperation(QNetworkAccessManager::PostOperation);
+    open(QIODevice::ReadOnly);
+    {
+        QMutexLocker lock(&m_call->m_mutex);
+        m_call->m_reply = this;
+    }
+    const QString name = serverName(endPoint);
+    if (!KDSoapInProcessHandler::dispatch(name, m_call)) {
+        detach();
+        // Queued, like network errors: the caller connects to finished() after this
+        QMetaObject::invokeMethod(this, "slotFailed", Qt::QueuedConnection,
+                                  Q_ARG(QString, QString::fromLatin1("No in-process server named %1").arg(name)));
+    }
+}
+
+KDSoapInProcessReply::~KDSoapInProcessReply()
+{
+    detach();
+}
+
+void KDSoapInProcessReply::detach()
+{
+    QMutexLocker lock(&m_call->m_mutex);
+    m_call->m_reply = 0;
+}
+
+void KDSoapInProcessReply::readResponse(KDSoapMessage *response, KDSoapHeaders *responseHeaders, KDSoapBodyParser *bodyParser) const
+{
+    if (error() != QNetworkReply::NoError) {
+        return;
+    }
+    const KDSoapMessage &message = m_call->m_response;
+    if (bodyParser && !message.isFault()) {
+        KDSoapMessageWriter writer;
+        writer.setVersion(m_call->m_version);
+        writer.setMessageNamespace(message.namespaceUri());
+        const QByteArray xml = writer.messageToXml(message, QString(), KDSoapHeaders(), QMap<QString, KDSoapMessage>());
+        KDSoapMessageReader reader;
+        reader.setBodyParser(bodyParser);
+        KDSoapHeaders ignoredHeaders;
+        reader.xmlToMessage(xml, response, 0, &ignoredHeaders, m_call->m_version);
+    } else {
+        *response = message;
+    }
+    *responseHeaders = m_call->m_responseHeaders;
+}
+
+void KDSoapInProcessReply::abort()
+{
+    if (isFinished()) {
+        return;
+    }
+    detach();
+    setError(QNetworkReply::OperationCanceledError, QString::fromLatin1("Operation canceled"));
+    setFinished(true);
+    emit finished();
+}
+
+qint64 KDSoapInProcessReply::bytesAvailable() const
+{
+    return QNetworkReply::bytesAvailable();
+}
+
+bool KDSoapInProcessReply::isSequential() const
+{
+    return true;
+}
+
+bool KDSoapInProcessReply::isInProcessEndPoint(const QString &endPoint)
+{
+    return endPoint.startsWith(QLatin1String(s_scheme));
+}
+
+QString KDSoapInProcessReply::serverName(const QString &endPoint)
+{
+    // Not from the URL, which lowercases the host part
+    return endPoint.mid(int(sizeof(s_scheme)) - 1);
+}
+
+qint64 KDSoapInProcessReply::readData(char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1; // the response is read with readResponse()
+}
+
+void KDSoapInProcessReply::slotFinished()
+{
+    if (isFinished()) { // aborted meanwhile
+        return;
+    }
+    detach();
+    setFinished(true);
+    emit finished();
+}
+
+void KDSoapInProcessReply::slotFailed(const QString &errorString)
+{
+    if (isFinished()) {
+        return;
+    }
+    setError(QNetworkReply::HostNotFoundError, errorString);
+    setFinished(true);
+    emit finished();
+}
+
+#include "moc_KDSoapInProcess_p.cpp"
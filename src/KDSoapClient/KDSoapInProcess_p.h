@@ -0,0 +1,140 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPINPROCESS_P_H
+#define KDSOAPINPROCESS_P_H
+
+#include "KDSoapMessage.h"
+#include "KDSoapClientInterface.h"
+#include <QtCore/QMetaType>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QMap>
+#include <QtNetwork/QNetworkReply>
+
+class KDSoapBodyParser;
+class KDSoapInProcessReply;
+class QThread;
+
+/**
+ * \internal
+ * A call made to an inproc:// endpoint: the request and response messages themselves,
+ * shared between the client (which created it) and the server handling it in its own thread.
+ *
+ * Internal class -- only exported for the server lib
+ */
+class KDSOAP_EXPORT KDSoapInProcessCall
+{
+public:
+    // \p elementName and \p messageNamespace as in KDSoapMessageWriter::messageToXml, so the
+    // server object gets what it would get from parsing the XML: named request, one KDSoapMessage per header element
+    KDSoapInProcessCall(const KDSoapMessage &request, const QString &elementName, const QString &messageNamespace,
+                        const KDSoapHeaders &requestHeaders, const QMap<QString, KDSoapMessage> &persistentHeaders,
+                        const QByteArray &soapAction, KDSoap::SoapVersion version);
+
+    KDSoapMessage request() const;
+    KDSoapHeaders requestHeaders() const;
+    QByteArray soapAction() const;
+    KDSoap::SoapVersion soapVersion() const;
+
+    // Called by the server, in its thread. The reply finishes later, in the thread of the client.
+    void finish(const KDSoapMessage &response, const KDSoapHeaders &responseHeaders, const QString &responseNamespace);
+
+private:
+    friend class KDSoapInProcessReply;
+    KDSoapMessage m_request;
+    KDSoapHeaders m_requestHeaders;
+    QByteArray m_soapAction;
+    KDSoap::SoapVersion m_version;
+
+    QMutex m_mutex; // for m_reply, which is deleted in the client thread
+    KDSoapInProcessReply *m_reply;
+    KDSoapMessage m_response;
+    KDSoapHeaders m_responseHeaders;
+};
+
+typedef QSharedPointer<KDSoapInProcessCall> KDSoapInProcessCallPtr;
+Q_DECLARE_METATYPE(KDSoapInProcessCallPtr)
+
+/**
+ * \internal
+ * The other end of inproc:// endpoints, implemented by KDSoapServer.
+ *
+ * Internal class -- only exported for the server lib
+ */
+class KDSOAP_EXPORT KDSoapInProcessHandler
+{
+public:
+    virtual ~KDSoapInProcessHandler();
+
+    // Called in the client thread, with the registry locked: must only queue the call.
+    virtual void handleCall(const KDSoapInProcessCallPtr &call) = 0;
+    // The thread processing the calls
+    virtual QThread *handlerThread() const = 0;
+
+    // \return false if another handler is registered with that name already
+    static bool registerHandler(const QString &name, KDSoapInProcessHandler *handler);
+    // To be called before the handler starts being destroyed
+    static void unregisterHandler(KDSoapInProcessHandler *handler);
+    // \return false if no handler is registered with that name
+    static bool dispatch(const QString &name, const KDSoapInProcessCallPtr &call);
+    // \return the thread of the handler registered with that name, 0 if none
+    static QThread *threadOf(const QString &name);
+};
+
+/**
+ * \internal
+ * The reply to a call to an inproc:// endpoint. It has no data to read, KDSoapPendingCall
+ * takes the response message from it directly.
+ */
+class KDSoapInProcessReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    // Dispatches \p call to the server named in \p endPoint, inproc://name
+    KDSoapInProcessReply(const QString &endPoint, const KDSoapInProcessCallPtr &call, QObject *parent = 0);
+    ~KDSoapInProcessReply();
+
+    // Parses the response through \p bodyParser if set, since body parsers read XML
+    void readResponse(KDSoapMessage *response, KDSoapHeaders *responseHeaders, KDSoapBodyParser *bodyParser) const;
+
+    /*! \reimp */ void abort();
+    /*! \reimp */ qint64 bytesAvailable() const;
+    /*! \reimp */ bool isSequential() const;
+
+    static bool isInProcessEndPoint(const QString &endPoint);
+    // \return the name of the server in \p endPoint, inproc://name
+    static QString serverName(const QString &endPoint);
+
+protected:
+    /*! \reimp */ qint64 readData(char *data, qint64 maxSize);
+
+private Q_SLOTS:
+    void slotFinished();
+    void slotFailed(const QString &errorString);
+
+private:
+    void detach();
+    KDSoapInProcessCallPtr m_call;
+};
+
+#endif // KDSOAPINPROCESS_P_H
@@ -0,0 +1,278 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapJobQueue.h"
+#include "KDSoapJob.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+
+class KDSoapJobQueue::Private
+{
+public:
+    Private()
+        : maxJobsPerEndPoint(6),
+          maxQueuedJobs(1000),
+          batchSize(1),
+          queuedJobs(0),
+          finishedJobs(0),
+          totalJobs(0),
+          faultedJobs(0),
+          refused(false),
+          inJobFinished(false)
+    {
+    }
+
+    struct EndPointQueue {
+        EndPointQueue() : running(0) {}
+        int running;
+        QMap<int, QList<KDSoapJob *> > pending; // by priority, the highest last
+    };
+
+    bool isFull() const
+    {
+        return maxQueuedJobs >= 0 && queuedJobs >= maxQueuedJobs;
+    }
+
+    bool isIdle() const
+    {
+        return queuedJobs == 0 && runningJobs.isEmpty();
+    }
+
+    void startJobs(const QString &endPoint);
+
+    int maxJobsPerEndPoint;
+    int maxQueuedJobs;
+    int batchSize;
+    int queuedJobs;
+    int finishedJobs;
+    int totalJobs;
+    int faultedJobs;
+    bool refused; // enqueue() returned false, spaceAvailable() is due
+    bool inJobFinished; // slotJobFinished() flushes the batch once its signals are emitted
+    QHash<QString, EndPointQueue> endPoints;
+    QHash<KDSoapJob *, QString> runningJobs; // and their endpoint
+    QList<KDSoapJob *> batch;
+};
+
+void KDSoapJobQueue::Private::startJobs(const QString &endPoint)
+{
+    QHash<QString, EndPointQueue>::Iterator it = endPoints.find(endPoint);
+    if (it == endPoints.end()) {
+        return;
+    }
+    EndPointQueue &queue = it.value();
+    while (queue.running < maxJobsPerEndPoint && !queue.pending.isEmpty()) {
+        QMap<int, QList<KDSoapJob *> >::Iterator highest = queue.pending.end() - 1;
+        KDSoapJob *job = highest.value().takeFirst();
+        if (highest.value().isEmpty()) {
+            queue.pending.erase(highest);
+        }
+        --queuedJobs;
+        ++queue.running;
+        runningJobs.insert(job, endPoint);
+        job->start();
+    }
+    if (queue.running == 0) {
+        endPoints.erase(it);
+    }
+}
+
+KDSoapJobQueue::KDSoapJobQueue(QObject *parent)
+    : QObject(parent),
+      d(new Private)
+{
+}
+
+KDSoapJobQueue::~KDSoapJobQueue()
+{
+    // The jobs are child objects, deleted by QObject
+    delete d;
+}
+
+bool KDSoapJobQueue::enqueue(KDSoapJob *job, int priority, const QString &endPoint)
+{
+    if (d->isFull()) {
+        d->refused = true;
+        return false;
+    }
+    if (d->isIdle() && d->batch.isEmpty()) {
+        // A new run
+        d->finishedJobs = 0;
+        d->totalJobs = 0;
+        d->faultedJobs = 0;
+    }
+    job->setParent(this);
+    job->setAutoDelete(false); // deleted after jobsFinished()
+    connect(job, SIGNAL(finished(KDSoapJob*)), this, SLOT(slotJobFinished(KDSoapJob*)));
+    d->endPoints[endPoint].pending[priority].append(job);
+    ++d->queuedJobs;
+    ++d->totalJobs;
+    d->startJobs(endPoint);
+    return true;
+}
+
+void KDSoapJobQueue::clear()
+{
+    const bool wasIdle = d->isIdle() && d->batch.isEmpty();
+    QHash<QString, Private::EndPointQueue>::Iterator it = d->endPoints.begin();
+    while (it != d->endPoints.end()) {
+        QMap<int, QList<KDSoapJob *> >::ConstIterator priorityIt = it.value().pending.constBegin();
+        for (; priorityIt != it.value().pending.constEnd(); ++priorityIt) {
+            qDeleteAll(priorityIt.value());
+        }
+        it.value().pending.clear();
+        if (it.value().running == 0) {
+            it = d->endPoints.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    d->totalJobs -= d->queuedJobs;
+    d->queuedJobs = 0;
+    if (d->refused) {
+        d->refused = false;
+        emit spaceAvailable();
+    }
+    // No running job left to finish the run
+    if (!wasIdle && d->isIdle() && !d->inJobFinished) {
+        flushBatch();
+        if (d->isIdle()) {
+            emit finished();
+        }
+    }
+}
+
+void KDSoapJobQueue::flushBatch()
+{
+    if (d->batch.isEmpty()) {
+        return;
+    }
+    const QList<KDSoapJob *> batch = d->batch;
+    d->batch.clear();
+    emit jobsFinished(batch);
+    Q_FOREACH (KDSoapJob *finishedJob, batch) {
+        finishedJob->deleteLater();
+    }
+}
+
+void KDSoapJobQueue::slotJobFinished(KDSoapJob *job)
+{
+    QHash<KDSoapJob *, QString>::Iterator it = d->runningJobs.find(job);
+    if (it == d->runningJobs.end()) {
+        return;
+    }
+    const QString endPoint = it.value();
+    d->runningJobs.erase(it);
+    --d->endPoints[endPoint].running;
+    ++d->finishedJobs;
+    if (job->isFault()) {
+        ++d->faultedJobs;
+    }
+    d->batch.append(job);
+    d->startJobs(endPoint);
+
+    // The connected slots may call clear()
+    d->inJobFinished = true;
+    emit progress(d->finishedJobs, d->totalJobs);
+    if (d->refused && !d->isFull()) {
+        d->refused = false;
+        emit spaceAvailable();
+    }
+    d->inJobFinished = false;
+    const bool idle = d->isIdle();
+    if (d->batch.count() >= d->batchSize || idle) {
+        flushBatch();
+    }
+    if (idle && d->isIdle()) { // unless jobsFinished() added more jobs
+        emit finished();
+    }
+}
+
+void KDSoapJobQueue::setMaxJobsPerEndPoint(int maxJobs)
+{
+    d->maxJobsPerEndPoint = qMax(1, maxJobs);
+    Q_FOREACH (const QString &endPoint, d->endPoints.keys()) {
+        d->startJobs(endPoint);
+    }
+}
+
+int KDSoapJobQueue::maxJobsPerEndPoint() const
+{
+    return d->maxJobsPerEndPoint;
+}
+
+void KDSoapJobQueue::setMaxQueuedJobs(int maxJobs)
+{
+    d->maxQueuedJobs = maxJobs;
+    if (d->refused && !d->isFull()) {
+        d->refused = false;
+        emit spaceAvailable();
+    }
+}
+
+int KDSoapJobQueue::maxQueuedJobs() const
+{
+    return d->maxQueuedJobs;
+}
+
+void KDSoapJobQueue::setBatchSize(int size)
+{
+    d->batchSize = qMax(1, size);
+}
+
+int KDSoapJobQueue::batchSize() const
+{
+    return d->batchSize;
+}
+
+int KDSoapJobQueue::queuedJobs() const
+{
+    return d->queuedJobs;
+}
+
+int KDSoapJobQueue::runningJobs() const
+{
+    return d->runningJobs.count();
+}
+
+int KDSoapJobQueue::finishedJobs() const
+{
+    return d->finishedJobs;
+}
+
+int KDSoapJobQueue::totalJobs() const
+{
+    return d->totalJobs;
+}
+
+int KDSoapJobQueue::faultedJobs() const
+{
+    return d->faultedJobs;
+}
+
+bool KDSoapJobQueue::isIdle() const
+{
+    return d->isIdle();
+}
+
+#include "moc_KDSoapJobQueue.cpp"
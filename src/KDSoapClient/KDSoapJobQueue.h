@@ -0,0 +1,192 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPJOBQUEUE_H
+#define KDSOAPJOBQUEUE_H
+
+#include "KDSoapGlobal.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+class KDSoapJob;
+
+/**
+ * \brief KDSoapJobQueue runs many KDSoapJob instances, a limited number of them at a time.
+ *
+ * Jobs are added with enqueue(), with a priority: the jobs with the highest priority start first,
+ * and the jobs with the same priority start in the order they were added. At most
+ * maxJobsPerEndPoint() jobs run at the same time for each endpoint, which bounds the number
+ * of connections to each server.
+ *
+ * The jobs only build their request when they start, so the memory used by the requests is
+ * bounded as well: the queued jobs only hold their parameters, and setMaxQueuedJobs() limits
+ * how many of them wait in the queue.
+ *
+ * \code
+ *  KDSoapJobQueue *queue = new KDSoapJobQueue(this);
+ *  queue->setBatchSize(50);
+ *  connect(queue, SIGNAL(jobsFinished(QList<KDSoapJob*>)), this, SLOT(processResults(QList<KDSoapJob*>)));
+ *  connect(queue, SIGNAL(progress(int,int)), this, SLOT(updateProgressBar(int,int)));
+ *  Q_FOREACH (const QString &item, items) {
+ *      GetItemJob *job = new GetItemJob(client);
+ *      job->setName(item);
+ *      queue->enqueue(job, 0, client->endPoint());
+ *  }
+ * \endcode
+ *
+ * The queue takes ownership of the jobs: it deletes them once jobsFinished() was emitted for them.
+ *
+ * \since 1.8
+ */
+class KDSOAP_EXPORT KDSoapJobQueue : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Constructs an empty job queue.
+     *
+     * \param parent optional parent object
+     */
+    explicit KDSoapJobQueue(QObject *parent = 0);
+
+    /**
+     * Destructor. The jobs still queued or running are deleted.
+     */
+    ~KDSoapJobQueue();
+
+    /**
+     * Adds \p job to the queue. It starts as soon as fewer than maxJobsPerEndPoint() jobs
+     * of \p endPoint are running, and no job with a higher priority is waiting for \p endPoint.
+     *
+     * \param job the job, which must not be started yet. The queue takes ownership of it.
+     * \param priority jobs with a higher priority start first
+     * \param endPoint the endpoint the job calls, usually the one of its client interface.
+     *        The jobs added without an endpoint share the same limit.
+     * \return false if the queue already holds maxQueuedJobs() jobs waiting to start. The job
+     *         is then not added, it still belongs to the caller, who can add it again after spaceAvailable().
+     */
+    bool enqueue(KDSoapJob *job, int priority = 0, const QString &endPoint = QString());
+
+    /**
+     * Deletes the jobs waiting to start. The running jobs finish normally.
+     * If none is running, the finished jobs not reported yet are, and finished() is emitted.
+     */
+    void clear();
+
+    /**
+     * Sets how many jobs run at the same time for each endpoint. The default is 6.
+     */
+    void setMaxJobsPerEndPoint(int maxJobs);
+
+    /**
+     * Returns how many jobs run at the same time for each endpoint.
+     */
+    int maxJobsPerEndPoint() const;
+
+    /**
+     * Sets how many jobs can wait to start, for all the endpoints together. The default is 1000;
+     * use -1 for no limit.
+     */
+    void setMaxQueuedJobs(int maxJobs);
+
+    /**
+     * Returns how many jobs can wait to start.
+     */
+    int maxQueuedJobs() const;
+
+    /**
+     * Sets how many finished jobs are reported together by jobsFinished(). The default is 1.
+     */
+    void setBatchSize(int size);
+
+    /**
+     * Returns how many finished jobs are reported together by jobsFinished().
+     */
+    int batchSize() const;
+
+    /**
+     * Returns the number of jobs waiting to start.
+     */
+    int queuedJobs() const;
+
+    /**
+     * Returns the number of jobs currently running.
+     */
+    int runningJobs() const;
+
+    /**
+     * Returns the number of jobs finished since the queue was last idle.
+     */
+    int finishedJobs() const;
+
+    /**
+     * Returns the number of jobs added since the queue was last idle.
+     */
+    int totalJobs() const;
+
+    /**
+     * Returns the number of finished jobs whose reply was a fault, since the queue was last idle.
+     */
+    int faultedJobs() const;
+
+    /**
+     * Returns true if no job is queued or running.
+     */
+    bool isIdle() const;
+
+Q_SIGNALS:
+    /**
+     * Emitted every time a job finishes.
+     * \param finishedJobs the number of jobs finished since the queue was last idle
+     * \param totalJobs the number of jobs added since the queue was last idle
+     */
+    void progress(int finishedJobs, int totalJobs);
+
+    /**
+     * Emitted every batchSize() finished jobs, and for the remaining finished jobs once the queue is idle.
+     * The jobs are deleted after this signal, read their results in the connected slot.
+     */
+    void jobsFinished(const QList<KDSoapJob *> &jobs);
+
+    /**
+     * Emitted when enqueue() can add jobs again, after it refused one because the queue was full.
+     */
+    void spaceAvailable();
+
+    /**
+     * Emitted when all the jobs have finished, after the last jobsFinished().
+     */
+    void finished();
+
+private Q_SLOTS:
+    void slotJobFinished(KDSoapJob *job);
+
+private:
+    void flushBatch();
+
+    class Private;
+    Private *const d;
+};
+
+#endif // KDSOAPJOBQUEUE_H
@@ -0,0 +1,246 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapLoadBalancer_p.h"
+#include <QtNetwork/QNetworkReply>
+
+// The ticket of a request: the generation of the endpoints, the index of the endpoint, and whether it's a probe
+static qint64 makeTicket(int generation, int index, bool probe)
+{
+    return (qint64(generation) << 32) | (qint64(index) << 1) | (probe ? 1 : 0);
+}
+
+static const double s_latencyWeight = 0.3; // of the latest response, in the moving average
+static const int s_maxEjectionDoublings = 4;
+
+KDSoapLoadBalancer::KDSoapLoadBalancer()
+    : m_strategy(KDSoapClientInterface::RoundRobin),
+      m_next(0),
+      m_generation(0),
+      m_maxConsecutiveFailures(3),
+      m_ejectionTime(10000)
+{
+    m_clock.start();
+}
+
+void KDSoapLoadBalancer::setEndPoints(const QStringList &endPoints)
+{
+    QMutexLocker locker(&m_mutex);
+    m_endPoints.clear();
+    Q_FOREACH (const QString &url, endPoints) {
+        EndPoint endPoint;
+        endPoint.url = url;
+        m_endPoints.append(endPoint);
+    }
+    m_next = 0;
+    ++m_generation;
+}
+
+QStringList KDSoapLoadBalancer::endPoints() const
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList urls;
+    Q_FOREACH (const EndPoint &endPoint, m_endPoints) {
+        urls.append(endPoint.url);
+    }
+    return urls;
+}
+
+int KDSoapLoadBalancer::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_endPoints.count();
+}
+
+void KDSoapLoadBalancer::setStrategy(KDSoapClientInterface::LoadBalancing strategy)
+{
+    QMutexLocker locker(&m_mutex);
+    m_strategy = strategy;
+}
+
+KDSoapClientInterface::LoadBalancing KDSoapLoadBalancer::strategy() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_strategy;
+}
+
+void KDSoapLoadBalancer::setEjection(int consecutiveFailures, int msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxConsecutiveFailures = consecutiveFailures;
+    m_ejectionTime = msecs;
+}
+
+QStringList KDSoapLoadBalancer::ejectedEndPoints() const
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList urls;
+    Q_FOREACH (const EndPoint &endPoint, m_endPoints) {
+        if (endPoint.ejectedUntil >= 0) {
+            urls.append(endPoint.url);
+        }
+    }
+    return urls;
+}
+
+bool KDSoapLoadBalancer::isAvailable(const EndPoint &endPoint, qint64 now) const
+{
+    if (endPoint.ejectedUntil < 0) {
+        return true;
+    }
+    // Ready for a probe
+    return endPoint.ejectedUntil <= now && !endPoint.probing;
+}
+
+int KDSoapLoadBalancer::pick(qint64 now)
+{
+    const int count = m_endPoints.count();
+    int best = -1;
+    double bestScore = 0;
+    // Starting from m_next, so that ties are broken in turn
+    for (int i = 0; i < count; ++i) {
+        const int index = (m_next + i) % count;
+        const EndPoint &endPoint = m_endPoints.at(index);
+        if (!isAvailable(endPoint, now)) {
+            continue;
+        }
+        double score;
+        switch (m_strategy) {
+        case KDSoapClientInterface::LeastOutstandingRequests:
+            score = endPoint.outstanding;
+            break;
+        case KDSoapClientInterface::LatencyEwma:
+            // Endpoints without a response yet come first, to measure them
+            score = qMax(endPoint.latency, 0.0) * (endPoint.outstanding + 1);
+            break;
+        default: // RoundRobin
+            score = i;
+            break;
+        }
+        if (best == -1 || score < bestScore) {
+            best = index;
+            bestScore = score;
+        }
+    }
+    if (best == -1) {
+        // All ejected: rather than failing right away, use the one coming back first
+        for (int index = 0; index < count; ++index) {
+            if (best == -1 || m_endPoints.at(index).ejectedUntil < m_endPoints.at(best).ejectedUntil) {
+                best = index;
+            }
+        }
+    }
+    m_next = (best + 1) % count;
+    return best;
+}
+
+QString KDSoapLoadBalancer::startRequest(qint64 *ticket)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_endPoints.isEmpty()) {
+        *ticket = -1;
+        return QString();
+    }
+    const qint64 now = m_clock.elapsed();
+    const int index = pick(now);
+    EndPoint &endPoint = m_endPoints[index];
+    ++endPoint.outstanding;
+    const bool probe = endPoint.ejectedUntil >= 0 && !endPoint.probing;
+    if (probe) {
+        endPoint.probing = true;
+    }
+    *ticket = makeTicket(m_generation, index, probe);
+    return endPoint.url;
+}
+
+void KDSoapLoadBalancer::finishRequest(qint64 ticket, bool success, bool failure, qint64 latency)
+{
+    QMutexLocker locker(&m_mutex);
+    const int index = int((ticket & 0xffffffff) >> 1);
+    const bool probe = ticket & 1;
+    if (int(ticket >> 32) != m_generation || index >= m_endPoints.count()) {
+        return; // the endpoints changed meanwhile
+    }
+    EndPoint &endPoint = m_endPoints[index];
+    --endPoint.outstanding;
+    if (probe) {
+        endPoint.probing = false;
+    }
+    if (success) {
+        endPoint.latency = endPoint.latency < 0 ? latency : s_latencyWeight * latency + (1 - s_latencyWeight) * endPoint.latency;
+        endPoint.consecutiveFailures = 0;
+        endPoint.ejections = 0;
+        endPoint.ejectedUntil = -1;
+    } else if (failure) {
+        ++endPoint.consecutiveFailures;
+        // A failed probe ejects it again; failures of requests started before the ejection don't extend it
+        if (probe || (endPoint.ejectedUntil < 0 && endPoint.consecutiveFailures >= m_maxConsecutiveFailures)) {
+            ++endPoint.ejections;
+            const int factor = 1 << qMin(endPoint.ejections - 1, s_maxEjectionDoublings);
+            endPoint.ejectedUntil = m_clock.elapsed() + qint64(m_ejectionTime) * factor;
+        }
+    }
+}
+
+bool KDSoapLoadBalancer::isTransportFailure(QNetworkReply *reply)
+{
+    const QNetworkReply::NetworkError error = reply->error();
+    if (error == QNetworkReply::OperationCanceledError) {
+        return reply->property("kdsoap_reply_timed_out").toBool(); // otherwise canceled by the application
+    }
+    // Other HTTP errors come from a working server: a SOAP fault, an authentication error...
+    const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    return (error != QNetworkReply::NoError && error < QNetworkReply::ContentAccessDenied)
+           || httpStatus == 502 || httpStatus == 503 || httpStatus == 504;
+}
+
+KDSoapLoadBalancerTracker::KDSoapLoadBalancerTracker(QNetworkReply *reply, const QSharedPointer<KDSoapLoadBalancer> &balancer, qint64 ticket)
+    : QObject(reply),
+      m_balancer(balancer),
+      m_ticket(ticket),
+      m_done(false)
+{
+    m_timer.start();
+    connect(reply, SIGNAL(finished()), this, SLOT(slotFinished()));
+}
+
+KDSoapLoadBalancerTracker::~KDSoapLoadBalancerTracker()
+{
+    if (!m_done) { // deleted without finishing: tells nothing about the endpoint
+        m_balancer->finishRequest(m_ticket, false, false, 0);
+    }
+}
+
+void KDSoapLoadBalancerTracker::slotFinished()
+{
+    if (m_done) {
+        return;
+    }
+    m_done = true;
+    QNetworkReply *reply = static_cast<QNetworkReply *>(parent());
+    const bool failure = KDSoapLoadBalancer::isTransportFailure(reply);
+    // Canceled by the application: tells nothing about the endpoint
+    const bool success = !failure && reply->error() != QNetworkReply::OperationCanceledError;
+    m_balancer->finishRequest(m_ticket, success, failure, m_timer.elapsed());
+}
+
+#include "moc_KDSoapLoadBalancer_p.cpp"
@@ -0,0 +1,117 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPLOADBALANCER_P_H
+#define KDSOAPLOADBALANCER_P_H
+
+#include "KDSoapClientInterface.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+QT_BEGIN_NAMESPACE
+class QNetworkReply;
+QT_END_NAMESPACE
+
+/**
+ * \internal
+ * Picks the endpoint of each request among the endpoints of a KDSoapClientInterface,
+ * and keeps track of their health from the outcome of the requests.
+ *
+ * An endpoint failing several requests in a row is ejected for a while, after which a single
+ * request probes it: it's back if that request succeeds, and ejected again, for twice as long, otherwise.
+ *
+ * Thread-safe: used by asynchronous calls and by the thread of blocking calls.
+ */
+class KDSoapLoadBalancer
+{
+public:
+    KDSoapLoadBalancer();
+
+    void setEndPoints(const QStringList &endPoints);
+    QStringList endPoints() const;
+    int count() const;
+    void setStrategy(KDSoapClientInterface::LoadBalancing strategy);
+    KDSoapClientInterface::LoadBalancing strategy() const;
+    void setEjection(int consecutiveFailures, int msecs);
+
+    // Picks the endpoint for a new request. \p ticket identifies it for finishRequest()
+    QString startRequest(qint64 *ticket);
+    // Records the outcome of the request started with \p ticket
+    void finishRequest(qint64 ticket, bool success, bool failure, qint64 latency);
+    QStringList ejectedEndPoints() const;
+
+    // True if \p reply failed to reach a working server: connection refused, timeout, 502, 503 or 504 HTTP status...
+    static bool isTransportFailure(QNetworkReply *reply);
+
+private:
+    struct EndPoint {
+        EndPoint()
+            : outstanding(0), latency(-1), consecutiveFailures(0), ejections(0), ejectedUntil(-1), probing(false)
+        {
+        }
+        QString url;
+        int outstanding;
+        double latency; // EWMA, in msecs; -1 until the first response
+        int consecutiveFailures;
+        int ejections; // in a row, to double the ejection time
+        qint64 ejectedUntil; // -1 if not ejected
+        bool probing; // a request is checking that an ejected endpoint is back
+    };
+    bool isAvailable(const EndPoint &endPoint, qint64 now) const;
+    int pick(qint64 now);
+
+    mutable QMutex m_mutex;
+    QVector<EndPoint> m_endPoints;
+    KDSoapClientInterface::LoadBalancing m_strategy;
+    int m_next; // for round-robin, and to break ties
+    int m_generation; // ignores the requests started before setEndPoints()
+    int m_maxConsecutiveFailures;
+    int m_ejectionTime;
+    QElapsedTimer m_clock;
+};
+
+/**
+ * \internal
+ * Reports the outcome of a request to KDSoapLoadBalancer. Child of the reply.
+ */
+class KDSoapLoadBalancerTracker : public QObject
+{
+    Q_OBJECT
+public:
+    KDSoapLoadBalancerTracker(QNetworkReply *reply, const QSharedPointer<KDSoapLoadBalancer> &balancer, qint64 ticket);
+    ~KDSoapLoadBalancerTracker();
+
+private Q_SLOTS:
+    void slotFinished();
+
+private:
+    QSharedPointer<KDSoapLoadBalancer> m_balancer;
+    qint64 m_ticket;
+    QElapsedTimer m_timer;
+    bool m_done;
+};
+
+#endif // KDSOAPLOADBALANCER_P_H
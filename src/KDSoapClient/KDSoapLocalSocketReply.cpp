@@ -0,0 +1,227 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapLocalSocketReply_p.h"
+#include <QtNetwork/QNetworkAccessManager>
+
+static const char s_scheme[] = "unix://";
+
+// Enough to keep the socket busy, without reading the whole request device into memory
+static const int s_uploadChunkSize = 64 * 1024;
+
+KDSoapLocalSocketReply::KDSoapLocalSocketReply(const QString &endPoint, const QNetworkRequest &request, QIODevice *outgoingData, QObject *parent)
+    : QNetworkReply(parent),
+      m_socket(new QLocalSocket(this)),
+      m_outgoingData(outgoingData),
+      m_bodyPos(0)
+{
+    setRequest(request);
+    setUrl(QUrl(endPoint));
+    setOperation(QNetworkAccessManager::PostOperation);
+    open(QIODevice::ReadOnly);
+
+    parseEndPoint(endPoint, &m_socketPath, &m_httpPath);
+    connect(m_socket, SIGNAL(connected()), this, SLOT(slotConnected()));
+    connect(m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(slotBytesWritten()));
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
+    connect(m_socket, SIGNAL(disconnected()), this, SLOT(slotDisconnected()));
+    connect(m_socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(slotError(QLocalSocket::LocalSocketError)));
+    // Queued, like QNetworkAccessManager: connectToServer can fail right away, and
+    // the caller connects to finished() after this
+    QMetaObject::invokeMethod(this, "slotStart", Qt::QueuedConnection);
+}
+
+KDSoapLocalSocketReply::~KDSoapLocalSocketReply()
+{
+}
+
+bool KDSoapLocalSocketReply::isLocalSocketEndPoint(const QString &endPoint)
+{
+    return endPoint.startsWith(QLatin1String(s_scheme));
+}
+
+void KDSoapLocalSocketReply::parseEndPoint(const QString &endPoint, QString *socketPath, QByteArray *httpPath)
+{
+    const QString path = endPoint.mid(int(sizeof(s_scheme)) - 1);
+    const int separator = path.indexOf(QLatin1String(":/"));
+    if (separator == -1) {
+        *socketPath = path;
+        *httpPath = "/";
+    } else {
+        *socketPath = path.left(separator);
+        *httpPath = path.mid(separator + 1).toUtf8();
+    }
+}
+
+void KDSoapLocalSocketReply::slotStart()
+{
+    if (!isFinished()) { // not aborted meanwhile
+        m_socket->connectToServer(m_socketPath);
+    }
+}
+
+void KDSoapLocalSocketReply::slotConnected()
+{
+    const QNetworkRequest req = request();
+    QByteArray header = "POST " + m_httpPath + " HTTP/1.1\r\n"
+                        "Host: localhost\r\n"
+                        "Connection: close\r\n";
+    header += "Content-Length: " + QByteArray::number(m_outgoingData ? m_outgoingData->size() : 0) + "\r\n";
+    Q_FOREACH (const QByteArray &name, req.rawHeaderList()) {
+        header += name + ": " + req.rawHeader(name) + "\r\n";
+    }
+    header += "\r\n";
+    m_socket->write(header);
+    sendMoreData();
+}
+
+void KDSoapLocalSocketReply::slotBytesWritten()
+{
+    sendMoreData();
+}
+
+void KDSoapLocalSocketReply::sendMoreData()
+{
+    if (!m_outgoingData) {
+        return;
+    }
+    while (m_socket->bytesToWrite() < s_uploadChunkSize && !m_outgoingData->atEnd()) {
+        const QByteArray chunk = m_outgoingData->read(s_uploadChunkSize);
+        if (chunk.isEmpty()) {
+            break;
+        }
+        m_socket->write(chunk);
+    }
+}
+
+void KDSoapLocalSocketReply::slotReadyRead()
+{
+    const QByteArray data = m_socket->readAll();
+    if (!m_parser.feed(data.constData(), data.size())) {
+        fail(QNetworkReply::ProtocolFailure, QString::fromLatin1("Invalid HTTP response"));
+    } else if (m_parser.isComplete()) {
+        finishResponse();
+    }
+}
+
+void KDSoapLocalSocketReply::slotDisconnected()
+{
+    if (isFinished()) {
+        return;
+    }
+    const QByteArray data = m_socket->readAll();
+    if (!m_parser.feed(data.constData(), data.size())) {
+        fail(QNetworkReply::ProtocolFailure, QString::fromLatin1("Invalid HTTP response"));
+    } else if (m_parser.isComplete() || m_parser.finishAtEndOfStream()) {
+        finishResponse();
+    } else {
+        fail(QNetworkReply::RemoteHostClosedError, QString::fromLatin1("Connection closed"));
+    }
+}
+
+void KDSoapLocalSocketReply::slotError(QLocalSocket::LocalSocketError socketError)
+{
+    if (isFinished()) {
+        return;
+    }
+    switch (socketError) {
+    case QLocalSocket::PeerClosedError:
+        slotDisconnected();
+        break;
+    case QLocalSocket::ServerNotFoundError:
+        fail(QNetworkReply::HostNotFoundError, m_socket->errorString());
+        break;
+    case QLocalSocket::ConnectionRefusedError:
+        fail(QNetworkReply::ConnectionRefusedError, m_socket->errorString());
+        break;
+    case QLocalSocket::SocketTimeoutError:
+        fail(QNetworkReply::TimeoutError, m_socket->errorString());
+        break;
+    default:
+        fail(QNetworkReply::UnknownNetworkError, m_socket->errorString());
+        break;
+    }
+}
+
+void KDSoapLocalSocketReply::finishResponse()
+{
+    m_socket->disconnect(this);
+    m_socket->abort(); // one request per connection
+    m_body = m_parser.takeBody();
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, m_parser.statusCode());
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, m_parser.reasonPhrase());
+    Q_FOREACH (const KDSoapHttpResponseParser::RawHeaderPair &header, m_parser.headers()) {
+        setRawHeader(header.first, header.second);
+    }
+    const QNetworkReply::NetworkError errorCode = KDSoapHttpResponseParser::errorForStatusCode(m_parser.statusCode());
+    if (errorCode != QNetworkReply::NoError) {
+        setError(errorCode, QString::fromLatin1("Error transferring %1 - server replied: %2")
+                 .arg(url().toString(), QString::fromLatin1(m_parser.reasonPhrase())));
+    }
+    setFinished(true);
+    emit metaDataChanged();
+    if (!m_body.isEmpty()) {
+        emit readyRead();
+    }
+    emit finished();
+}
+
+void KDSoapLocalSocketReply::fail(QNetworkReply::NetworkError errorCode, const QString &errorString)
+{
+    m_socket->disconnect(this);
+    m_socket->abort();
+    setError(errorCode, errorString);
+    setFinished(true);
+    emit finished();
+}
+
+void KDSoapLocalSocketReply::abort()
+{
+    if (isFinished()) {
+        return;
+    }
+    fail(QNetworkReply::OperationCanceledError, QString::fromLatin1("Operation canceled"));
+}
+
+qint64 KDSoapLocalSocketReply::bytesAvailable() const
+{
+    return QNetworkReply::bytesAvailable() + m_body.size() - m_bodyPos;
+}
+
+bool KDSoapLocalSocketReply::isSequential() const
+{
+    return true;
+}
+
+qint64 KDSoapLocalSocketReply::readData(char *data, qint64 maxSize)
+{
+    const int bytes = int(qMin<qint64>(maxSize, m_body.size() - m_bodyPos));
+    if (bytes == 0 && isFinished()) {
+        return -1;
+    }
+    memcpy(data, m_body.constData() + m_bodyPos, bytes);
+    m_bodyPos += bytes;
+    return bytes;
+}
+
+#include "moc_KDSoapLocalSocketReply_p.cpp"
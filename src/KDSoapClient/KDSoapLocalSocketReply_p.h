@@ -0,0 +1,79 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPLOCALSOCKETREPLY_P_H
+#define KDSOAPLOCALSOCKETREPLY_P_H
+
+#include "KDSoapHttpResponseParser_p.h"
+#include <QtNetwork/QLocalSocket>
+#include <QtNetwork/QNetworkReply>
+
+/**
+ * \internal
+ * A HTTP POST request over a Unix domain socket, for unix:// endpoints, which QNetworkAccessManager
+ * doesn't support. The endpoint is "unix://" followed by the path of the socket, and optionally by
+ * ":" and the HTTP path, e.g. "unix:///run/service.sock:/soap". The HTTP path defaults to "/".
+ *
+ * Each request uses its own connection.
+ */
+class KDSoapLocalSocketReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    // Takes the headers from \p request, and sends the contents of \p outgoingData, which must have a known size
+    KDSoapLocalSocketReply(const QString &endPoint, const QNetworkRequest &request, QIODevice *outgoingData, QObject *parent = 0);
+    ~KDSoapLocalSocketReply();
+
+    /*! \reimp */ void abort();
+    /*! \reimp */ qint64 bytesAvailable() const;
+    /*! \reimp */ bool isSequential() const;
+
+    static bool isLocalSocketEndPoint(const QString &endPoint);
+    // Splits \p endPoint into the path of the socket and the HTTP path
+    static void parseEndPoint(const QString &endPoint, QString *socketPath, QByteArray *httpPath);
+
+protected:
+    /*! \reimp */ qint64 readData(char *data, qint64 maxSize);
+
+private Q_SLOTS:
+    void slotStart();
+    void slotConnected();
+    void slotBytesWritten();
+    void slotReadyRead();
+    void slotDisconnected();
+    void slotError(QLocalSocket::LocalSocketError socketError);
+
+private:
+    void sendMoreData();
+    void finishResponse();
+    void fail(QNetworkReply::NetworkError errorCode, const QString &errorString);
+
+    QLocalSocket *m_socket;
+    QIODevice *m_outgoingData;
+    QString m_socketPath;
+    QByteArray m_httpPath;
+    KDSoapHttpResponseParser m_parser;
+    QByteArray m_body;
+    int m_bodyPos;
+};
+
+#endif // KDSOAPLOCALSOCKETREPLY_P_H
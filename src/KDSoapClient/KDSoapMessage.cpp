@@ -23,6 +23,7 @@
 #include "KDSoapMessage.h"
 #include "KDSoapNamespaceManager.h"
 #include "KDSoapNamespacePrefixes_p.h"
+#include "KDSoapBodyWriter.h"
 #include "KDDateTime.h"
 #include <QDebug>
 #include <QXmlStreamReader>
@@ -39,6 +40,7 @@ public:
     bool isFault;
     bool hasMessageAddressingProperties;
     KDSoapMessageAddressingProperties messageAddressingProperties;
+    QSharedPointer<KDSoapBodyWriter> bodyWriter;
 };
 
 KDSoapMessage::KDSoapMessage()
@@ -204,6 +206,16 @@ void KDSoapMessage::setUse(Use use)
     d->use = use;
 }
 
+void KDSoapMessage::setBodyWriter(const QSharedPointer<KDSoapBodyWriter> &writer)
+{
+    d->bodyWriter = writer;
+}
+
+QSharedPointer<KDSoapBodyWriter> KDSoapMessage::bodyWriter() const
+{
+    return d->bodyWriter;
+}
+
 KDSoapMessage KDSoapHeaders::header(const QString &name) const
 {
     const_iterator it = begin();
@@ -231,5 +243,5 @@ KDSoapMessage KDSoapHeaders::header(const QString &name, const QString &namespac
 
 bool KDSoapMessage::isNull() const
 {
-    return childValues().isEmpty() && childValues().attributes().isEmpty() && value().isNull();
+    return childValues().isEmpty() && childValues().attributes().isEmpty() && value().isNull() && !d->bodyWriter;
 }
@@ -24,6 +24,7 @@
 #define KDSOAPMESSAGE_H
 
 #include <QtCore/QSharedDataPointer>
+#include <QtCore/QSharedPointer>
 #include <QtCore/QVariant>
 
 #include "KDSoapValue.h"
@@ -34,6 +35,7 @@ class QString;
 QT_END_NAMESPACE
 class KDSoapMessageData;
 class KDSoapHeaders;
+class KDSoapBodyWriter;
 
 /**
  * The KDSoapMessage class represents one message sent or received via SOAP.
@@ -84,6 +86,22 @@ public:
      */
     Use use() const;
 
+    /**
+     * Sets a writer for the contents of the message element.
+     * When set, the child values and attributes of this message are ignored when sending it:
+     * the message element is written with the name and namespace of this message,
+     * and \p writer writes everything inside it, straight to the XML stream.
+     * This is only supported for #LiteralUse.
+     * \see KDSoapBodyWriter
+     * \since 1.8
+     */
+    void setBodyWriter(const QSharedPointer<KDSoapBodyWriter> &writer);
+    /**
+     * Returns the writer passed to setBodyWriter(), or a null pointer.
+     * \since 1.8
+     */
+    QSharedPointer<KDSoapBodyWriter> bodyWriter() const;
+
     /**
      * Adds an argument to the message.
      *
@@ -185,6 +203,7 @@ private:
     friend class KDSoapPendingCall;
     friend class KDSoapServerSocket;
     friend class KDSoapMessageWriter;
+    friend class KDSoapInProcessCall;
     QSharedDataPointer<KDSoapMessageData> d;
 };
 
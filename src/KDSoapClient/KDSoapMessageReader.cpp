@@ -25,9 +25,17 @@
 #include "KDSoapNamespaceManager.h"
 #include "KDSoapNamespacePrefixes_p.h"
 #include "KDDateTime.h"
+#include "KDSoapBodyParser.h"
+#include "KDSoapMtom_p.h"
+#include "KDSoapNumericCodec.h"
+#include "KDSoapBinaryEncoding_p.h"
+#include "KDSoapMessageWriter_p.h"
 
 #include <QDebug>
 #include <QXmlStreamReader>
+#include <QThreadStorage>
+
+#include <string.h>
 
 // Wrapper for compatibility with Qt < 4.6.
 static bool readNextStartElement(QXmlStreamReader &reader)
@@ -60,29 +68,54 @@ static QStringRef namespaceForPrefix(const QXmlStreamNamespaceDeclarations &decl
 static int xmlTypeToMetaType(const QString &xmlType)
 {
     // Reverse operation from variantToXmlType in KDSoapClientInterface, keep in sync
-    static const struct {
-        const char *xml; // xsd: prefix assumed
-        const int metaTypeId;
-    } s_types[] = {
-        { "string", QVariant::String }, // or QUrl
-        { "base64Binary", QVariant::ByteArray },
-        { "int", QVariant::Int }, // or long, or uint, or longlong
-        { "unsignedInt", QVariant::ULongLong },
-        { "boolean", QVariant::Bool },
-        { "float", QMetaType::Float },
-        { "double", QVariant::Double },
-        { "time", QVariant::Time },
-        { "date", QVariant::Date }
-    };
-    // Speed: could be sorted and then we could use qBinaryFind
-    static const int s_numTypes = sizeof(s_types) / sizeof(*s_types);
-    for (int i = 0; i < s_numTypes; ++i) {
-        if (xmlType == QLatin1String(s_types[i].xml)) {
-            return s_types[i].metaTypeId;
+    // xsd: prefix assumed. Dispatch on the length first, this is called for every element with an xsi:type.
+    switch (xmlType.size()) {
+    case 3:
+        if (xmlType == QLatin1String("int")) {
+            return QVariant::Int; // or long, or uint, or longlong
         }
-    }
-    if (xmlType == QLatin1String("dateTime")) {
-        return qMetaTypeId<KDDateTime>();
+        break;
+    case 4:
+        if (xmlType == QLatin1String("time")) {
+            return QVariant::Time;
+        }
+        if (xmlType == QLatin1String("date")) {
+            return QVariant::Date;
+        }
+        break;
+    case 5:
+        if (xmlType == QLatin1String("float")) {
+            return QMetaType::Float;
+        }
+        break;
+    case 6:
+        if (xmlType == QLatin1String("string")) {
+            return QVariant::String; // or QUrl
+        }
+        if (xmlType == QLatin1String("double")) {
+            return QVariant::Double;
+        }
+        break;
+    case 7:
+        if (xmlType == QLatin1String("boolean")) {
+            return QVariant::Bool;
+        }
+        break;
+    case 8:
+        if (xmlType == QLatin1String("dateTime")) {
+            return qMetaTypeId<KDDateTime>();
+        }
+        break;
+    case 11:
+        if (xmlType == QLatin1String("unsignedInt")) {
+            return QVariant::ULongLong;
+        }
+        break;
+    case 12:
+        if (xmlType == QLatin1String("base64Binary")) {
+            return QVariant::ByteArray;
+        }
+        break;
     }
     // This will happen with any custom type, don't bother the user
     //qDebug() << QString::fromLatin1("xmlTypeToMetaType: XML type %1 is not supported in "
@@ -90,7 +123,83 @@ static int xmlTypeToMetaType(const QString &xmlType)
     return -1;
 }
 
-static KDSoapValue parseElement(QXmlStreamReader &reader, const QXmlStreamNamespaceDeclarations &envNsDecls)
+template <typename T>
+static bool parseNumber(const QString &text, QVariant *result)
+{
+    T value;
+    if (!KDSoapNumericCodec::parse(text.constData(), text.size(), &value)) {
+        return false;
+    }
+    *result = QVariant::fromValue(value);
+    return true;
+}
+
+// Converts the text of a numeric value without going through QVariant::convert
+// \return false if \p metaTypeId isn't numeric, or if the text isn't in a lexical form we handle
+static bool parseNumericText(const QString &text, int metaTypeId, QVariant *result)
+{
+    switch (metaTypeId) {
+    case QVariant::Int:
+        return parseNumber<int>(text, result);
+    case QVariant::ULongLong:
+        return parseNumber<quint64>(text, result);
+    case QVariant::Bool:
+        return parseNumber<bool>(text, result);
+    case QVariant::Double:
+        return parseNumber<double>(text, result);
+    case QMetaType::Float:
+        return parseNumber<float>(text, result);
+    }
+    return false;
+}
+
+// Same for xsd:date and xsd:time, see KDDateTime
+static bool parseDateOrTimeText(const QString &text, int metaTypeId, QVariant *result)
+{
+    if (metaTypeId == QVariant::Date) {
+        const QDate date = KDDateTime::dateFromString(text);
+        if (date.isValid()) {
+            *result = date;
+            return true;
+        }
+    } else if (metaTypeId == QVariant::Time) {
+        const QTime time = KDDateTime::timeFromString(text);
+        if (time.isValid()) {
+            *result = time;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void skipElement(QXmlStreamReader &reader)
+{
+    int depth = 1;
+    while (depth > 0 && reader.readNext() != QXmlStreamReader::Invalid) {
+        if (reader.isStartElement()) {
+            ++depth;
+        } else if (reader.isEndElement()) {
+            --depth;
+        }
+    }
+}
+
+// Reads the xop:Include element \p reader is positioned on, if it is one.
+static bool readXopInclude(QXmlStreamReader &reader, const KDSoapMtomPackage *mtomPackage, QByteArray *data, QString *contentType, QIODevice **device = 0)
+{
+    if (!mtomPackage || reader.name() != QLatin1String("Include") ||
+            reader.namespaceUri() != KDSoapNamespaceManager::xmlBinaryOptimizedPackaging()) {
+        return false;
+    }
+    const QString href = reader.attributes().value(QLatin1String("href")).toString();
+    if (!mtomPackage->attachment(href, data, contentType, device)) {
+        qWarning() << "KDSoap: MTOM attachment not found:" << href;
+    }
+    skipElement(reader);
+    return true;
+}
+
+static KDSoapValue parseElement(QXmlStreamReader &reader, const QXmlStreamNamespaceDeclarations &envNsDecls, const KDSoapMtomPackage *mtomPackage)
 {
     const QXmlStreamNamespaceDeclarations combinedNamespaceDeclarations = envNsDecls + reader.namespaceDeclarations();
     const QString name = reader.name().toString();
@@ -127,6 +236,7 @@ static KDSoapValue parseElement(QXmlStreamReader &reader, const QXmlStreamNamesp
         val.childValues().attributes().append(KDSoapValue(name.toString(), attrValue.toString()));
     }
     QString text;
+    bool isAttachment = false;
     while (reader.readNext() != QXmlStreamReader::Invalid) {
         if (reader.isEndElement()) {
             break;
@@ -135,17 +245,37 @@ static KDSoapValue parseElement(QXmlStreamReader &reader, const QXmlStreamNamesp
             text = reader.text().toString();
             //qDebug() << "text=" << text;
         } else if (reader.isStartElement()) {
-            const KDSoapValue subVal = parseElement(reader, combinedNamespaceDeclarations); // recurse
+            QByteArray data;
+            QString contentType;
+            QIODevice *device = 0;
+            if (readXopInclude(reader, mtomPackage, &data, &contentType, &device)) {
+                // MTOM: the value holds the raw bytes, there's nothing to decode
+                if (device) {
+                    val.setBinaryDevice(device);
+                } else {
+                    val.setValue(data);
+                }
+                val.setContentType(contentType);
+                isAttachment = true;
+                continue;
+            }
+            const KDSoapValue subVal = parseElement(reader, combinedNamespaceDeclarations, mtomPackage); // recurse
             val.childValues().append(subVal);
         }
     }
 
-    if (!text.isEmpty()) {
+    if (isAttachment) {
+        // done
+    } else if (!text.isEmpty() && metaTypeId == QVariant::ByteArray) {
+        // Keep base64 as bytes: decoding is up to the caller, and writing it out again doesn't re-encode it
+        val.setEncodedBinaryValue(text.toLatin1());
+    } else if (!text.isEmpty()) {
         QVariant variant(text);
         //qDebug() << text << variant << metaTypeId;
         // With use=encoded, we have type info, we can convert the variant here
         // Otherwise, for servers, we do it later, once we know the method's parameter types.
-        if (metaTypeId != QVariant::Invalid) {
+        if (metaTypeId != QVariant::Invalid && !parseNumericText(text, metaTypeId, &variant)
+                && !parseDateOrTimeText(text, metaTypeId, &variant)) {
             QVariant copy = variant;
             if (!variant.convert(metaTypeId)) {
                 variant = copy;
@@ -157,53 +287,132 @@ static KDSoapValue parseElement(QXmlStreamReader &reader, const QXmlStreamNamesp
 }
 
 KDSoapMessageReader::KDSoapMessageReader()
+    : m_bodyParser(0),
+      m_mtomPackage(0)
 {
 }
 
-static bool isInvalidCharRef(const QByteArray &charRef)
+void KDSoapMessageReader::setBodyParser(KDSoapBodyParser *parser)
 {
-    bool ok = true;
-    int symbol = charRef.indexOf('x');
-    int end = charRef.indexOf(';');
+    m_bodyParser = parser;
+}
 
-    if (symbol == -1 || end == -1) {
-        return false;
-    }
+void KDSoapMessageReader::setMtomPackage(const KDSoapMtomPackage *package)
+{
+    m_mtomPackage = package;
+}
 
-    uint val = charRef.mid(symbol + 1, end - symbol - 1).toInt(&ok, 16);
+// What parseElement needs, while a body parser is running in this thread:
+// the namespace declarations of the envelope (QXmlStreamReader doesn't give access to the
+// declarations in scope, but they're needed for xsi:type and QName values), and the MTOM attachments.
+struct KDSoapBodyParserContext {
+    QXmlStreamNamespaceDeclarations envNsDecls;
+    const KDSoapMtomPackage *mtomPackage;
+};
+static QThreadStorage<KDSoapBodyParserContext *> s_bodyParserContext;
 
-    if (!ok) {
-        return false;
+KDSoapValue KDSoapMessageReader::parseBodyElement(QXmlStreamReader &reader)
+{
+    const KDSoapBodyParserContext *context = s_bodyParserContext.localData();
+    if (!context) {
+        return parseElement(reader, QXmlStreamNamespaceDeclarations(), 0);
     }
+    return parseElement(reader, context->envNsDecls, context->mtomPackage);
+}
 
-    if (val != 0x9 && val != 0xa && val != 0xd && (val <= 0x20)) {
-        return true;
-    }
+bool KDSoapMessageReader::readBodyXopInclude(QXmlStreamReader &reader, QByteArray *data, QString *contentType)
+{
+    const KDSoapBodyParserContext *context = s_bodyParserContext.localData();
+    return readXopInclude(reader, context ? context->mtomPackage : 0, data, contentType);
+}
 
-    return false;
+static bool runBodyParser(KDSoapBodyParser *parser, QXmlStreamReader &reader, const QXmlStreamNamespaceDeclarations &envNsDecls, const KDSoapMtomPackage *mtomPackage)
+{
+    KDSoapBodyParserContext *context = new KDSoapBodyParserContext;
+    context->envNsDecls = envNsDecls + reader.namespaceDeclarations();
+    context->mtomPackage = mtomPackage;
+    s_bodyParserContext.setLocalData(context);
+    const bool handled = parser->parseBody(reader);
+    s_bodyParserContext.setLocalData(0);
+    return handled;
 }
 
-static QByteArray handleNotWellFormedError(const QByteArray &data, qint64 offset)
+// http://www.w3.org/TR/xml/#charsets
+static bool isXmlChar(uint ch)
 {
-    qint64 i = offset - 1; // offset is the char following the failing one
-    QByteArray dataCleanedUp;
-    QByteArray originalSequence;
+    return ch == 0x9 || ch == 0xa || ch == 0xd
+           || (ch >= 0x20 && ch <= 0xd7ff)
+           || (ch >= 0xe000 && ch <= 0xfffd)
+           || (ch >= 0x10000 && ch <= 0x10ffff);
+}
 
-    while (i >= 0 && data.at(i) != '&') {
-        if (data.at(i) == '<') { // InvalidXML but not invalid characters related
-            return dataCleanedUp;
+// If the character reference starting at \p p (after "&#") is complete, sets \p end
+// to the character following its ';' and \p ch to the referenced character.
+static bool readCharRef(const char *p, const char *dataEnd, const char **end, uint *ch)
+{
+    int base = 10;
+    if (p != dataEnd && *p == 'x') {
+        base = 16;
+        ++p;
+    }
+    uint value = 0;
+    int digits = 0;
+    for (; p != dataEnd && *p != ';'; ++p) {
+        int digit;
+        if (*p >= '0' && *p <= '9') {
+            digit = *p - '0';
+        } else if (base == 16 && *p >= 'a' && *p <= 'f') {
+            digit = *p - 'a' + 10;
+        } else if (base == 16 && *p >= 'A' && *p <= 'F') {
+            digit = *p - 'A' + 10;
+        } else {
+            return false;
         }
-
-        originalSequence.prepend(data.at(i));
-        i--;
+        if (++digits > 8) {
+            return false;
+        }
+        value = value * base + digit;
     }
+    if (p == dataEnd || digits == 0) {
+        return false;
+    }
+    *end = p + 1;
+    *ch = value;
+    return true;
+}
 
-    if (isInvalidCharRef(originalSequence)) {
-        qWarning() << "found an invalid character sequence to remove:" << QLatin1String(originalSequence.prepend('&').constData());
-        dataCleanedUp = data;
-        dataCleanedUp = dataCleanedUp.replace(originalSequence, "?");
+// Some servers send references to characters which aren't allowed in XML, like &#x13;,
+// which QXmlStreamReader rightfully rejects. Replace them all with '?' in a single pass.
+// Returns a null QByteArray if there are none.
+static QByteArray replaceInvalidCharRefs(const QByteArray &data)
+{
+    QByteArray result;
+    int replaced = 0;
+    const char *begin = data.constData();
+    const char *dataEnd = begin + data.size();
+    const char *copied = begin; // everything before this is in result already
+    const char *p = begin;
+    while ((p = static_cast<const char *>(memchr(p, '&', dataEnd - p)))) {
+        const char *refEnd;
+        uint ch;
+        if (p + 1 != dataEnd && p[1] == '#' && readCharRef(p + 2, dataEnd, &refEnd, &ch) && !isXmlChar(ch)) {
+            if (result.isNull()) {
+                result.reserve(data.size());
+            }
+            result.append(copied, int(p - copied));
+            result.append('?');
+            copied = refEnd;
+            p = refEnd;
+            ++replaced;
+        } else {
+            ++p;
+        }
+    }
+    if (replaced > 0) {
+        result.append(copied, int(dataEnd - copied));
+        qWarning() << "KDSoap: replaced" << replaced << "invalid character references with '?'";
     }
-    return dataCleanedUp;
+    return result;
 }
 
 KDSoapMessageReader::XmlError KDSoapMessageReader::xmlToMessage(const QByteArray &data, KDSoapMessage *pMsg, QString *pMessageNamespace, KDSoapHeaders *pRequestHeaders, KDSoap::SoapVersion soapVersion) const
@@ -220,11 +429,11 @@ KDSoapMessageReader::XmlError KDSoapMessageReader::xmlToMessage(const QByteArray
                     KDSoapMessageAddressingProperties messageAddressingProperties;
                     while (readNextStartElement(reader)) {
                         if (KDSoapMessageAddressingProperties::isWSAddressingNamespace(reader.namespaceUri().toString())) {
-                            KDSoapValue value = parseElement(reader, envNsDecls);
+                            KDSoapValue value = parseElement(reader, envNsDecls, m_mtomPackage);
                             messageAddressingProperties.readMessageAddressingProperty(value);
                         } else {
                             KDSoapMessage header;
-                            static_cast<KDSoapValue &>(header) = parseElement(reader, envNsDecls);
+                            static_cast<KDSoapValue &>(header) = parseElement(reader, envNsDecls, m_mtomPackage);
                             pRequestHeaders->append(header);
                         }
                     }
@@ -234,7 +443,19 @@ KDSoapMessageReader::XmlError KDSoapMessageReader::xmlToMessage(const QByteArray
                 if (reader.name() == QLatin1String("Body") && (reader.namespaceUri() == KDSoapNamespaceManager::soapEnvelope() ||
                         reader.namespaceUri() == KDSoapNamespaceManager::soapEnvelope200305())) {
                     if (readNextStartElement(reader)) {
-                        *pMsg = parseElement(reader, envNsDecls);
+                        const bool isFault = reader.name() == QLatin1String("Fault") && (reader.namespaceUri() == KDSoapNamespaceManager::soapEnvelope() ||
+                                                                                        reader.namespaceUri() == KDSoapNamespaceManager::soapEnvelope200305());
+                        if (m_bodyParser && !isFault) {
+                            KDSoapValue bodyElement(reader.name().toString(), QVariant());
+                            bodyElement.setNamespaceUri(reader.namespaceUri().toString());
+                            if (runBodyParser(m_bodyParser, reader, envNsDecls, m_mtomPackage)) {
+                                *pMsg = bodyElement;
+                            } else {
+                                *pMsg = parseElement(reader, envNsDecls, m_mtomPackage);
+                            }
+                        } else {
+                            *pMsg = parseElement(reader, envNsDecls, m_mtomPackage);
+                        }
                         if (pMessageNamespace) {
                             *pMessageNamespace = pMsg->namespaceUri();
                         }
@@ -257,7 +478,9 @@ KDSoapMessageReader::XmlError KDSoapMessageReader::xmlToMessage(const QByteArray
     if (reader.hasError()) {
         if (reader.error() == QXmlStreamReader::NotWellFormedError) {
             qWarning() << "Handling a Not well Formed Error";
-            QByteArray dataCleanedUp = handleNotWellFormedError(data, reader.characterOffset());
+            // Only done now, so that the common case doesn't pay for it. After this, there are
+            // no invalid character references left, so this happens at most once per message.
+            const QByteArray dataCleanedUp = replaceInvalidCharRefs(data);
             if (!dataCleanedUp.isEmpty()) {
                 return xmlToMessage(dataCleanedUp, pMsg, pMessageNamespace, pRequestHeaders, soapVersion);
             }
@@ -272,3 +495,28 @@ KDSoapMessageReader::XmlError KDSoapMessageReader::xmlToMessage(const QByteArray
 
     return NoError;
 }
+
+KDSoapMessageReader::XmlError KDSoapMessageReader::binaryToMessage(const QByteArray &data, KDSoapMessage *pMsg, QString *pMessageNamespace, KDSoapHeaders *pRequestHeaders, KDSoap::SoapVersion soapVersion) const
+{
+    Q_ASSERT(pMsg);
+    KDSoapMessage message;
+    KDSoap::SoapVersion messageVersion = soapVersion;
+    if (!KDSoapBinaryEncoding::decode(data, &message, pRequestHeaders, &messageVersion)) {
+        pMsg->createFaultMessage(QString::number(QXmlStreamReader::NotWellFormedError), QObject::tr("Invalid binary SOAP message"), soapVersion);
+        return ParseError;
+    }
+    if (m_bodyParser && !message.isFault()) {
+        // The body parser reads XML: hand it the body in that form, the headers are done already.
+        KDSoapMessageWriter writer;
+        writer.setVersion(messageVersion);
+        writer.setMessageNamespace(message.namespaceUri());
+        const QByteArray xml = writer.messageToXml(message, QString(), KDSoapHeaders(), QMap<QString, KDSoapMessage>());
+        KDSoapHeaders ignoredHeaders;
+        return xmlToMessage(xml, pMsg, pMessageNamespace, &ignoredHeaders, soapVersion);
+    }
+    *pMsg = message;
+    if (pMessageNamespace) {
+        *pMessageNamespace = pMsg->namespaceUri();
+    }
+    return NoError;
+}
@@ -27,6 +27,12 @@
 #include "KDSoapMessage.h"
 #include "KDSoapClientInterface.h"
 
+class KDSoapBodyParser;
+class KDSoapMtomPackage;
+QT_BEGIN_NAMESPACE
+class QXmlStreamReader;
+QT_END_NAMESPACE
+
 class KDSOAP_EXPORT KDSoapMessageReader
 {
 public:
@@ -39,6 +45,27 @@ public:
     KDSoapMessageReader();
 
     XmlError xmlToMessage(const QByteArray &data, KDSoapMessage *pParsedMessage, QString *pMessageNamespace, KDSoapHeaders *pRequestHeaders, KDSoap::SoapVersion soapVersion) const;
+
+    // Same for messages in the binary encoding, see KDSoapBinaryEncoding
+    XmlError binaryToMessage(const QByteArray &data, KDSoapMessage *pParsedMessage, QString *pMessageNamespace, KDSoapHeaders *pRequestHeaders, KDSoap::SoapVersion soapVersion) const;
+
+    // Hands the contents of the body (unless it's a fault) to this parser, rather than creating KDSoapValues for it.
+    // pParsedMessage then only gets the name and namespace of the body element.
+    void setBodyParser(KDSoapBodyParser *parser);
+
+    // For MTOM messages: the package holding the attachments referred to by xop:Include elements
+    void setMtomPackage(const KDSoapMtomPackage *package);
+
+    // For KDSoapBodyParser::readValue, only valid while a body parser is running
+    static KDSoapValue parseBodyElement(QXmlStreamReader &reader);
+
+    // For KDSoapBodyParser::readBase64Binary, only valid while a body parser is running.
+    // If \p reader is positioned on an xop:Include element, reads it and returns the attachment it refers to.
+    static bool readBodyXopInclude(QXmlStreamReader &reader, QByteArray *data, QString *contentType);
+
+private:
+    KDSoapBodyParser *m_bodyParser;
+    const KDSoapMtomPackage *m_mtomPackage;
 };
 
 #endif
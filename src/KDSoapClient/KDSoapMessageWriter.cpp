@@ -25,11 +25,17 @@
 #include "KDSoapClientInterface_p.h"
 #include "KDSoapNamespaceManager.h"
 #include "KDSoapValue.h"
+#include "KDSoapBodyWriter.h"
+#include "KDSoapMtom_p.h"
+#include "KDSoapRequestDevice_p.h"
+#include "KDSoapBinaryEncoding_p.h"
 #include <QVariant>
 #include <QDebug>
 
 KDSoapMessageWriter::KDSoapMessageWriter()
-    : m_version(KDSoap::SOAP1_1)
+    : m_version(KDSoap::SOAP1_1),
+      m_mtomPackage(0),
+      m_requestDevice(0)
 {
 }
 
@@ -43,12 +49,24 @@ void KDSoapMessageWriter::setMessageNamespace(const QString &ns)
     m_messageNamespace = ns;
 }
 
+void KDSoapMessageWriter::setMtomPackage(KDSoapMtomPackage *package)
+{
+    m_mtomPackage = package;
+}
+
+void KDSoapMessageWriter::setRequestDevice(KDSoapRequestDevice *device)
+{
+    m_requestDevice = device;
+}
+
 QByteArray KDSoapMessageWriter::messageToXml(const KDSoapMessage &message, const QString &method,
         const KDSoapHeaders &headers, const QMap<QString, KDSoapMessage> &persistentHeaders,
         const KDSoapAuthentication &authentication) const
 {
     QByteArray data;
     QXmlStreamWriter writer(&data);
+    KDSoapMtomPackage::Scope mtomScope(m_mtomPackage);
+    KDSoapRequestDevice::Scope requestDeviceScope(m_requestDevice);
     writer.writeStartDocument();
 
     KDSoapNamespacePrefixes namespacePrefixes;
@@ -119,7 +137,13 @@ QByteArray KDSoapMessageWriter::messageToXml(const KDSoapMessage &message, const
             // Fault element should be inside soap namespace
             writer.writeStartElement(soapEnvelope, elementName);
         }
-        message.writeElementContents(namespacePrefixes, writer, message.use(), messageNamespace);
+        const QSharedPointer<KDSoapBodyWriter> bodyWriter = message.bodyWriter();
+        if (bodyWriter && !message.isFault()) {
+            namespacePrefixes.setMessageNamespace(messageNamespace);
+            bodyWriter->writeBody(writer, namespacePrefixes);
+        } else {
+            message.writeElementContents(namespacePrefixes, writer, message.use(), messageNamespace);
+        }
         writer.writeEndElement();
     }
     writer.writeEndElement(); // Body
@@ -128,3 +152,14 @@ QByteArray KDSoapMessageWriter::messageToXml(const KDSoapMessage &message, const
 
     return data;
 }
+
+QByteArray KDSoapMessageWriter::messageToBinary(const KDSoapMessage &message, const QString &method,
+        const KDSoapHeaders &headers, const QMap<QString, KDSoapMessage> &persistentHeaders) const
+{
+    QString messageNamespace = m_messageNamespace;
+    if (!message.namespaceUri().isEmpty() && messageNamespace != message.namespaceUri()) {
+        messageNamespace = message.namespaceUri();
+    }
+    const QString elementName = !method.isEmpty() ? method : message.name();
+    return KDSoapBinaryEncoding::encode(message, elementName, messageNamespace, headers, persistentHeaders, m_version);
+}
@@ -35,6 +35,8 @@ class KDSoapHeaders;
 class KDSoapNamespacePrefixes;
 class KDSoapValue;
 class KDSoapValueList;
+class KDSoapMtomPackage;
+class KDSoapRequestDevice;
 
 /**
  * \internal
@@ -47,15 +49,26 @@ public:
 
     void setVersion(KDSoap::SoapVersion version);
     void setMessageNamespace(const QString &ns);
+    // When set, binary values are written as MTOM attachments, added to \p package
+    void setMtomPackage(KDSoapMtomPackage *package);
+    // Device values are then recorded into \p device rather than read, see KDSoapRequestDevice::appendXml
+    void setRequestDevice(KDSoapRequestDevice *device);
 
     QByteArray messageToXml(const KDSoapMessage &message, const QString &method /*empty in document style*/,
                             const KDSoapHeaders &headers,
                             const QMap<QString, KDSoapMessage> &persistentHeaders,
                             const KDSoapAuthentication &authentication = KDSoapAuthentication()) const;
 
+    // The same message in the binary encoding, see KDSoapBinaryEncoding::canEncode for what it can't hold
+    QByteArray messageToBinary(const KDSoapMessage &message, const QString &method /*empty in document style*/,
+                               const KDSoapHeaders &headers,
+                               const QMap<QString, KDSoapMessage> &persistentHeaders) const;
+
 private:
     QString m_messageNamespace;
     KDSoap::SoapVersion m_version;
+    KDSoapMtomPackage *m_mtomPackage;
+    KDSoapRequestDevice *m_requestDevice;
 
 };
 
@@ -0,0 +1,354 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+
+#include "KDSoapMtom_p.h"
+#include "KDSoapNamespaceManager.h"
+#include "KDSoapBinaryCodec.h"
+#include "KDSoapRequestDevice_p.h"
+
+#include <QBuffer>
+#include <QThreadStorage>
+#include <QUrl>
+#include <QUuid>
+#include <QXmlStreamWriter>
+
+static const char s_rootContentId[] = "root.message@kdsoap";
+
+KDSoapMtomPackage::KDSoapMtomPackage()
+    : m_deviceThreshold(-1)
+{
+}
+
+// The package collecting attachments while a message is being written in this thread.
+struct KDSoapCurrentMtomPackage {
+    KDSoapCurrentMtomPackage() : package(0) {}
+    KDSoapMtomPackage *package;
+};
+static QThreadStorage<KDSoapCurrentMtomPackage *> s_currentPackage;
+
+static KDSoapCurrentMtomPackage *currentPackageStorage()
+{
+    if (!s_currentPackage.hasLocalData()) {
+        s_currentPackage.setLocalData(new KDSoapCurrentMtomPackage);
+    }
+    return s_currentPackage.localData();
+}
+
+KDSoapMtomPackage::Scope::Scope(KDSoapMtomPackage *package)
+{
+    KDSoapCurrentMtomPackage *storage = currentPackageStorage();
+    m_previous = storage->package;
+    storage->package = package;
+}
+
+KDSoapMtomPackage::Scope::~Scope()
+{
+    currentPackageStorage()->package = m_previous;
+}
+
+KDSoapMtomPackage *KDSoapMtomPackage::current()
+{
+    return s_currentPackage.hasLocalData() ? s_currentPackage.localData()->package : 0;
+}
+
+KDSoapMtomPackage::Part &KDSoapMtomPackage::addPart(QXmlStreamWriter &writer, const QString &contentType)
+{
+    if (m_boundary.isEmpty()) {
+        // e.g. {67c8770b-44f1-410a-ab9a-f9b5446f13ee}
+        const QByteArray uuid = QUuid::createUuid().toString().toLatin1();
+        m_boundary = "MIMEBoundary_" + uuid.mid(1, uuid.length() - 2);
+    }
+    Part part;
+    part.contentId = QByteArray::number(m_parts.count() + 1) + '.' + m_boundary + "@kdsoap";
+    part.contentType = contentType.isEmpty() ? QByteArray("application/octet-stream") : contentType.toLatin1();
+    m_parts.append(part);
+
+    writer.writeStartElement(QLatin1String("xop:Include"));
+    writer.writeNamespace(KDSoapNamespaceManager::xmlBinaryOptimizedPackaging(), QLatin1String("xop"));
+    writer.writeAttribute(QLatin1String("href"), QLatin1String("cid:") + QString::fromLatin1(part.contentId.constData()));
+    writer.writeEndElement();
+    return m_parts.last();
+}
+
+void KDSoapMtomPackage::writeInclude(QXmlStreamWriter &writer, const QByteArray &data, const QString &contentType)
+{
+    addPart(writer, contentType).data = data;
+}
+
+void KDSoapMtomPackage::writeInclude(QXmlStreamWriter &writer, QIODevice *device, const QString &contentType)
+{
+    addPart(writer, contentType).device = device;
+}
+
+bool KDSoapMtomPackage::hasAttachments() const
+{
+    return !m_parts.isEmpty();
+}
+
+static QByteArray rootType(KDSoap::SoapVersion version)
+{
+    return version == KDSoap::SOAP1_2 ? "application/soap+xml" : "text/xml";
+}
+
+QByteArray KDSoapMtomPackage::contentType(KDSoap::SoapVersion version, const QString &soapAction) const
+{
+    QByteArray contentType = "multipart/related; type=\"application/xop+xml\"; start=\"<";
+    contentType += s_rootContentId;
+    contentType += ">\"; start-info=\"" + rootType(version) + "\"; boundary=\"" + m_boundary + '\"';
+    if (version == KDSoap::SOAP1_2 && !soapAction.isEmpty()) {
+        contentType += "; action=\"" + soapAction.toUtf8() + '\"';
+    }
+    return contentType;
+}
+
+QByteArray KDSoapMtomPackage::rootPartHeaders(KDSoap::SoapVersion version) const
+{
+    QByteArray result = "--" + m_boundary + "\r\n";
+    result += "Content-Type: application/xop+xml; charset=UTF-8; type=\"" + rootType(version) + "\"\r\n";
+    result += "Content-Transfer-Encoding: 8bit\r\n";
+    result += "Content-ID: <";
+    result += s_rootContentId;
+    result += ">\r\n\r\n";
+    return result;
+}
+
+QByteArray KDSoapMtomPackage::partHeaders(const Part &part) const
+{
+    QByteArray result = "\r\n--" + m_boundary + "\r\n";
+    result += "Content-Type: " + part.contentType + "\r\n";
+    result += "Content-Transfer-Encoding: binary\r\n";
+    result += "Content-ID: <" + part.contentId + ">\r\n\r\n";
+    return result;
+}
+
+QByteArray KDSoapMtomPackage::toMultipart(const QByteArray &xml, KDSoap::SoapVersion version) const
+{
+    int size = xml.size() + 200;
+    Q_FOREACH (const Part &part, m_parts) {
+        size += part.data.size() + part.contentId.size() + part.contentType.size() + 100;
+    }
+    QByteArray result;
+    result.reserve(size);
+
+    result += rootPartHeaders(version);
+    result += xml;
+    Q_FOREACH (const Part &part, m_parts) {
+        result += partHeaders(part);
+        result += part.device ? KDSoapRequestDevice::readDevice(part.device) : part.data;
+    }
+    result += "\r\n--" + m_boundary + "--\r\n";
+    return result;
+}
+
+void KDSoapMtomPackage::appendTo(KDSoapRequestDevice *device, const QByteArray &xml, KDSoap::SoapVersion version) const
+{
+    device->appendData(rootPartHeaders(version));
+    device->appendXml(xml);
+    Q_FOREACH (const Part &part, m_parts) {
+        device->appendData(partHeaders(part));
+        if (part.device) {
+            device->appendDevice(part.device, KDSoapRequestDevice::Raw);
+        } else {
+            device->appendData(part.data);
+        }
+    }
+    device->appendData("\r\n--" + m_boundary + "--\r\n");
+}
+
+bool KDSoapMtomPackage::isMultipart(const QByteArray &contentType)
+{
+    return contentType.trimmed().toLower().startsWith("multipart/related"); //krazy:exclude=strings
+}
+
+static QByteArray unquote(const QByteArray &value)
+{
+    if (value.length() < 2 || !value.startsWith('\"') || !value.endsWith('\"')) {
+        return value;
+    }
+    QByteArray result = value.mid(1, value.length() - 2);
+    result.replace("\\\"", "\"");
+    return result;
+}
+
+// Returns the value of the parameter \p name in a header like
+// multipart/related; type="application/xop+xml"; boundary="..."
+// Semicolons are allowed in quoted values, e.g. start-info="application/soap+xml; action=\"...\""
+static QByteArray headerParameter(const QByteArray &header, const QByteArray &name)
+{
+    int start = header.indexOf(';');
+    while (start != -1) {
+        ++start;
+        bool quoted = false;
+        int end = start;
+        for (; end < header.length(); ++end) {
+            const char ch = header.at(end);
+            if (ch == '\\' && quoted) {
+                ++end;
+            } else if (ch == '\"') {
+                quoted = !quoted;
+            } else if (ch == ';' && !quoted) {
+                break;
+            }
+        }
+        const QByteArray parameter = header.mid(start, end - start);
+        const int equal = parameter.indexOf('=');
+        if (equal != -1 && parameter.left(equal).trimmed().toLower() == name) {
+            return unquote(parameter.mid(equal + 1).trimmed());
+        }
+        start = end < header.length() ? end : -1;
+    }
+    return QByteArray();
+}
+
+static QByteArray stripAngleBrackets(const QByteArray &contentId)
+{
+    const QByteArray id = contentId.trimmed();
+    if (id.startsWith('<') && id.endsWith('>')) {
+        return id.mid(1, id.length() - 2);
+    }
+    return id;
+}
+
+void KDSoapMtomPackage::setDeviceThreshold(qint64 size)
+{
+    m_deviceThreshold = size;
+}
+
+bool KDSoapMtomPackage::parse(const QByteArray &contentType, const QByteArray &body, QByteArray *rootPart)
+{
+    m_boundary = headerParameter(contentType, "boundary");
+    m_startInfo = headerParameter(contentType, "start-info");
+    m_parts.clear();
+    if (m_boundary.isEmpty()) {
+        return false;
+    }
+    const QByteArray start = stripAngleBrackets(headerParameter(contentType, "start"));
+    const QByteArray delimiter = "--" + m_boundary;
+    const QByteArray partEnd = "\r\n" + delimiter;
+
+    bool rootFound = false;
+    int pos = body.indexOf(delimiter);
+    if (pos == -1) {
+        return false;
+    }
+    for (;;) {
+        pos += delimiter.size();
+        if (body.mid(pos, 2) == "--") {
+            break; // close delimiter
+        }
+        // Skip the rest of the delimiter line (transport padding)
+        pos = body.indexOf("\r\n", pos);
+        if (pos == -1) {
+            return false;
+        }
+        pos += 2;
+        int dataStart;
+        int headersEnd;
+        if (body.mid(pos, 2) == "\r\n") { // no headers
+            headersEnd = pos;
+            dataStart = pos + 2;
+        } else {
+            headersEnd = body.indexOf("\r\n\r\n", pos);
+            if (headersEnd == -1) {
+                return false;
+            }
+            dataStart = headersEnd + 4;
+        }
+        const int dataEnd = body.indexOf(partEnd, dataStart);
+        if (dataEnd == -1) {
+            return false;
+        }
+
+        Part part;
+        QByteArray transferEncoding;
+        Q_FOREACH (const QByteArray &line, body.mid(pos, headersEnd - pos).split('\n')) {
+            const int colon = line.indexOf(':');
+            if (colon == -1) {
+                continue;
+            }
+            const QByteArray header = line.left(colon).trimmed().toLower(); // header names are case-insensitive
+            const QByteArray value = line.mid(colon + 1).trimmed();
+            if (header == "content-id") {
+                part.contentId = stripAngleBrackets(value);
+            } else if (header == "content-type") {
+                part.contentType = value;
+            } else if (header == "content-transfer-encoding") {
+                transferEncoding = value.toLower();
+            }
+        }
+        if (m_deviceThreshold >= 0) {
+            // No copy, e.g. for a memory-mapped request
+            part.data = QByteArray::fromRawData(body.constData() + dataStart, dataEnd - dataStart);
+        } else {
+            part.data = body.mid(dataStart, dataEnd - dataStart);
+        }
+        if (transferEncoding == "base64") {
+            part.data = KDSoapBinaryCodec::fromBase64(part.data);
+        }
+        if (m_deviceThreshold >= 0 && part.data.size() >= m_deviceThreshold && !part.contentId.isEmpty()) {
+            part.buffer = QSharedPointer<QBuffer>(new QBuffer);
+            part.buffer->setData(part.data);
+            part.buffer->open(QIODevice::ReadOnly);
+            part.device = part.buffer.data();
+        }
+
+        if (!rootFound && (start.isEmpty() || part.contentId == start)) {
+            rootFound = true;
+            *rootPart = part.data; // only read while parsing
+        } else {
+            if (!part.device && part.data.constData() == body.constData() + dataStart) {
+                // Handed over as a QByteArray value, which can outlive the mapping
+                part.data = QByteArray(part.data.constData(), part.data.size());
+            }
+            m_parts.append(part);
+        }
+        pos = dataEnd + 2;
+    }
+    return rootFound;
+}
+
+QByteArray KDSoapMtomPackage::startInfo() const
+{
+    return m_startInfo;
+}
+
+bool KDSoapMtomPackage::attachment(const QString &href, QByteArray *data, QString *contentType, QIODevice **device) const
+{
+    if (!href.startsWith(QLatin1String("cid:"))) {
+        return false;
+    }
+    const QByteArray contentId = QUrl::fromPercentEncoding(href.mid(4).toLatin1()).toLatin1();
+    Q_FOREACH (const Part &part, m_parts) {
+        if (part.contentId == contentId) {
+            *data = part.data;
+            if (contentType) {
+                *contentType = QString::fromLatin1(part.contentType.constData(), part.contentType.size());
+            }
+            if (device) {
+                *device = part.buffer.data();
+            }
+            return true;
+        }
+    }
+    return false;
+}
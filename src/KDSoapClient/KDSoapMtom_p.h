@@ -0,0 +1,119 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPMTOM_P_H
+#define KDSOAPMTOM_P_H
+
+#include "KDSoapValue.h"
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+
+QT_BEGIN_NAMESPACE
+class QBuffer;
+class QIODevice;
+class QXmlStreamWriter;
+QT_END_NAMESPACE
+class KDSoapRequestDevice;
+
+/**
+ * \internal
+ * An XOP package, as used by MTOM (http://www.w3.org/TR/soap12-mtom/): a multipart/related
+ * MIME message whose root part is the SOAP envelope, in which binary values are replaced
+ * with xop:Include elements referring to other MIME parts, which hold the raw bytes.
+ *
+ * Internal class -- only exported for the server lib
+ */
+class KDSOAP_EXPORT KDSoapMtomPackage
+{
+public:
+    KDSoapMtomPackage();
+
+    // Writing: while a KDSoapMtomPackage::Scope is alive, KDSoapValue and KDSoapBodyWriter
+    // write base64Binary data by calling writeInclude() on current().
+    class Scope
+    {
+    public:
+        explicit Scope(KDSoapMtomPackage *package);
+        ~Scope();
+    private:
+        KDSoapMtomPackage *m_previous;
+    };
+    static KDSoapMtomPackage *current();
+
+    // Adds a part holding \p data, and writes an xop:Include element referring to it
+    // as the contents of the current element of \p writer.
+    void writeInclude(QXmlStreamWriter &writer, const QByteArray &data, const QString &contentType);
+    // Same, for a part whose data is read from \p device (from its current position) when sending the package.
+    void writeInclude(QXmlStreamWriter &writer, QIODevice *device, const QString &contentType);
+
+    bool hasAttachments() const;
+
+    // The value of the Content-Type HTTP header for the whole package.
+    QByteArray contentType(KDSoap::SoapVersion version, const QString &soapAction) const;
+
+    // Returns the whole MIME message, with \p xml as the root part.
+    QByteArray toMultipart(const QByteArray &xml, KDSoap::SoapVersion version) const;
+
+    // Same as toMultipart, but parts coming from devices are streamed by \p device rather than read into memory.
+    void appendTo(KDSoapRequestDevice *device, const QByteArray &xml, KDSoap::SoapVersion version) const;
+
+    // Reading
+    static bool isMultipart(const QByteArray &contentType);
+
+    // By default, parse() copies the parts out of the body. After calling this with a value >= 0,
+    // the parts refer to the body instead (which must then outlive the package), and parts of
+    // at least \p size bytes are exposed as QIODevices, see attachment().
+    void setDeviceThreshold(qint64 size);
+
+    // Splits the multipart \p body into parts, and sets \p rootPart to the SOAP envelope.
+    // Returns false if \p body isn't a valid multipart/related message.
+    bool parse(const QByteArray &contentType, const QByteArray &body, QByteArray *rootPart);
+
+    // The type parameter of the start-info of a parsed package (e.g. "application/soap+xml; action=...")
+    QByteArray startInfo() const;
+
+    // Looks up the part referred to by \p href (a cid: URL) in a parsed package.
+    // If \p device is set, it is set to a device reading the part if it's above the device threshold, and to 0 otherwise.
+    bool attachment(const QString &href, QByteArray *data, QString *contentType, QIODevice **device = 0) const;
+
+private:
+    struct Part {
+        Part() : device(0) {}
+        QByteArray contentId; // without the angle brackets
+        QByteArray contentType;
+        QByteArray data;
+        QIODevice *device; // if set, the data comes from there instead
+        QSharedPointer<QBuffer> buffer; // owns device, for parsed parts above the device threshold
+    };
+    Part &addPart(QXmlStreamWriter &writer, const QString &contentType);
+    QByteArray rootPartHeaders(KDSoap::SoapVersion version) const;
+    QByteArray partHeaders(const Part &part) const;
+
+    QByteArray m_boundary;
+    QByteArray m_startInfo;
+    qint64 m_deviceThreshold;
+    QList<Part> m_parts;
+};
+
+#endif // KDSOAPMTOM_P_H
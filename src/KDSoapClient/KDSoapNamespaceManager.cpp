@@ -95,3 +95,13 @@ QString KDSoapNamespaceManager::soapMessageAddressing200408()
 {
     return QString::fromLatin1("http://schemas.xmlsoap.org/ws/2004/08/addressing");
 }
+
+QString KDSoapNamespaceManager::xmlBinaryOptimizedPackaging()
+{
+    return QString::fromLatin1("http://www.w3.org/2004/08/xop/include");
+}
+
+QString KDSoapNamespaceManager::xmlMime()
+{
+    return QString::fromLatin1("http://www.w3.org/2005/05/xmlmime");
+}
@@ -46,6 +46,10 @@ public:
     static QString soapMessageAddressing200303();
     static QString soapMessageAddressing200403();
     static QString soapMessageAddressing200408();
+    /// XOP namespace, for the xop:Include elements of MTOM messages. \since 1.8
+    static QString xmlBinaryOptimizedPackaging();
+    /// XML Media Types namespace (xmime:contentType, xmime:expectedContentTypes). \since 1.8
+    static QString xmlMime();
 
 private: // TODO instantiate to handle custom namespaces per clientinterface
     KDSoapNamespaceManager();
@@ -24,6 +24,12 @@
 #include "KDSoapClientInterface_p.h"
 #include "KDSoapNamespaceManager.h"
 
+KDSoapNamespacePrefixes::KDSoapNamespacePrefixes()
+    : m_schemaInstanceNamespace(KDSoapNamespaceManager::xmlSchemaInstance2001()),
+      m_typeAttributeName(QString::fromLatin1("type"))
+{
+}
+
 void KDSoapNamespacePrefixes::writeStandardNamespaces(QXmlStreamWriter &writer,
         KDSoap::SoapVersion version,
         bool messageAddressingEnabled)
@@ -24,6 +24,8 @@
 #define KDSOAPNAMESPACEPREFIXES_P_H
 
 #include <QtCore/QMap>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
 #include <QtCore/QXmlStreamWriter>
 
 #include "KDSoapClientInterface.h"
@@ -31,6 +33,8 @@
 class KDSoapNamespacePrefixes : public QMap<QString /*ns*/, QString /*prefix*/>
 {
 public:
+    KDSoapNamespacePrefixes();
+
     void writeStandardNamespaces(QXmlStreamWriter &writer,
                                  KDSoap::SoapVersion version = KDSoap::SOAP1_1,
                                  bool messageAddressingEnabled = false);
@@ -41,14 +45,56 @@ public:
         insert(ns, prefix);
         writer.writeNamespace(ns, prefix);
     }
+    // Hides QMap::insert, to keep the cache of resolve() up to date
+    iterator insert(const QString &ns, const QString &prefix)
+    {
+        m_resolvedNames.clear();
+        return QMap<QString, QString>::insert(ns, prefix);
+    }
+
+    // The same few types are resolved for most elements of a message, so the qualified names are
+    // cached for as long as this object is used, i.e. one message write
     QString resolve(const QString &ns, const QString &localName) const
     {
+        const QPair<QString, QString> key(ns, localName);
+        QHash<QPair<QString, QString>, QString>::const_iterator it = m_resolvedNames.constFind(key);
+        if (it != m_resolvedNames.constEnd()) {
+            return it.value();
+        }
         const QString prefix = value(ns);
         if (prefix.isEmpty()) {
             qWarning("ERROR: Namespace not found: %s (for localName %s)", qPrintable(ns), qPrintable(localName));
         }
-        return prefix + QLatin1Char(':') + localName;
+        const QString qualifiedName = prefix + QLatin1Char(':') + localName;
+        m_resolvedNames.insert(key, qualifiedName);
+        return qualifiedName;
+    }
+
+    // The namespace of the body element, used to decide which child elements must be qualified
+    void setMessageNamespace(const QString &ns)
+    {
+        m_messageNamespace = ns;
     }
+    QString messageNamespace() const
+    {
+        return m_messageNamespace;
+    }
+
+    // For the xsi:type attribute of each element with use=encoded
+    const QString &schemaInstanceNamespace() const
+    {
+        return m_schemaInstanceNamespace;
+    }
+    const QString &typeAttributeName() const
+    {
+        return m_typeAttributeName;
+    }
+
+private:
+    QString m_messageNamespace;
+    const QString m_schemaInstanceNamespace;
+    const QString m_typeAttributeName;
+    mutable QHash<QPair<QString, QString>, QString> m_resolvedNames;
 };
 
 #endif // KDSOAPNAMESPACESPREFIXES_H
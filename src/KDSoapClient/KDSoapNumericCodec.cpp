@@ -0,0 +1,323 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+
+#include "KDSoapNumericCodec.h"
+
+#include <cfloat>
+#include <limits>
+
+// The parsers work on UTF-16 code units; QChar has the same layout.
+typedef unsigned short Char;
+
+static inline const Char *utf16(const QChar *text)
+{
+    return reinterpret_cast<const Char *>(text);
+}
+
+static inline bool isXmlSpace(Char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+// The whiteSpace facet of all numeric types is "collapse"
+static inline void trimSpaces(const Char *&begin, const Char *&end)
+{
+    while (begin != end && isXmlSpace(*begin)) {
+        ++begin;
+    }
+    while (end != begin && isXmlSpace(*(end - 1))) {
+        --end;
+    }
+}
+
+static bool parseDigits(const Char *p, const Char *end, quint64 max, quint64 *result)
+{
+    if (p == end) {
+        return false;
+    }
+    quint64 value = 0;
+    for (; p != end; ++p) {
+        const unsigned int digit = unsigned(*p) - '0';
+        if (digit > 9) {
+            return false;
+        }
+        if (value > (max - digit) / 10) {
+            return false; // overflow
+        }
+        value = value * 10 + digit;
+    }
+    *result = value;
+    return true;
+}
+
+static bool parseSigned(const QChar *text, int length, qint64 min, qint64 max, qint64 *result)
+{
+    const Char *p = utf16(text);
+    const Char *end = p + length;
+    trimSpaces(p, end);
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    quint64 magnitude;
+    // -min doesn't fit in qint64 for the 64-bit minimum, hence the unsigned arithmetic
+    const quint64 limit = negative ? quint64(-(min + 1)) + 1 : quint64(max);
+    if (!parseDigits(p, end, limit, &magnitude)) {
+        return false;
+    }
+    *result = negative ? qint64(0 - magnitude) : qint64(magnitude);
+    return true;
+}
+
+static bool parseUnsigned(const QChar *text, int length, quint64 max, quint64 *result)
+{
+    const Char *p = utf16(text);
+    const Char *end = p + length;
+    trimSpaces(p, end);
+    if (p != end && *p == '+') {
+        ++p;
+    }
+    return parseDigits(p, end, max, result);
+}
+
+bool KDSoapNumericCodec::parse(const QChar *text, int length, qint64 *result)
+{
+    return parseSigned(text, length, std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(), result);
+}
+
+bool KDSoapNumericCodec::parse(const QChar *text, int length, quint64 *result)
+{
+    return parseUnsigned(text, length, std::numeric_limits<quint64>::max(), result);
+}
+
+bool KDSoapNumericCodec::parse(const QChar *text, int length, int *result)
+{
+    qint64 value;
+    if (!parseSigned(text, length, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), &value)) {
+        return false;
+    }
+    *result = int(value);
+    return true;
+}
+
+bool KDSoapNumericCodec::parse(const QChar *text, int length, uint *result)
+{
+    quint64 value;
+    if (!parseUnsigned(text, length, std::numeric_limits<uint>::max(), &value)) {
+        return false;
+    }
+    *result = uint(value);
+    return true;
+}
+
+bool KDSoapNumericCodec::parse(const QChar *text, int length, signed char *result)
+{
+    qint64 value;
+    if (!parseSigned(text, length, std::numeric_limits<signed char>::min(), std::numeric_limits<signed char>::max(), &value)) {
+        return false;
+    }
+    *result = static_cast<signed char>(value);
+    return true;
+}
+
+bool KDSoapNumericCodec::parse(const QChar *text, int length, uchar *result)
+{
+    quint64 value;
+    if (!parseUnsigned(text, length, std::numeric_limits<uchar>::max(), &value)) {
+        return false;
+    }
+    *result = uchar(value);
+    return true;
+}
+
+static bool equals(const Char *p, const Char *end, const char *literal)
+{
+    for (; p != end && *literal; ++p, ++literal) {
+        if (*p != Char(*literal)) {
+            return false;
+        }
+    }
+    return p == end && !*literal;
+}
+
+// Exact conversion for the common case: at most 19 significant digits giving a mantissa
+// below 2^53, and a decimal exponent within [-22, 22]. Then the mantissa and the power of ten
+// are exact doubles, and a single IEEE multiplication or division rounds correctly (Clinger's fast path).
+static bool parseDoubleFast(const Char *p, const Char *end, double *result)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+    // x87 extended precision would round twice
+    Q_UNUSED(p);
+    Q_UNUSED(end);
+    Q_UNUSED(result);
+    return false;
+#else
+    static const double s_powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    quint64 mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    for (; p != end && unsigned(*p) - '0' <= 9; ++p) {
+        hasDigits = true;
+        if (mantissa != 0 || *p != '0') {
+            if (++significantDigits > 19) {
+                return false;
+            }
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+    }
+    if (p != end && *p == '.') {
+        ++p;
+        for (; p != end && unsigned(*p) - '0' <= 9; ++p) {
+            hasDigits = true;
+            --exponent;
+            if (mantissa != 0 || *p != '0') {
+                if (++significantDigits > 19) {
+                    return false;
+                }
+                mantissa = mantissa * 10 + (*p - '0');
+            }
+        }
+    }
+    if (!hasDigits) {
+        return false;
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p != end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            ++p;
+        }
+        if (p == end) {
+            return false;
+        }
+        int explicitExponent = 0;
+        for (; p != end && unsigned(*p) - '0' <= 9; ++p) {
+            if (explicitExponent > 10000) {
+                return false;
+            }
+            explicitExponent = explicitExponent * 10 + (*p - '0');
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    if (p != end || mantissa > (Q_UINT64_C(1) << 53)) {
+        return false;
+    }
+    double value = double(mantissa);
+    if (mantissa != 0 && exponent != 0) {
+        if (exponent > 22 || exponent < -22) {
+            return false;
+        }
+        value = exponent > 0 ? value * s_powersOfTen[exponent] : value / s_powersOfTen[-exponent];
+    }
+    *result = negative ? -value : value;
+    return true;
+#endif
+}
+
+bool KDSoapNumericCodec::parse(const QChar *text, int length, double *result)
+{
+    const Char *p = utf16(text);
+    const Char *end = p + length;
+    trimSpaces(p, end);
+    if (parseDoubleFast(p, end, result)) {
+        return true;
+    }
+    if (equals(p, end, "INF") || equals(p, end, "+INF")) {
+        *result = std::numeric_limits<double>::infinity();
+        return true;
+    } else if (equals(p, end, "-INF")) {
+        *result = -std::numeric_limits<double>::infinity();
+        return true;
+    } else if (equals(p, end, "NaN")) {
+        *result = std::numeric_limits<double>::quiet_NaN();
+        return true;
+    }
+    // Many significant digits, large exponents...
+    bool ok;
+    *result = QString(reinterpret_cast<const QChar *>(p), int(end - p)).toDouble(&ok);
+    return ok;
+}
+
+bool KDSoapNumericCodec::parse(const QChar *text, int length, float *result)
+{
+    // Like QString::toFloat
+    double value;
+    if (!parse(text, length, &value)) {
+        return false;
+    }
+    if (value == value && (value > FLT_MAX || value < -FLT_MAX)
+            && value != std::numeric_limits<double>::infinity() && value != -std::numeric_limits<double>::infinity()) {
+        return false; // out of range for float
+    }
+    *result = float(value);
+    return true;
+}
+
+bool KDSoapNumericCodec::parse(const QChar *text, int length, bool *result)
+{
+    const Char *p = utf16(text);
+    const Char *end = p + length;
+    trimSpaces(p, end);
+    if (equals(p, end, "true") || equals(p, end, "1")) {
+        *result = true;
+        return true;
+    } else if (equals(p, end, "false") || equals(p, end, "0")) {
+        *result = false;
+        return true;
+    }
+    return false;
+}
+
+int KDSoapNumericCodec::format(quint64 value, char *buffer)
+{
+    char digits[MaxIntegerLength];
+    int count = 0;
+    do {
+        digits[count++] = char('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (int i = 0; i < count; ++i) {
+        buffer[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+int KDSoapNumericCodec::format(qint64 value, char *buffer)
+{
+    if (value < 0) {
+        buffer[0] = '-';
+        return 1 + format(0 - quint64(value), buffer + 1);
+    }
+    return format(quint64(value), buffer);
+}
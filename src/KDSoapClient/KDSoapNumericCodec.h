@@ -0,0 +1,129 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPNUMERICCODEC_H
+#define KDSOAPNUMERICCODEC_H
+
+#include "KDSoapGlobal.h"
+#include <QtCore/QString>
+#include <QtCore/QVariant>
+
+/**
+ * \brief KDSoapNumericCodec converts between numbers and the text of the numeric XML Schema types.
+ *
+ * Parsing works directly on the characters of the XML text (e.g. a QStringRef into the XML
+ * stream), without creating a QString or going through QVariant conversions. The common
+ * lexical forms are handled by fast paths, and anything else (e.g. doubles with more
+ * than 19 significant digits) is converted the same way QVariant does it.
+ *
+ * This is used by KDSoapValue, by the message reader, and by the code generated by kdwsdl2cpp.
+ *
+ * \since 1.8
+ */
+class KDSOAP_EXPORT KDSoapNumericCodec
+{
+public:
+    /**
+     * Parses \p length characters of \p text as an xsd:long (or any integer type).
+     * Leading and trailing whitespace is allowed.
+     * \return false if the text isn't a decimal integer, or if it is out of range.
+     */
+    static bool parse(const QChar *text, int length, qint64 *result);
+    /** \overload */
+    static bool parse(const QChar *text, int length, quint64 *result);
+    /** \overload */
+    static bool parse(const QChar *text, int length, int *result);
+    /** \overload */
+    static bool parse(const QChar *text, int length, uint *result);
+    /** \overload */
+    static bool parse(const QChar *text, int length, signed char *result);
+    /** \overload */
+    static bool parse(const QChar *text, int length, uchar *result);
+    /**
+     * Parses \p length characters of \p text as an xsd:double, including INF, -INF and NaN.
+     */
+    static bool parse(const QChar *text, int length, double *result);
+    /** \overload */
+    static bool parse(const QChar *text, int length, float *result);
+    /**
+     * Parses \p length characters of \p text as an xsd:boolean: true, false, 1 or 0.
+     */
+    static bool parse(const QChar *text, int length, bool *result);
+
+    /**
+     * Returns \p text converted to the numeric type T.
+     * Text which can't be parsed is converted by QVariant, as in previous versions.
+     */
+    template <typename T> static T fromText(const QChar *text, int length)
+    {
+        T result;
+        if (parse(text, length, &result)) {
+            return result;
+        }
+        return QVariant(QString(text, length)).value<T>();
+    }
+    /** \overload */
+    template <typename T> static T fromText(const QString &text)
+    {
+        T result;
+        if (parse(text.constData(), text.size(), &result)) {
+            return result;
+        }
+        return QVariant(text).value<T>();
+    }
+    /** \overload */
+    template <typename T> static T fromText(const QStringRef &text)
+    {
+        return fromText<T>(text.unicode(), text.size());
+    }
+
+    /**
+     * Returns \p value converted to the numeric type T.
+     * This is the same as value.value<T>(), but faster for values holding text, as received
+     * in a KDSoapValue without type information.
+     */
+    template <typename T> static T fromVariant(const QVariant &value)
+    {
+        if (value.userType() == QVariant::String) {
+            return fromText<T>(value.toString()); // no copy, QString is implicitly shared
+        }
+        return value.value<T>();
+    }
+
+    enum {
+        /** The size of the buffer needed by format(), including the sign */
+        MaxIntegerLength = 20
+    };
+    /**
+     * Writes \p value in decimal into \p buffer, which must have room for MaxIntegerLength characters.
+     * There is no terminating null character.
+     * \return the number of characters written
+     */
+    static int format(qint64 value, char *buffer);
+    /** \overload */
+    static int format(quint64 value, char *buffer);
+
+private:
+    KDSoapNumericCodec(); // only static methods
+};
+
+#endif // KDSOAPNUMERICCODEC_H
@@ -23,7 +23,11 @@
 #include "KDSoapPendingCall.h"
 #include "KDSoapPendingCall_p.h"
 #include "KDSoapNamespaceManager.h"
-#include "KDSoapMessageReader_p.h"
+#include "KDSoapClientInterface_p.h"
+#include "KDSoapInProcess_p.h"
+#include "KDSoapReplyParser_p.h"
+#include "KDSoapCallMetrics_p.h"
+#include <QElapsedTimer>
 #include <QNetworkReply>
 #include <QDebug>
 
@@ -83,7 +87,8 @@ static void debugHelper(const QByteArray &data, const QList<QNetworkReply::RawHe
 }
 
 // Log the HTTP and XML of a response from the server.
-static void maybeDebugResponse(const QByteArray &data, QNetworkReply *reply) {
+// (not static, because this is used in KDSoapReplyParser)
+void maybeDebugResponse(const QByteArray &data, QNetworkReply *reply) {
     const QByteArray doDebug = qgetenv("KDSOAP_DEBUG");
     if (doDebug.trimmed().isEmpty() || doDebug == "0") {
         return;
@@ -124,6 +129,7 @@ void maybeDebugRequest(const QByteArray &data, const QNetworkRequest &request, Q
 
 KDSoapPendingCall::Private::~Private()
 {
+    delete backgroundParser;
     if (reply) {
         // Ensure the connection is closed, which QNetworkReply doesn't do in its destructor. This needs abort().
         QObject::disconnect(reply.data(), SIGNAL(finished()), 0, 0);
@@ -133,7 +139,7 @@ KDSoapPendingCall::Private::~Private()
     delete buffer;
 }
 
-KDSoapPendingCall::KDSoapPendingCall(QNetworkReply *reply, QBuffer *buffer)
+KDSoapPendingCall::KDSoapPendingCall(QNetworkReply *reply, QIODevice *buffer)
     : d(new Private(reply, buffer))
 {
 }
@@ -155,6 +161,9 @@ KDSoapPendingCall &KDSoapPendingCall::operator=(const KDSoapPendingCall &other)
 
 bool KDSoapPendingCall::isFinished() const
 {
+    if (d->backgroundParser) {
+        return d->backgroundParser->isDone();
+    }
     return d->reply.data()->isFinished();
 }
 
@@ -170,6 +179,21 @@ KDSoapHeaders KDSoapPendingCall::returnHeaders() const
     return d->replyHeaders;
 }
 
+void KDSoapPendingCall::setBodyParser(KDSoapBodyParser *parser)
+{
+    d->bodyParser = parser;
+}
+
+void KDSoapPendingCall::setBackgroundParsingEnabled(bool enabled)
+{
+    d->parseInBackground = enabled;
+}
+
+KDSoapPendingCall::Timings KDSoapPendingCall::timings() const
+{
+    return d->timings();
+}
+
 QVariant KDSoapPendingCall::returnValue() const
 {
     d->parseReply();
@@ -193,15 +217,114 @@ void KDSoapPendingCall::Private::parseReply()
 #endif
     parsed = true;
 
-    // Don't try to read from an aborted (closed) reply
-    const QByteArray data = reply->isOpen() ? reply->readAll() : QByteArray();
-    maybeDebugResponse(data, reply);
+    readReplyMessage(reply);
+    if (statistics) {
+        statistics->record(method, timings(), replyMessage.isFault());
+    }
+}
+
+void KDSoapPendingCall::Private::readReplyMessage(QNetworkReply *reply)
+{
+    if (KDSoapInProcessReply *inProcessReply = qobject_cast<KDSoapInProcessReply *>(reply)) {
+        // inproc:// endpoint: nothing to parse, the server's messages are there already
+        inProcessReply->readResponse(&replyMessage, &replyHeaders, bodyParser);
+        bodyParser = 0;
+        checkReplyError(reply);
+        return;
+    }
+
+    QByteArray data;
+    QByteArray contentType;
+    if (backgroundParser) {
+        backgroundParser->waitForDone();
+        if (!bodyParser) {
+            replyMessage = backgroundParser->message();
+            replyHeaders = backgroundParser->headers();
+            parseTime = backgroundParser->parseTime();
+            responseSize = backgroundParser->data().size();
+            if (backgroundParser->isBinary() && clientInterface) {
+                clientInterface->m_binaryPeer.fetchAndStoreRelaxed(1);
+            }
+            checkReplyError(reply);
+            return;
+        }
+        // The body parser was set once the reply was parsed already (e.g. by generated code,
+        // when the watcher emits finished): parse it again, with the body parser
+        data = backgroundParser->data();
+        contentType = backgroundParser->contentType();
+    } else {
+        // Don't try to read from an aborted (closed) reply
+        data = reply->isOpen() ? reply->readAll() : QByteArray();
+        contentType = reply->rawHeader("Content-Type");
+        maybeDebugResponse(data, reply);
+    }
+
+    responseSize = data.size();
+    QElapsedTimer parseTimer;
+    parseTimer.start();
+    if (KDSoapReplyParser::parse(data, contentType, soapVersion, bodyParser, &replyMessage, &replyHeaders) && clientInterface) {
+        clientInterface->m_binaryPeer.fetchAndStoreRelaxed(1);
+    }
+    parseTime = parseTimer.nsecsElapsed() / 1000;
+    bodyParser = 0; // not needed anymore, and might be deleted now
+    checkReplyError(reply);
+}
+
+void KDSoapPendingCall::Private::startTimings(const QString &calledMethod, qint64 requestSerializationTime, const QSharedPointer<KDSoapCallStatistics> &callStatistics)
+{
+    method = calledMethod;
+    serializationTime = requestSerializationTime;
+    statistics = callStatistics;
+    if (buffer) {
+        requestSize = buffer->size();
+    }
+    if (reply) {
+        timer = new KDSoapCallTimer(reply.data());
+    }
+}
+
+KDSoapPendingCall::Timings KDSoapPendingCall::Private::timings() const
+{
+    KDSoapPendingCall::Timings result;
+    result.serializationTime = serializationTime;
+    result.requestSize = requestSize;
+    result.parseTime = parseTime;
+    result.responseSize = responseSize;
+    if (KDSoapCallTimer *callTimer = timer.data()) {
+        if (reply && reply->isFinished()) {
+            callTimer->markFinished();
+        }
+        const qint64 requestSent = callTimer->requestSentTime();
+        const qint64 firstByte = callTimer->firstByteTime();
+        result.queueTime = requestSent;
+        if (firstByte >= 0) {
+            // Since the request was sent, if the reply doesn't tell when it was uploaded
+            result.timeToFirstByte = firstByte - qMax<qint64>(requestSent, 0);
+            if (callTimer->finishedTime() >= 0) {
+                result.downloadTime = callTimer->finishedTime() - firstByte;
+            }
+        }
+    }
+    return result;
+}
 
-    if (!data.isEmpty()) {
-        KDSoapMessageReader reader;
-        reader.xmlToMessage(data, &replyMessage, 0, &replyHeaders, this->soapVersion);
+void KDSoapPendingCall::Private::startBackgroundParsing()
+{
+    if (parseInBackground && !backgroundParser && !parsed && reply && !reply->isFinished()) {
+        backgroundParser = new KDSoapReplyParser(reply.data(), soapVersion);
     }
+}
 
+QObject *KDSoapPendingCall::Private::finishedNotifier() const
+{
+    if (backgroundParser) {
+        return backgroundParser;
+    }
+    return reply.data();
+}
+
+void KDSoapPendingCall::Private::checkReplyError(QNetworkReply *reply)
+{
     if (reply->error()) {
         if (!replyMessage.isFault()) {
             replyHeaders.clear();
@@ -27,9 +27,10 @@
 #include "KDSoapMessage.h"
 QT_BEGIN_NAMESPACE
 class QNetworkReply;
-class QBuffer;
+class QIODevice;
 QT_END_NAMESPACE
 class KDSoapPendingCallWatcher;
+class KDSoapBodyParser;
 
 /**
  * The KDSoapPendingCall class refers to one pending asynchronous call
@@ -106,10 +107,74 @@ public:
      */
     bool isFinished() const;
 
+    /**
+     * Sets a parser for the body of the response message. Instead of being parsed into
+     * KDSoapValues, the contents of the body are then handed to \p parser, and returnMessage()
+     * only contains the name and namespace of the response element.
+     * Fault responses are still parsed into returnMessage().
+     *
+     * This must be called before the response is parsed, i.e. before the first call to
+     * returnMessage(), returnValue() or returnHeaders(). \p parser is not owned by the pending call
+     * and must stay alive until the response has been parsed.
+     *
+     * With KDSoapClientInterface::setBackgroundParsingEnabled(), the response is parsed already when
+     * KDSoapPendingCallWatcher emits finished(): setting a body parser then parses it again, in the calling thread.
+     * Use setBackgroundParsingEnabled(false) to avoid that.
+     *
+     * \since 1.8
+     */
+    void setBodyParser(KDSoapBodyParser *parser);
+
+    /**
+     * Enables or disables parsing the response in a background thread for this call, overriding
+     * KDSoapClientInterface::setBackgroundParsingEnabled(). This must be called before creating
+     * the KDSoapPendingCallWatcher for this call.
+     *
+     * Disable it when a body parser is set once the call finished, as the generated code with direct parsing does:
+     * the response is then parsed with the body parser anyway.
+     *
+     * \since 1.8
+     */
+    void setBackgroundParsingEnabled(bool enabled);
+
+    /**
+     * How long each step of a call took, and the size of the messages.
+     * The durations are in microseconds. Whatever wasn't measured is -1.
+     * \since 1.8
+     */
+    struct Timings {
+        Timings()
+            : serializationTime(-1), queueTime(-1), timeToFirstByte(-1), downloadTime(-1), parseTime(-1), requestSize(-1), responseSize(-1)
+        {
+        }
+
+        qint64 serializationTime; ///< writing the request message
+        qint64 queueTime;         ///< from sending the request until it's uploaded: waiting for a connection, connecting (TCP, TLS), uploading
+        qint64 timeToFirstByte;   ///< from the end of the upload to the first byte of the response: the server and the network latency
+        qint64 downloadTime;      ///< from the first to the last byte of the response
+        qint64 parseTime;         ///< reading the response message
+        qint64 requestSize;       ///< the size of the request, in bytes
+        qint64 responseSize;      ///< the size of the response, in bytes
+    };
+
+    /**
+     * Returns the timings of the call. The response times are known once the call is finished,
+     * and the parse time once the response was parsed, e.g. by returnMessage().
+     *
+     * The queue time is only known with the default and the native HTTP engines: when it isn't,
+     * the time to first byte starts when the request is sent. Responses from the cache (see
+     * KDSoapClientInterface::setResponseCacheTimeToLive()) and retried calls (see
+     * KDSoapClientInterface::setRetryPolicy()) have no download time, it's part of the time to first byte.
+     *
+     * The timings of all the calls of each method are aggregated by KDSoapClientInterface::callStatistics().
+     * \since 1.8
+     */
+    Timings timings() const;
+
 private:
     friend class KDSoapClientInterface;
     friend class KDSoapThreadTask;
-    KDSoapPendingCall(QNetworkReply *reply, QBuffer *buffer);
+    KDSoapPendingCall(QNetworkReply *reply, QIODevice *buffer);
 
     friend class KDSoapPendingCallWatcher; // for connecting to d->reply
 
@@ -30,7 +30,8 @@ KDSoapPendingCallWatcher::KDSoapPendingCallWatcher(const KDSoapPendingCall &call
     : QObject(parent), KDSoapPendingCall(call),
       d(new Private(this))
 {
-    connect(call.d->reply.data(), SIGNAL(finished()), this, SLOT(_kd_slotReplyFinished()));
+    call.d->startBackgroundParsing();
+    connect(call.d->finishedNotifier(), SIGNAL(finished()), this, SLOT(_kd_slotReplyFinished()));
 }
 
 KDSoapPendingCallWatcher::~KDSoapPendingCallWatcher()
@@ -48,7 +49,7 @@ void KDSoapPendingCallWatcher::waitForFinished()
 void KDSoapPendingCallWatcher::Private::_kd_slotReplyFinished()
 {
     // Workaround Qt-4.5 emitting finished twice in testCallRefusedAuth
-    disconnect(q->KDSoapPendingCall::d->reply.data(), SIGNAL(finished()), q, 0);
+    disconnect(q->KDSoapPendingCall::d->finishedNotifier(), SIGNAL(finished()), q, 0);
     emit q->finished(q);
 }
 
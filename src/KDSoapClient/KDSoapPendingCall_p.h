@@ -24,37 +24,71 @@
 #define KDSOAPPENDINGCALL_P_H
 
 #include <QSharedData>
-#include <QBuffer>
+#include <QIODevice>
 #include <QXmlStreamReader>
 #include "KDSoapMessage.h"
 #include <QPointer>
+#include <QSharedPointer>
 #include "KDSoapClientInterface.h"
 #include <QNetworkReply>
 
 class KDSoapValue;
+class KDSoapClientInterfacePrivate;
+class KDSoapReplyParser;
+class KDSoapCallTimer;
+class KDSoapCallStatistics;
 
 void maybeDebugRequest(const QByteArray &data, const QNetworkRequest &request, QNetworkReply *reply);
+void maybeDebugResponse(const QByteArray &data, QNetworkReply *reply);
 
 class KDSoapPendingCall::Private : public QSharedData
 {
 public:
-    Private(QNetworkReply *r, QBuffer *b)
-        : reply(r), buffer(b), soapVersion(KDSoap::SOAP1_1), parsed(false)
+    Private(QNetworkReply *r, QIODevice *b)
+        : reply(r), buffer(b), soapVersion(KDSoap::SOAP1_1), bodyParser(0), parseInBackground(false), backgroundParser(0), parsed(false),
+          serializationTime(-1), requestSize(-1), parseTime(-1), responseSize(-1)
     {
     }
     ~Private();
 
+    // Starts parsing the reply on a thread pool once it's finished, if enabled
+    void startBackgroundParsing();
+    // The object emitting finished() once the reply can be read without blocking
+    QObject *finishedNotifier() const;
+
     void parseReply();
+    void readReplyMessage(QNetworkReply *reply);
+    // Turns the reply message into a fault if \p reply has a network error
+    void checkReplyError(QNetworkReply *reply);
     KDSoapValue parseReplyElement(QXmlStreamReader &reader);
 
+    // Starts measuring the timings of the call, which are added to \p statistics once the reply is parsed
+    void startTimings(const QString &method, qint64 serializationTime, const QSharedPointer<KDSoapCallStatistics> &statistics);
+    KDSoapPendingCall::Timings timings() const;
+
     // Can be deleted under us if the KDSoapClientInterface (and its QNetworkAccessManager)
     // are deleted before the KDSoapPendingCall.
     QPointer<QNetworkReply> reply;
-    QBuffer *buffer;
+    QIODevice *buffer;
     KDSoapMessage replyMessage;
     KDSoapHeaders replyHeaders;
     KDSoap::SoapVersion soapVersion;
+    KDSoapBodyParser *bodyParser;
+    // To record that the server replied in the binary encoding
+    QPointer<KDSoapClientInterfacePrivate> clientInterface;
+    // KDSoapClientInterface::setBackgroundParsingEnabled
+    bool parseInBackground;
+    KDSoapReplyParser *backgroundParser;
     bool parsed;
+
+    // KDSoapPendingCall::timings()
+    QString method;
+    QPointer<KDSoapCallTimer> timer; // a child of the reply
+    QSharedPointer<KDSoapCallStatistics> statistics;
+    qint64 serializationTime;
+    qint64 requestSize;
+    qint64 parseTime;
+    qint64 responseSize;
 };
 
 #endif // KDSOAPPENDINGCALL_P_H
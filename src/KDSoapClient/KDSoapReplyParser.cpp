@@ -0,0 +1,234 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapReplyParser_p.h"
+#include "KDSoapPendingCall_p.h"
+#include "KDSoapMessageReader_p.h"
+#include "KDSoapMtom_p.h"
+#include "KDSoapBinaryEncoding_p.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+#include <QtNetwork/QNetworkReply>
+
+// What the job reads and writes. Outlives the KDSoapReplyParser if it's deleted while the job runs.
+struct KDSoapReplyParser::State
+{
+    State()
+        : receiver(0), done(false), soapVersion(KDSoap::SOAP1_1), binary(false), parseTime(-1)
+    {
+    }
+
+    QMutex mutex;
+    QWaitCondition doneCondition;
+    KDSoapReplyParser *receiver; // reset when the parser is deleted
+    bool done;
+
+    // Set before the job starts
+    QByteArray data;
+    QByteArray contentType;
+    KDSoap::SoapVersion soapVersion;
+
+    // Set by the job
+    KDSoapMessage message;
+    KDSoapHeaders headers;
+    bool binary;
+    qint64 parseTime; // in microseconds
+};
+
+class KDSoapReplyParser::Job : public QRunnable
+{
+public:
+    explicit Job(const QSharedPointer<State> &state)
+        : m_state(state)
+    {
+    }
+
+    /*! \reimp */ void run()
+    {
+        KDSoapMessage message;
+        KDSoapHeaders headers;
+        QElapsedTimer timer;
+        timer.start();
+        const bool binary = KDSoapReplyParser::parse(m_state->data, m_state->contentType, m_state->soapVersion, 0, &message, &headers);
+        const qint64 parseTime = timer.nsecsElapsed() / 1000;
+
+        QMutexLocker locker(&m_state->mutex);
+        m_state->message = message;
+        m_state->headers = headers;
+        m_state->binary = binary;
+        m_state->parseTime = parseTime;
+        m_state->done = true;
+        m_state->doneCondition.wakeAll();
+        if (m_state->receiver) {
+            QMetaObject::invokeMethod(m_state->receiver, "slotParsed", Qt::QueuedConnection);
+        }
+    }
+
+private:
+    QSharedPointer<State> m_state;
+};
+
+KDSoapReplyParser::KDSoapReplyParser(QNetworkReply *reply, KDSoap::SoapVersion soapVersion)
+    : m_reply(reply),
+      m_state(new State),
+      m_started(false),
+      m_finishedEmitted(false)
+{
+    m_state->receiver = this;
+    m_state->soapVersion = soapVersion;
+    connect(reply, SIGNAL(finished()), this, SLOT(slotReplyFinished()));
+}
+
+KDSoapReplyParser::~KDSoapReplyParser()
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_state->receiver = 0;
+}
+
+void KDSoapReplyParser::readReply()
+{
+    m_started = true;
+    if (QNetworkReply *reply = m_reply.data()) {
+        // Don't try to read from an aborted (closed) reply
+        m_state->data = reply->isOpen() ? reply->readAll() : QByteArray();
+        m_state->contentType = reply->rawHeader("Content-Type");
+        maybeDebugResponse(m_state->data, reply);
+    }
+}
+
+void KDSoapReplyParser::slotReplyFinished()
+{
+    if (!m_started) {
+        readReply();
+        if (!m_state->data.isEmpty()) {
+            QThreadPool::globalInstance()->start(new Job(m_state));
+            return;
+        }
+        // Nothing to parse, e.g. after a network error
+        QMutexLocker locker(&m_state->mutex);
+        m_state->done = true;
+    }
+    if (isDone()) {
+        slotParsed();
+    }
+}
+
+void KDSoapReplyParser::slotParsed()
+{
+    if (!m_finishedEmitted) {
+        m_finishedEmitted = true;
+        emit finished();
+    }
+}
+
+bool KDSoapReplyParser::isDone() const
+{
+    QMutexLocker locker(&m_state->mutex);
+    return m_state->done;
+}
+
+void KDSoapReplyParser::waitForDone()
+{
+    if (!m_started) {
+        // finished() wasn't delivered to us yet
+        readReply();
+        QElapsedTimer timer;
+        timer.start();
+        m_state->binary = parse(m_state->data, m_state->contentType, m_state->soapVersion, 0, &m_state->message, &m_state->headers);
+        QMutexLocker locker(&m_state->mutex);
+        m_state->parseTime = timer.nsecsElapsed() / 1000;
+        m_state->done = true;
+        return;
+    }
+    QMutexLocker locker(&m_state->mutex);
+    while (!m_state->done) {
+        m_state->doneCondition.wait(&m_state->mutex);
+    }
+}
+
+KDSoapMessage KDSoapReplyParser::message() const
+{
+    QMutexLocker locker(&m_state->mutex);
+    return m_state->message;
+}
+
+KDSoapHeaders KDSoapReplyParser::headers() const
+{
+    QMutexLocker locker(&m_state->mutex);
+    return m_state->headers;
+}
+
+bool KDSoapReplyParser::isBinary() const
+{
+    QMutexLocker locker(&m_state->mutex);
+    return m_state->binary;
+}
+
+qint64 KDSoapReplyParser::parseTime() const
+{
+    QMutexLocker locker(&m_state->mutex);
+    return m_state->parseTime;
+}
+
+QByteArray KDSoapReplyParser::data() const
+{
+    return m_state->data;
+}
+
+QByteArray KDSoapReplyParser::contentType() const
+{
+    return m_state->contentType;
+}
+
+bool KDSoapReplyParser::parse(const QByteArray &replyData, const QByteArray &contentType, KDSoap::SoapVersion soapVersion, KDSoapBodyParser *bodyParser,
+                              KDSoapMessage *message, KDSoapHeaders *headers)
+{
+    if (replyData.isEmpty()) {
+        return false;
+    }
+
+    // MTOM: the envelope is the root part, binary values are in the other parts
+    QByteArray data = replyData;
+    KDSoapMtomPackage mtomPackage;
+    if (KDSoapMtomPackage::isMultipart(contentType)) {
+        QByteArray rootPart;
+        if (mtomPackage.parse(contentType, data, &rootPart)) {
+            data = rootPart;
+        } else {
+            qWarning("KDSoap: Invalid multipart reply");
+        }
+    }
+
+    KDSoapMessageReader reader;
+    reader.setBodyParser(bodyParser);
+    reader.setMtomPackage(&mtomPackage);
+    if (KDSoapBinaryEncoding::isBinaryContentType(contentType)) {
+        return reader.binaryToMessage(data, message, 0, headers, soapVersion) == KDSoapMessageReader::NoError;
+    }
+    reader.xmlToMessage(data, message, 0, headers, soapVersion);
+    return false;
+}
+
+#include "moc_KDSoapReplyParser_p.cpp"
@@ -0,0 +1,88 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPREPLYPARSER_P_H
+#define KDSOAPREPLYPARSER_P_H
+
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QSharedPointer>
+#include "KDSoapMessage.h"
+
+QT_BEGIN_NAMESPACE
+class QNetworkReply;
+QT_END_NAMESPACE
+class KDSoapBodyParser;
+
+/**
+ * \internal
+ * Parses the response of a reply on a thread of QThreadPool::globalInstance(), once the reply is finished.
+ * finished() is emitted, in the thread of this object, when the message is ready.
+ *
+ * The data of the reply is kept, so that it can be parsed again if a body parser is set afterwards.
+ */
+class KDSoapReplyParser : public QObject
+{
+    Q_OBJECT
+public:
+    KDSoapReplyParser(QNetworkReply *reply, KDSoap::SoapVersion soapVersion);
+    ~KDSoapReplyParser();
+
+    // True once the message is ready
+    bool isDone() const;
+    // Blocks until the message is ready. Parses it in the current thread if the reply just finished.
+    void waitForDone();
+
+    // Only valid once done
+    KDSoapMessage message() const;
+    KDSoapHeaders headers() const;
+    bool isBinary() const;
+    // In microseconds
+    qint64 parseTime() const;
+    QByteArray data() const;
+    QByteArray contentType() const;
+
+    // Parses \p data, the response of a reply with the content type \p contentType.
+    // Returns true if the message was successfully read from the binary encoding.
+    // This can be called from any thread.
+    static bool parse(const QByteArray &data, const QByteArray &contentType, KDSoap::SoapVersion soapVersion, KDSoapBodyParser *bodyParser,
+                      KDSoapMessage *message, KDSoapHeaders *headers);
+
+Q_SIGNALS:
+    void finished();
+
+private Q_SLOTS:
+    void slotReplyFinished();
+    void slotParsed();
+
+private:
+    class Job;
+    struct State;
+    void readReply();
+
+    QPointer<QNetworkReply> m_reply;
+    QSharedPointer<State> m_state; // shared with the job
+    bool m_started;
+    bool m_finishedEmitted;
+};
+
+#endif // KDSOAPREPLYPARSER_P_H
@@ -0,0 +1,321 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+
+#include "KDSoapRequestDevice_p.h"
+#include "KDSoapBinaryCodec.h"
+#include "KDSoapBodyWriter.h"
+#include "KDSoapMtom_p.h"
+
+#include <QThreadStorage>
+#include <QXmlStreamWriter>
+#include <string.h>
+
+// Number of source bytes encoded at a time; a multiple of 3, so that only the last chunk gets base64 padding
+static const qint64 s_chunkSize = 3 * 16384;
+
+KDSoapRequestDevice::KDSoapRequestDevice()
+    : m_size(0),
+      m_segment(0),
+      m_offset(0),
+      m_sourceRead(0),
+      m_chunkPos(0)
+{
+}
+
+KDSoapRequestDevice::~KDSoapRequestDevice()
+{
+}
+
+// The request device collecting device values while a message is being written in this thread.
+struct KDSoapCurrentRequestDevice {
+    KDSoapCurrentRequestDevice() : device(0) {}
+    KDSoapRequestDevice *device;
+};
+static QThreadStorage<KDSoapCurrentRequestDevice *> s_currentDevice;
+
+static KDSoapCurrentRequestDevice *currentDeviceStorage()
+{
+    if (!s_currentDevice.hasLocalData()) {
+        s_currentDevice.setLocalData(new KDSoapCurrentRequestDevice);
+    }
+    return s_currentDevice.localData();
+}
+
+KDSoapRequestDevice::Scope::Scope(KDSoapRequestDevice *device)
+{
+    KDSoapCurrentRequestDevice *storage = currentDeviceStorage();
+    m_previous = storage->device;
+    storage->device = device;
+}
+
+KDSoapRequestDevice::Scope::~Scope()
+{
+    currentDeviceStorage()->device = m_previous;
+}
+
+KDSoapRequestDevice *KDSoapRequestDevice::current()
+{
+    return s_currentDevice.hasLocalData() ? s_currentDevice.localData()->device : 0;
+}
+
+void KDSoapRequestDevice::writeBase64Device(QXmlStreamWriter &writer, QIODevice *device, const QString &contentType)
+{
+    if (!device->isSequential()) {
+        KDSoapMtomPackage *mtomPackage = KDSoapMtomPackage::current();
+        if (mtomPackage) {
+            mtomPackage->writeInclude(writer, device, contentType);
+            return;
+        }
+        KDSoapRequestDevice *requestDevice = current();
+        if (requestDevice && writer.device()) {
+            writer.writeCharacters(QString()); // finish the start tag, so that the device data goes after it
+            requestDevice->insertDevice(writer.device()->pos(), device);
+            return;
+        }
+    }
+    // Sequential device, or no request being written (e.g. KDSoapValue::toXml): read it all
+    KDSoapBodyWriter::writeBase64Binary(writer, readDevice(device), contentType);
+}
+
+QByteArray KDSoapRequestDevice::readDevice(QIODevice *device)
+{
+    const qint64 pos = device->pos();
+    const QByteArray data = device->readAll();
+    if (!device->isSequential()) {
+        device->seek(pos);
+    }
+    return data;
+}
+
+qint64 KDSoapRequestDevice::Segment::outputSize() const
+{
+    if (!device) {
+        return data.size();
+    }
+    return encoding == Base64 ? (sourceSize + 2) / 3 * 4 : sourceSize;
+}
+
+void KDSoapRequestDevice::insertDevice(qint64 xmlOffset, QIODevice *device)
+{
+    Insertion insertion;
+    insertion.offset = xmlOffset;
+    insertion.device = device;
+    m_insertions.append(insertion);
+}
+
+void KDSoapRequestDevice::appendXml(const QByteArray &xml)
+{
+    qint64 offset = 0;
+    Q_FOREACH (const Insertion &insertion, m_insertions) {
+        appendData(xml.mid(offset, insertion.offset - offset));
+        appendDevice(insertion.device, Base64);
+        offset = insertion.offset;
+    }
+    appendData(offset == 0 ? xml : xml.mid(offset));
+    m_insertions.clear();
+}
+
+void KDSoapRequestDevice::appendData(const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+    Segment segment;
+    segment.data = data;
+    m_segments.append(segment);
+    m_size += data.size();
+}
+
+void KDSoapRequestDevice::appendDevice(QIODevice *device, Encoding encoding)
+{
+    Segment segment;
+    segment.device = device;
+    segment.start = device->pos();
+    segment.sourceSize = qMax(qint64(0), device->size() - segment.start);
+    segment.encoding = encoding;
+    m_segments.append(segment);
+    m_size += segment.outputSize();
+}
+
+bool KDSoapRequestDevice::hasDevices() const
+{
+    Q_FOREACH (const Segment &segment, m_segments) {
+        if (segment.device) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QByteArray KDSoapRequestDevice::debugData() const
+{
+    QByteArray result;
+    Q_FOREACH (const Segment &segment, m_segments) {
+        if (segment.device) {
+            result += "[" + QByteArray::number(segment.sourceSize) + " bytes from a QIODevice]";
+        } else {
+            result += segment.data;
+        }
+    }
+    return result;
+}
+
+bool KDSoapRequestDevice::open(OpenMode mode)
+{
+    // Unbuffered: QIODevice's buffer would only duplicate m_chunk, and get in the way of seek()
+    return QIODevice::open(mode | QIODevice::Unbuffered) && positionAt(0);
+}
+
+bool KDSoapRequestDevice::isSequential() const
+{
+    return false;
+}
+
+qint64 KDSoapRequestDevice::size() const
+{
+    return m_size;
+}
+
+bool KDSoapRequestDevice::seek(qint64 pos)
+{
+    return QIODevice::seek(pos) && positionAt(pos);
+}
+
+bool KDSoapRequestDevice::positionAt(qint64 pos)
+{
+    for (m_segment = 0; m_segment < m_segments.count(); ++m_segment) {
+        const qint64 segmentSize = m_segments.at(m_segment).outputSize();
+        if (pos < segmentSize) {
+            break;
+        }
+        pos -= segmentSize;
+    }
+    m_offset = pos;
+    m_sourceRead = 0;
+    m_chunk.clear();
+    m_chunkPos = 0;
+    if (m_segment == m_segments.count()) {
+        return true;
+    }
+    const Segment &segment = m_segments.at(m_segment);
+    if (!segment.device) {
+        return true;
+    }
+    if (segment.encoding == Raw) {
+        return segment.device->seek(segment.start + pos);
+    }
+    // Go back to the start of the group of 4 base64 characters, and skip what's before pos in that group
+    m_offset = pos / 4 * 4;
+    m_sourceRead = pos / 4 * 3;
+    if (!segment.device->seek(segment.start + m_sourceRead)) {
+        return false;
+    }
+    if (pos > m_offset) {
+        if (!fillChunk(segment)) {
+            return false;
+        }
+        m_chunkPos = pos - m_offset;
+        m_offset = pos;
+    }
+    return true;
+}
+
+bool KDSoapRequestDevice::nextSegment()
+{
+    ++m_segment;
+    m_offset = 0;
+    m_sourceRead = 0;
+    m_chunk.clear();
+    m_chunkPos = 0;
+    if (m_segment < m_segments.count()) {
+        const Segment &segment = m_segments.at(m_segment);
+        if (segment.device) {
+            return segment.device->seek(segment.start);
+        }
+    }
+    return true;
+}
+
+bool KDSoapRequestDevice::fillChunk(const Segment &segment)
+{
+    const qint64 wanted = qMin(segment.sourceSize - m_sourceRead, s_chunkSize);
+    QByteArray source;
+    source.resize(int(wanted));
+    qint64 got = 0;
+    while (got < wanted) {
+        const qint64 bytesRead = segment.device->read(source.data() + got, wanted - got);
+        if (bytesRead <= 0) {
+            setErrorString(QString::fromLatin1("Error reading binary value: %1").arg(segment.device->errorString()));
+            return false;
+        }
+        got += bytesRead;
+    }
+    m_sourceRead += got;
+    m_chunk = KDSoapBinaryCodec::toBase64(source);
+    m_chunkPos = 0;
+    return true;
+}
+
+qint64 KDSoapRequestDevice::readData(char *data, qint64 maxSize)
+{
+    qint64 done = 0;
+    while (done < maxSize && m_segment < m_segments.count()) {
+        const Segment &segment = m_segments.at(m_segment);
+        const qint64 segmentSize = segment.outputSize();
+        if (m_offset == segmentSize) {
+            if (!nextSegment()) {
+                setErrorString(QString::fromLatin1("Error seeking in binary value: %1").arg(m_segments.at(m_segment).device->errorString()));
+                return done > 0 ? done : -1;
+            }
+            continue;
+        }
+        qint64 bytes;
+        if (!segment.device) {
+            bytes = qMin(maxSize - done, segmentSize - m_offset);
+            memcpy(data + done, segment.data.constData() + m_offset, size_t(bytes));
+        } else if (segment.encoding == Raw) {
+            bytes = segment.device->read(data + done, qMin(maxSize - done, segmentSize - m_offset));
+            if (bytes <= 0) {
+                setErrorString(QString::fromLatin1("Error reading binary value: %1").arg(segment.device->errorString()));
+                return done > 0 ? done : -1;
+            }
+        } else {
+            if (m_chunkPos == m_chunk.size() && !fillChunk(segment)) {
+                return done > 0 ? done : -1;
+            }
+            bytes = qMin(maxSize - done, qint64(m_chunk.size() - m_chunkPos));
+            memcpy(data + done, m_chunk.constData() + m_chunkPos, size_t(bytes));
+            m_chunkPos += int(bytes);
+        }
+        done += bytes;
+        m_offset += bytes;
+    }
+    return done;
+}
+
+qint64 KDSoapRequestDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
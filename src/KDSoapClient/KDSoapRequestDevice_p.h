@@ -0,0 +1,131 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPREQUESTDEVICE_P_H
+#define KDSOAPREQUESTDEVICE_P_H
+
+#include "KDSoapGlobal.h"
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+QT_BEGIN_NAMESPACE
+class QXmlStreamWriter;
+QT_END_NAMESPACE
+
+/**
+ * \internal
+ * The body of a request whose binary values come from QIODevices (see KDSoapValue::setBinaryDevice).
+ * Instead of serializing everything into a QByteArray, the request is a list of segments:
+ * XML text, and ranges of source devices which are read (and base64-encoded if needed)
+ * in chunks, while QNetworkAccessManager uploads the request.
+ *
+ * The device is random-access (it can be rewound when QNAM has to resend the request),
+ * so the source devices must be random-access too.
+ *
+ * Internal class -- only exported for the server lib
+ */
+class KDSOAP_EXPORT KDSoapRequestDevice : public QIODevice
+{
+public:
+    enum Encoding {
+        Raw,
+        Base64
+    };
+
+    KDSoapRequestDevice();
+    ~KDSoapRequestDevice();
+
+    // Writing: while a KDSoapRequestDevice::Scope is alive, KDSoapValue and KDSoapBodyWriter
+    // call insertDevice() on current() for device values, rather than reading them.
+    class Scope
+    {
+    public:
+        explicit Scope(KDSoapRequestDevice *device);
+        ~Scope();
+    private:
+        KDSoapRequestDevice *m_previous;
+    };
+    static KDSoapRequestDevice *current();
+
+    // Writes the contents of \p device as the base64Binary contents of the current element of \p writer.
+    // Depending on the current scopes, this is an MTOM attachment, a device segment of the current
+    // request device, or (as a fallback) the base64 text read from \p device.
+    static void writeBase64Device(QXmlStreamWriter &writer, QIODevice *device, const QString &contentType);
+
+    // Returns the data of \p device from its current position, leaving the device at that position if possible.
+    static QByteArray readDevice(QIODevice *device);
+
+    // Records that the contents of \p device go at offset \p xmlOffset of the XML being written.
+    void insertDevice(qint64 xmlOffset, QIODevice *device);
+
+    // Appends \p xml, with the devices recorded by insertDevice() in between.
+    void appendXml(const QByteArray &xml);
+    void appendData(const QByteArray &data);
+    void appendDevice(QIODevice *device, Encoding encoding);
+
+    bool hasDevices() const;
+
+    // The request, with placeholders for the device data (for KDSOAP_DEBUG)
+    QByteArray debugData() const;
+
+    /*! \reimp */ bool open(OpenMode mode);
+    /*! \reimp */ bool isSequential() const;
+    /*! \reimp */ qint64 size() const;
+    /*! \reimp */ bool seek(qint64 pos);
+
+protected:
+    /*! \reimp */ qint64 readData(char *data, qint64 maxSize);
+    /*! \reimp */ qint64 writeData(const char *data, qint64 maxSize);
+
+private:
+    struct Segment {
+        Segment() : device(0), start(0), sourceSize(0), encoding(Raw) {}
+        qint64 outputSize() const;
+
+        QByteArray data;
+        QIODevice *device;
+        qint64 start; // position of the data in device
+        qint64 sourceSize;
+        Encoding encoding;
+    };
+    struct Insertion {
+        qint64 offset;
+        QIODevice *device;
+    };
+    bool fillChunk(const Segment &segment);
+    bool nextSegment();
+    bool positionAt(qint64 pos);
+
+    QList<Segment> m_segments;
+    QVector<Insertion> m_insertions;
+    qint64 m_size;
+    // Read state
+    int m_segment;
+    qint64 m_offset; // in the output of m_segment
+    qint64 m_sourceRead; // bytes of m_segment's device consumed so far
+    QByteArray m_chunk; // encoded chunk of the current device segment
+    int m_chunkPos;
+};
+
+#endif // KDSOAPREQUESTDEVICE_P_H
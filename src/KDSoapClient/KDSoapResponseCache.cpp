@@ -0,0 +1,309 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapResponseCache_p.h"
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QThread>
+
+static const int s_defaultMaxSize = 10 * 1024 * 1024;
+
+QSharedPointer<KDSoapResponseCache> KDSoapResponseCache::create()
+{
+    QSharedPointer<KDSoapResponseCache> cache(new KDSoapResponseCache);
+    cache->m_self = cache;
+    return cache;
+}
+
+KDSoapResponseCache::KDSoapResponseCache()
+    : m_entries(s_defaultMaxSize),
+      m_hits(0),
+      m_misses(0),
+      m_coalesced(0)
+{
+    m_clock.start();
+}
+
+void KDSoapResponseCache::setTimeToLive(const QString &method, int msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (msecs > 0) {
+        m_timeToLive.insert(method, msecs);
+    } else {
+        m_timeToLive.remove(method);
+    }
+}
+
+int KDSoapResponseCache::timeToLive(const QString &method) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_timeToLive.value(method);
+}
+
+void KDSoapResponseCache::setMaxSize(int bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.setMaxCost(bytes);
+}
+
+int KDSoapResponseCache::maxSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.maxCost();
+}
+
+void KDSoapResponseCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+}
+
+KDSoapClientInterface::ResponseCacheStatistics KDSoapResponseCache::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    KDSoapClientInterface::ResponseCacheStatistics stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.coalesced = m_coalesced;
+    stats.entries = m_entries.count();
+    stats.size = m_entries.totalCost();
+    return stats;
+}
+
+QByteArray KDSoapResponseCache::cacheKey(const QNetworkRequest &request, const QByteArray &data)
+{
+    // The content type has the SOAP action with SOAP 1.2
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(request.url().toEncoded());
+    hash.addData("\n", 1);
+    hash.addData(request.rawHeader("SoapAction"));
+    hash.addData("\n", 1);
+    hash.addData(request.header(QNetworkRequest::ContentTypeHeader).toByteArray());
+    hash.addData("\n", 1);
+    hash.addData(data);
+    return hash.result();
+}
+
+QNetworkReply *KDSoapResponseCache::lookup(const QByteArray &key, const QNetworkRequest &request, bool coalesce, bool *watch)
+{
+    QMutexLocker locker(&m_mutex);
+    *watch = false;
+    if (Entry *entry = m_entries.object(key)) {
+        if (entry->expiry > m_clock.elapsed()) {
+            ++m_hits;
+            return new KDSoapCachedReply(request, entry->data, entry->contentType);
+        }
+        m_entries.remove(key);
+    }
+    QHash<QByteArray, Pending>::iterator it = m_pending.find(key);
+    if (it == m_pending.end()) {
+        Pending pending;
+        pending.thread = QThread::currentThread();
+        m_pending.insert(key, pending);
+        *watch = true;
+    } else if (coalesce && it->thread == QThread::currentThread()) {
+        ++m_coalesced;
+        KDSoapCachedReply *reply = new KDSoapCachedReply(request, m_self.toStrongRef(), key);
+        it->waiting.append(reply);
+        return reply;
+    }
+    ++m_misses;
+    return 0;
+}
+
+void KDSoapResponseCache::watch(QNetworkReply *reply, const QByteArray &key, int timeToLive)
+{
+    new KDSoapResponseCacheFiller(reply, m_self.toStrongRef(), key, timeToLive);
+}
+
+void KDSoapResponseCache::finishRequest(const QByteArray &key, int timeToLive, const QByteArray &data, const QByteArray &contentType,
+                                        QNetworkReply::NetworkError error, const QString &errorString, bool timedOut)
+{
+    QMutexLocker locker(&m_mutex);
+    if (error == QNetworkReply::NoError && timeToLive > 0) {
+        Entry *entry = new Entry;
+        entry->data = data;
+        entry->contentType = contentType;
+        entry->expiry = m_clock.elapsed() + timeToLive;
+        m_entries.insert(key, entry, data.size() + contentType.size() + key.size());
+    }
+    // Queued, since the waiting calls can be in other threads
+    const QList<KDSoapCachedReply *> waiting = m_pending.take(key).waiting;
+    Q_FOREACH (KDSoapCachedReply *reply, waiting) {
+        QMetaObject::invokeMethod(reply, "slotResponse", Qt::QueuedConnection,
+                                  Q_ARG(QByteArray, data), Q_ARG(QByteArray, contentType),
+                                  Q_ARG(int, error), Q_ARG(QString, errorString), Q_ARG(bool, timedOut));
+    }
+}
+
+void KDSoapResponseCache::removeWaiter(const QByteArray &key, KDSoapCachedReply *reply)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QByteArray, Pending>::iterator it = m_pending.find(key);
+    if (it != m_pending.end()) {
+        it->waiting.removeAll(reply);
+    }
+}
+
+KDSoapCachedReply::KDSoapCachedReply(const QNetworkRequest &request, const QByteArray &data, const QByteArray &contentType, QObject *parent)
+    : QNetworkReply(parent),
+      m_data(data),
+      m_dataPos(0)
+{
+    init(request);
+    setRawHeader("Content-Type", contentType);
+    // Queued, like network replies: the caller connects to finished() after this
+    QMetaObject::invokeMethod(this, "slotFinished", Qt::QueuedConnection);
+}
+
+KDSoapCachedReply::KDSoapCachedReply(const QNetworkRequest &request, const QSharedPointer<KDSoapResponseCache> &cache, const QByteArray &key, QObject *parent)
+    : QNetworkReply(parent),
+      m_cache(cache),
+      m_key(key),
+      m_dataPos(0)
+{
+    init(request);
+}
+
+KDSoapCachedReply::~KDSoapCachedReply()
+{
+    detach();
+}
+
+void KDSoapCachedReply::init(const QNetworkRequest &request)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(QNetworkAccessManager::PostOperation);
+    open(QIODevice::ReadOnly);
+}
+
+void KDSoapCachedReply::detach()
+{
+    if (m_cache) {
+        m_cache->removeWaiter(m_key, this);
+        m_cache.clear();
+    }
+}
+
+void KDSoapCachedReply::waitForFinished()
+{
+    if (!m_cache) {
+        slotFinished();
+    }
+}
+
+void KDSoapCachedReply::abort()
+{
+    if (isFinished()) {
+        return;
+    }
+    detach();
+    m_data.clear();
+    setError(QNetworkReply::OperationCanceledError, QString::fromLatin1("Operation canceled"));
+    setFinished(true);
+    emit finished();
+}
+
+qint64 KDSoapCachedReply::bytesAvailable() const
+{
+    return QNetworkReply::bytesAvailable() + m_data.size() - m_dataPos;
+}
+
+bool KDSoapCachedReply::isSequential() const
+{
+    return true;
+}
+
+qint64 KDSoapCachedReply::readData(char *data, qint64 maxSize)
+{
+    const int count = int(qMin<qint64>(maxSize, m_data.size() - m_dataPos));
+    if (count == 0 && isFinished()) {
+        return -1;
+    }
+    memcpy(data, m_data.constData() + m_dataPos, count);
+    m_dataPos += count;
+    return count;
+}
+
+void KDSoapCachedReply::slotFinished()
+{
+    if (isFinished()) { // aborted meanwhile
+        return;
+    }
+    if (error() == QNetworkReply::NoError) {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+    }
+    setFinished(true);
+    emit readyRead();
+    emit finished();
+}
+
+void KDSoapCachedReply::slotResponse(const QByteArray &data, const QByteArray &contentType, int error, const QString &errorString, bool timedOut)
+{
+    if (isFinished()) {
+        return;
+    }
+    m_cache.clear(); // not waiting anymore
+    if (error != QNetworkReply::NoError) {
+        if (timedOut) {
+            setProperty("kdsoap_reply_timed_out", true); // see KDSoapPendingCall.cpp
+        }
+        setError(static_cast<QNetworkReply::NetworkError>(error), errorString);
+    }
+    m_data = data;
+    setRawHeader("Content-Type", contentType);
+    slotFinished();
+}
+
+KDSoapResponseCacheFiller::KDSoapResponseCacheFiller(QNetworkReply *reply, const QSharedPointer<KDSoapResponseCache> &cache, const QByteArray &key, int timeToLive)
+    : QObject(reply),
+      m_cache(cache),
+      m_key(key),
+      m_timeToLive(timeToLive),
+      m_done(false)
+{
+    connect(reply, SIGNAL(finished()), this, SLOT(slotFinished()));
+}
+
+KDSoapResponseCacheFiller::~KDSoapResponseCacheFiller()
+{
+    if (!m_done) {
+        // The reply is deleted without finishing: the calls waiting for it won't get a response
+        m_cache->finishRequest(m_key, 0, QByteArray(), QByteArray(), QNetworkReply::OperationCanceledError,
+                               QString::fromLatin1("Operation canceled"), false);
+    }
+}
+
+void KDSoapResponseCacheFiller::slotFinished()
+{
+    if (m_done) {
+        return;
+    }
+    m_done = true;
+    QNetworkReply *reply = static_cast<QNetworkReply *>(parent());
+    // Only peek at the data, KDSoapPendingCall reads it
+    const QByteArray data = reply->isOpen() ? reply->peek(reply->bytesAvailable()) : QByteArray();
+    m_cache->finishRequest(m_key, m_timeToLive, data, reply->rawHeader("Content-Type"),
+                           reply->error(), reply->errorString(), reply->property("kdsoap_reply_timed_out").toBool());
+}
+
+#include "moc_KDSoapResponseCache_p.cpp"
@@ -0,0 +1,159 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPRESPONSECACHE_P_H
+#define KDSOAPRESPONSECACHE_P_H
+
+#include "KDSoapClientInterface.h"
+#include <QtCore/QCache>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QWeakPointer>
+#include <QtNetwork/QNetworkReply>
+
+class KDSoapCachedReply;
+
+/**
+ * \internal
+ * The responses to the calls of the operations with a time to live, and the calls of these operations
+ * in progress, keyed on the endpoint, the SoapAction and the request data.
+ *
+ * Thread-safe: used by asynchronous calls and by the thread of blocking calls.
+ */
+class KDSoapResponseCache
+{
+public:
+    static QSharedPointer<KDSoapResponseCache> create();
+
+    void setTimeToLive(const QString &method, int msecs);
+    int timeToLive(const QString &method) const;
+    void setMaxSize(int bytes);
+    int maxSize() const;
+    void clear();
+    KDSoapClientInterface::ResponseCacheStatistics statistics() const;
+
+    // The key of the request \p request, with the body \p data
+    static QByteArray cacheKey(const QNetworkRequest &request, const QByteArray &data);
+
+    // Returns a reply with the cached response, or, if \p coalesce is true, a reply waiting for the
+    // response of the identical call in progress, if that call belongs to the current thread: the response
+    // of a call made from another thread could depend on the event loop of a thread blocked waiting for us.
+    // Otherwise returns null: the caller sends the request, and then calls watch() if \p watch is set to true.
+    QNetworkReply *lookup(const QByteArray &key, const QNetworkRequest &request, bool coalesce, bool *watch);
+    // Caches the response of \p reply, for \p timeToLive msecs, and hands it to the calls waiting for it
+    void watch(QNetworkReply *reply, const QByteArray &key, int timeToLive);
+
+private:
+    friend class KDSoapCachedReply;
+    friend class KDSoapResponseCacheFiller;
+    KDSoapResponseCache();
+
+    struct Entry {
+        QByteArray data;
+        QByteArray contentType;
+        qint64 expiry;
+    };
+
+    struct Pending {
+        Pending() : thread(0) {}
+        QThread *thread; // of the call in progress
+        QList<KDSoapCachedReply *> waiting;
+    };
+
+    // Called once the response of the call with \p key is known
+    void finishRequest(const QByteArray &key, int timeToLive, const QByteArray &data, const QByteArray &contentType,
+                       QNetworkReply::NetworkError error, const QString &errorString, bool timedOut);
+    void removeWaiter(const QByteArray &key, KDSoapCachedReply *reply);
+
+    QWeakPointer<KDSoapResponseCache> m_self;
+    mutable QMutex m_mutex;
+    QHash<QString, int> m_timeToLive;
+    QCache<QByteArray, Entry> m_entries; // the cost of an entry is its size in bytes
+    QHash<QByteArray, Pending> m_pending; // the calls in progress, and the calls waiting for them
+    QElapsedTimer m_clock;
+    int m_hits;
+    int m_misses;
+    int m_coalesced;
+};
+
+/**
+ * \internal
+ * A reply from KDSoapResponseCache: either a cached response, or the response of another call
+ */
+class KDSoapCachedReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    // A cached response, which finishes once the event loop runs
+    KDSoapCachedReply(const QNetworkRequest &request, const QByteArray &data, const QByteArray &contentType, QObject *parent = 0);
+    // A call waiting for the call with \p key
+    KDSoapCachedReply(const QNetworkRequest &request, const QSharedPointer<KDSoapResponseCache> &cache, const QByteArray &key, QObject *parent = 0);
+    ~KDSoapCachedReply();
+
+    // For cached responses: finishes right away, for blocking calls
+    void waitForFinished();
+
+    /*! \reimp */ void abort();
+    /*! \reimp */ qint64 bytesAvailable() const;
+    /*! \reimp */ bool isSequential() const;
+
+protected:
+    /*! \reimp */ qint64 readData(char *data, qint64 maxSize);
+
+private Q_SLOTS:
+    void slotFinished();
+    void slotResponse(const QByteArray &data, const QByteArray &contentType, int error, const QString &errorString, bool timedOut);
+
+private:
+    void init(const QNetworkRequest &request);
+    void detach();
+
+    QSharedPointer<KDSoapResponseCache> m_cache; // while waiting
+    QByteArray m_key;
+    QByteArray m_data;
+    int m_dataPos;
+};
+
+/**
+ * \internal
+ * Reads the response of a call for KDSoapResponseCache. Child of the reply.
+ */
+class KDSoapResponseCacheFiller : public QObject
+{
+    Q_OBJECT
+public:
+    KDSoapResponseCacheFiller(QNetworkReply *reply, const QSharedPointer<KDSoapResponseCache> &cache, const QByteArray &key, int timeToLive);
+    ~KDSoapResponseCacheFiller();
+
+private Q_SLOTS:
+    void slotFinished();
+
+private:
+    QSharedPointer<KDSoapResponseCache> m_cache;
+    QByteArray m_key;
+    int m_timeToLive;
+    bool m_done;
+};
+
+#endif // KDSOAPRESPONSECACHE_P_H
@@ -0,0 +1,258 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapRetry_p.h"
+#include "KDSoapClientInterface_p.h"
+#include "KDSoapLoadBalancer_p.h"
+#include <QtCore/QBuffer>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QtCore/QRandomGenerator>
+#endif
+#include <algorithm>
+
+static const int s_responseTimeSamples = 100;
+static const int s_minResponseTimeSamples = 20; // before hedging
+
+// For the jitter: must differ between the processes, and the threads, retrying at the same time
+static int randomNumber()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    return int(QRandomGenerator::global()->generate() & 0x7fffffff);
+#else
+    // qrand() has a sequence per thread, the same everywhere unless seeded
+    static QThreadStorage<bool> seeded;
+    if (!seeded.hasLocalData()) {
+        seeded.setLocalData(true);
+        qsrand(uint(QDateTime::currentMSecsSinceEpoch()) ^ uint(QCoreApplication::applicationPid())
+               ^ uint(quintptr(QThread::currentThreadId())));
+    }
+    return qrand();
+#endif
+}
+
+void KDSoapRetryPolicies::setPolicy(const QString &method, const KDSoapClientInterface::RetryPolicy &policy)
+{
+    QMutexLocker locker(&m_mutex);
+    m_policies.insert(method, policy);
+}
+
+KDSoapClientInterface::RetryPolicy KDSoapRetryPolicies::policy(const QString &method) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_policies.value(method);
+}
+
+void KDSoapRetryPolicies::addResponseTime(const QString &method, int msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    ResponseTimes &times = m_responseTimes[method];
+    if (times.samples.count() < s_responseTimeSamples) {
+        times.samples.append(msecs);
+    } else {
+        times.samples[times.next] = msecs;
+        times.next = (times.next + 1) % s_responseTimeSamples;
+    }
+}
+
+int KDSoapRetryPolicies::responseTimePercentile(const QString &method, int percentile) const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<int> samples = m_responseTimes.value(method).samples;
+    locker.unlock();
+    if (samples.count() < s_minResponseTimeSamples) {
+        return -1;
+    }
+    const int index = (samples.count() - 1) * qBound(0, percentile, 100) / 100;
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples.at(index);
+}
+
+KDSoapRetryingReply::KDSoapRetryingReply(KDSoapClientInterfacePrivate *client, QNetworkAccessManager *manager, const QNetworkRequest &request,
+                                         const QByteArray &requestData, const QString &method, const QSharedPointer<KDSoapRetryPolicies> &policies)
+    : m_client(client),
+      m_manager(manager),
+      m_requestData(requestData),
+      m_method(method),
+      m_policies(policies),
+      m_policy(policies->policy(method)),
+      m_retries(0),
+      m_hedged(false),
+      m_dataPos(0)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(QNetworkAccessManager::PostOperation);
+    open(QIODevice::ReadOnly);
+    m_retryTimer.setSingleShot(true);
+    connect(&m_retryTimer, SIGNAL(timeout()), this, SLOT(slotRetry()));
+    m_hedgeTimer.setSingleShot(true);
+    connect(&m_hedgeTimer, SIGNAL(timeout()), this, SLOT(slotHedge()));
+    m_clock.start();
+    startAttempt();
+}
+
+KDSoapRetryingReply::~KDSoapRetryingReply()
+{
+    abortAttempts();
+}
+
+void KDSoapRetryingReply::startAttempt()
+{
+    QBuffer *buffer = new QBuffer;
+    buffer->setData(m_requestData);
+    buffer->open(QIODevice::ReadOnly);
+    QNetworkReply *attempt = m_client->post(m_manager.data(), request(), buffer);
+    buffer->setParent(attempt);
+    m_client->setupReply(attempt, false); // the timeout is for the whole call, i.e. this reply
+    attempt->setProperty("kdsoap_attempt_start", m_clock.elapsed());
+    connect(attempt, SIGNAL(finished()), this, SLOT(slotAttemptFinished()));
+    m_attempts.append(attempt);
+    if (m_policy.hedging && !m_hedged) {
+        const int delay = m_policies->responseTimePercentile(m_method, m_policy.hedgingPercentile);
+        if (delay >= 0) {
+            m_hedgeTimer.start(delay);
+        }
+    }
+}
+
+void KDSoapRetryingReply::abortAttempts()
+{
+    Q_FOREACH (QNetworkReply *attempt, m_attempts) {
+        disconnect(attempt, 0, this, 0);
+        attempt->abort();
+        attempt->deleteLater();
+    }
+    m_attempts.clear();
+}
+
+void KDSoapRetryingReply::slotAttemptFinished()
+{
+    QNetworkReply *attempt = qobject_cast<QNetworkReply *>(sender());
+    if (!attempt || !m_attempts.contains(attempt) || isFinished()) {
+        return;
+    }
+    m_attempts.removeAll(attempt);
+    if (KDSoapLoadBalancer::isTransportFailure(attempt)) {
+        if (!m_attempts.isEmpty()) {
+            // The other request might still succeed
+            attempt->deleteLater();
+            return;
+        }
+        if (m_retries < m_policy.maxRetries && m_client && m_manager) {
+            const int backoff = int(qMin<qint64>(m_policy.maxBackoff, qint64(m_policy.initialBackoff) << qMin(m_retries, 20)));
+            // Between half and all of the backoff, so that the clients failing together don't retry together
+            const int delay = backoff / 2 + randomNumber() % (backoff / 2 + 1);
+            ++m_retries;
+            m_hedgeTimer.stop();
+            m_retryTimer.start(delay);
+            attempt->deleteLater();
+            return;
+        }
+    }
+    finishWith(attempt);
+}
+
+void KDSoapRetryingReply::slotRetry()
+{
+    if (isFinished()) {
+        return;
+    }
+    if (!m_client || !m_manager) {
+        setError(QNetworkReply::OperationCanceledError, QString::fromLatin1("Operation canceled"));
+        setFinished(true);
+        emit finished();
+        return;
+    }
+    startAttempt();
+}
+
+void KDSoapRetryingReply::slotHedge()
+{
+    if (isFinished() || m_hedged || m_attempts.count() != 1 || !m_client || !m_manager) {
+        return;
+    }
+    m_hedged = true;
+    startAttempt();
+}
+
+void KDSoapRetryingReply::finishWith(QNetworkReply *attempt)
+{
+    m_retryTimer.stop();
+    m_hedgeTimer.stop();
+    abortAttempts(); // the slower request, if any
+    if (attempt->error() == QNetworkReply::NoError) {
+        m_policies->addResponseTime(m_method, int(m_clock.elapsed() - attempt->property("kdsoap_attempt_start").toLongLong()));
+    }
+    Q_FOREACH (const QNetworkReply::RawHeaderPair &header, attempt->rawHeaderPairs()) {
+        setRawHeader(header.first, header.second);
+    }
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, attempt->attribute(QNetworkRequest::HttpStatusCodeAttribute));
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, attempt->attribute(QNetworkRequest::HttpReasonPhraseAttribute));
+    if (attempt->error() != QNetworkReply::NoError) {
+        setError(attempt->error(), attempt->errorString());
+    }
+    m_data = attempt->isOpen() ? attempt->readAll() : QByteArray();
+    attempt->deleteLater();
+    setFinished(true);
+    emit readyRead();
+    emit finished();
+}
+
+void KDSoapRetryingReply::abort()
+{
+    if (isFinished()) {
+        return;
+    }
+    m_retryTimer.stop();
+    m_hedgeTimer.stop();
+    abortAttempts();
+    setError(QNetworkReply::OperationCanceledError, QString::fromLatin1("Operation canceled"));
+    setFinished(true);
+    emit finished();
+}
+
+qint64 KDSoapRetryingReply::bytesAvailable() const
+{
+    return QNetworkReply::bytesAvailable() + m_data.size() - m_dataPos;
+}
+
+bool KDSoapRetryingReply::isSequential() const
+{
+    return true;
+}
+
+qint64 KDSoapRetryingReply::readData(char *data, qint64 maxSize)
+{
+    const int count = int(qMin<qint64>(maxSize, m_data.size() - m_dataPos));
+    if (count == 0 && isFinished()) {
+        return -1;
+    }
+    memcpy(data, m_data.constData() + m_dataPos, count);
+    m_dataPos += count;
+    return count;
+}
+
+#include "moc_KDSoapRetry_p.cpp"
@@ -0,0 +1,114 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPRETRY_P_H
+#define KDSOAPRETRY_P_H
+
+#include "KDSoapClientInterface.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QPointer>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+#include <QtNetwork/QNetworkReply>
+
+class KDSoapClientInterfacePrivate;
+
+/**
+ * \internal
+ * The retry policies of the operations, and the latest response times of their calls,
+ * from which the hedging delay is computed.
+ *
+ * Thread-safe: used by asynchronous calls and by the thread of blocking calls.
+ */
+class KDSoapRetryPolicies
+{
+public:
+    void setPolicy(const QString &method, const KDSoapClientInterface::RetryPolicy &policy);
+    KDSoapClientInterface::RetryPolicy policy(const QString &method) const;
+
+    void addResponseTime(const QString &method, int msecs);
+    // The given percentile of the latest response times of \p method, -1 if there aren't enough of them yet
+    int responseTimePercentile(const QString &method, int percentile) const;
+
+private:
+    struct ResponseTimes {
+        ResponseTimes() : next(0) {}
+        QVector<int> samples; // a ring buffer
+        int next;
+    };
+
+    mutable QMutex m_mutex;
+    QHash<QString, KDSoapClientInterface::RetryPolicy> m_policies;
+    QHash<QString, ResponseTimes> m_responseTimes;
+};
+
+/**
+ * \internal
+ * The reply to a call of an idempotent operation: sends the request again after a transport error,
+ * and, with hedging, sends a second request if the first one is slower than usual.
+ * The first response wins, the other request is aborted.
+ */
+class KDSoapRetryingReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    KDSoapRetryingReply(KDSoapClientInterfacePrivate *client, QNetworkAccessManager *manager, const QNetworkRequest &request,
+                        const QByteArray &requestData, const QString &method, const QSharedPointer<KDSoapRetryPolicies> &policies);
+    ~KDSoapRetryingReply();
+
+    /*! \reimp */ void abort();
+    /*! \reimp */ qint64 bytesAvailable() const;
+    /*! \reimp */ bool isSequential() const;
+
+protected:
+    /*! \reimp */ qint64 readData(char *data, qint64 maxSize);
+
+private Q_SLOTS:
+    void slotAttemptFinished();
+    void slotRetry();
+    void slotHedge();
+
+private:
+    void startAttempt();
+    void abortAttempts();
+    void finishWith(QNetworkReply *attempt);
+
+    QPointer<KDSoapClientInterfacePrivate> m_client;
+    QPointer<QNetworkAccessManager> m_manager;
+    QByteArray m_requestData;
+    QString m_method;
+    QSharedPointer<KDSoapRetryPolicies> m_policies;
+    KDSoapClientInterface::RetryPolicy m_policy;
+    QList<QNetworkReply *> m_attempts; // in progress
+    int m_retries;
+    bool m_hedged;
+    QTimer m_retryTimer;
+    QTimer m_hedgeTimer;
+    QElapsedTimer m_clock; // for the response times
+    QByteArray m_data;
+    int m_dataPos;
+};
+
+#endif // KDSOAPRETRY_P_H
@@ -0,0 +1,239 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapTimeoutWheel_p.h"
+#include <QtCore/QPointer>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QTimerEvent>
+#include <QtNetwork/QNetworkReply>
+
+static const int s_tickLength = 10; // msecs
+// The first level has one slot per tick, the slots of the next levels span a whole lower level
+static const int s_rootBits = 8;
+static const int s_rootSize = 1 << s_rootBits;
+static const int s_levelBits = 6;
+static const int s_levelSize = 1 << s_levelBits;
+static const int s_levels = 3;
+
+// The span of \p level: the ticks it can hold, from the current tick
+static qint64 levelSpan(int level)
+{
+    return qint64(1) << (s_rootBits + level * s_levelBits);
+}
+
+// The slot of \p level (1 to s_levels) for \p tick
+static int levelSlot(int level, qint64 tick)
+{
+    return s_rootSize + (level - 1) * s_levelSize + int((tick >> (s_rootBits + (level - 1) * s_levelBits)) & (s_levelSize - 1));
+}
+
+Q_GLOBAL_STATIC(QThreadStorage<KDSoapTimeoutWheel *>, s_wheels)
+
+KDSoapTimeoutWheel *KDSoapTimeoutWheel::instance()
+{
+    QThreadStorage<KDSoapTimeoutWheel *> *wheels = s_wheels();
+    if (!wheels->hasLocalData()) {
+        wheels->setLocalData(new KDSoapTimeoutWheel);
+    }
+    return wheels->localData();
+}
+
+KDSoapTimeoutWheel::KDSoapTimeoutWheel()
+    : m_currentTick(0),
+      m_wakeUpTick(0)
+{
+    m_clock.start();
+    memset(m_slots, 0, sizeof(m_slots));
+}
+
+KDSoapTimeoutWheel::~KDSoapTimeoutWheel()
+{
+    qDeleteAll(m_entries);
+}
+
+qint64 KDSoapTimeoutWheel::currentTime() const
+{
+    return m_clock.elapsed();
+}
+
+int KDSoapTimeoutWheel::count() const
+{
+    return m_entries.count();
+}
+
+void KDSoapTimeoutWheel::add(QNetworkReply *reply, int msecs)
+{
+    remove(reply);
+    const qint64 now = currentTime();
+    if (m_entries.isEmpty()) {
+        m_currentTick = now / s_tickLength; // nothing to catch up with
+    }
+    Entry *entry = new Entry;
+    entry->reply = reply;
+    entry->expiry = (now + msecs + s_tickLength - 1) / s_tickLength; // never early
+    place(entry);
+    m_entries.insert(reply, entry);
+    connect(reply, SIGNAL(finished()), this, SLOT(slotReplyFinished()));
+    connect(reply, SIGNAL(destroyed(QObject*)), this, SLOT(slotReplyDestroyed(QObject*)));
+
+    if (!m_timer.isActive() || entry->expiry < m_wakeUpTick) {
+        m_wakeUpTick = entry->expiry;
+        m_timer.start(int(qMax<qint64>(0, m_wakeUpTick * s_tickLength - now)), this);
+    }
+}
+
+void KDSoapTimeoutWheel::place(Entry *entry)
+{
+    if (entry->expiry < m_currentTick) {
+        entry->expiry = m_currentTick;
+    }
+    const qint64 delta = entry->expiry - m_currentTick;
+    int slot;
+    if (delta < s_rootSize) {
+        slot = int(entry->expiry & (s_rootSize - 1));
+    } else {
+        int level = 1;
+        while (level < s_levels && delta >= levelSpan(level)) {
+            ++level;
+        }
+        // Beyond the last level: placed as far as possible, and placed again from there
+        const qint64 tick = delta < levelSpan(level) ? entry->expiry : m_currentTick + levelSpan(level) - 1;
+        slot = levelSlot(level, tick);
+    }
+    Entry **head = &m_slots[slot];
+    entry->next = *head;
+    if (entry->next) {
+        entry->next->pprev = &entry->next;
+    }
+    entry->pprev = head;
+    *head = entry;
+}
+
+void KDSoapTimeoutWheel::remove(QObject *reply)
+{
+    Entry *entry = m_entries.take(reply);
+    if (!entry) {
+        return;
+    }
+    *entry->pprev = entry->next;
+    if (entry->next) {
+        entry->next->pprev = entry->pprev;
+    }
+    delete entry;
+    // The timer is stopped at the next wake up, if nothing is left
+}
+
+void KDSoapTimeoutWheel::cascade(int slot)
+{
+    Entry *entry = m_slots[slot];
+    m_slots[slot] = 0;
+    while (entry) {
+        Entry *next = entry->next;
+        place(entry);
+        entry = next;
+    }
+}
+
+void KDSoapTimeoutWheel::advance(qint64 tick, QList<Entry *> *expired)
+{
+    while (m_currentTick <= tick && !m_entries.isEmpty()) {
+        const int index = int(m_currentTick & (s_rootSize - 1));
+        if (index == 0) {
+            // The next slot of each level moves down, as long as the level wraps around
+            for (int level = 1; level <= s_levels; ++level) {
+                const int slot = levelSlot(level, m_currentTick);
+                cascade(slot);
+                if (slot != levelSlot(level, 0)) {
+                    break;
+                }
+            }
+        }
+        Entry *entry = m_slots[index];
+        m_slots[index] = 0;
+        while (entry) {
+            Entry *next = entry->next;
+            m_entries.remove(entry->reply);
+            expired->append(entry);
+            entry = next;
+        }
+        ++m_currentTick;
+    }
+    if (m_entries.isEmpty()) {
+        m_currentTick = tick + 1;
+    }
+}
+
+void KDSoapTimeoutWheel::scheduleWakeUp()
+{
+    if (m_entries.isEmpty()) {
+        m_timer.stop();
+        return;
+    }
+    // The next slot of the first level with entries, or the next cascade
+    qint64 tick = m_currentTick;
+    while ((tick & (s_rootSize - 1)) && !m_slots[tick & (s_rootSize - 1)]) {
+        ++tick;
+    }
+    m_wakeUpTick = tick;
+    m_timer.start(int(qMax<qint64>(0, tick * s_tickLength - currentTime())), this);
+}
+
+void KDSoapTimeoutWheel::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != m_timer.timerId()) {
+        QObject::timerEvent(event);
+        return;
+    }
+    m_timer.stop();
+    QList<Entry *> expired;
+    advance(currentTime() / s_tickLength, &expired);
+
+    // Abort them all at once; the slots connected to finished() might delete other replies
+    QList<QPointer<QNetworkReply> > replies;
+    replies.reserve(expired.count());
+    Q_FOREACH (Entry *entry, expired) {
+        entry->reply->disconnect(this);
+        replies.append(entry->reply);
+        delete entry;
+    }
+    Q_FOREACH (const QPointer<QNetworkReply> &reply, replies) {
+        if (reply) {
+            reply->setProperty("kdsoap_reply_timed_out", true); // see KDSoapPendingCall.cpp
+            reply->abort();
+        }
+    }
+    scheduleWakeUp();
+}
+
+void KDSoapTimeoutWheel::slotReplyFinished()
+{
+    QObject *reply = sender();
+    reply->disconnect(this);
+    remove(reply);
+}
+
+void KDSoapTimeoutWheel::slotReplyDestroyed(QObject *reply)
+{
+    remove(reply);
+}
+
+#include "moc_KDSoapTimeoutWheel_p.cpp"
@@ -0,0 +1,89 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPTIMEOUTWHEEL_P_H
+#define KDSOAPTIMEOUTWHEEL_P_H
+
+#include <QtCore/QBasicTimer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+
+QT_BEGIN_NAMESPACE
+class QNetworkReply;
+QT_END_NAMESPACE
+
+/**
+ * \internal
+ * The timeouts of the pending calls of a thread, in a hierarchical timing wheel: adding and
+ * removing a timeout is O(1), and a single timer wakes up for the next expiring slot.
+ * Replies which time out are aborted, flagged with the "kdsoap_reply_timed_out" property.
+ *
+ * The timeout of a reply is removed when it finishes or is deleted.
+ */
+class KDSoapTimeoutWheel : public QObject
+{
+    Q_OBJECT
+public:
+    // The wheel of the current thread, created on demand and deleted when the thread exits
+    static KDSoapTimeoutWheel *instance();
+
+    ~KDSoapTimeoutWheel();
+
+    // Aborts \p reply after \p msecs, unless it's finished by then
+    void add(QNetworkReply *reply, int msecs);
+    // The number of replies which might time out
+    int count() const;
+
+protected:
+    /*! \reimp */ void timerEvent(QTimerEvent *event);
+
+private Q_SLOTS:
+    void slotReplyFinished();
+    void slotReplyDestroyed(QObject *reply);
+
+private:
+    KDSoapTimeoutWheel();
+
+    struct Entry {
+        Entry *next;
+        Entry **pprev; // the pointer to this entry, in the previous entry or in the slot
+        qint64 expiry; // in ticks
+        QNetworkReply *reply;
+    };
+
+    qint64 currentTime() const;
+    void remove(QObject *reply);
+    void place(Entry *entry);
+    void cascade(int slot);
+    void advance(qint64 tick, QList<Entry *> *expired);
+    void scheduleWakeUp();
+
+    QElapsedTimer m_clock;
+    qint64 m_currentTick; // the next tick to process
+    qint64 m_wakeUpTick;
+    QBasicTimer m_timer;
+    Entry *m_slots[256 + 3 * 64]; // 256 slots of one tick, then 3 levels of 64 slots
+    QHash<QObject *, Entry *> m_entries;
+};
+
+#endif // KDSOAPTIMEOUTWHEEL_P_H
@@ -23,18 +23,24 @@
 #include "KDSoapValue.h"
 #include "KDSoapNamespacePrefixes_p.h"
 #include "KDSoapNamespaceManager.h"
+#include "KDSoapBinaryCodec.h"
+#include "KDSoapNumericCodec.h"
+#include "KDSoapMtom_p.h"
+#include "KDSoapRequestDevice_p.h"
 #include "KDDateTime.h"
 #include <QDateTime>
 #include <QUrl>
 #include <QDebug>
+#include <QIODevice>
 #include <QStringList>
+#include <QTextCodec>
 
 class KDSoapValue::Private : public QSharedData
 {
 public:
-    Private(): m_qualified(false), m_nillable(false) {}
+    Private(): m_qualified(false), m_nillable(false), m_encodedBinary(false), m_device(0) {}
     Private(const QString &n, const QVariant &v, const QString &typeNameSpace, const QString &typeName)
-        : m_name(n), m_value(v), m_typeNamespace(typeNameSpace), m_typeName(typeName), m_qualified(false), m_nillable(false) {}
+        : m_name(n), m_value(v), m_typeNamespace(typeNameSpace), m_typeName(typeName), m_qualified(false), m_nillable(false), m_encodedBinary(false), m_device(0) {}
 
     QString m_name;
     QString m_nameNamespace;
@@ -44,6 +50,9 @@ public:
     KDSoapValueList m_childValues;
     bool m_qualified;
     bool m_nillable;
+    bool m_encodedBinary; // m_value is a QByteArray holding base64 or hex text
+    QString m_contentType;
+    QIODevice *m_device; // not owned, see setBinaryDevice
     QXmlStreamNamespaceDeclarations m_environmentNamespaceDeclarations;
     QXmlStreamNamespaceDeclarations m_localNamespaceDeclarations;
 };
@@ -85,7 +94,7 @@ bool KDSoapValue::isNull() const
 
 bool KDSoapValue::isNil() const
 {
-    return d->m_value.isNull() && d->m_childValues.isEmpty() && d->m_childValues.attributes().isEmpty();
+    return d->m_value.isNull() && !d->m_device && d->m_childValues.isEmpty() && d->m_childValues.attributes().isEmpty();
 }
 
 void KDSoapValue::setNillable(bool nillable)
@@ -111,6 +120,49 @@ QVariant KDSoapValue::value() const
 void KDSoapValue::setValue(const QVariant &value)
 {
     d->m_value = value;
+    d->m_encodedBinary = false;
+    d->m_device = 0;
+}
+
+void KDSoapValue::setEncodedBinaryValue(const QByteArray &encodedData)
+{
+    d->m_value = encodedData;
+    d->m_encodedBinary = true;
+    d->m_device = 0;
+}
+
+void KDSoapValue::setBinaryDevice(QIODevice *device)
+{
+    d->m_value = QVariant();
+    d->m_encodedBinary = false;
+    d->m_device = device;
+}
+
+QIODevice *KDSoapValue::binaryDevice() const
+{
+    return d->m_device;
+}
+
+bool KDSoapValue::isEncodedBinaryValue() const
+{
+    return d->m_encodedBinary;
+}
+
+KDSoapValue KDSoapValue::fromEncodedBinary(const QString &name, const QByteArray &encodedData, const QString &typeNameSpace, const QString &typeName)
+{
+    KDSoapValue value(name, QVariant(), typeNameSpace, typeName);
+    value.setEncodedBinaryValue(encodedData);
+    return value;
+}
+
+void KDSoapValue::setContentType(const QString &contentType)
+{
+    d->m_contentType = contentType;
+}
+
+QString KDSoapValue::contentType() const
+{
+    return d->m_contentType;
 }
 
 bool KDSoapValue::isQualified() const
@@ -164,7 +216,7 @@ bool KDSoapValue::operator !=(const KDSoapValue &other) const
     return d != other.d;
 }
 
-static QString variantToTextValue(const QVariant &value, const QString &typeNs, const QString &type)
+QString KDSoapValue::variantToTextValue(const QVariant &value, const QString &typeNs, const QString &type)
 {
     switch (value.userType()) {
     case QVariant::Char:
@@ -175,16 +227,8 @@ static QString variantToTextValue(const QVariant &value, const QString &typeNs,
         // xmlpatterns/data/qatomicvalue.cpp says to do this:
         return value.toUrl().toString();
     case QVariant::ByteArray: {
-        const QByteArray data = value.toByteArray();
-        if (typeNs == KDSoapNamespaceManager::xmlSchema1999() || typeNs == KDSoapNamespaceManager::xmlSchema2001()) {
-            if (type == QLatin1String("hexBinary")) {
-                const QByteArray hb = data.toHex();
-                return QString::fromLatin1(hb.constData(), hb.size());
-            }
-        }
-        // default to base64Binary, like variantToXMLType() does.
-        const QByteArray b64 = value.toByteArray().toBase64();
-        return QString::fromLatin1(b64.constData(), b64.size());
+        const QByteArray text = encodeBinary(value.toByteArray(), typeNs, type);
+        return QString::fromLatin1(text.constData(), text.size());
     }
     case QVariant::Int:
     // fall-through
@@ -198,17 +242,10 @@ static QString variantToTextValue(const QVariant &value, const QString &typeNs,
     case QMetaType::Float:
     case QVariant::Double:
         return value.toString();
-    case QVariant::Time: {
-        const QTime time = value.toTime();
-        if (time.msec()) {
-            // include milli-seconds
-            return time.toString(QLatin1String("hh:mm:ss.zzz"));
-        } else {
-            return time.toString(Qt::ISODate);
-        }
-    }
+    case QVariant::Time:
+        return KDDateTime::timeToString(value.toTime());
     case QVariant::Date:
-        return value.toDate().toString(Qt::ISODate);
+        return KDDateTime::dateToString(value.toDate());
     case QVariant::DateTime: // http://www.w3.org/TR/xmlschema-2/#dateTime
         return KDDateTime(value.toDateTime()).toDateString();
     case QVariant::Invalid:
@@ -229,6 +266,144 @@ static QString variantToTextValue(const QVariant &value, const QString &typeNs,
     }
 }
 
+static bool isHexBinaryType(const QString &typeNs, const QString &type)
+{
+    return (typeNs == KDSoapNamespaceManager::xmlSchema1999() || typeNs == KDSoapNamespaceManager::xmlSchema2001())
+           && type == QLatin1String("hexBinary");
+}
+
+QByteArray KDSoapValue::encodeBinary(const QByteArray &data, const QString &typeNs, const QString &type)
+{
+    if (isHexBinaryType(typeNs, type)) {
+        return KDSoapBinaryCodec::toHex(data);
+    }
+    // default to base64Binary, like variantToXMLType() does.
+    return KDSoapBinaryCodec::toBase64(data);
+}
+
+QString KDSoapValue::textValue() const
+{
+    if (d->m_encodedBinary) {
+        const QByteArray text = d->m_value.toByteArray();
+        return QString::fromLatin1(text.constData(), text.size());
+    }
+    return variantToTextValue(d->m_value, d->m_typeNamespace, d->m_typeName);
+}
+
+void KDSoapValue::writeEncodedText(QXmlStreamWriter &writer, const QByteArray &text)
+{
+    writeEncodedText(writer, text.constData(), text.size());
+}
+
+void KDSoapValue::writeEncodedText(QXmlStreamWriter &writer, const char *text, int length)
+{
+    // base64, hex and numeric text is plain ASCII, with nothing to escape: once the start element
+    // is finished, it can go straight to the output device, without a QString copy.
+    QIODevice *device = writer.device();
+    QTextCodec *codec = writer.codec();
+    if (device && codec && codec->mibEnum() == 106 /*UTF-8*/) {
+        writer.writeCharacters(QString()); // finishes the start element
+        device->write(text, length);
+    } else {
+        writer.writeCharacters(QString::fromLatin1(text, length));
+    }
+}
+
+// SSE2 is part of x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define KDSOAP_HAVE_SSE2
+#  include <emmintrin.h>
+#endif
+
+// Characters which QXmlStreamWriter::writeCharacters writes unchanged, and which are single bytes in UTF-8:
+// printable ASCII minus the characters it escapes (the apostrophe is kept out too, to be safe), tab and newline.
+static inline bool isPlainTextChar(ushort ch)
+{
+    return (ch >= 0x20 && ch < 0x7f && ch != '<' && ch != '>' && ch != '&' && ch != '"' && ch != '\'') || ch == '\t' || ch == '\n';
+}
+
+static bool isPlainText(const ushort *text, int length)
+{
+    int i = 0;
+#ifdef KDSOAP_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= length; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+        // Non-zero lanes are outside of [0x20, 0x7e]
+        const __m128i outOfRange = _mm_or_si128(_mm_subs_epu16(v, _mm_set1_epi16(0x7e)), _mm_subs_epu16(_mm_set1_epi16(0x20), v));
+        __m128i bad = _mm_andnot_si128(_mm_cmpeq_epi16(outOfRange, zero), _mm_set1_epi16(-1));
+        bad = _mm_or_si128(bad, _mm_cmpeq_epi16(v, _mm_set1_epi16('<')));
+        bad = _mm_or_si128(bad, _mm_cmpeq_epi16(v, _mm_set1_epi16('>')));
+        bad = _mm_or_si128(bad, _mm_cmpeq_epi16(v, _mm_set1_epi16('&')));
+        bad = _mm_or_si128(bad, _mm_cmpeq_epi16(v, _mm_set1_epi16('"')));
+        bad = _mm_or_si128(bad, _mm_cmpeq_epi16(v, _mm_set1_epi16('\'')));
+        const __m128i whitespace = _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('\t')), _mm_cmpeq_epi16(v, _mm_set1_epi16('\n')));
+        if (_mm_movemask_epi8(_mm_andnot_si128(whitespace, bad)) != 0) {
+            return false;
+        }
+    }
+#endif
+    for (; i < length; ++i) {
+        if (!isPlainTextChar(text[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void KDSoapValue::writeText(QXmlStreamWriter &writer, const QString &text)
+{
+    // Most text needs no escaping at all: then the UTF-8 output is the same as the Latin-1 one,
+    // and it's written straight to the output device, without QTextCodec and its temporary QByteArray.
+    QIODevice *device = writer.device();
+    QTextCodec *codec = writer.codec();
+    const ushort *chars = text.utf16();
+    if (!device || !codec || codec->mibEnum() != 106 /*UTF-8*/ || !isPlainText(chars, text.size())) {
+        writer.writeCharacters(text);
+        return;
+    }
+    writer.writeCharacters(QString()); // finishes the start element
+    char buffer[1024];
+    for (int pos = 0; pos < text.size(); pos += int(sizeof(buffer))) {
+        const int length = qMin(int(sizeof(buffer)), text.size() - pos);
+        for (int i = 0; i < length; ++i) {
+            buffer[i] = char(chars[pos + i]);
+        }
+        device->write(buffer, length);
+    }
+}
+
+bool KDSoapValue::writeNumericText(QXmlStreamWriter &writer, const QVariant &value)
+{
+    // Same text as variantToTextValue, without the QString.
+    // Floating-point values are left to it, to keep QString::number's shortest representation.
+    char buffer[KDSoapNumericCodec::MaxIntegerLength];
+    int length;
+    switch (value.userType()) {
+    case QVariant::Int:
+    // fall-through
+    case QVariant::LongLong:
+    // fall-through
+    case QVariant::UInt:
+        length = KDSoapNumericCodec::format(qint64(value.toLongLong()), buffer);
+        break;
+    case QVariant::ULongLong:
+        length = KDSoapNumericCodec::format(quint64(value.toULongLong()), buffer);
+        break;
+    case QVariant::Bool:
+        if (value.toBool()) {
+            writeEncodedText(writer, "true", 4);
+        } else {
+            writeEncodedText(writer, "false", 5);
+        }
+        return true;
+    default:
+        return false;
+    }
+    writeEncodedText(writer, buffer, length);
+    return true;
+}
+
 // See also xmlTypeToVariant in serverlib
 static QString variantToXMLType(const QVariant &value)
 {
@@ -307,7 +482,7 @@ void KDSoapValue::writeElementContents(KDSoapNamespacePrefixes &namespacePrefixe
     }
 
     if (isNil() && d->m_nillable) {
-        writer.writeAttribute(KDSoapNamespaceManager::xmlSchemaInstance2001(), QLatin1String("nil"), QLatin1String("true"));
+        writer.writeAttribute(namespacePrefixes.schemaInstanceNamespace(), QLatin1String("nil"), QLatin1String("true"));
     }
 
     if (use == EncodedUse) {
@@ -318,9 +493,11 @@ void KDSoapValue::writeElementContents(KDSoapNamespacePrefixes &namespacePrefixe
         }
         if (type.isEmpty() && !value.isNull()) {
             type = variantToXMLType(value);    // fallback
+        } else if (type.isEmpty() && d->m_device) {
+            type = namespacePrefixes.resolve(KDSoapNamespaceManager::xmlSchema2001(), QLatin1String("base64Binary"));
         }
         if (!type.isEmpty()) {
-            writer.writeAttribute(KDSoapNamespaceManager::xmlSchemaInstance2001(), QLatin1String("type"), type);
+            writer.writeAttribute(namespacePrefixes.schemaInstanceNamespace(), namespacePrefixes.typeAttributeName(), type);
         }
 
         // cppcheck-suppress redundantCopyLocalConst
@@ -332,8 +509,29 @@ void KDSoapValue::writeElementContents(KDSoapNamespacePrefixes &namespacePrefixe
     }
     writeChildren(namespacePrefixes, writer, use, messageNamespace, false);
 
-    if (!value.isNull()) {
-        writer.writeCharacters(variantToTextValue(value, this->typeNs(), this->type()));
+    if (d->m_device) {
+        if (isHexBinaryType(this->typeNs(), this->type())) {
+            writeEncodedText(writer, encodeBinary(KDSoapRequestDevice::readDevice(d->m_device), this->typeNs(), this->type()));
+        } else {
+            KDSoapRequestDevice::writeBase64Device(writer, d->m_device, d->m_contentType);
+        }
+        return;
+    }
+    if (value.isNull()) {
+        return;
+    }
+    if (d->m_encodedBinary) {
+        writeEncodedText(writer, value.toByteArray());
+    } else if (value.userType() == QVariant::ByteArray) {
+        KDSoapMtomPackage *mtomPackage = KDSoapMtomPackage::current();
+        if (mtomPackage && !isHexBinaryType(this->typeNs(), this->type())) {
+            // MTOM: the raw bytes go into a MIME part of their own
+            mtomPackage->writeInclude(writer, value.toByteArray(), d->m_contentType);
+        } else {
+            writeEncodedText(writer, encodeBinary(value.toByteArray(), this->typeNs(), this->type()));
+        }
+    } else if (!writeNumericText(writer, value)) {
+        writeText(writer, variantToTextValue(value, this->typeNs(), this->type()));
     }
 }
 
@@ -345,9 +543,9 @@ void KDSoapValue::writeChildren(KDSoapNamespacePrefixes &namespacePrefixes, QXml
 
         const QString attributeNamespace = attr.namespaceUri();
         if (attr.isQualified() || forceQualified) {
-            writer.writeAttribute(attributeNamespace, attr.name(), variantToTextValue(attr.value(), attr.typeNs(), attr.type()));
+            writer.writeAttribute(attributeNamespace, attr.name(), attr.textValue());
         } else {
-            writer.writeAttribute(attr.name(), variantToTextValue(attr.value(), attr.typeNs(), attr.type()));
+            writer.writeAttribute(attr.name(), attr.textValue());
         }
     }
     KDSoapValueListIterator it(args);
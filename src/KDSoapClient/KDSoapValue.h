@@ -45,6 +45,7 @@ Q_DECLARE_METATYPE(signed char)
 class KDSoapValueList;
 class KDSoapNamespacePrefixes;
 QT_BEGIN_NAMESPACE
+class QIODevice;
 class QXmlStreamWriter;
 QT_END_NAMESPACE
 
@@ -178,6 +179,63 @@ public:
      */
     void setValue(const QVariant &value);
 
+    /**
+     * Sets the value of the argument to binary data which is already encoded
+     * as text, e.g. using base64 or hex encoding (the type of the value says which).
+     * value() then returns \p encodedData as a QByteArray, and the data is written
+     * out as is, rather than being converted to a QString first, which would
+     * take twice as much memory for large payloads.
+     * \since 1.8
+     */
+    void setEncodedBinaryValue(const QByteArray &encodedData);
+
+    /**
+     * Returns true if the value was set with setEncodedBinaryValue(),
+     * or parsed from a base64Binary or hexBinary element with an xsi:type attribute.
+     * \since 1.8
+     */
+    bool isEncodedBinaryValue() const;
+
+    /**
+     * Convenience method for creating a value holding encoded binary data.
+     * \sa setEncodedBinaryValue()
+     * \since 1.8
+     */
+    static KDSoapValue fromEncodedBinary(const QString &name, const QByteArray &encodedData, const QString &typeNameSpace, const QString &typeName);
+
+    /**
+     * Sets the value of the argument to the contents of \p device, from its current position to its end.
+     * This is meant for sending large base64Binary (or MTOM) payloads, such as files: the data is read
+     * and encoded in chunks while the request is being sent, rather than being loaded into memory.
+     *
+     * The device must be open for reading, and must stay alive and unused until the call has finished.
+     * Only random-access devices (e.g. QFile) are streamed; the contents of sequential devices
+     * are read into memory when the request is created.
+     * value() returns a null QVariant for such values.
+     * \since 1.8
+     */
+    void setBinaryDevice(QIODevice *device);
+
+    /**
+     * Returns the device set with setBinaryDevice(), or 0.
+     * \since 1.8
+     */
+    QIODevice *binaryDevice() const;
+
+    /**
+     * Sets the MIME type of the binary data held by this value, e.g. "image/png".
+     * This is only used when the value is sent as an MTOM attachment, see KDSoapClientInterface::setMtomEnabled().
+     * \since 1.8
+     */
+    void setContentType(const QString &contentType);
+
+    /**
+     * Returns the MIME type of the binary data held by this value.
+     * For a value received as an MTOM attachment, this is the type of the MIME part.
+     * \since 1.8
+     */
+    QString contentType() const;
+
     /**
      * Whether the element should be qualified in the XML. See setQualified()
      *
@@ -298,6 +356,15 @@ private:
     KDSoapValue(QString, QString, QString);
 
     friend class KDSoapMessageWriter;
+    friend class KDSoapBodyWriter;
+    friend class KDSoapBinaryWriter;
+    static QString variantToTextValue(const QVariant &value, const QString &typeNs, const QString &type);
+    static QByteArray encodeBinary(const QByteArray &data, const QString &typeNs, const QString &type);
+    static void writeEncodedText(QXmlStreamWriter &writer, const QByteArray &text);
+    static void writeEncodedText(QXmlStreamWriter &writer, const char *text, int length);
+    static bool writeNumericText(QXmlStreamWriter &writer, const QVariant &value);
+    static void writeText(QXmlStreamWriter &writer, const QString &text);
+    QString textValue() const;
     void writeElement(KDSoapNamespacePrefixes &namespacePrefixes, QXmlStreamWriter &writer, KDSoapValue::Use use, const QString &messageNamespace, bool forceQualified) const;
     void writeElementContents(KDSoapNamespacePrefixes &namespacePrefixes, QXmlStreamWriter &writer, KDSoapValue::Use use, const QString &messageNamespace) const;
     void writeChildren(KDSoapNamespacePrefixes &namespacePrefixes, QXmlStreamWriter &writer, KDSoapValue::Use use, const QString &messageNamespace, bool forceQualified) const;
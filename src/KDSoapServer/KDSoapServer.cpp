@@ -23,8 +23,11 @@
 #include "KDSoapServer.h"
 #include "KDSoapThreadPool.h"
 #include "KDSoapSocketList_p.h"
+#include "KDSoapServerInProcess_p.h"
 #include <QMutex>
 #include <QFile>
+#include <QLocalServer>
+#include <QLocalSocket>
 #ifdef Q_OS_UNIX
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -32,6 +35,30 @@
 #include <limits.h>
 #endif
 
+// Listens on a Unix domain socket, and hands the connections to the KDSoapServer like TCP ones.
+// On Unix, QLocalServer gives the socket descriptor, which QTcpSocket (hence KDSoapServerSocket) can use.
+class KDSoapLocalServer : public QLocalServer
+{
+public:
+    explicit KDSoapLocalServer(KDSoapServer *server)
+        : QLocalServer(server), m_server(server)
+    {
+    }
+
+protected:
+    /*! \reimp */ void incomingConnection(quintptr socketDescriptor)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+        m_server->incomingConnection(qintptr(socketDescriptor));
+#else
+        m_server->incomingConnection(int(socketDescriptor));
+#endif
+    }
+
+private:
+    KDSoapServer *m_server;
+};
+
 class KDSoapServer::Private
 {
 public:
@@ -42,12 +69,16 @@ public:
           m_logLevel(KDSoapServer::LogNothing),
           m_path(QString::fromLatin1("/")),
           m_maxConnections(-1),
-          m_portBeforeSuspend(0)
+          m_maxInMemoryRequestSize(-1),
+          m_portBeforeSuspend(0),
+          m_localServer(0),
+          m_inProcessHandler(0)
     {
     }
 
     ~Private()
     {
+        delete m_inProcessHandler;
         delete m_mainThreadSocketList;
     }
 
@@ -66,10 +97,17 @@ public:
     QString m_wsdlPathInUrl;
     QString m_path;
     int m_maxConnections;
+    qint64 m_maxInMemoryRequestSize;
 
     QHostAddress m_addressBeforeSuspend;
     quint16 m_portBeforeSuspend;
 
+    KDSoapLocalServer *m_localServer; // child of the KDSoapServer
+    QString m_localPathBeforeSuspend;
+
+    QString m_inProcessName;
+    KDSoapServerInProcessHandler *m_inProcessHandler;
+
 #ifndef QT_NO_OPENSSL
     QSslConfiguration m_sslConfiguration;
 #endif
@@ -167,6 +205,69 @@ QString KDSoapServer::endPoint() const
            .arg(d->m_path);
 }
 
+#ifdef Q_OS_UNIX
+// A socket file nobody answers on was left behind by a process which didn't close it
+static bool isStaleLocalSocket(const QString &path)
+{
+    QLocalSocket socket;
+    socket.connectToServer(path);
+    return !socket.waitForConnected(1000);
+}
+#endif
+
+bool KDSoapServer::listenOnLocalSocket(const QString &path)
+{
+#ifdef Q_OS_UNIX
+    closeLocalSocket();
+    KDSoapLocalServer *localServer = new KDSoapLocalServer(this);
+    localServer->setMaxPendingConnections(maxPendingConnections());
+    if (!localServer->listen(path)) {
+        if (localServer->serverError() != QAbstractSocket::AddressInUseError || !isStaleLocalSocket(path)
+                || !QLocalServer::removeServer(path) || !localServer->listen(path)) {
+            qWarning("KDSoapServer: failed to listen on %s: %s", qPrintable(path), qPrintable(localServer->errorString()));
+            delete localServer;
+            return false;
+        }
+    }
+    QMutexLocker lock(&d->m_serverDataMutex);
+    d->m_localServer = localServer;
+    return true;
+#else
+    qWarning("KDSoapServer: Unix domain sockets are not supported on this platform");
+    Q_UNUSED(path);
+    return false;
+#endif
+}
+
+void KDSoapServer::closeLocalSocket()
+{
+    QMutexLocker lock(&d->m_serverDataMutex);
+    if (d->m_localServer) {
+        d->m_localServer->close(); // removes the socket file
+        delete d->m_localServer;
+        d->m_localServer = 0;
+    }
+}
+
+QString KDSoapServer::localSocketPath() const
+{
+    QMutexLocker lock(&d->m_serverDataMutex);
+    return d->m_localServer ? d->m_localServer->fullServerName() : QString();
+}
+
+QString KDSoapServer::localEndPoint() const
+{
+    QMutexLocker lock(&d->m_serverDataMutex);
+    if (!d->m_localServer) {
+        return QString();
+    }
+    QString endPoint = QLatin1String("unix://") + d->m_localServer->fullServerName();
+    if (d->m_path != QLatin1String("/")) {
+        endPoint += QLatin1Char(':') + d->m_path;
+    }
+    return endPoint;
+}
+
 void KDSoapServer::setUse(KDSoapMessage::Use use)
 {
     d->m_use = use;
@@ -291,6 +392,8 @@ void KDSoapServer::suspend()
     d->m_portBeforeSuspend = serverPort();
     d->m_addressBeforeSuspend = serverAddress();
     close();
+    d->m_localPathBeforeSuspend = localSocketPath();
+    closeLocalSocket();
 
     // Disconnect connected sockets, otherwise they could still make calls
     if (d->m_threadPool) {
@@ -302,14 +405,20 @@ void KDSoapServer::suspend()
 
 void KDSoapServer::resume()
 {
-    if (d->m_portBeforeSuspend == 0) {
+    if (d->m_portBeforeSuspend == 0 && d->m_localPathBeforeSuspend.isEmpty()) {
         qWarning("KDSoapServer: resume() called without calling suspend() first");
-    } else {
+        return;
+    }
+    if (d->m_portBeforeSuspend != 0) {
         if (!listen(d->m_addressBeforeSuspend, d->m_portBeforeSuspend)) {
             qWarning("KDSoapServer: failed to listen on %s port %d", qPrintable(d->m_addressBeforeSuspend.toString()), d->m_portBeforeSuspend);
         }
         d->m_portBeforeSuspend = 0;
     }
+    if (!d->m_localPathBeforeSuspend.isEmpty()) {
+        listenOnLocalSocket(d->m_localPathBeforeSuspend);
+        d->m_localPathBeforeSuspend.clear();
+    }
 }
 
 void KDSoapServer::setWsdlFile(const QString &file, const QString &pathInUrl)
@@ -343,6 +452,38 @@ QString KDSoapServer::path() const
     return d->m_path;
 }
 
+bool KDSoapServer::setInProcessName(const QString &name)
+{
+    QMutexLocker lock(&d->m_serverDataMutex);
+    if (name == d->m_inProcessName) {
+        return true;
+    }
+    if (d->m_inProcessHandler) {
+        KDSoapInProcessHandler::unregisterHandler(d->m_inProcessHandler);
+        d->m_inProcessHandler->deleteLater(); // in the thread of the server, with its server object
+        d->m_inProcessHandler = 0;
+    }
+    d->m_inProcessName.clear();
+    if (name.isEmpty()) {
+        return true;
+    }
+    KDSoapServerInProcessHandler *handler = new KDSoapServerInProcessHandler(this);
+    if (!KDSoapInProcessHandler::registerHandler(name, handler)) {
+        qWarning("KDSoapServer: another server is registered as %s already", qPrintable(name));
+        delete handler;
+        return false;
+    }
+    d->m_inProcessHandler = handler;
+    d->m_inProcessName = name;
+    return true;
+}
+
+QString KDSoapServer::inProcessName() const
+{
+    QMutexLocker lock(&d->m_serverDataMutex);
+    return d->m_inProcessName;
+}
+
 void KDSoapServer::setMaxConnections(int sockets)
 {
     QMutexLocker lock(&d->m_serverDataMutex);
@@ -355,6 +496,18 @@ int KDSoapServer::maxConnections() const
     return d->m_maxConnections;
 }
 
+void KDSoapServer::setMaxInMemoryRequestSize(qint64 bytes)
+{
+    QMutexLocker lock(&d->m_serverDataMutex);
+    d->m_maxInMemoryRequestSize = bytes;
+}
+
+qint64 KDSoapServer::maxInMemoryRequestSize() const
+{
+    QMutexLocker lock(&d->m_serverDataMutex);
+    return d->m_maxInMemoryRequestSize;
+}
+
 void KDSoapServer::setFeatures(Features features)
 {
     QMutexLocker lock(&d->m_serverDataMutex);
@@ -59,8 +59,16 @@ public:
     enum Feature {
         Public = 0,       ///< HTTP with no ssl and no authentication needed (default)
         Ssl = 1,          ///< HTTPS
-        AuthRequired = 2  ///< Requires authentication. Currently not implemented, patches welcome.
-                       // bitfield, next item is 4
+        AuthRequired = 2, ///< Requires authentication. Currently not implemented, patches welcome.
+        /**
+         * Accepts HTTP/2 over cleartext connections (h2c), with prior knowledge or with an
+         * upgrade from HTTP/1.1. Requests sent concurrently on a connection are still handled one
+         * at a time by the server object, but a client needs a single connection for all of them.
+         * Not available over SSL, which would require ALPN. HTTP/2 requests are kept in memory,
+         * regardless of maxInMemoryRequestSize(). \since 1.8
+         */
+        Http2 = 4
+                       // bitfield, next item is 8
     };
     Q_DECLARE_FLAGS(Features, Feature)
 
@@ -102,6 +110,70 @@ public:
      */
     QString path() const;
 
+    /**
+     * Makes this server reachable from clients in the same process, by setting their endpoint
+     * to "inproc://" followed by \p name (see KDSoapClientInterface::setEndPoint).
+     * Calls to such an endpoint don't use sockets, HTTP or XML: the KDSoapMessage objects are handed
+     * to a server object created for this purpose, in the thread of this KDSoapServer (an event loop
+     * must be running there), and the response message is handed back to the client.
+     * The server object processes one call at a time, in the thread of this server, whether a thread pool is set or not.
+     * Blocking calls (KDSoapClientInterface::call()) from that same thread fail with a "Client.Deadlock" fault,
+     * use asynchronous calls there.
+     *
+     * Calls fail with a "Server.NotSupported" fault when the server object requires authentication
+     * (KDSoapServerAuthInterface), asks for raw XML (KDSoapServerRawXMLInterface), prepares a delayed response,
+     * or calls writeHTTP() or writeXML(). processRequestWithPath() and logging aren't used for such calls.
+     *
+     * An empty name, the default, unregisters the server.
+     * \return false if another server is registered with \p name already.
+     * \since 1.8
+     */
+    bool setInProcessName(const QString &name);
+
+    /**
+     * \return the name set with setInProcessName()
+     * \since 1.8
+     */
+    QString inProcessName() const;
+
+    /**
+     * Makes this server listen for connections on the Unix domain socket \p path too, in addition to
+     * (or instead of) the TCP port given to listen(). For clients running on the same host, this avoids
+     * the overhead of the TCP/IP stack. Clients connect to it using the endpoint returned by localEndPoint().
+     * The connections are handled like TCP connections (thread pool, maximum number of connections...),
+     * but never use SSL.
+     *
+     * A stale socket file left at \p path by a previous process is removed, but this fails
+     * if another server is still listening there.
+     * Only supported on Unix.
+     * \return false if the server could not listen on \p path.
+     * \since 1.8
+     */
+    bool listenOnLocalSocket(const QString &path);
+
+    /**
+     * Stops listening on the Unix domain socket, and removes the socket file.
+     * Connected clients are not disconnected.
+     * \since 1.8
+     */
+    void closeLocalSocket();
+
+    /**
+     * \return the path given to listenOnLocalSocket(), or an empty string if the server isn't listening on one.
+     * \since 1.8
+     */
+    QString localSocketPath() const;
+
+    /**
+     * Returns the endpoint which clients can use to access this server through the Unix domain socket,
+     * for instance "unix:///run/myservice.sock", or "unix:///run/myservice.sock:/soap" if path() isn't "/".
+     * See KDSoapClientInterface::setEndPoint.
+     *
+     * If the server isn't listening on a Unix domain socket, returns an empty string.
+     * \since 1.8
+     */
+    QString localEndPoint() const;
+
     /**
      * Returns the HTTP URL which can be used to access this server.
      * For instance "http://127.0.0.1:8000/".
@@ -191,6 +263,27 @@ public:
      */
     int maxConnections() const;
 
+    /**
+     * Sets the size above which the body of an incoming request is written to a temporary file
+     * while it is being received, rather than kept in memory. The request is then parsed from
+     * a memory mapping of that file, and MTOM attachments of at least \p bytes bytes are given
+     * to the server object as devices (see KDSoapValue::binaryDevice()) instead of QByteArrays.
+     * This keeps the memory usage of the server bounded when receiving large uploads.
+     *
+     * Such devices are only valid until the reply has been sent. The smaller attachments are
+     * copied, so their QByteArrays can be kept as long as needed.
+     *
+     * The special value -1 (the default) means that requests are always kept in memory.
+     * \since 1.8
+     */
+    void setMaxInMemoryRequestSize(qint64 bytes);
+
+    /**
+     * Returns the size set by setMaxInMemoryRequestSize().
+     * \since 1.8
+     */
+    qint64 maxInMemoryRequestSize() const;
+
     /**
      * Sets the number of expected sockets (connections) in this process.
      * This is necessary in order to increase system limits when a large number of clients
@@ -282,6 +375,7 @@ protected:
 
 private:
     friend class KDSoapServerSocket;
+    friend class KDSoapLocalServer;
     void log(const QByteArray &text);
     class Private;
     Private *const d;
@@ -26,6 +26,8 @@ HEADERS = $$INSTALLHEADERS \
     KDSoapServerSocket_p.h \
     KDSoapServerThread_p.h \
     KDSoapSocketList_p.h \
+    KDSoapServerInProcess_p.h \
+    KDSoapServerHttp2_p.h \
 
 SOURCES = KDSoapServer.cpp \
     KDSoapThreadPool.cpp \
@@ -36,7 +38,9 @@ SOURCES = KDSoapServer.cpp \
     KDSoapServerRawXMLInterface.cpp \
     KDSoapServerObjectInterface.cpp \
     KDSoapDelayedResponseHandle.cpp \
-    KDSoapServerCustomVerbRequestInterface.cpp
+    KDSoapServerCustomVerbRequestInterface.cpp \
+    KDSoapServerInProcess.cpp \
+    KDSoapServerHttp2.cpp
 
 DEFINES += KDSOAP_BUILD_KDSOAPSERVER_LIB
 
@@ -0,0 +1,986 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapServerHttp2_p.h"
+#include <QtCore/QDir>
+#include <QtCore/QGlobalStatic>
+#include <string.h>
+
+enum FrameType {
+    DataFrame = 0x0,
+    HeadersFrame = 0x1,
+    PriorityFrame = 0x2,
+    RstStreamFrame = 0x3,
+    SettingsFrame = 0x4,
+    PushPromiseFrame = 0x5,
+    PingFrame = 0x6,
+    GoAwayFrame = 0x7,
+    WindowUpdateFrame = 0x8,
+    ContinuationFrame = 0x9
+};
+
+enum FrameFlag {
+    EndStreamFlag = 0x1,
+    AckFlag = 0x1,
+    EndHeadersFlag = 0x4,
+    PaddedFlag = 0x8,
+    PriorityFlag = 0x20
+};
+
+enum ErrorCode {
+    NoError = 0x0,
+    ProtocolError = 0x1,
+    InternalError = 0x2,
+    FlowControlError = 0x3,
+    FrameSizeError = 0x6,
+    RefusedStream = 0x7,
+    CompressionError = 0x9,
+    EnhanceYourCalm = 0xb
+};
+
+enum SettingId {
+    HeaderTableSizeSetting = 0x1,
+    MaxConcurrentStreamsSetting = 0x3,
+    InitialWindowSizeSetting = 0x4,
+    MaxFrameSizeSetting = 0x5
+};
+
+static const char s_preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+static const int s_prefaceLength = sizeof(s_preface) - 1;
+static const int s_frameHeaderSize = 9;
+static const int s_defaultWindowSize = 65535;
+static const int s_defaultFrameSize = 16384; // the largest frame we accept, as we don't change SETTINGS_MAX_FRAME_SIZE
+static const int s_headerTableSize = 4096; // SETTINGS_HEADER_TABLE_SIZE, not changed either
+static const int s_maxConcurrentStreams = 100;
+static const int s_maxHeaderBlockSize = 256 * 1024;
+
+// RFC 7541 appendix A
+static const char *const s_staticTable[][2] = {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" }
+};
+static const quint32 s_staticTableSize = sizeof(s_staticTable) / sizeof(*s_staticTable);
+
+// RFC 7541 appendix B: the length of the code of each symbol, 256 being EOS.
+// The code is canonical, so the codes themselves follow from the lengths.
+static const uchar s_huffmanCodeLengths[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30
+};
+static const int s_maxHuffmanCodeLength = 30;
+static const int s_eosSymbol = 256;
+
+// Canonical Huffman decoding: the codes of length n are the consecutive values from m_firstCode[n]
+class KDSoapHuffmanTable
+{
+public:
+    KDSoapHuffmanTable()
+    {
+        int count[s_maxHuffmanCodeLength + 1] = { 0 };
+        for (int symbol = 0; symbol <= s_eosSymbol; ++symbol) {
+            ++count[s_huffmanCodeLengths[symbol]];
+        }
+        quint32 code = 0;
+        int offset = 0;
+        for (int length = 1; length <= s_maxHuffmanCodeLength; ++length) {
+            code = (code + (length > 1 ? count[length - 1] : 0)) << (length > 1 ? 1 : 0);
+            m_firstCode[length] = code;
+            m_count[length] = count[length];
+            m_offset[length] = offset;
+            offset += count[length];
+        }
+        // Symbols sorted by code length, then by value
+        int index = 0;
+        for (int length = 1; length <= s_maxHuffmanCodeLength; ++length) {
+            for (int symbol = 0; symbol <= s_eosSymbol; ++symbol) {
+                if (s_huffmanCodeLengths[symbol] == length) {
+                    m_symbols[index++] = quint16(symbol);
+                }
+            }
+        }
+    }
+
+    bool decode(const uchar *data, int size, QByteArray *out) const
+    {
+        out->clear();
+        out->reserve(size * 8 / 5);
+        quint32 code = 0;
+        int length = 0;
+        for (int i = 0; i < size; ++i) {
+            for (int bit = 7; bit >= 0; --bit) {
+                code = (code << 1) | ((data[i] >> bit) & 1);
+                ++length;
+                const quint32 position = code - m_firstCode[length];
+                if (code >= m_firstCode[length] && position < quint32(m_count[length])) {
+                    const int symbol = m_symbols[m_offset[length] + position];
+                    if (symbol == s_eosSymbol) {
+                        return false;
+                    }
+                    out->append(char(symbol));
+                    code = 0;
+                    length = 0;
+                } else if (length == s_maxHuffmanCodeLength) {
+                    return false;
+                }
+            }
+        }
+        // Padding: at most 7 bits, the most significant bits of EOS (all ones)
+        return length <= 7 && code == (1u << length) - 1;
+    }
+
+private:
+    quint32 m_firstCode[s_maxHuffmanCodeLength + 1];
+    int m_count[s_maxHuffmanCodeLength + 1];
+    int m_offset[s_maxHuffmanCodeLength + 1];
+    quint16 m_symbols[s_eosSymbol + 1];
+};
+
+Q_GLOBAL_STATIC(KDSoapHuffmanTable, s_huffmanTable)
+
+// RFC 7541 section 5.1
+static bool decodeInteger(const uchar *&pos, const uchar *end, int prefixBits, quint32 *value)
+{
+    if (pos >= end) {
+        return false;
+    }
+    const quint32 maxPrefix = (1u << prefixBits) - 1;
+    quint64 result = *pos++ & maxPrefix;
+    if (result < maxPrefix) {
+        *value = quint32(result);
+        return true;
+    }
+    for (int shift = 0; pos < end && shift <= 28; shift += 7) {
+        const uchar byte = *pos++;
+        result += quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            if (result > 0x7fffffff) {
+                return false;
+            }
+            *value = quint32(result);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void encodeInteger(QByteArray &out, quint32 value, int prefixBits, uchar firstByteFlags)
+{
+    const quint32 maxPrefix = (1u << prefixBits) - 1;
+    if (value < maxPrefix) {
+        out += char(firstByteFlags | value);
+        return;
+    }
+    out += char(firstByteFlags | maxPrefix);
+    value -= maxPrefix;
+    while (value >= 0x80) {
+        out += char((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += char(value);
+}
+
+// RFC 7541 section 5.2
+static bool decodeString(const uchar *&pos, const uchar *end, QByteArray *out)
+{
+    if (pos >= end) {
+        return false;
+    }
+    const bool huffman = *pos & 0x80;
+    quint32 length;
+    if (!decodeInteger(pos, end, 7, &length) || length > quint32(end - pos)) {
+        return false;
+    }
+    if (huffman) {
+        if (!s_huffmanTable()->decode(pos, int(length), out)) {
+            return false;
+        }
+    } else {
+        *out = QByteArray(reinterpret_cast<const char *>(pos), int(length));
+    }
+    pos += length;
+    return true;
+}
+
+// Without Huffman coding: the responses are small, and mostly XML content types
+static void encodeString(QByteArray &out, const QByteArray &str)
+{
+    encodeInteger(out, quint32(str.size()), 7, 0x00);
+    out += str;
+}
+
+KDSoapHpackDecoder::KDSoapHpackDecoder()
+    : m_tableSize(0),
+      m_maxTableSize(s_headerTableSize)
+{
+}
+
+bool KDSoapHpackDecoder::entry(quint32 index, KDSoapHttp2Header *header) const
+{
+    if (index == 0) {
+        return false;
+    }
+    if (index <= s_staticTableSize) {
+        header->first = s_staticTable[index - 1][0];
+        header->second = s_staticTable[index - 1][1];
+        return true;
+    }
+    index -= s_staticTableSize + 1;
+    if (index >= quint32(m_table.count())) {
+        return false;
+    }
+    *header = m_table.at(int(index));
+    return true;
+}
+
+static int entrySize(const KDSoapHttp2Header &header)
+{
+    return header.first.size() + header.second.size() + 32;
+}
+
+void KDSoapHpackDecoder::evict(int maxSize)
+{
+    while (m_tableSize > maxSize) {
+        m_tableSize -= entrySize(m_table.takeLast());
+    }
+}
+
+void KDSoapHpackDecoder::insert(const KDSoapHttp2Header &header)
+{
+    const int size = entrySize(header);
+    evict(m_maxTableSize - size);
+    if (size <= m_maxTableSize) { // otherwise the table is just emptied
+        m_table.prepend(header);
+        m_tableSize += size;
+    }
+}
+
+bool KDSoapHpackDecoder::decode(const QByteArray &block, QList<KDSoapHttp2Header> *headers)
+{
+    const uchar *pos = reinterpret_cast<const uchar *>(block.constData());
+    const uchar *end = pos + block.size();
+    while (pos < end) {
+        const uchar first = *pos;
+        KDSoapHttp2Header header;
+        quint32 index;
+        if (first & 0x80) { // indexed header field
+            if (!decodeInteger(pos, end, 7, &index) || !entry(index, &header)) {
+                return false;
+            }
+            headers->append(header);
+        } else if ((first & 0xe0) == 0x20) { // dynamic table size update
+            if (!decodeInteger(pos, end, 5, &index) || index > quint32(s_headerTableSize)) {
+                return false;
+            }
+            m_maxTableSize = int(index);
+            evict(m_maxTableSize);
+        } else {
+            // literal header field: with incremental indexing (01), without indexing (0000) or never indexed (0001)
+            const bool indexing = first & 0x40;
+            if (!decodeInteger(pos, end, indexing ? 6 : 4, &index)) {
+                return false;
+            }
+            if (index != 0) {
+                if (!entry(index, &header)) {
+                    return false;
+                }
+            } else if (!decodeString(pos, end, &header.first)) {
+                return false;
+            }
+            if (!decodeString(pos, end, &header.second)) {
+                return false;
+            }
+            if (indexing) {
+                insert(header);
+            }
+            headers->append(header);
+        }
+    }
+    return true;
+}
+
+KDSoapServerHttp2Connection::KDSoapServerHttp2Connection()
+    : m_expectPreface(false),
+      m_closed(false),
+      m_lastStreamId(0),
+      m_headerBlockStream(0),
+      m_headerBlockEndsStream(false),
+      m_sendWindow(s_defaultWindowSize),
+      m_initialSendWindow(s_defaultWindowSize),
+      m_peerMaxFrameSize(s_defaultFrameSize)
+{
+}
+
+KDSoapServerHttp2Connection::~KDSoapServerHttp2Connection()
+{
+    qDeleteAll(m_streams);
+}
+
+KDSoapServerHttp2Connection::PrefaceCheck KDSoapServerHttp2Connection::checkPreface(const QByteArray &data)
+{
+    const int length = qMin(data.size(), s_prefaceLength);
+    if (memcmp(data.constData(), s_preface, length) != 0) {
+        return NoPreface;
+    }
+    return length < s_prefaceLength ? PartialPreface : Preface;
+}
+
+bool KDSoapServerHttp2Connection::isUpgradeRequest(const HeadersMap &headers)
+{
+    if (!headers.contains("http2-settings")) {
+        return false;
+    }
+    Q_FOREACH (const QByteArray &protocol, headers.value("upgrade").split(',')) {
+        if (protocol.trimmed().toLower() == "h2c") {
+            return true;
+        }
+    }
+    return false;
+}
+
+void KDSoapServerHttp2Connection::start()
+{
+    m_expectPreface = true;
+    writeSettings();
+}
+
+// HTTP2-Settings is a base64url-encoded SETTINGS payload, without padding
+static QByteArray fromBase64Url(QByteArray data)
+{
+    data.replace('-', '+');
+    data.replace('_', '/');
+    while (data.size() % 4) {
+        data += '=';
+    }
+    return QByteArray::fromBase64(data);
+}
+
+void KDSoapServerHttp2Connection::startWithUpgrade(const HeadersMap &headers, const QByteArray &body)
+{
+    m_output += "HTTP/1.1 101 Switching Protocols\r\n"
+                "Connection: Upgrade\r\n"
+                "Upgrade: h2c\r\n"
+                "\r\n";
+    start();
+    const QByteArray settings = fromBase64Url(headers.value("http2-settings"));
+    if (settings.size() % 6 != 0) {
+        connectionError(ProtocolError);
+        return;
+    }
+    if (!applySettings(settings)) {
+        return;
+    }
+
+    // The request becomes stream 1, half-closed since the client sent all of it already
+    Stream *stream = new Stream;
+    stream->sendWindow = m_initialSendWindow;
+    for (HeadersMap::const_iterator it = headers.constBegin(); it != headers.constEnd(); ++it) {
+        if (it.key() == "_requestType") {
+            stream->headers.append(qMakePair(QByteArray(":method"), it.value()));
+        } else if (it.key() == "_path") {
+            stream->headers.append(qMakePair(QByteArray(":path"), it.value()));
+        } else if (!it.key().startsWith('_') && it.key() != "connection" && it.key() != "upgrade" && it.key() != "http2-settings") {
+            stream->headers.append(qMakePair(it.key(), it.value()));
+        }
+    }
+    stream->body = QByteArray(body.constData(), body.size()); // deep copy: it can be the mapping of a temporary file
+    m_streams.insert(1, stream);
+    m_lastStreamId = 1;
+    requestComplete(1);
+}
+
+bool KDSoapServerHttp2Connection::feed(const QByteArray &data)
+{
+    if (m_closed) {
+        return false;
+    }
+    m_input += data;
+    int pos = 0;
+    if (m_expectPreface) {
+        if (m_input.size() < s_prefaceLength) {
+            return checkPreface(m_input) != NoPreface || connectionError(ProtocolError);
+        }
+        if (checkPreface(m_input) != Preface) {
+            return connectionError(ProtocolError);
+        }
+        m_expectPreface = false;
+        pos = s_prefaceLength;
+    }
+    while (m_input.size() - pos >= s_frameHeaderSize) {
+        const uchar *header = reinterpret_cast<const uchar *>(m_input.constData() + pos);
+        const int length = (header[0] << 16) | (header[1] << 8) | header[2];
+        const quint8 type = header[3];
+        const quint8 flags = header[4];
+        const quint32 streamId = (quint32(header[5] & 0x7f) << 24) | (header[6] << 16) | (header[7] << 8) | header[8];
+        if (length > s_defaultFrameSize) {
+            return connectionError(FrameSizeError);
+        }
+        if (m_input.size() - pos - s_frameHeaderSize < length) {
+            break; // incomplete frame
+        }
+        const QByteArray payload = m_input.mid(pos + s_frameHeaderSize, length);
+        pos += s_frameHeaderSize + length;
+        if (!handleFrame(type, flags, streamId, payload)) {
+            m_input.clear();
+            return false;
+        }
+    }
+    m_input.remove(0, pos);
+    return true;
+}
+
+bool KDSoapServerHttp2Connection::handleFrame(quint8 type, quint8 flags, quint32 streamId, const QByteArray &payload)
+{
+    if (m_headerBlockStream && (type != ContinuationFrame || streamId != m_headerBlockStream)) {
+        return connectionError(ProtocolError);
+    }
+    switch (type) {
+    case DataFrame:
+        return handleData(flags, streamId, payload);
+    case HeadersFrame:
+        return handleHeaders(flags, streamId, payload);
+    case ContinuationFrame:
+        if (!m_headerBlockStream) {
+            return connectionError(ProtocolError);
+        }
+        m_headerBlock += payload;
+        if (m_headerBlock.size() > s_maxHeaderBlockSize) {
+            return connectionError(EnhanceYourCalm);
+        }
+        return (flags & EndHeadersFlag) ? handleHeaderBlockEnd() : true;
+    case RstStreamFrame:
+        if (streamId == 0 || payload.size() != 4) {
+            return connectionError(ProtocolError);
+        }
+        closeStream(streamId);
+        return true;
+    case SettingsFrame:
+        return handleSettings(flags, streamId, payload);
+    case PushPromiseFrame:
+        return connectionError(ProtocolError); // clients can't push
+    case PingFrame:
+        if (streamId != 0 || payload.size() != 8) {
+            return connectionError(ProtocolError);
+        }
+        if (!(flags & AckFlag)) {
+            writeFrame(PingFrame, AckFlag, 0, payload);
+        }
+        return true;
+    case WindowUpdateFrame:
+        return handleWindowUpdate(streamId, payload);
+    case PriorityFrame: // all streams are handled in order anyway
+    case GoAwayFrame: // the client closes the connection once it has the responses it wants
+    default: // unknown frame types are ignored
+        return true;
+    }
+}
+
+// Removes the padding and priority fields of DATA and HEADERS frames
+static bool framePayload(quint8 flags, const QByteArray &payload, int *start, int *end)
+{
+    *start = 0;
+    *end = payload.size();
+    if (flags & PaddedFlag) {
+        if (payload.isEmpty()) {
+            return false;
+        }
+        const int padding = uchar(payload.at(0));
+        *start = 1;
+        *end -= padding;
+    }
+    if (flags & PriorityFlag) {
+        *start += 5;
+    }
+    return *start <= *end;
+}
+
+bool KDSoapServerHttp2Connection::handleHeaders(quint8 flags, quint32 streamId, const QByteArray &payload)
+{
+    if (streamId == 0 || !(streamId & 1)) {
+        return connectionError(ProtocolError);
+    }
+    int start, end;
+    if (!framePayload(flags, payload, &start, &end)) {
+        return connectionError(ProtocolError);
+    }
+    Stream *stream = m_streams.value(streamId);
+    if (!stream) {
+        if (streamId <= m_lastStreamId) {
+            return connectionError(ProtocolError); // closed stream
+        }
+        m_lastStreamId = streamId;
+    } else if (stream->requestComplete) {
+        return connectionError(ProtocolError);
+    }
+    m_headerBlockStream = streamId;
+    m_headerBlockEndsStream = flags & EndStreamFlag;
+    m_headerBlock = payload.mid(start, end - start);
+    return (flags & EndHeadersFlag) ? handleHeaderBlockEnd() : true;
+}
+
+bool KDSoapServerHttp2Connection::handleHeaderBlockEnd()
+{
+    const quint32 streamId = m_headerBlockStream;
+    m_headerBlockStream = 0;
+    // Decoded even for refused streams, to keep the dynamic table in sync
+    QList<KDSoapHttp2Header> headers;
+    if (!m_decoder.decode(m_headerBlock, &headers)) {
+        return connectionError(CompressionError);
+    }
+    m_headerBlock.clear();
+    Stream *stream = m_streams.value(streamId);
+    if (!stream) {
+        if (m_streams.count() >= s_maxConcurrentStreams) {
+            writeResetStream(streamId, RefusedStream);
+            return true;
+        }
+        stream = new Stream;
+        stream->sendWindow = m_initialSendWindow;
+        stream->headers = headers;
+        m_streams.insert(streamId, stream);
+    } // else: trailers, ignored
+    if (m_headerBlockEndsStream) {
+        requestComplete(streamId);
+    }
+    return true;
+}
+
+bool KDSoapServerHttp2Connection::handleData(quint8 flags, quint32 streamId, const QByteArray &payload)
+{
+    if (streamId == 0) {
+        return connectionError(ProtocolError);
+    }
+    int start, end;
+    if (!framePayload(flags & ~PriorityFlag, payload, &start, &end)) {
+        return connectionError(ProtocolError);
+    }
+    // The data is consumed right away, so the flow control windows are restored right away
+    if (!payload.isEmpty()) {
+        writeWindowUpdate(0, quint32(payload.size()));
+    }
+    Stream *stream = m_streams.value(streamId);
+    if (!stream || stream->requestComplete) {
+        if (streamId > m_lastStreamId) {
+            return connectionError(ProtocolError); // idle stream
+        }
+        return true; // refused or reset stream
+    }
+    stream->body.append(payload.constData() + start, end - start);
+    if (flags & EndStreamFlag) {
+        requestComplete(streamId);
+    } else if (!payload.isEmpty()) {
+        writeWindowUpdate(streamId, quint32(payload.size()));
+    }
+    return true;
+}
+
+bool KDSoapServerHttp2Connection::handleSettings(quint8 flags, quint32 streamId, const QByteArray &payload)
+{
+    if (streamId != 0) {
+        return connectionError(ProtocolError);
+    }
+    if (flags & AckFlag) {
+        return payload.isEmpty() || connectionError(FrameSizeError);
+    }
+    if (payload.size() % 6 != 0) {
+        return connectionError(FrameSizeError);
+    }
+    if (!applySettings(payload)) {
+        return false;
+    }
+    writeFrame(SettingsFrame, AckFlag, 0, QByteArray());
+    flushAll(); // the windows might be larger now
+    return true;
+}
+
+bool KDSoapServerHttp2Connection::applySettings(const QByteArray &payload)
+{
+    const uchar *data = reinterpret_cast<const uchar *>(payload.constData());
+    for (int i = 0; i + 6 <= payload.size(); i += 6) {
+        const quint16 id = quint16((data[i] << 8) | data[i + 1]);
+        const quint32 value = (quint32(data[i + 2]) << 24) | (data[i + 3] << 16) | (data[i + 4] << 8) | data[i + 5];
+        switch (id) {
+        case InitialWindowSizeSetting: {
+            if (value > 0x7fffffff) {
+                return connectionError(FlowControlError);
+            }
+            const qint64 delta = qint64(value) - m_initialSendWindow;
+            Q_FOREACH (Stream *stream, m_streams) {
+                stream->sendWindow += delta;
+            }
+            m_initialSendWindow = value;
+            break;
+        }
+        case MaxFrameSizeSetting:
+            if (value < quint32(s_defaultFrameSize) || value > 0xffffff) {
+                return connectionError(ProtocolError);
+            }
+            m_peerMaxFrameSize = int(value);
+            break;
+        default:
+            // SETTINGS_HEADER_TABLE_SIZE doesn't matter, since responses don't use the dynamic table
+            break;
+        }
+    }
+    return true;
+}
+
+bool KDSoapServerHttp2Connection::handleWindowUpdate(quint32 streamId, const QByteArray &payload)
+{
+    if (payload.size() != 4) {
+        return connectionError(FrameSizeError);
+    }
+    const uchar *data = reinterpret_cast<const uchar *>(payload.constData());
+    const quint32 increment = (quint32(data[0] & 0x7f) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+    if (streamId == 0) {
+        m_sendWindow += increment;
+        if (increment == 0 || m_sendWindow > 0x7fffffff) {
+            return connectionError(increment == 0 ? ProtocolError : FlowControlError);
+        }
+        flushAll();
+    } else if (Stream *stream = m_streams.value(streamId)) {
+        stream->sendWindow += increment;
+        if (increment == 0 || stream->sendWindow > 0x7fffffff) {
+            writeResetStream(streamId, increment == 0 ? ProtocolError : FlowControlError);
+            closeStream(streamId);
+        } else {
+            flushStream(streamId);
+        }
+    }
+    return true;
+}
+
+void KDSoapServerHttp2Connection::requestComplete(quint32 streamId)
+{
+    m_streams.value(streamId)->requestComplete = true;
+    m_pendingRequests.enqueue(streamId);
+}
+
+bool KDSoapServerHttp2Connection::hasPendingRequest() const
+{
+    return !m_pendingRequests.isEmpty();
+}
+
+KDSoapServerHttp2Connection::Request KDSoapServerHttp2Connection::takeRequest()
+{
+    Request request;
+    if (m_pendingRequests.isEmpty()) {
+        return request;
+    }
+    request.streamId = m_pendingRequests.dequeue();
+    Stream *stream = m_streams.value(request.streamId);
+    // Same as what KDSoapServerSocket parses from HTTP/1.1 requests
+    request.headers.insert("_httpVersion", "HTTP/2");
+    Q_FOREACH (const KDSoapHttp2Header &header, stream->headers) {
+        if (header.first == ":method") {
+            request.headers.insert("_requestType", header.second);
+        } else if (header.first == ":path") {
+            request.headers.insert("_path", QDir::cleanPath(QString::fromLatin1(header.second.constData())).toLatin1());
+        } else if (header.first == ":authority") {
+            request.headers.insert("host", header.second);
+        } else if (header.first.startsWith(':')) {
+            continue;
+        } else if (request.headers.contains(header.first)) {
+            // HTTP/2 sends each cookie separately (RFC 7540 section 8.1.2.5)
+            QByteArray &value = request.headers[header.first];
+            value += (header.first == "cookie" ? "; " : ", ") + header.second;
+        } else {
+            request.headers.insert(header.first, header.second);
+        }
+    }
+    request.body = stream->body;
+    stream->headers.clear();
+    stream->body.clear();
+    return request;
+}
+
+void KDSoapServerHttp2Connection::writeResponse(quint32 streamId, const char *data, qint64 size)
+{
+    Stream *stream = m_streams.value(streamId);
+    if (!stream || stream->responseComplete) {
+        return; // reset by the client meanwhile
+    }
+    if (!stream->response.feed(data, int(size))) {
+        qWarning("KDSoapServerHttp2Connection: invalid response");
+        writeResetStream(streamId, InternalError);
+        closeStream(streamId);
+        return;
+    }
+    if (stream->response.headersComplete()) {
+        stream->pendingData += stream->response.takeBody();
+        stream->responseComplete = stream->response.isComplete();
+        flushStream(streamId);
+    }
+}
+
+void KDSoapServerHttp2Connection::finishResponse(quint32 streamId)
+{
+    Stream *stream = m_streams.value(streamId);
+    if (!stream || stream->responseComplete) {
+        return;
+    }
+    if (!stream->response.headersComplete()) {
+        // Nothing (valid) was written for this request
+        static const char serverError[] = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+        stream->response = KDSoapHttpResponseParser();
+        writeResponse(streamId, serverError, sizeof(serverError) - 1);
+        return;
+    }
+    stream->responseComplete = true;
+    flushStream(streamId);
+}
+
+QByteArray KDSoapServerHttp2Connection::takeOutput()
+{
+    const QByteArray output = m_output;
+    m_output.clear();
+    return output;
+}
+
+void KDSoapServerHttp2Connection::writeFrame(quint8 type, quint8 flags, quint32 streamId, const QByteArray &payload)
+{
+    const int length = payload.size();
+    char header[s_frameHeaderSize] = {
+        char(length >> 16), char(length >> 8), char(length),
+        char(type), char(flags),
+        char(streamId >> 24), char(streamId >> 16), char(streamId >> 8), char(streamId)
+    };
+    m_output.append(header, s_frameHeaderSize);
+    m_output += payload;
+}
+
+static void appendUInt16(QByteArray &out, quint16 value)
+{
+    out += char(value >> 8);
+    out += char(value);
+}
+
+static void appendUInt32(QByteArray &out, quint32 value)
+{
+    out += char(value >> 24);
+    out += char(value >> 16);
+    out += char(value >> 8);
+    out += char(value);
+}
+
+void KDSoapServerHttp2Connection::writeSettings()
+{
+    QByteArray payload;
+    appendUInt16(payload, MaxConcurrentStreamsSetting);
+    appendUInt32(payload, s_maxConcurrentStreams);
+    writeFrame(SettingsFrame, 0, 0, payload);
+}
+
+void KDSoapServerHttp2Connection::writeWindowUpdate(quint32 streamId, quint32 increment)
+{
+    QByteArray payload;
+    appendUInt32(payload, increment);
+    writeFrame(WindowUpdateFrame, 0, streamId, payload);
+}
+
+void KDSoapServerHttp2Connection::writeResetStream(quint32 streamId, quint32 errorCode)
+{
+    QByteArray payload;
+    appendUInt32(payload, errorCode);
+    writeFrame(RstStreamFrame, 0, streamId, payload);
+}
+
+bool KDSoapServerHttp2Connection::connectionError(quint32 errorCode)
+{
+    QByteArray payload;
+    appendUInt32(payload, m_lastStreamId);
+    appendUInt32(payload, errorCode);
+    writeFrame(GoAwayFrame, 0, 0, payload);
+    m_closed = true;
+    return false;
+}
+
+// Connection-specific headers, not allowed in HTTP/2 (RFC 7540 section 8.1.2.2)
+static bool isConnectionHeader(const QByteArray &name)
+{
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+           || name == "transfer-encoding" || name == "upgrade";
+}
+
+void KDSoapServerHttp2Connection::sendResponseHeaders(quint32 streamId, Stream *stream, bool endStream)
+{
+    QByteArray block;
+    const int status = stream->response.statusCode();
+    // Indexed in the static table, or a literal with the indexed name ":status"
+    static const int s_indexedStatuses[] = { 200, 204, 206, 304, 400, 404, 500 };
+    int statusIndex = 0;
+    for (int i = 0; i < int(sizeof(s_indexedStatuses) / sizeof(*s_indexedStatuses)); ++i) {
+        if (s_indexedStatuses[i] == status) {
+            statusIndex = 8 + i;
+        }
+    }
+    if (statusIndex) {
+        encodeInteger(block, quint32(statusIndex), 7, 0x80);
+    } else {
+        encodeInteger(block, 8, 4, 0x00);
+        encodeString(block, QByteArray::number(status));
+    }
+    Q_FOREACH (const KDSoapHttpResponseParser::RawHeaderPair &header, stream->response.headers()) {
+        const QByteArray name = header.first.toLower();
+        if (isConnectionHeader(name)) {
+            continue;
+        }
+        block += char(0x00); // literal without indexing, new name
+        encodeString(block, name);
+        encodeString(block, header.second);
+    }
+
+    // HEADERS, then CONTINUATION frames if the block doesn't fit
+    int pos = 0;
+    do {
+        const int size = qMin(block.size() - pos, m_peerMaxFrameSize);
+        const bool last = pos + size == block.size();
+        const quint8 flags = (last ? EndHeadersFlag : 0) | ((pos == 0 && endStream) ? EndStreamFlag : 0);
+        writeFrame(pos == 0 ? HeadersFrame : ContinuationFrame, flags, streamId, block.mid(pos, size));
+        pos += size;
+    } while (pos < block.size());
+}
+
+void KDSoapServerHttp2Connection::flushStream(quint32 streamId)
+{
+    Stream *stream = m_streams.value(streamId);
+    if (!stream || !stream->response.headersComplete()) {
+        return;
+    }
+    if (!stream->headersSent) {
+        stream->headersSent = true;
+        const bool endStream = stream->responseComplete && stream->pendingData.isEmpty();
+        sendResponseHeaders(streamId, stream, endStream);
+        if (endStream) {
+            closeStream(streamId);
+            return;
+        }
+    }
+    int pos = 0;
+    while (pos < stream->pendingData.size()) {
+        const qint64 window = qMin(m_sendWindow, stream->sendWindow);
+        if (window <= 0) {
+            break; // wait for WINDOW_UPDATE
+        }
+        const int size = int(qMin(qMin<qint64>(window, m_peerMaxFrameSize), qint64(stream->pendingData.size() - pos)));
+        const bool last = stream->responseComplete && pos + size == stream->pendingData.size();
+        writeFrame(DataFrame, last ? EndStreamFlag : 0, streamId, stream->pendingData.mid(pos, size));
+        pos += size;
+        m_sendWindow -= size;
+        stream->sendWindow -= size;
+        if (last) {
+            closeStream(streamId);
+            return;
+        }
+    }
+    stream->pendingData.remove(0, pos);
+    if (stream->responseComplete && stream->pendingData.isEmpty()) {
+        writeFrame(DataFrame, EndStreamFlag, streamId, QByteArray());
+        closeStream(streamId);
+    }
+}
+
+void KDSoapServerHttp2Connection::flushAll()
+{
+    Q_FOREACH (quint32 streamId, m_streams.keys()) {
+        flushStream(streamId);
+    }
+}
+
+void KDSoapServerHttp2Connection::closeStream(quint32 streamId)
+{
+    delete m_streams.take(streamId);
+    m_pendingRequests.removeAll(streamId);
+}
@@ -0,0 +1,161 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPSERVERHTTP2_P_H
+#define KDSOAPSERVERHTTP2_P_H
+
+#include <KDSoapClient/KDSoapHttpResponseParser_p.h>
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QPair>
+#include <QtCore/QQueue>
+
+typedef QPair<QByteArray, QByteArray> KDSoapHttp2Header;
+
+/**
+ * \internal
+ * HPACK (RFC 7541) decoder, for the header blocks of requests.
+ */
+class KDSoapHpackDecoder
+{
+public:
+    KDSoapHpackDecoder();
+
+    // \return false on a compression error, which is a connection error
+    bool decode(const QByteArray &block, QList<KDSoapHttp2Header> *headers);
+
+private:
+    bool entry(quint32 index, KDSoapHttp2Header *header) const;
+    void insert(const KDSoapHttp2Header &header);
+    void evict(int maxSize);
+
+    QList<KDSoapHttp2Header> m_table; // dynamic table, newest entry first
+    int m_tableSize;
+    int m_maxTableSize;
+};
+
+/**
+ * \internal
+ * The HTTP/2 (RFC 7540) side of a KDSoapServerSocket using h2c, without the socket:
+ * frames received are given to feed(), and the frames to send are returned by takeOutput().
+ *
+ * Complete requests are converted into the headers map and body which KDSoapServerSocket
+ * gets from HTTP/1.1 requests. Conversely, the responses are written in HTTP/1.1 form
+ * with writeResponse(), and sent as HEADERS and DATA frames.
+ */
+class KDSoapServerHttp2Connection
+{
+public:
+    typedef QMap<QByteArray, QByteArray> HeadersMap;
+
+    struct Request {
+        Request() : streamId(0) {}
+        quint32 streamId;
+        HeadersMap headers;
+        QByteArray body;
+    };
+
+    KDSoapServerHttp2Connection();
+    ~KDSoapServerHttp2Connection();
+
+    enum PrefaceCheck {
+        NoPreface,
+        PartialPreface,
+        Preface
+    };
+    // Whether a connection starting with \p data uses HTTP/2 with prior knowledge
+    static PrefaceCheck checkPreface(const QByteArray &data);
+    // Whether the HTTP/1.1 request with \p headers asks for an upgrade to h2c
+    static bool isUpgradeRequest(const HeadersMap &headers);
+
+    // Prior knowledge: the client preface is the next data given to feed()
+    void start();
+    // Upgrade: the HTTP/1.1 request becomes stream 1, the 101 response is the start of the output
+    void startWithUpgrade(const HeadersMap &headers, const QByteArray &body);
+
+    // \return false on a connection error: the output then ends with GOAWAY, and the connection must be closed
+    bool feed(const QByteArray &data);
+
+    bool hasPendingRequest() const;
+    Request takeRequest();
+
+    // The HTTP/1.1 response to the request of \p streamId, or part of it
+    void writeResponse(quint32 streamId, const char *data, qint64 size);
+    // Ends the response of \p streamId, if the data written didn't end it
+    void finishResponse(quint32 streamId);
+
+    QByteArray takeOutput();
+
+private:
+    struct Stream {
+        Stream() : sendWindow(0), requestComplete(false), headersSent(false), responseComplete(false) {}
+        QList<KDSoapHttp2Header> headers;
+        QByteArray body;
+        qint64 sendWindow;
+        bool requestComplete;
+        KDSoapHttpResponseParser response;
+        bool headersSent;
+        bool responseComplete;
+        QByteArray pendingData; // response body waiting for flow control
+    };
+
+    void writeFrame(quint8 type, quint8 flags, quint32 streamId, const QByteArray &payload);
+    void writeSettings();
+    void writeWindowUpdate(quint32 streamId, quint32 increment);
+    void writeResetStream(quint32 streamId, quint32 errorCode);
+    bool connectionError(quint32 errorCode);
+
+    bool handleFrame(quint8 type, quint8 flags, quint32 streamId, const QByteArray &payload);
+    bool handleHeaders(quint8 flags, quint32 streamId, const QByteArray &payload);
+    bool handleHeaderBlockEnd();
+    bool handleData(quint8 flags, quint32 streamId, const QByteArray &payload);
+    bool handleSettings(quint8 flags, quint32 streamId, const QByteArray &payload);
+    bool applySettings(const QByteArray &payload);
+    bool handleWindowUpdate(quint32 streamId, const QByteArray &payload);
+    void requestComplete(quint32 streamId);
+
+    void sendResponseHeaders(quint32 streamId, Stream *stream, bool endStream);
+    void flushStream(quint32 streamId);
+    void flushAll();
+    void closeStream(quint32 streamId);
+
+    QByteArray m_input;
+    QByteArray m_output;
+    bool m_expectPreface;
+    bool m_closed;
+    KDSoapHpackDecoder m_decoder;
+    QHash<quint32, Stream *> m_streams;
+    QQueue<quint32> m_pendingRequests;
+    quint32 m_lastStreamId;
+    // Header block split into CONTINUATION frames
+    quint32 m_headerBlockStream;
+    bool m_headerBlockEndsStream;
+    QByteArray m_headerBlock;
+    // Peer settings and flow control
+    qint64 m_sendWindow;
+    qint64 m_initialSendWindow;
+    int m_peerMaxFrameSize;
+};
+
+#endif // KDSOAPSERVERHTTP2_P_H
@@ -0,0 +1,123 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#include "KDSoapServerInProcess_p.h"
+#include "KDSoapServer.h"
+#include "KDSoapServerObjectInterface.h"
+#include "KDSoapServerAuthInterface.h"
+#include "KDSoapServerRawXMLInterface.h"
+#include <KDSoapClient/KDSoapAuthentication.h>
+#include <KDSoapClient/KDSoapMessageReader_p.h>
+#include <KDSoapClient/KDSoapMessageWriter_p.h>
+
+KDSoapServerInProcessHandler::KDSoapServerInProcessHandler(KDSoapServer *server)
+    : m_server(server),
+      m_serverObject(0)
+{
+    qRegisterMetaType<KDSoapInProcessCallPtr>("KDSoapInProcessCallPtr");
+    moveToThread(server->thread());
+}
+
+KDSoapServerInProcessHandler::~KDSoapServerInProcessHandler()
+{
+    // Before anything is destroyed: no more calls can come in after this
+    KDSoapInProcessHandler::unregisterHandler(this);
+    delete m_serverObject;
+}
+
+QThread *KDSoapServerInProcessHandler::handlerThread() const
+{
+    return thread();
+}
+
+void KDSoapServerInProcessHandler::handleCall(const KDSoapInProcessCallPtr &call)
+{
+    QMetaObject::invokeMethod(this, "processCall", Qt::QueuedConnection, Q_ARG(KDSoapInProcessCallPtr, call));
+}
+
+// Same steps as KDSoapServerSocket::handleRequest and makeCall, minus HTTP and XML
+void KDSoapServerInProcessHandler::processCall(const KDSoapInProcessCallPtr &call)
+{
+    if (!m_serverObject) {
+        m_serverObject = m_server->createServerObject();
+    }
+    KDSoapServerObjectInterface *serverObjectInterface = qobject_cast<KDSoapServerObjectInterface *>(m_serverObject);
+    KDSoapMessage replyMsg;
+    if (!serverObjectInterface) {
+        const QString error = QString::fromLatin1("Server object %1 does not implement KDSoapServerObjectInterface!").arg(QString::fromLatin1(m_serverObject->metaObject()->className()));
+        qWarning("%s", qPrintable(error));
+        replyMsg.createFaultMessage(QString::fromLatin1("Server.ImplementationError"), error, call->soapVersion());
+        call->finish(replyMsg, KDSoapHeaders(), QString());
+        return;
+    }
+
+    const QByteArray soapAction = call->soapAction();
+    // No HTTP here: these can only work if the server object doesn't actually need them for this call
+    QString notSupported;
+    if (KDSoapServerAuthInterface *authInterface = qobject_cast<KDSoapServerAuthInterface *>(m_serverObject)) {
+        // There are no credentials to send, like an HTTP request without an Authorization header
+        if (!authInterface->validateAuthentication(KDSoapAuthentication(), m_server->path())) {
+            notSupported = QString::fromLatin1("Authentication is not supported for in-process calls");
+        }
+    }
+    if (KDSoapServerRawXMLInterface *rawXmlInterface = qobject_cast<KDSoapServerRawXMLInterface *>(m_serverObject)) {
+        QMap<QByteArray, QByteArray> httpHeaders;
+        httpHeaders.insert("_requestType", "POST");
+        httpHeaders.insert("_path", m_server->path().toLatin1());
+        httpHeaders.insert("soapaction", soapAction);
+        if (notSupported.isEmpty() && rawXmlInterface->newRequest("POST", httpHeaders)) {
+            notSupported = QString::fromLatin1("Raw XML requests are not supported for in-process calls");
+        }
+    }
+    if (!notSupported.isEmpty()) {
+        replyMsg.createFaultMessage(QString::fromLatin1("Server.NotSupported"), notSupported, call->soapVersion());
+        call->finish(replyMsg, KDSoapHeaders(), QString());
+        return;
+    }
+
+    KDSoapMessage requestMsg = call->request();
+    if (KDSoapBodyParser *bodyParser = serverObjectInterface->requestBodyParser(soapAction)) {
+        // Body parsers (generated with direct parsing) read XML, so this needs it after all
+        KDSoapMessageWriter writer;
+        writer.setVersion(call->soapVersion());
+        writer.setMessageNamespace(requestMsg.namespaceUri());
+        const QByteArray xml = writer.messageToXml(requestMsg, QString(), KDSoapHeaders(), QMap<QString, KDSoapMessage>());
+        KDSoapMessageReader reader;
+        reader.setBodyParser(bodyParser);
+        KDSoapHeaders ignoredHeaders;
+        reader.xmlToMessage(xml, &requestMsg, 0, &ignoredHeaders, call->soapVersion());
+    }
+
+    serverObjectInterface->setRequestHeaders(call->requestHeaders(), soapAction);
+    serverObjectInterface->processRequest(requestMsg, replyMsg, soapAction);
+    if (serverObjectInterface->hasFault()) {
+        replyMsg.setFault(true);
+        serverObjectInterface->storeFaultAttributes(replyMsg);
+    }
+    QString responseNamespace = serverObjectInterface->responseNamespace();
+    if (responseNamespace.isEmpty()) {
+        responseNamespace = requestMsg.namespaceUri();
+    }
+    call->finish(replyMsg, serverObjectInterface->responseHeaders(), responseNamespace);
+}
+
+#include "moc_KDSoapServerInProcess_p.cpp"
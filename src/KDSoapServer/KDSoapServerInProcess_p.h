@@ -0,0 +1,54 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+#ifndef KDSOAPSERVERINPROCESS_P_H
+#define KDSOAPSERVERINPROCESS_P_H
+
+#include <QtCore/QObject>
+#include <KDSoapClient/KDSoapInProcess_p.h>
+
+class KDSoapServer;
+
+/**
+ * \internal
+ * Handles the calls to the inproc:// endpoint of a KDSoapServer, in the thread of the server,
+ * with a server object of its own.
+ */
+class KDSoapServerInProcessHandler : public QObject, public KDSoapInProcessHandler
+{
+    Q_OBJECT
+public:
+    explicit KDSoapServerInProcessHandler(KDSoapServer *server);
+    ~KDSoapServerInProcessHandler();
+
+    /*! \reimp */ QThread *handlerThread() const;
+    /*! \reimp */ void handleCall(const KDSoapInProcessCallPtr &call);
+
+private Q_SLOTS:
+    void processCall(const KDSoapInProcessCallPtr &call);
+
+private:
+    KDSoapServer *m_server;
+    QObject *m_serverObject; // created on the first call
+};
+
+#endif // KDSOAPSERVERINPROCESS_P_H
@@ -24,6 +24,7 @@
 #include "KDSoapServerSocket_p.h"
 #include "KDSoapClient/KDSoapValue.h"
 #include <QDebug>
+#include <QHash>
 #include <QPointer>
 
 class KDSoapServerObjectInterface::Private
@@ -45,6 +46,9 @@ public:
     QByteArray m_soapAction;
     // QPointer in case the client disconnects during a delayed response
     QPointer<KDSoapServerSocket> m_serverSocket;
+
+    QHash<QString, KDSoapServerObjectInterface::RequestHandler> m_handlersByName;
+    QHash<QByteArray, KDSoapServerObjectInterface::RequestHandler> m_handlersByAction;
 };
 
 KDSoapServerObjectInterface::HttpResponseHeaderItem::HttpResponseHeaderItem(const QByteArray &name, const QByteArray &value)
@@ -68,6 +72,9 @@ KDSoapServerObjectInterface::~KDSoapServerObjectInterface()
 
 void KDSoapServerObjectInterface::processRequest(const KDSoapMessage &request, KDSoapMessage &response, const QByteArray &soapAction)
 {
+    if (dispatchRequest(request, response, soapAction)) {
+        return;
+    }
     const QString method = request.name();
     qDebug() << "Slot not found:" << method << "[soapAction =" << soapAction << "]" /* << "in" << metaObject()->className()*/;
     const KDSoap::SoapVersion soapVersion = KDSoap::SOAP1_1; // TODO version selection on the server side
@@ -96,6 +103,36 @@ KDSoapServerObjectInterface::HttpResponseHeaderItems KDSoapServerObjectInterface
     return HttpResponseHeaderItems();
 }
 
+KDSoapBodyParser *KDSoapServerObjectInterface::requestBodyParser(const QByteArray &soapAction)
+{
+    Q_UNUSED(soapAction);
+    return 0;
+}
+
+void KDSoapServerObjectInterface::registerRequestHandlerInternal(const QString &operationName, const QByteArray &soapAction, RequestHandler handler)
+{
+    Q_ASSERT(handler);
+    if (!operationName.isEmpty() && !d->m_handlersByName.contains(operationName)) {
+        d->m_handlersByName.insert(operationName, handler);
+    }
+    if (!soapAction.isEmpty() && !d->m_handlersByAction.contains(soapAction)) {
+        d->m_handlersByAction.insert(soapAction, handler);
+    }
+}
+
+bool KDSoapServerObjectInterface::dispatchRequest(const KDSoapMessage &request, KDSoapMessage &response, const QByteArray &soapAction)
+{
+    RequestHandler handler = d->m_handlersByName.value(request.name());
+    if (!handler && !soapAction.isEmpty()) {
+        handler = d->m_handlersByAction.value(soapAction);
+    }
+    if (!handler) {
+        return false;
+    }
+    (this->*handler)(request, response);
+    return true;
+}
+
 void KDSoapServerObjectInterface::doneProcessingRequestWithPath(const KDSoapServerObjectInterface &otherInterface)
 {
     d->m_faultCode = otherInterface.d->m_faultCode;
@@ -180,8 +217,14 @@ QByteArray KDSoapServerObjectInterface::soapAction() const
     return d->m_soapAction;
 }
 
+// No server socket during in-process calls (KDSoapServer::setInProcessName): the call fails instead
+static const char s_notInProcess[] = "%1 is not supported for in-process calls";
+
 KDSoapDelayedResponseHandle KDSoapServerObjectInterface::prepareDelayedResponse()
 {
+    if (!d->m_serverSocket) {
+        setFault(QString::fromLatin1("Server.NotSupported"), QString::fromLatin1(s_notInProcess).arg(QLatin1String("prepareDelayedResponse()")));
+    }
     return KDSoapDelayedResponseHandle(d->m_serverSocket);
 }
 
@@ -200,13 +243,21 @@ void KDSoapServerObjectInterface::sendDelayedResponse(const KDSoapDelayedRespons
 
 void KDSoapServerObjectInterface::writeHTTP(const QByteArray &httpReply)
 {
-    const qint64 written = d->m_serverSocket->write(httpReply);
+    if (!d->m_serverSocket) {
+        setFault(QString::fromLatin1("Server.NotSupported"), QString::fromLatin1(s_notInProcess).arg(QLatin1String("writeHTTP()")));
+        return;
+    }
+    const qint64 written = d->m_serverSocket->writeResponse(httpReply);
     Q_ASSERT(written == httpReply.size()); // Please report a bug if you hit this.
     Q_UNUSED(written);
 }
 
 void KDSoapServerObjectInterface::writeXML(const QByteArray &reply, bool isFault)
 {
+    if (!d->m_serverSocket) {
+        setFault(QString::fromLatin1("Server.NotSupported"), QString::fromLatin1(s_notInProcess).arg(QLatin1String("writeXML()")));
+        return;
+    }
     d->m_serverSocket->writeXML(reply, isFault);
 }
 
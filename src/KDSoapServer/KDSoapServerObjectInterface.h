@@ -33,6 +33,7 @@
 #include <QIODevice>
 
 class KDSoapServerSocket;
+class KDSoapBodyParser;
 
 QT_BEGIN_NAMESPACE
 class QAbstractSocket;
@@ -147,6 +148,61 @@ public:
      */
     virtual HttpResponseHeaderItems additionalHttpResponseHeaderItems() const;
 
+    /**
+     * Returns a parser for the body of the incoming request, or 0 for the regular parsing
+     * of the request into the KDSoapMessage given to processRequest().
+     * The body parser is called before processRequest(), and can decline to handle the
+     * request (see KDSoapBodyParser::parseBody()). The request given to processRequest() then
+     * only contains the name and namespace of the body element, if the parser handled it.
+     *
+     * The default implementation in this base class returns 0. Code generated by kdwsdl2cpp
+     * with the -direct-parsing option reimplements it, to fill the generated classes directly
+     * from the XML stream.
+     *
+     * \param soapAction the SOAP action string sent by the client
+     * \since 1.8
+     */
+    virtual KDSoapBodyParser *requestBodyParser(const QByteArray &soapAction);
+
+    /**
+     * Signature of the methods which can be registered with registerRequestHandler().
+     * \since 1.8
+     */
+    typedef void (KDSoapServerObjectInterface::*RequestHandler)(const KDSoapMessage &request, KDSoapMessage &response);
+
+    /**
+     * Registers \p handler to be called for requests whose body element is \p operationName,
+     * or whose SOAP action is \p soapAction (if not empty).
+     * The lookup uses hash tables, so that servers with many operations don't have to compare
+     * the request against each operation in turn.
+     *
+     * The default implementation of processRequest() calls the registered handlers, so
+     * a hand-written server can register its methods in its constructor, instead of reimplementing
+     * processRequest():
+     * <code>
+     *   registerRequestHandler(QLatin1String("getEmployeeCountry"), "http://www.example.com/getEmployeeCountry",
+     *                          &EmployeeServerObject::handleGetEmployeeCountry);
+     * </code>
+     * with handleGetEmployeeCountry(const KDSoapMessage &request, KDSoapMessage &response) being a
+     * method of EmployeeServerObject, which must inherit KDSoapServerObjectInterface.
+     *
+     * If an operation name is registered more than once, the first registration wins.
+     * \since 1.8
+     */
+    template<class T>
+    void registerRequestHandler(const QString &operationName, const QByteArray &soapAction,
+                                void (T::*handler)(const KDSoapMessage &, KDSoapMessage &))
+    {
+        registerRequestHandlerInternal(operationName, soapAction, static_cast<RequestHandler>(handler));
+    }
+
+    /**
+     * Calls the handler registered for \p request (looked up by name, then by \p soapAction).
+     * \return false if no handler was registered for this request.
+     * \since 1.8
+     */
+    bool dispatchRequest(const KDSoapMessage &request, KDSoapMessage &response, const QByteArray &soapAction);
+
     /**
      * Call this after processRequestWithPath has finished handling a request,
      * in order to copy response headers, faults, etc. from the secondary object interface
@@ -263,11 +319,13 @@ public:
 
 private:
     friend class KDSoapServerSocket;
+    friend class KDSoapServerInProcessHandler;
     void setServerSocket(KDSoapServerSocket *serverSocket); // only valid during processRequest()
     void setRequestHeaders(const KDSoapHeaders &headers, const QByteArray &soapAction);
     KDSoapHeaders responseHeaders() const;
     QString responseNamespace() const;
     void storeFaultAttributes(KDSoapMessage &message) const;
+    void registerRequestHandlerInternal(const QString &operationName, const QByteArray &soapAction, RequestHandler handler);
     class Private;
     Private *const d;
 };
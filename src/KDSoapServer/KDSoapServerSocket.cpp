@@ -27,17 +27,22 @@
 #include "KDSoapServerRawXMLInterface.h"
 #include "KDSoapServerCustomVerbRequestInterface.h"
 #include "KDSoapServer.h"
+#include "KDSoapServerHttp2_p.h"
 #include <KDSoapClient/KDSoapMessage.h>
 #include <KDSoapClient/KDSoapNamespaceManager.h>
 #include <KDSoapClient/KDSoapMessageReader_p.h>
 #include <KDSoapClient/KDSoapMessageWriter_p.h>
+#include <KDSoapClient/KDSoapMtom_p.h>
+#include <KDSoapClient/KDSoapBinaryEncoding_p.h>
 #include <QBuffer>
 #include <QThread>
 #include <QMetaMethod>
 #include <QFile>
 #include <QDir>
 #include <QFileInfo>
+#include <QTemporaryFile>
 #include <QVarLengthArray>
+#include <limits>
 
 KDSoapServerSocket::KDSoapServerSocket(KDSoapSocketList *owner, QObject *serverObject)
 #ifndef QT_NO_OPENSSL
@@ -52,7 +57,14 @@ KDSoapServerSocket::KDSoapServerSocket(KDSoapSocketList *owner, QObject *serverO
       m_receivedData(false),
       m_useRawXML(false),
       m_bytesReceived(0),
-      m_chunkStart(0)
+      m_chunkStart(0),
+      m_requestFile(0),
+      m_requestFileFailed(false),
+      m_http2(0),
+      m_http2Stream(0),
+      m_mtomResponse(false),
+      m_binaryResponse(false),
+      m_callFile(0)
 {
     connect(this, SIGNAL(readyRead()),
             this, SLOT(slotReadyRead()));
@@ -64,6 +76,9 @@ KDSoapServerSocket::~KDSoapServerSocket()
 {
     // same as m_owner->socketDeleted, but safe in case m_owner is deleted first
     emit socketDeleted(this);
+    releaseCallData();
+    delete m_requestFile;
+    delete m_http2;
 }
 
 typedef QMap<QByteArray, QByteArray> HeadersMap;
@@ -183,6 +198,24 @@ void KDSoapServerSocket::slotReadyRead()
         m_bytesReceived += nread;
     }
 
+    if (m_http2) {
+        handleHttp2Data();
+        return;
+    }
+    if (m_httpHeaders.isEmpty() && isHttp2Allowed()) {
+        // HTTP/2 with prior knowledge starts with the client connection preface instead of a request line
+        const KDSoapServerHttp2Connection::PrefaceCheck preface = KDSoapServerHttp2Connection::checkPreface(m_requestBuffer);
+        if (preface == KDSoapServerHttp2Connection::PartialPreface) {
+            return;
+        }
+        if (preface == KDSoapServerHttp2Connection::Preface) {
+            m_http2 = new KDSoapServerHttp2Connection;
+            m_http2->start();
+            handleHttp2Data();
+            return;
+        }
+    }
+
     KDSoapServerRawXMLInterface *rawXmlInterface = qobject_cast<KDSoapServerRawXMLInterface *>(m_serverObject);
 
     if (m_httpHeaders.isEmpty()) {
@@ -199,11 +232,23 @@ void KDSoapServerSocket::slotReadyRead()
         m_requestBuffer = receivedData;
         m_bytesReceived = receivedData.size();
         m_useRawXML = false;
+        m_requestFileFailed = false;
         if (rawXmlInterface) {
             KDSoapServerObjectInterface *serverObjectInterface = qobject_cast<KDSoapServerObjectInterface *>(m_serverObject);
             serverObjectInterface->setServerSocket(this);
             m_useRawXML = rawXmlInterface->newRequest(m_httpHeaders.value("_requestType"), m_httpHeaders);
         }
+        if (!m_useRawXML && m_httpHeaders.value("transfer-encoding") != "chunked") {
+            const qint64 maxInMemory = m_owner->server()->maxInMemoryRequestSize();
+            if (maxInMemory >= 0 && m_httpHeaders.value("content-length").toLongLong() > maxInMemory) {
+                if (startRequestFile(m_requestBuffer)) {
+                    if (!m_requestFile) {
+                        return; // write error, the connection is dropped
+                    }
+                    m_requestBuffer.clear();
+                }
+            }
+        }
     }
 
     if (m_doDebug) {
@@ -215,21 +260,34 @@ void KDSoapServerSocket::slotReadyRead()
         if (m_useRawXML) {
             rawXmlInterface->processXML(m_requestBuffer);
             m_requestBuffer.clear();
+        } else if (m_requestFile) {
+            if (!writeToRequestFile(m_requestBuffer)) {
+                return;
+            }
+            m_requestBuffer.clear();
         }
 
         const QByteArray contentLength = m_httpHeaders.value("content-length");
-        if (m_bytesReceived < contentLength.toInt()) {
+        if (m_bytesReceived < contentLength.toLongLong()) {
             return;    // incomplete request, wait for more data
         }
 
         if (m_useRawXML) {
             rawXmlInterface->endRequest();
+        } else if (m_requestFile) {
+            handleHttp1Request(m_httpHeaders, takeRequestFileData());
         } else {
-            handleRequest(m_httpHeaders, m_requestBuffer);
+            handleHttp1Request(m_httpHeaders, m_requestBuffer);
         }
     } else {
         //qDebug() << "requestBuffer has " << m_requestBuffer.size() << "bytes, starting at" << m_chunkStart;
+        const qint64 maxInMemory = m_useRawXML ? -1 : m_owner->server()->maxInMemoryRequestSize();
         while (m_chunkStart >= 0) {
+            if (m_requestFile && m_chunkStart > 0) {
+                // Don't keep the chunks which were written to the file
+                m_requestBuffer.remove(0, m_chunkStart);
+                m_chunkStart = 0;
+            }
             const int nextEOL = m_requestBuffer.indexOf("\r\n", m_chunkStart);
             if (nextEOL == -1) {
                 return;
@@ -254,8 +312,20 @@ void KDSoapServerSocket::slotReadyRead()
             const QByteArray chunk = m_requestBuffer.mid(nextEOL + 2, chunkSize);
             if (m_useRawXML) {
                 rawXmlInterface->processXML(chunk);
+            } else if (m_requestFile) {
+                if (!writeToRequestFile(chunk)) {
+                    return;
+                }
             } else {
                 m_decodedRequestBuffer += chunk;
+                if (maxInMemory >= 0 && !m_requestFileFailed && m_decodedRequestBuffer.size() > maxInMemory) {
+                    if (startRequestFile(m_decodedRequestBuffer)) {
+                        if (!m_requestFile) {
+                            return; // write error, the connection is dropped
+                        }
+                        m_decodedRequestBuffer.clear();
+                    }
+                }
             }
             m_chunkStart = nextEOL + 2 + chunkSize + 2;
         }
@@ -265,8 +335,10 @@ void KDSoapServerSocket::slotReadyRead()
         }
         if (m_useRawXML) {
             rawXmlInterface->endRequest();
+        } else if (m_requestFile) {
+            handleHttp1Request(m_httpHeaders, takeRequestFileData());
         } else {
-            handleRequest(m_httpHeaders, m_decodedRequestBuffer);
+            handleHttp1Request(m_httpHeaders, m_decodedRequestBuffer);
         }
         m_decodedRequestBuffer.clear();
         m_chunkStart = 0;
@@ -276,10 +348,171 @@ void KDSoapServerSocket::slotReadyRead()
     m_receivedData = 0;
 }
 
+bool KDSoapServerSocket::isHttp2Allowed() const
+{
+    // h2c only: over TLS, HTTP/2 is negotiated with ALPN
+    if (!(m_owner->server()->features() & KDSoapServer::Http2)) {
+        return false;
+    }
+#ifndef QT_NO_OPENSSL
+    if (mode() != QSslSocket::UnencryptedMode) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+void KDSoapServerSocket::handleHttp1Request(const QMap<QByteArray, QByteArray> &headers, const QByteArray &receivedData)
+{
+    if (!m_http2 && isHttp2Allowed() && KDSoapServerHttp2Connection::isUpgradeRequest(headers)) {
+        m_http2 = new KDSoapServerHttp2Connection;
+        m_http2->startWithUpgrade(headers, receivedData);
+        releaseCallData(); // the request data was copied
+        processHttp2Requests();
+        flushHttp2();
+        return;
+    }
+    handleRequest(headers, receivedData);
+}
+
+void KDSoapServerSocket::handleHttp2Data()
+{
+    const bool ok = m_http2->feed(m_requestBuffer);
+    m_requestBuffer.clear();
+    m_bytesReceived = 0;
+    processHttp2Requests();
+    flushHttp2();
+    if (!ok) {
+        disconnectFromHost();
+    }
+}
+
+// The streams are multiplexed on the connection, but the server object still handles one request at a time
+void KDSoapServerSocket::processHttp2Requests()
+{
+    KDSoapServerRawXMLInterface *rawXmlInterface = qobject_cast<KDSoapServerRawXMLInterface *>(m_serverObject);
+    while (!m_delayedResponse && m_http2->hasPendingRequest()) {
+        const KDSoapServerHttp2Connection::Request request = m_http2->takeRequest();
+        m_http2Stream = request.streamId;
+        bool useRawXML = false;
+        if (rawXmlInterface) {
+            KDSoapServerObjectInterface *serverObjectInterface = qobject_cast<KDSoapServerObjectInterface *>(m_serverObject);
+            serverObjectInterface->setServerSocket(this);
+            useRawXML = rawXmlInterface->newRequest(request.headers.value("_requestType"), request.headers);
+        }
+        if (useRawXML) {
+            rawXmlInterface->processXML(request.body);
+            rawXmlInterface->endRequest();
+        } else {
+            handleRequest(request.headers, request.body);
+        }
+        if (m_delayedResponse) {
+            return; // see sendDelayedReply
+        }
+        m_http2->finishResponse(m_http2Stream);
+        m_http2Stream = 0;
+        flushHttp2();
+    }
+}
+
+void KDSoapServerSocket::flushHttp2()
+{
+    const QByteArray output = m_http2->takeOutput();
+    if (!output.isEmpty()) {
+        write(output);
+    }
+}
+
+// All responses to requests go through here, to be sent as frames with HTTP/2
+qint64 KDSoapServerSocket::writeResponse(const char *data, qint64 size)
+{
+    if (!m_http2) {
+        return write(data, size);
+    }
+    if (m_http2Stream) {
+        m_http2->writeResponse(m_http2Stream, data, size);
+        flushHttp2();
+    }
+    return size;
+}
+
+qint64 KDSoapServerSocket::writeResponse(const QByteArray &data)
+{
+    return writeResponse(data.constData(), data.size());
+}
+
+// Returns false if the request has to stay in memory; the caller keeps its buffer then.
+bool KDSoapServerSocket::startRequestFile(const QByteArray &initialData)
+{
+    m_requestFile = new QTemporaryFile(QDir::tempPath() + QLatin1String("/kdsoap_request_XXXXXX"));
+    if (!m_requestFile->open()) {
+        qWarning() << "KDSoapServerSocket: could not create a temporary file for the request, keeping it in memory:" << m_requestFile->errorString();
+        delete m_requestFile;
+        m_requestFile = 0;
+        m_requestFileFailed = true; // don't try again for every chunk of this request
+        return false;
+    }
+    // On error, the connection is dropped and m_requestFile is reset
+    writeToRequestFile(initialData);
+    return true;
+}
+
+bool KDSoapServerSocket::writeToRequestFile(const QByteArray &data)
+{
+    if (m_requestFile->write(data) == data.size()) {
+        return true;
+    }
+    // e.g. disk full. The rest of the request can't be handled, so drop the connection.
+    qWarning() << "KDSoapServerSocket: error writing the request to" << m_requestFile->fileName() << ":" << m_requestFile->errorString();
+    const QByteArray serverError = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+    write(serverError);
+    delete m_requestFile;
+    m_requestFile = 0;
+    m_requestBuffer.clear();
+    m_decodedRequestBuffer.clear();
+    m_httpHeaders.clear();
+    m_chunkStart = 0;
+    disconnectFromHost();
+    return false;
+}
+
+// Returns the request body held by m_requestFile, without copying it into memory.
+// The data stays valid until releaseCallData() is called.
+QByteArray KDSoapServerSocket::takeRequestFileData()
+{
+    releaseCallData();
+    m_callFile = m_requestFile;
+    m_requestFile = 0;
+    m_callFile->flush();
+    const qint64 size = m_callFile->size();
+    if (size > std::numeric_limits<int>::max()) { // QByteArray limit
+        qWarning() << "KDSoapServerSocket: request too large:" << size << "bytes";
+        return QByteArray();
+    }
+    uchar *data = size > 0 ? m_callFile->map(0, size) : 0;
+    if (!data) {
+        // mapping not supported by this file system, fall back to reading it
+        m_callFile->seek(0);
+        return m_callFile->readAll();
+    }
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(data), int(size));
+}
+
+void KDSoapServerSocket::releaseCallData()
+{
+    // First the devices referencing the mapped file, then the file
+    m_mtomPackage = KDSoapMtomPackage();
+    delete m_callFile;
+    m_callFile = 0;
+}
+
 void KDSoapServerSocket::handleRequest(const QMap<QByteArray, QByteArray> &httpHeaders, const QByteArray &receivedData)
 {
     const QByteArray requestType = httpHeaders.value("_requestType");
     const QString path = QString::fromLatin1(httpHeaders.value("_path").constData());
+    m_mtomResponse = false;
+    // A KDSoap client announcing the binary encoding can read it, whatever the request used
+    m_binaryResponse = KDSoapBinaryEncoding::acceptsBinary(httpHeaders.value("accept"));
 
     KDSoapServerAuthInterface *serverAuthInterface = qobject_cast<KDSoapServerAuthInterface *>(m_serverObject);
     if (serverAuthInterface) {
@@ -287,7 +520,7 @@ void KDSoapServerSocket::handleRequest(const QMap<QByteArray, QByteArray> &httpH
         if (!serverAuthInterface->handleHttpAuth(authValue, path)) {
             // send auth request (Qt supports basic, ntlm and digest)
             const QByteArray unauthorized = "HTTP/1.1 401 Authorization Required\r\nWWW-Authenticate: Basic realm=\"example\"\r\nContent-Length: 0\r\n\r\n";
-            write(unauthorized);
+            writeResponse(unauthorized);
             return;
         }
     }
@@ -296,14 +529,14 @@ void KDSoapServerSocket::handleRequest(const QMap<QByteArray, QByteArray> &httpH
         KDSoapServerCustomVerbRequestInterface *serverCustomRequest = qobject_cast<KDSoapServerCustomVerbRequestInterface *>(m_serverObject);
         QByteArray customVerbRequestAnswer;
         if (serverCustomRequest && serverCustomRequest->processCustomVerbRequest(requestType, receivedData, httpHeaders, customVerbRequestAnswer)) {
-            write(customVerbRequestAnswer);
+            writeResponse(customVerbRequestAnswer);
             return;
         } else {
             qWarning() << "Unknown HTTP request:" << requestType;
             //handleError(replyMsg, "Client.Data", QString::fromLatin1("Invalid request type '%1', should be GET or POST").arg(QString::fromLatin1(requestType.constData())));
             //sendReply(0, replyMsg);
             const QByteArray methodNotAllowed = "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET POST\r\nContent-Length: 0\r\n\r\n";
-            write(methodNotAllowed);
+            writeResponse(methodNotAllowed);
             return;
         }
     }
@@ -337,29 +570,46 @@ void KDSoapServerSocket::handleRequest(const QMap<QByteArray, QByteArray> &httpH
         return;
     }
 
-    //parse message
-    KDSoapMessage requestMsg;
-    KDSoapHeaders requestHeaders;
-    KDSoapMessageReader reader;
-    KDSoapMessageReader::XmlError err = reader.xmlToMessage(receivedData, &requestMsg, &m_messageNamespace, &requestHeaders, KDSoap::SOAP1_1);
-    if (err == KDSoapMessageReader::PrematureEndOfDocumentError) {
-        //qDebug() << "Incomplete SOAP message, wait for more data";
-        // This should never happen, since we check for content-size above.
-        return;
-    } //TODO handle parse errors?
+    // MTOM: the envelope is the root part, binary values are in the other parts
+    const QByteArray contentType = httpHeaders.value("content-type");
+    QByteArray soapContentType = contentType;
+    QByteArray requestData = receivedData;
+    KDSoapMtomPackage &mtomPackage = m_mtomPackage;
+    mtomPackage = KDSoapMtomPackage();
+    if (m_callFile) {
+        // receivedData is the mapped file, which lives as long as the package: large parts can be exposed as devices
+        mtomPackage.setDeviceThreshold(server->maxInMemoryRequestSize());
+    }
+    if (KDSoapMtomPackage::isMultipart(contentType)) {
+        QByteArray rootPart;
+        if (mtomPackage.parse(contentType, receivedData, &rootPart)) {
+            requestData = rootPart;
+            soapContentType = mtomPackage.startInfo();
+            m_mtomResponse = true;
+        } else {
+            handleError(replyMsg, "Client.Data", QString::fromLatin1("Invalid multipart request"));
+            sendReply(0, replyMsg);
+            return;
+        }
+    }
 
     // check soap version and extract soapAction header
     QByteArray soapAction;
-    const QByteArray contentType = httpHeaders.value("content-type");
-    if (contentType.startsWith("text/xml")) { //krazy:exclude=strings
+    const bool binaryRequest = KDSoapBinaryEncoding::isBinaryContentType(contentType);
+    if (binaryRequest) {
+        // The binary encoding has no envelope, the action is in the header as with SOAP 1.1
+        soapAction = stripQuotes(httpHeaders.value("soapaction"));
+        m_binaryResponse = true;
+    } else if (soapContentType.startsWith("text/xml")) { //krazy:exclude=strings
         // SOAP 1.1
         soapAction = httpHeaders.value("soapaction");
         // The SOAP standard allows quotation marks around the SoapAction, so we have to get rid of these.
         soapAction = stripQuotes(soapAction);
 
-    } else if (contentType.startsWith("application/soap+xml")) { //krazy:exclude=strings
+    } else if (soapContentType.startsWith("application/soap+xml")) { //krazy:exclude=strings
         // SOAP 1.2
         // Example: application/soap+xml;charset=utf-8;action=ActionHex
+        // (with MTOM, the action is a parameter of the multipart/related content type)
         const QList<QByteArray> parts = contentType.split(';');
         Q_FOREACH (const QByteArray &part, parts) {
             if (part.trimmed().startsWith("action=")) { //krazy:exclude=strings
@@ -368,6 +618,26 @@ void KDSoapServerSocket::handleRequest(const QMap<QByteArray, QByteArray> &httpH
         }
     }
 
+    //parse message
+    KDSoapMessage requestMsg;
+    KDSoapHeaders requestHeaders;
+    KDSoapMessageReader reader;
+    if (path == server->path()) { // otherwise processRequestWithPath needs the full message
+        reader.setBodyParser(serverObjectInterface->requestBodyParser(soapAction));
+    }
+    reader.setMtomPackage(&mtomPackage);
+    KDSoapMessageReader::XmlError err;
+    if (binaryRequest) {
+        err = reader.binaryToMessage(requestData, &requestMsg, &m_messageNamespace, &requestHeaders, KDSoap::SOAP1_1);
+    } else {
+        err = reader.xmlToMessage(requestData, &requestMsg, &m_messageNamespace, &requestHeaders, KDSoap::SOAP1_1);
+    }
+    if (err == KDSoapMessageReader::PrematureEndOfDocumentError) {
+        //qDebug() << "Incomplete SOAP message, wait for more data";
+        // This should never happen, since we check for content-size above.
+        return;
+    } //TODO handle parse errors?
+
     m_method = requestMsg.name();
 
     if (!replyMsg.isFault()) {
@@ -391,8 +661,8 @@ bool KDSoapServerSocket::handleWsdlDownload()
         //qDebug() << "Returning wsdl file contents";
         const QByteArray responseText = wf.readAll();
         const QByteArray response = httpResponseHeaders(false, "application/xml", responseText.size(), m_serverObject);
-        write(response);
-        write(responseText);
+        writeResponse(response);
+        writeResponse(responseText);
         return true;
     }
     return false;
@@ -404,12 +674,12 @@ bool KDSoapServerSocket::handleFileDownload(KDSoapServerObjectInterface *serverO
     QIODevice *device = serverObjectInterface->processFileRequest(path, contentType);
     if (!device) {
         const QByteArray notFound = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
-        write(notFound);
+        writeResponse(notFound);
         return true;
     }
     if (!device->open(QIODevice::ReadOnly)) {
         const QByteArray forbidden = "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n\r\n";
-        write(forbidden);
+        writeResponse(forbidden);
         delete device;
         return true; // handled!
     }
@@ -417,7 +687,7 @@ bool KDSoapServerSocket::handleFileDownload(KDSoapServerObjectInterface *serverO
     if (m_doDebug) {
         qDebug() << "KDSoapServerSocket: file download response" << response;
     }
-    qint64 written = write(response);
+    qint64 written = writeResponse(response);
     Q_ASSERT(written == response.size()); // Please report a bug if you hit this.
     Q_UNUSED(written);
 
@@ -429,7 +699,7 @@ bool KDSoapServerSocket::handleFileDownload(KDSoapServerObjectInterface *serverO
             break;
         }
         totalRead += in;
-        if (in != write(block, in)) {
+        if (in != writeResponse(block, in)) {
             //error = true;
             break;
         }
@@ -444,15 +714,15 @@ bool KDSoapServerSocket::handleFileDownload(KDSoapServerObjectInterface *serverO
     return true;
 }
 
-void KDSoapServerSocket::writeXML(const QByteArray &xmlResponse, bool isFault)
+void KDSoapServerSocket::writeXML(const QByteArray &xmlResponse, bool isFault, const QByteArray &contentType)
 {
-    const QByteArray httpHeaders = httpResponseHeaders(isFault, "text/xml", xmlResponse.size(), m_serverObject); // TODO return application/soap+xml;charset=utf-8 instead for SOAP 1.2
+    const QByteArray httpHeaders = httpResponseHeaders(isFault, contentType, xmlResponse.size(), m_serverObject); // TODO return application/soap+xml;charset=utf-8 instead for SOAP 1.2
     if (m_doDebug) {
         qDebug() << "KDSoapServerSocket: writing" << httpHeaders << xmlResponse;
     }
-    qint64 written = write(httpHeaders);
+    qint64 written = writeResponse(httpHeaders);
     Q_ASSERT(written == httpHeaders.size()); // Please report a bug if you hit this.
-    written = write(xmlResponse);
+    written = writeResponse(xmlResponse);
     Q_ASSERT(written == xmlResponse.size()); // Please report a bug if you hit this.
     Q_UNUSED(written);
     // flush() ?
@@ -463,8 +733,13 @@ void KDSoapServerSocket::sendReply(KDSoapServerObjectInterface *serverObjectInte
     const bool isFault = replyMsg.isFault();
 
     QByteArray xmlResponse;
+    QByteArray contentType = "text/xml";
     if (!replyMsg.isNull()) {
         KDSoapMessageWriter msgWriter;
+        KDSoapMtomPackage mtomPackage;
+        if (m_mtomResponse) {
+            msgWriter.setMtomPackage(&mtomPackage);
+        }
         // Note that the kdsoap client parsing code doesn't care for the name (except if it's fault), even in
         // Document mode. Other implementations do, though.
         QString responseName = isFault ? QString::fromLatin1("Fault") : replyMsg.name();
@@ -480,10 +755,19 @@ void KDSoapServerSocket::sendReply(KDSoapServerObjectInterface *serverObjectInte
             }
         }
         msgWriter.setMessageNamespace(responseNamespace);
-        xmlResponse = msgWriter.messageToXml(replyMsg, responseName, responseHeaders, QMap<QString, KDSoapMessage>());
+        if (m_binaryResponse && KDSoapBinaryEncoding::canEncode(replyMsg)) {
+            xmlResponse = msgWriter.messageToBinary(replyMsg, responseName, responseHeaders, QMap<QString, KDSoapMessage>());
+            contentType = KDSoapBinaryEncoding::contentType();
+        } else {
+            xmlResponse = msgWriter.messageToXml(replyMsg, responseName, responseHeaders, QMap<QString, KDSoapMessage>());
+        }
+        if (mtomPackage.hasAttachments()) {
+            xmlResponse = mtomPackage.toMultipart(xmlResponse, KDSoap::SOAP1_1);
+            contentType = mtomPackage.contentType(KDSoap::SOAP1_1, QString());
+        }
     }
 
-    writeXML(xmlResponse, isFault);
+    writeXML(xmlResponse, isFault, contentType);
 
     // All done, check if we should log this
     KDSoapServer *server = m_owner->server();
@@ -499,12 +783,20 @@ void KDSoapServerSocket::sendReply(KDSoapServerObjectInterface *serverObjectInte
             }
         }
     }
+
+    // The request values can't refer to the request data anymore
+    releaseCallData();
 }
 
 void KDSoapServerSocket::sendDelayedReply(KDSoapServerObjectInterface *serverObjectInterface, const KDSoapMessage &replyMsg)
 {
     sendReply(serverObjectInterface, replyMsg);
     m_delayedResponse = false;
+    if (m_http2) {
+        m_http2->finishResponse(m_http2Stream);
+        m_http2Stream = 0;
+        flushHttp2();
+    }
     setSocketEnabled(true);
 }
 
@@ -31,13 +31,16 @@
 #endif
 
 #include <QMap>
+#include <KDSoapClient/KDSoapMtom_p.h>
 QT_BEGIN_NAMESPACE
 class QObject;
+class QTemporaryFile;
 QT_END_NAMESPACE
 class KDSoapSocketList;
 class KDSoapServerObjectInterface;
 class KDSoapMessage;
 class KDSoapHeaders;
+class KDSoapServerHttp2Connection;
 
 class KDSoapServerSocket
 #ifndef QT_NO_OPENSSL
@@ -61,6 +64,7 @@ private Q_SLOTS:
     void slotReadyRead();
 
 private:
+    void handleHttp1Request(const QMap<QByteArray, QByteArray> &headers, const QByteArray &receivedData);
     void handleRequest(const QMap<QByteArray, QByteArray> &headers, const QByteArray &receivedData);
     bool handleWsdlDownload();
     bool handleFileDownload(KDSoapServerObjectInterface *serverObjectInterface, const QString &path);
@@ -70,7 +74,17 @@ private:
                   const QByteArray &soapAction, const QString &path);
     void handleError(KDSoapMessage &replyMsg, const char *errorCode, const QString &error);
     void setSocketEnabled(bool enabled);
-    void writeXML(const QByteArray &xmlResponse, bool isFault);
+    void writeXML(const QByteArray &xmlResponse, bool isFault, const QByteArray &contentType = "text/xml");
+    qint64 writeResponse(const char *data, qint64 size);
+    qint64 writeResponse(const QByteArray &data);
+    bool isHttp2Allowed() const;
+    void handleHttp2Data();
+    void processHttp2Requests();
+    void flushHttp2();
+    bool startRequestFile(const QByteArray &initialData);
+    bool writeToRequestFile(const QByteArray &data);
+    QByteArray takeRequestFileData();
+    void releaseCallData();
     friend class KDSoapServerObjectInterface;
 
     KDSoapSocketList *m_owner;
@@ -82,15 +96,25 @@ private:
 
     // Current request being assembled
     bool m_useRawXML;
-    int m_bytesReceived;
+    qint64 m_bytesReceived;
     int m_chunkStart;
     QMap<QByteArray, QByteArray> m_httpHeaders;
     QByteArray m_requestBuffer;
     QByteArray m_decodedRequestBuffer; // used for chunked transfer encoding only
+    QTemporaryFile *m_requestFile; // the body, if it's larger than KDSoapServer::maxInMemoryRequestSize()
+    bool m_requestFileFailed; // the temporary file couldn't be created, the body stays in memory
+
+    // HTTP/2, once the connection switched to it
+    KDSoapServerHttp2Connection *m_http2;
+    quint32 m_http2Stream; // the stream of the request being handled
 
     // Data for the current call (stored here for delayed replies)
     QString m_messageNamespace;
     QString m_method;
+    bool m_mtomResponse; // the request used MTOM, so the reply does too
+    bool m_binaryResponse; // the client can read the binary encoding
+    QTemporaryFile *m_callFile; // the request body (memory-mapped), for large requests
+    KDSoapMtomPackage m_mtomPackage; // its parts can be referenced by the request values, as devices
 };
 
 #endif // KDSOAPSERVERSOCKET_P_H
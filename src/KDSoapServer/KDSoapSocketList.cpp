@@ -24,6 +24,9 @@
 #include "KDSoapServerSocket_p.h"
 #include "KDSoapServer.h"
 #include <QDebug>
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#endif
 
 KDSoapSocketList::KDSoapSocketList(KDSoapServer *server)
     : m_server(server), m_serverObject(server->createServerObject()), m_totalConnectionCount(0)
@@ -37,13 +40,29 @@ KDSoapSocketList::~KDSoapSocketList()
     delete m_serverObject;
 }
 
+#ifndef QT_NO_OPENSSL
+// Connections accepted by KDSoapServer::listenOnLocalSocket(), which don't use SSL
+static bool isLocalSocket(int socketDescriptor)
+{
+#ifdef Q_OS_UNIX
+    struct sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    return getsockname(socketDescriptor, reinterpret_cast<struct sockaddr *>(&address), &length) == 0
+           && address.ss_family == AF_UNIX;
+#else
+    Q_UNUSED(socketDescriptor);
+    return false;
+#endif
+}
+#endif
+
 KDSoapServerSocket *KDSoapSocketList::handleIncomingConnection(int socketDescriptor)
 {
     KDSoapServerSocket *socket = new KDSoapServerSocket(this, m_serverObject);
     socket->setSocketDescriptor(socketDescriptor);
 
 #ifndef QT_NO_OPENSSL
-    if (m_server->features() & KDSoapServer::Ssl) {
+    if ((m_server->features() & KDSoapServer::Ssl) && !isLocalSocket(socketDescriptor)) {
         // We could call a virtual "m_server->setSslConfiguration(socket)" here,
         // if more control is needed (e.g. due to SNI)
         if (!m_server->sslConfiguration().isNull()) {
@@ -22,7 +22,14 @@
 **********************************************************************/
 
 #include "KDSoapValue.h"
+#include "KDSoapNamespaceManager.h"
 #include "KDDateTime.h"
+#include "KDSoapBinaryCodec.h"
+#include "KDSoapBodyWriter.h"
+#include "KDSoapNumericCodec.h"
+#include "KDSoapRequestDevice_p.h"
+#include <QBuffer>
+#include <QXmlStreamWriter>
 #include <QTest>
 
 class Basic : public QObject
@@ -65,6 +72,270 @@ private Q_SLOTS:
         kdt.setTimeZone(QString::fromLatin1("+01:00"));
         QCOMPARE(kdt.toDateString(), QString::fromLatin1("2011-03-15T23:59:59.999+01:00"));
     }
+
+    void testEncodedBinaryValue()
+    {
+        const QByteArray data("KDSoap");
+        KDSoapValue value = KDSoapValue::fromEncodedBinary(QLatin1String("data"), data.toBase64(), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
+        QVERIFY(value.isEncodedBinaryValue());
+        QCOMPARE(value.value().toByteArray(), data.toBase64());
+        // Written as is, not encoded a second time
+        QVERIFY(value.toXml().contains("<data>S0RTb2Fw</data>"));
+
+        value.setValue(data);
+        QVERIFY(!value.isEncodedBinaryValue());
+        QVERIFY(value.toXml().contains("<data>S0RTb2Fw</data>"));
+    }
+
+    void testBinaryCodec()
+    {
+        // Sizes around the SIMD block sizes, so that both the vectorized loops and the scalar tails are used
+        qsrand(42);
+        for (int size = 0; size < 200; ++size) {
+            QByteArray data;
+            data.resize(size);
+            for (int i = 0; i < size; ++i) {
+                data[i] = char(qrand() & 0xff);
+            }
+            const QByteArray base64 = data.toBase64();
+            const QByteArray hex = data.toHex();
+            QCOMPARE(KDSoapBinaryCodec::toBase64(data), base64);
+            QCOMPARE(KDSoapBinaryCodec::toHex(data), hex);
+            QCOMPARE(KDSoapBinaryCodec::fromBase64(base64), data);
+            QCOMPARE(KDSoapBinaryCodec::fromBase64(QString::fromLatin1(base64)), data);
+            QCOMPARE(KDSoapBinaryCodec::fromBase64Value(QVariant(base64)), data);
+            QCOMPARE(KDSoapBinaryCodec::fromHex(hex), data);
+            QCOMPARE(KDSoapBinaryCodec::fromHex(QString::fromLatin1(hex.toUpper())), data);
+            QCOMPARE(KDSoapBinaryCodec::fromHexValue(QVariant(QString::fromLatin1(hex))), data);
+
+            // Line breaks and other invalid characters are skipped, like QByteArray does
+            QByteArray wrapped = base64;
+            for (int pos = 76; pos < wrapped.size(); pos += 77) {
+                wrapped.insert(pos, '\n');
+            }
+            QCOMPARE(KDSoapBinaryCodec::fromBase64(wrapped), QByteArray::fromBase64(wrapped));
+            const QByteArray spacedHex = hex + " 4";
+            QCOMPARE(KDSoapBinaryCodec::fromHex(spacedHex), QByteArray::fromHex(spacedHex));
+        }
+    }
+
+    void testNumericCodec_data()
+    {
+        QTest::addColumn<QString>("text");
+
+        QTest::newRow("zero") << QString::fromLatin1("0");
+        QTest::newRow("positive") << QString::fromLatin1("+42");
+        QTest::newRow("negative") << QString::fromLatin1("-42");
+        QTest::newRow("spaces") << QString::fromLatin1(" 12\n");
+        QTest::newRow("int_max") << QString::fromLatin1("2147483647");
+        QTest::newRow("int_overflow") << QString::fromLatin1("2147483648");
+        QTest::newRow("long_min") << QString::fromLatin1("-9223372036854775808");
+        QTest::newRow("long_overflow") << QString::fromLatin1("9223372036854775808");
+        QTest::newRow("ulong_max") << QString::fromLatin1("18446744073709551615");
+        QTest::newRow("ulong_overflow") << QString::fromLatin1("18446744073709551616");
+        QTest::newRow("decimal") << QString::fromLatin1("3.14159");
+        QTest::newRow("small") << QString::fromLatin1("-0.1e-3");
+        QTest::newRow("exponent") << QString::fromLatin1("1E5");
+        QTest::newRow("large_exponent") << QString::fromLatin1("1e300");
+        QTest::newRow("many_digits") << QString::fromLatin1("0.30000000000000004441");
+        QTest::newRow("empty") << QString();
+        QTest::newRow("sign_only") << QString::fromLatin1("-");
+        QTest::newRow("garbage") << QString::fromLatin1("12abc");
+    }
+
+    void testNumericCodec()
+    {
+        QFETCH(QString, text);
+        const QString trimmed = text.trimmed();
+
+        qint64 longValue;
+        bool ok;
+        const qint64 expectedLong = trimmed.toLongLong(&ok);
+        QCOMPARE(KDSoapNumericCodec::parse(text.constData(), text.size(), &longValue), ok);
+        if (ok) {
+            QCOMPARE(longValue, expectedLong);
+        }
+        quint64 ulongValue;
+        const quint64 expectedULong = trimmed.toULongLong(&ok);
+        if (trimmed.startsWith(QLatin1Char('-'))) {
+            ok = false; // not consistent across Qt versions
+        }
+        QCOMPARE(KDSoapNumericCodec::parse(text.constData(), text.size(), &ulongValue), ok);
+        if (ok) {
+            QCOMPARE(ulongValue, expectedULong);
+        }
+        int intValue;
+        const int expectedInt = trimmed.toInt(&ok);
+        QCOMPARE(KDSoapNumericCodec::parse(text.constData(), text.size(), &intValue), ok);
+        if (ok) {
+            QCOMPARE(intValue, expectedInt);
+        }
+        double doubleValue;
+        const double expectedDouble = trimmed.toDouble(&ok);
+        QCOMPARE(KDSoapNumericCodec::parse(text.constData(), text.size(), &doubleValue), ok);
+        if (ok) {
+            QCOMPARE(doubleValue, expectedDouble); // exactly, not fuzzy
+        }
+        // The fallback is QVariant's conversion
+        QCOMPARE(KDSoapNumericCodec::fromText<int>(text), QVariant(text).value<int>());
+        QCOMPARE(KDSoapNumericCodec::fromVariant<double>(QVariant(text)), QVariant(text).value<double>());
+        QCOMPARE(KDSoapNumericCodec::fromVariant<int>(QVariant(12)), 12);
+    }
+
+    void testNumericCodecSpecialValues()
+    {
+        static const QString inf = QString::fromLatin1("-INF");
+        double value;
+        QVERIFY(KDSoapNumericCodec::parse(inf.constData(), inf.size(), &value));
+        QVERIFY(qIsInf(value) && value < 0);
+        static const QString nan = QString::fromLatin1("NaN");
+        QVERIFY(KDSoapNumericCodec::parse(nan.constData(), nan.size(), &value));
+        QVERIFY(qIsNaN(value));
+        QCOMPARE(KDSoapNumericCodec::fromText<float>(QString::fromLatin1("1.5")), 1.5f);
+        QCOMPARE(KDSoapNumericCodec::fromText<bool>(QString::fromLatin1("true")), true);
+        QCOMPARE(KDSoapNumericCodec::fromText<bool>(QString::fromLatin1(" 0 ")), false);
+        QCOMPARE(KDSoapNumericCodec::fromText<uchar>(QString::fromLatin1("255")), uchar(255));
+        QCOMPARE(KDSoapNumericCodec::fromText<signed char>(QString::fromLatin1("-128")), static_cast<signed char>(-128));
+
+        char buffer[KDSoapNumericCodec::MaxIntegerLength];
+        const qint64 longValues[] = { 0, 7, -1, 1234567890, Q_INT64_C(-9223372036854775807) - 1, Q_INT64_C(9223372036854775807) };
+        for (uint i = 0; i < sizeof(longValues) / sizeof(*longValues); ++i) {
+            const int length = KDSoapNumericCodec::format(longValues[i], buffer);
+            QCOMPARE(QByteArray(buffer, length), QByteArray::number(longValues[i]));
+        }
+        const quint64 ulongMax = Q_UINT64_C(18446744073709551615);
+        QCOMPARE(QByteArray(buffer, KDSoapNumericCodec::format(ulongMax, buffer)), QByteArray::number(ulongMax));
+    }
+
+    void testWriteText_data()
+    {
+        QTest::addColumn<QString>("text");
+
+        QTest::newRow("empty") << QString();
+        QTest::newRow("plain") << QString::fromLatin1("Hello World, this is plain text with 0123456789");
+        QTest::newRow("whitespace") << QString::fromLatin1("line one\n\tline two\r\n");
+        QTest::newRow("markup") << QString::fromLatin1("a < b && c > d \"quoted\" 'single'");
+        QTest::newRow("markup_at_end") << QString::fromLatin1("0123456789abcdef<");
+        QTest::newRow("non_ascii") << QString::fromUtf8("caf\xc3\xa9 \xe2\x82\xac");
+        QTest::newRow("long") << QString(3000, QLatin1Char('x'));
+    }
+
+    // The fast path must give the same bytes as QXmlStreamWriter::writeCharacters
+    void testWriteText()
+    {
+        QFETCH(QString, text);
+        QByteArray expected;
+        {
+            QXmlStreamWriter writer(&expected);
+            writer.writeStartElement(QLatin1String("e"));
+            writer.writeCharacters(text);
+            writer.writeEndElement();
+        }
+        QByteArray actual;
+        {
+            QXmlStreamWriter writer(&actual);
+            writer.writeStartElement(QLatin1String("e"));
+            KDSoapBodyWriter::writeText(writer, text, QString(), QString());
+            writer.writeEndElement();
+        }
+        QCOMPARE(actual, expected);
+    }
+
+    static KDSoapValue encodedTestValue(int count)
+    {
+        KDSoapValueList children;
+        for (int i = 0; i < count; ++i) {
+            children.append(KDSoapValue(QLatin1String("id"), i, KDSoapNamespaceManager::xmlSchema2001(), QLatin1String("int")));
+            children.append(KDSoapValue(QLatin1String("name"), QString::fromLatin1("item"), KDSoapNamespaceManager::xmlSchema2001(), QLatin1String("string")));
+        }
+        KDSoapValue array(QLatin1String("names"), QVariant(), KDSoapNamespaceManager::soapEncoding(), QLatin1String("Array"));
+        array.childValues().setArrayType(KDSoapNamespaceManager::xmlSchema2001(), QLatin1String("string"));
+        array.childValues().append(KDSoapValue(QLatin1String("item"), QString::fromLatin1("a"), KDSoapNamespaceManager::xmlSchema2001(), QLatin1String("string")));
+        array.childValues().append(KDSoapValue(QLatin1String("item"), QString::fromLatin1("b"), KDSoapNamespaceManager::xmlSchema2001(), QLatin1String("string")));
+        children.append(array);
+        return KDSoapValue(QLatin1String("items"), children);
+    }
+
+    // The qualified type names are cached for the whole message write
+    void testEncodedValueTypes()
+    {
+        const QByteArray xml = encodedTestValue(3).toXml(KDSoapValue::EncodedUse);
+        QCOMPARE(xml.count("<id xsi:type=\"xsd:int\">"), 3);
+        QCOMPARE(xml.count("<name xsi:type=\"xsd:string\">item</name>"), 3);
+        QVERIFY(xml.contains("<names xsi:type=\"soap-enc:Array\" soap-enc:arrayType=\"xsd:string[2]\">"));
+        QCOMPARE(xml.count("<item xsi:type=\"xsd:string\">"), 2);
+    }
+
+    // Writing many typed values: with use=encoded, each one gets an xsi:type attribute
+    void benchmarkValueToXml_data()
+    {
+        QTest::addColumn<bool>("encoded");
+        QTest::newRow("literal") << false;
+        QTest::newRow("encoded") << true;
+    }
+
+    void benchmarkValueToXml()
+    {
+        QFETCH(bool, encoded);
+        const KDSoapValue value = encodedTestValue(500);
+        QBENCHMARK {
+            const QByteArray xml = value.toXml(encoded ? KDSoapValue::EncodedUse : KDSoapValue::LiteralUse);
+            Q_UNUSED(xml);
+        }
+    }
+
+    void testBinaryDeviceValue()
+    {
+        QBuffer buffer;
+        buffer.setData(QByteArray("xxKDSoap"));
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        QVERIFY(buffer.seek(2)); // the data starts at the current position
+        KDSoapValue value(QLatin1String("data"), QVariant(), KDSoapNamespaceManager::xmlSchema2001(), QLatin1String("base64Binary"));
+        value.setBinaryDevice(&buffer);
+        QCOMPARE(value.binaryDevice(), static_cast<QIODevice *>(&buffer));
+        QVERIFY(!value.isNil());
+        // Outside of a request, the device is simply read
+        QVERIFY(value.toXml().contains("<data>S0RTb2Fw</data>"));
+        QCOMPARE(buffer.pos(), qint64(2));
+        value.setValue(QVariant());
+        QVERIFY(!value.binaryDevice());
+    }
+
+    void testRequestDevice()
+    {
+        QByteArray binary;
+        for (int i = 0; i < 200000; ++i) { // several chunks
+            binary.append(char(i * 13));
+        }
+        QBuffer source1;
+        source1.setData(binary);
+        QVERIFY(source1.open(QIODevice::ReadOnly));
+        QBuffer source2;
+        source2.setData(binary.left(1001));
+        QVERIFY(source2.open(QIODevice::ReadOnly));
+
+        KDSoapRequestDevice device;
+        device.insertDevice(6, &source1);
+        device.appendXml("<data></data>");
+        device.appendData("--");
+        device.appendDevice(&source2, KDSoapRequestDevice::Raw);
+        QVERIFY(device.hasDevices());
+        const QByteArray expected = "<data>" + binary.toBase64() + "</data>--" + binary.left(1001);
+        QCOMPARE(device.size(), qint64(expected.size()));
+
+        QVERIFY(device.open(QIODevice::ReadOnly));
+        QCOMPARE(device.readAll(), expected);
+        QVERIFY(device.atEnd());
+
+        // Seeking, e.g. when QNetworkAccessManager resends the request
+        const qint64 positions[] = { 0, 3, 6, 7, 9, 10, 65541, 65542, 100000, expected.size() - 1001, expected.size() - 5 };
+        for (uint i = 0; i < sizeof(positions) / sizeof(*positions); ++i) {
+            const qint64 pos = positions[i];
+            QVERIFY(device.seek(pos));
+            QCOMPARE(device.read(10), expected.mid(pos, 10));
+            QCOMPARE(device.readAll(), expected.mid(pos + 10));
+        }
+    }
 };
 
 QTEST_MAIN(Basic)
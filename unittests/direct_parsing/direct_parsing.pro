@@ -0,0 +1,13 @@
+KDWSDL_OPTIONS = -server -direct-parsing -direct-writing
+include( $${TOP_SOURCE_DIR}/unittests/unittests.pri )
+QT += network xml
+SOURCES = test_direct_parsing.cpp
+test.target = test
+test.commands = ./$(TARGET)
+test.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += test
+
+KDWSDL = direct_parsing.wsdl
+
+OTHER_FILES = $$KDWSDL
+LIBS        += -L$${TOP_BUILD_DIR}/lib -l$$KDSOAPSERVERLIB
@@ -0,0 +1,227 @@
+/****************************************************************************
+** Copyright (C) 2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+
+#include "wsdl_direct_parsing.h"
+
+#include "httpserver_p.h"
+#include <KDSoapServer.h>
+#include <QTest>
+#include <QEventLoop>
+#include <QDebug>
+
+using namespace KDSoapUnitTestHelpers;
+
+class DirectParsingServerObject : public DirectParsingServerBase
+{
+public:
+    virtual TNS__GetItemsResponse getItems(const TNS__GetItems &parameters)
+    {
+        m_receivedQuery = parameters.query();
+        m_receivedLimit = parameters.limit();
+        m_receivedFilterCount = parameters.filter().count();
+        TNS__Item item;
+        item.setName(QString::fromLatin1("Answer to ") + parameters.query());
+        item.setCount(42);
+        item.setData(QByteArray("hello"));
+        TNS__GetItemsResponse response;
+        response.setItem(QList<TNS__Item>() << item);
+        response.setTotal(1);
+        response.setStatus(QString::fromLatin1("ok"));
+        return response;
+    }
+
+    QString m_receivedQuery;
+    int m_receivedLimit;
+    int m_receivedFilterCount;
+};
+
+class DirectParsingServer : public KDSoapServer
+{
+    Q_OBJECT
+public:
+    DirectParsingServer() : KDSoapServer(), m_lastServerObject(0)
+    {
+        setPath(QLatin1String("/directparsing"));
+    }
+    virtual QObject *createServerObject()
+    {
+        m_lastServerObject = new DirectParsingServerObject;
+        return m_lastServerObject;
+    }
+    DirectParsingServerObject *lastServerObject()
+    {
+        return m_lastServerObject;
+    }
+private:
+    DirectParsingServerObject *m_lastServerObject;
+};
+
+class DirectParsingTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testSyncCall()
+    {
+        HttpServerThread server(getItemsResponse(), HttpServerThread::Public);
+        DirectParsing service;
+        service.setEndPoint(server.endPoint());
+
+        const TNS__GetItemsResponse response = service.getItems(getItemsParameters());
+        QVERIFY2(service.lastError().isEmpty(), qPrintable(service.lastError()));
+        checkResponse(response);
+
+        // The request is written by the generated writeTo(), it must look the same as with serialize()
+        const QByteArray expectedRequest = QByteArray(xmlEnvBegin11()) + "><soap:Body>"
+                                           "<n1:getItems xmlns:n1=\"http://www.kdab.com/directparsing/\" mode=\"fast\">"
+                                           "<n1:query>foo</n1:query>"
+                                           "<n1:limit>10</n1:limit>"
+                                           "<n1:filter><n1:name>A &amp; B</n1:name><n1:count>2</n1:count><n1:data>aGVsbG8=</n1:data></n1:filter>"
+                                           "<n1:filter><n1:name>C</n1:name><n1:count>0</n1:count><n1:data></n1:data>"
+                                           "<n1:modified>2019-03-04T05:06:07Z</n1:modified></n1:filter>"
+                                           "<hint><value>1</value></hint>"
+                                           "</n1:getItems>"
+                                           "</soap:Body>" + xmlEnvEnd();
+        QVERIFY(xmlBufferCompare(server.receivedData(), expectedRequest));
+    }
+
+    void testFault()
+    {
+        HttpServerThread server(faultResponse(), HttpServerThread::Public);
+        DirectParsing service;
+        service.setEndPoint(server.endPoint());
+
+        const TNS__GetItemsResponse response = service.getItems(getItemsParameters());
+        QCOMPARE(service.lastError(), QString::fromLatin1("Fault code soap:Server: Not found"));
+        QCOMPARE(response.item().count(), 0);
+    }
+
+    void testJob()
+    {
+        HttpServerThread server(getItemsResponse(), HttpServerThread::Public);
+        DirectParsing service;
+        service.setEndPoint(server.endPoint());
+
+        GetItemsJob *job = new GetItemsJob(&service);
+        job->setParameters(getItemsParameters());
+        connect(job, SIGNAL(finished(KDSoapJob*)), &m_eventLoop, SLOT(quit()));
+        job->start();
+        m_eventLoop.exec();
+
+        QVERIFY2(!job->isFault(), qPrintable(job->faultAsString()));
+        checkResponse(job->resultParameters());
+    }
+
+    void testServer()
+    {
+        TestServerThread<DirectParsingServer> serverThread;
+        DirectParsingServer *server = serverThread.startThread();
+
+        DirectParsing service;
+        service.setEndPoint(server->endPoint());
+        const TNS__GetItemsResponse response = service.getItems(getItemsParameters());
+        QVERIFY2(service.lastError().isEmpty(), qPrintable(service.lastError()));
+        QVERIFY(server->lastServerObject());
+        QCOMPARE(server->lastServerObject()->m_receivedQuery, QString::fromLatin1("foo"));
+        QCOMPARE(server->lastServerObject()->m_receivedLimit, 10);
+        QCOMPARE(server->lastServerObject()->m_receivedFilterCount, 2);
+
+        QCOMPARE(response.item().count(), 1);
+        QCOMPARE(response.item().at(0).name(), QString::fromLatin1("Answer to foo"));
+        QCOMPARE(response.item().at(0).count(), 42);
+        QCOMPARE(response.item().at(0).data(), QByteArray("hello"));
+        QCOMPARE(response.total(), 1);
+        QCOMPARE(response.status(), QString::fromLatin1("ok"));
+    }
+
+private:
+    static TNS__GetItems getItemsParameters()
+    {
+        TNS__GetItems params;
+        params.setQuery(QString::fromLatin1("foo"));
+        params.setLimit(10);
+        params.setMode(QString::fromLatin1("fast"));
+        TNS__Item first;
+        first.setName(QString::fromLatin1("A & B"));
+        first.setCount(2);
+        first.setData(QByteArray("hello"));
+        TNS__Item second;
+        second.setName(QString::fromLatin1("C"));
+        second.setCount(0);
+        second.setModified(KDDateTime::fromDateString(QString::fromLatin1("2019-03-04T05:06:07Z")));
+        params.setFilter(QList<TNS__Item>() << first << second);
+        KDSoapValue hint(QString::fromLatin1("hint"), QVariant());
+        hint.childValues().append(KDSoapValue(QString::fromLatin1("value"), 1));
+        params.setHint(hint);
+        return params;
+    }
+
+    static QByteArray getItemsResponse()
+    {
+        return QByteArray(xmlEnvBegin11()) + "><soap:Body>"
+               "<getItemsResponse xmlns=\"http://www.kdab.com/directparsing/\" status=\"complete\">"
+               "<item><name>First</name><count>3</count><data>aGVsbG8=</data>"
+               "<modified>2019-03-04T05:06:07Z</modified></item>"
+               "<item><name>Second &amp; last</name><count>-1</count><data></data>"
+               "<unknown><nested>ignored</nested></unknown></item>"
+               "<total>2</total>"
+               "<comment>some comment</comment>"
+               "<extra><value>1</value></extra>"
+               "</getItemsResponse>"
+               "</soap:Body>" + xmlEnvEnd();
+    }
+
+    static QByteArray faultResponse()
+    {
+        return QByteArray(xmlEnvBegin11()) + "><soap:Body>"
+               "<soap:Fault>"
+               "<faultcode>soap:Server</faultcode>"
+               "<faultstring>Not found</faultstring>"
+               "</soap:Fault>"
+               "</soap:Body>" + xmlEnvEnd();
+    }
+
+    static void checkResponse(const TNS__GetItemsResponse &response)
+    {
+        QCOMPARE(response.status(), QString::fromLatin1("complete"));
+        QCOMPARE(response.item().count(), 2);
+        const TNS__Item first = response.item().at(0);
+        QCOMPARE(first.name(), QString::fromLatin1("First"));
+        QCOMPARE(first.count(), 3);
+        QCOMPARE(first.data(), QByteArray("hello"));
+        QCOMPARE(first.modified().toDateString(), QString::fromLatin1("2019-03-04T05:06:07Z"));
+        const TNS__Item second = response.item().at(1);
+        QCOMPARE(second.name(), QString::fromLatin1("Second & last"));
+        QCOMPARE(second.count(), -1);
+        QVERIFY(second.data().isEmpty());
+        QCOMPARE(response.total(), 2);
+        QCOMPARE(response.comment(), QString::fromLatin1("some comment"));
+        QCOMPARE(response.extra().childValues().count(), 1);
+    }
+
+    QEventLoop m_eventLoop;
+};
+
+QTEST_MAIN(DirectParsingTest)
+
+#include "test_direct_parsing.moc"
@@ -25,6 +25,50 @@
 #include "KDDateTime.h"
 #include <QTest>
 
+// The implementation of previous versions, to compare results and speed
+static KDDateTime referenceFromDateString(const QString &s)
+{
+    KDDateTime kdt;
+    QString tz;
+    QString baseString = s;
+    if (s.endsWith(QLatin1Char('Z'))) {
+        tz = QString::fromLatin1("Z");
+        baseString.chop(1);
+    } else {
+        QString maybeTz = s.right(6);
+        if (maybeTz.startsWith(QLatin1Char('+')) || maybeTz.startsWith(QLatin1Char('-'))) {
+            tz = maybeTz;
+            baseString.chop(6);
+        }
+    }
+    kdt = QDateTime::fromString(baseString, Qt::ISODate);
+    kdt.setTimeZone(tz);
+    return kdt;
+}
+
+static QString referenceToDateString(const KDDateTime &dateTime)
+{
+    QString str;
+    if (dateTime.time().msec()) {
+        str = dateTime.toString(QLatin1String("yyyy-MM-ddThh:mm:ss.zzz"));
+        str += dateTime.timeZone();
+    } else {
+        str = dateTime.toString(Qt::ISODate);
+#if QT_VERSION < 0x040800
+        str += dateTime.timeZone();
+#endif
+    }
+    return str;
+}
+
+static QString referenceTimeToString(const QTime &time)
+{
+    if (time.msec()) {
+        return time.toString(QLatin1String("hh:mm:ss.zzz"));
+    }
+    return time.toString(Qt::ISODate);
+}
+
 class KDDateTimeTest : public QObject
 {
     Q_OBJECT
@@ -48,6 +92,221 @@ private Q_SLOTS:
         QCOMPARE(inputDateTime.timeZone(), outputDateTime.timeZone());
         QCOMPARE(inputDateTime.toDateString(), outputDateTime.toDateString());
     }
+
+    void testDateString_data()
+    {
+        QTest::addColumn<QString>("text");
+
+        QTest::newRow("local") << QString::fromLatin1("2011-03-15T12:34:56");
+        QTest::newRow("utc") << QString::fromLatin1("2011-03-15T12:34:56Z");
+        QTest::newRow("offset") << QString::fromLatin1("2011-03-15T12:34:56+05:30");
+        QTest::newRow("negative_offset") << QString::fromLatin1("1999-12-31T23:59:59-03:00");
+        QTest::newRow("msec") << QString::fromLatin1("2011-03-15T12:34:56.789Z");
+        QTest::newRow("short_fraction") << QString::fromLatin1("2011-03-15T12:34:56.5+01:00");
+        QTest::newRow("long_fraction") << QString::fromLatin1("2011-03-15T12:34:56.1234567Z");
+        QTest::newRow("leap_day") << QString::fromLatin1("2012-02-29T00:00:00Z");
+        QTest::newRow("invalid_day") << QString::fromLatin1("2011-02-29T00:00:00Z");
+        QTest::newRow("date_only") << QString::fromLatin1("2011-03-15");
+        QTest::newRow("garbage") << QString::fromLatin1("yesterday");
+        QTest::newRow("empty") << QString();
+    }
+
+    void testDateString()
+    {
+        QFETCH(QString, text);
+        const KDDateTime expected = referenceFromDateString(text);
+        const KDDateTime actual = KDDateTime::fromDateString(text);
+        QCOMPARE(actual.isValid(), expected.isValid());
+        QCOMPARE(actual.timeZone(), expected.timeZone());
+        QCOMPARE(actual.timeSpec(), expected.timeSpec());
+        if (expected.isValid()) {
+            QCOMPARE(actual.date(), expected.date());
+            QCOMPARE(actual.time(), expected.time());
+            QCOMPARE(actual, expected);
+        }
+        QCOMPARE(actual.toDateString(), referenceToDateString(expected));
+        QCOMPARE(expected.toDateString(), referenceToDateString(expected));
+    }
+
+    void testDate_data()
+    {
+        QTest::addColumn<QString>("text");
+
+        QTest::newRow("date") << QString::fromLatin1("2011-03-15");
+        QTest::newRow("utc") << QString::fromLatin1("2011-03-15Z");
+        QTest::newRow("offset") << QString::fromLatin1("2011-03-15+05:30");
+        QTest::newRow("first_year") << QString::fromLatin1("0001-01-01");
+        QTest::newRow("leap_day") << QString::fromLatin1("2012-02-29");
+        QTest::newRow("invalid_day") << QString::fromLatin1("2011-02-29");
+        QTest::newRow("invalid_month") << QString::fromLatin1("2011-13-01");
+        QTest::newRow("date_time") << QString::fromLatin1("2011-03-15T12:34:56");
+        QTest::newRow("short") << QString::fromLatin1("2011-3-15");
+        QTest::newRow("garbage") << QString::fromLatin1("yesterday");
+        QTest::newRow("empty") << QString();
+    }
+
+    void testDate()
+    {
+        QFETCH(QString, text);
+        const QDate expected = QDate::fromString(text, Qt::ISODate);
+        const QDate actual = KDDateTime::dateFromString(text);
+        QCOMPARE(actual, expected);
+        QCOMPARE(KDDateTime::dateToString(actual), expected.toString(Qt::ISODate));
+    }
+
+    void testTime_data()
+    {
+        QTest::addColumn<QString>("text");
+
+        QTest::newRow("time") << QString::fromLatin1("12:34:56");
+        QTest::newRow("midnight") << QString::fromLatin1("00:00:00");
+        QTest::newRow("msec") << QString::fromLatin1("12:34:56.789");
+        QTest::newRow("short_fraction") << QString::fromLatin1("12:34:56.5");
+        QTest::newRow("two_digit_fraction") << QString::fromLatin1("23:59:59.05");
+        QTest::newRow("long_fraction") << QString::fromLatin1("12:34:56.1234567");
+        QTest::newRow("end_of_day") << QString::fromLatin1("24:00:00");
+        QTest::newRow("invalid_minute") << QString::fromLatin1("12:60:00");
+        QTest::newRow("no_seconds") << QString::fromLatin1("12:34");
+        QTest::newRow("garbage") << QString::fromLatin1("noon");
+        QTest::newRow("empty") << QString();
+    }
+
+    void testTime()
+    {
+        QFETCH(QString, text);
+        const QTime expected = QTime::fromString(text, Qt::ISODate);
+        const QTime actual = KDDateTime::timeFromString(text);
+        QCOMPARE(actual, expected);
+        QCOMPARE(KDDateTime::timeToString(actual), referenceTimeToString(expected));
+    }
+
+    // xsd:date and xsd:time values are written with the same text as before
+    void testDateAndTimeValues()
+    {
+        const QDate date(2011, 3, 5);
+        const QTime time(4, 3, 2, 10);
+        QCOMPARE(KDSoapValue(QLatin1String("d"), date).toXml(), KDSoapValue(QLatin1String("d"), date.toString(Qt::ISODate)).toXml());
+        QCOMPARE(KDSoapValue(QLatin1String("t"), time).toXml(), KDSoapValue(QLatin1String("t"), QString::fromLatin1("04:03:02.010")).toXml());
+        QCOMPARE(KDSoapValue(QLatin1String("t"), QTime(4, 3, 2)).toXml(), KDSoapValue(QLatin1String("t"), QString::fromLatin1("04:03:02")).toXml());
+    }
+
+    void benchmarkFromDateString_data()
+    {
+        testDateString_data();
+    }
+
+    void benchmarkFromDateString()
+    {
+        QFETCH(QString, text);
+        QBENCHMARK {
+            KDDateTime::fromDateString(text);
+        }
+    }
+
+    void benchmarkReferenceFromDateString_data()
+    {
+        testDateString_data();
+    }
+
+    void benchmarkReferenceFromDateString()
+    {
+        QFETCH(QString, text);
+        QBENCHMARK {
+            referenceFromDateString(text);
+        }
+    }
+
+    void benchmarkToDateString_data()
+    {
+        testDateString_data();
+    }
+
+    void benchmarkToDateString()
+    {
+        QFETCH(QString, text);
+        const KDDateTime dateTime = KDDateTime::fromDateString(text);
+        QBENCHMARK {
+            dateTime.toDateString();
+        }
+    }
+
+    void benchmarkReferenceToDateString_data()
+    {
+        testDateString_data();
+    }
+
+    void benchmarkReferenceToDateString()
+    {
+        QFETCH(QString, text);
+        const KDDateTime dateTime = KDDateTime::fromDateString(text);
+        QBENCHMARK {
+            referenceToDateString(dateTime);
+        }
+    }
+
+    void benchmarkDateFromString()
+    {
+        const QString text = QString::fromLatin1("2011-03-15");
+        QBENCHMARK {
+            KDDateTime::dateFromString(text);
+        }
+    }
+
+    void benchmarkReferenceDateFromString()
+    {
+        const QString text = QString::fromLatin1("2011-03-15");
+        QBENCHMARK {
+            QDate::fromString(text, Qt::ISODate);
+        }
+    }
+
+    void benchmarkDateToString()
+    {
+        const QDate date(2011, 3, 15);
+        QBENCHMARK {
+            KDDateTime::dateToString(date);
+        }
+    }
+
+    void benchmarkReferenceDateToString()
+    {
+        const QDate date(2011, 3, 15);
+        QBENCHMARK {
+            date.toString(Qt::ISODate);
+        }
+    }
+
+    void benchmarkTimeFromString()
+    {
+        const QString text = QString::fromLatin1("12:34:56.789");
+        QBENCHMARK {
+            KDDateTime::timeFromString(text);
+        }
+    }
+
+    void benchmarkReferenceTimeFromString()
+    {
+        const QString text = QString::fromLatin1("12:34:56.789");
+        QBENCHMARK {
+            QTime::fromString(text, Qt::ISODate);
+        }
+    }
+
+    void benchmarkTimeToString()
+    {
+        const QTime time(12, 34, 56, 789);
+        QBENCHMARK {
+            KDDateTime::timeToString(time);
+        }
+    }
+
+    void benchmarkReferenceTimeToString()
+    {
+        const QTime time(12, 34, 56, 789);
+        QBENCHMARK {
+            referenceTimeToString(time);
+        }
+    }
 };
 
 QTEST_MAIN(KDDateTimeTest)
@@ -22,7 +22,10 @@
 **********************************************************************/
 
 #include "KDSoapMessage.h"
+#include "KDSoapBinaryCodec.h"
 #include "KDSoapMessageReader_p.h"
+#include "KDSoapMessageWriter_p.h"
+#include "KDSoapNamespaceManager.h"
 #include <QTest>
 #include <QDebug>
 
@@ -114,6 +117,170 @@ private Q_SLOTS:
         QCOMPARE(msg.faultAsString(), QString::fromLatin1(
                      "Fault 4: XML error: [1:163] Premature end of document."));
     }
+
+    void testInvalidCharacterReferences()
+    {
+        // Many invalid references, all replaced in one go; valid ones are kept
+        QByteArray subject;
+        QString expected;
+        for (int i = 0; i < 1000; ++i) {
+            subject += "a&#x13;&#1;&#x41;&#39;";
+            expected += QLatin1String("a??A'");
+        }
+        const QByteArray xml =
+            "<soapenv:Envelope xmlns:soapenv=\"http://schemas.xmlsoap.org/soap/envelope/\" xmlns:dat=\"http://www.27seconds.com/Holidays/US/Dates/\">"
+            "<soapenv:Body>"
+            "<dat:GetEaster>"
+            "<dat:subject>" + subject + "</dat:subject>"
+            "<dat:other>&amp;&#xFFFE;</dat:other>"
+            "</dat:GetEaster>"
+            "</soapenv:Body>"
+            "</soapenv:Envelope>";
+
+        const KDSoapMessageReader reader;
+        QString ns;
+        KDSoapMessage msg;
+        KDSoapHeaders headers;
+        const KDSoapMessageReader::XmlError err = reader.xmlToMessage(xml, &msg, &ns, &headers, KDSoap::SOAP1_1);
+        QCOMPARE(err, KDSoapMessageReader::NoError);
+        QVERIFY(!msg.isFault());
+        QCOMPARE(msg.childValues().child(QLatin1String("subject")).value().toString(), expected);
+        QCOMPARE(msg.childValues().child(QLatin1String("other")).value().toString(), QString::fromLatin1("&?"));
+    }
+
+    void testNotWellFormed()
+    {
+        // Not a character reference problem: still an error
+        const QByteArray xml =
+            "<soapenv:Envelope xmlns:soapenv=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+            "<soapenv:Body><a>&#x13</a></soapenv:Body>"
+            "</soapenv:Envelope>";
+
+        const KDSoapMessageReader reader;
+        QString ns;
+        KDSoapMessage msg;
+        KDSoapHeaders headers;
+        const KDSoapMessageReader::XmlError err = reader.xmlToMessage(xml, &msg, &ns, &headers, KDSoap::SOAP1_1);
+        QCOMPARE(err, KDSoapMessageReader::ParseError);
+        QVERIFY(msg.isFault());
+    }
+
+    void testBinaryToMessage()
+    {
+        const QString ns = QString::fromLatin1("http://www.kdab.com/xml/MyWsdl/");
+        KDSoapMessage message;
+        message.addArgument(QLatin1String("text"), QString::fromLatin1("h\u00e9llo <world>"));
+        message.addArgument(QLatin1String("empty"), QString());
+        message.addArgument(QLatin1String("int"), -42);
+        message.addArgument(QLatin1String("long"), Q_INT64_C(-9000000000));
+        message.addArgument(QLatin1String("ulong"), Q_UINT64_C(18000000000000000000));
+        message.addArgument(QLatin1String("bool"), true);
+        message.addArgument(QLatin1String("double"), 3.25);
+        message.addArgument(QLatin1String("bytes"), QByteArray("\0\1\2KD", 5), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
+        KDSoapValue encoded(QLatin1String("encoded"), QVariant());
+        encoded.setEncodedBinaryValue("S0RTb2Fw");
+        message.childValues().append(encoded);
+        KDSoapValue qualified(QLatin1String("qualified"), QString::fromLatin1("q"));
+        qualified.setNamespaceUri(QLatin1String("http://foo"));
+        qualified.childValues().attributes().append(KDSoapValue(QLatin1String("attr"), QString::fromLatin1("a")));
+        qualified.childValues().append(KDSoapValue(QLatin1String("text"), QString::fromLatin1("again"))); // name from the string table
+        message.childValues().append(qualified);
+
+        KDSoapHeaders headers;
+        KDSoapMessage header;
+        header.addArgument(QLatin1String("header1"), QString::fromLatin1("headerValue"));
+        headers.append(header);
+
+        KDSoapMessageWriter writer;
+        writer.setMessageNamespace(ns);
+        const QByteArray data = writer.messageToBinary(message, QLatin1String("method"), headers, QMap<QString, KDSoapMessage>());
+        const QByteArray xml = writer.messageToXml(message, QLatin1String("method"), headers, QMap<QString, KDSoapMessage>());
+        QVERIFY(data.size() < xml.size());
+
+        const KDSoapMessageReader reader;
+        QString messageNamespace;
+        KDSoapMessage msg;
+        KDSoapHeaders msgHeaders;
+        QCOMPARE(reader.binaryToMessage(data, &msg, &messageNamespace, &msgHeaders, KDSoap::SOAP1_1), KDSoapMessageReader::NoError);
+        QVERIFY(!msg.isFault());
+        QCOMPARE(msg.name(), QString::fromLatin1("method"));
+        QCOMPARE(messageNamespace, ns);
+        QCOMPARE(msgHeaders.count(), 1);
+        QCOMPARE(msgHeaders.header(QLatin1String("header1")).value().toString(), QString::fromLatin1("headerValue"));
+
+        const KDSoapValueList &args = msg.childValues();
+        QCOMPARE(args.child(QLatin1String("text")).value().toString(), QString::fromLatin1("h\u00e9llo <world>"));
+        QVERIFY(args.child(QLatin1String("empty")).value().isNull());
+        QCOMPARE(args.child(QLatin1String("int")).value(), QVariant(-42));
+        QCOMPARE(args.child(QLatin1String("long")).value(), QVariant(Q_INT64_C(-9000000000)));
+        QCOMPARE(args.child(QLatin1String("ulong")).value(), QVariant(Q_UINT64_C(18000000000000000000)));
+        QCOMPARE(args.child(QLatin1String("bool")).value(), QVariant(true));
+        QCOMPARE(args.child(QLatin1String("double")).value(), QVariant(3.25));
+        QCOMPARE(args.child(QLatin1String("bytes")).value(), QVariant(QByteArray("\0\1\2KD", 5)));
+        QVERIFY(args.child(QLatin1String("encoded")).isEncodedBinaryValue());
+        QCOMPARE(args.child(QLatin1String("encoded")).value().toByteArray(), QByteArray("S0RTb2Fw"));
+        const KDSoapValue readQualified = args.child(QLatin1String("qualified"));
+        QCOMPARE(readQualified.namespaceUri(), QString::fromLatin1("http://foo"));
+        QCOMPARE(readQualified.value().toString(), QString::fromLatin1("q"));
+        QCOMPARE(readQualified.childValues().attributes().count(), 1);
+        QCOMPARE(readQualified.childValues().attributes().first().value().toString(), QString::fromLatin1("a"));
+        QCOMPARE(readQualified.childValues().child(QLatin1String("text")).value().toString(), QString::fromLatin1("again"));
+
+        // Truncated or corrupted data gives a fault, like invalid XML
+        for (int size = 0; size < data.size(); size += 7) {
+            KDSoapMessage truncated;
+            KDSoapHeaders truncatedHeaders;
+            QCOMPARE(reader.binaryToMessage(data.left(size), &truncated, 0, &truncatedHeaders, KDSoap::SOAP1_1), KDSoapMessageReader::ParseError);
+            QVERIFY(truncated.isFault());
+        }
+    }
+
+    void testBinaryBytesLikeXml_data()
+    {
+        QTest::addColumn<bool>("encodedUse");
+        QTest::addColumn<QString>("type");
+        QTest::newRow("literal") << false << QString::fromLatin1("base64Binary");
+        QTest::newRow("base64Binary") << true << QString::fromLatin1("base64Binary");
+        QTest::newRow("hexBinary") << true << QString::fromLatin1("hexBinary");
+        QTest::newRow("untyped") << true << QString();
+    }
+
+    // Binary data stays raw bytes in the binary encoding, but reads back as the same data and type as from XML
+    void testBinaryBytesLikeXml()
+    {
+        QFETCH(bool, encodedUse);
+        QFETCH(QString, type);
+
+        KDSoapMessage message;
+        message.setUse(encodedUse ? KDSoapMessage::EncodedUse : KDSoapMessage::LiteralUse);
+        message.addArgument(QLatin1String("bytes"), QByteArray("\0\1\2KD", 5),
+                            type.isEmpty() ? QString() : KDSoapNamespaceManager::xmlSchema2001(), type);
+
+        KDSoapMessageWriter writer;
+        writer.setMessageNamespace(QString::fromLatin1("http://www.kdab.com/xml/MyWsdl/"));
+        const QByteArray xml = writer.messageToXml(message, QLatin1String("method"), KDSoapHeaders(), QMap<QString, KDSoapMessage>());
+        const QByteArray data = writer.messageToBinary(message, QLatin1String("method"), KDSoapHeaders(), QMap<QString, KDSoapMessage>());
+
+        const KDSoapMessageReader reader;
+        KDSoapMessage fromXml;
+        KDSoapMessage fromBinary;
+        KDSoapHeaders headers;
+        QCOMPARE(reader.xmlToMessage(xml, &fromXml, 0, &headers, KDSoap::SOAP1_1), KDSoapMessageReader::NoError);
+        QCOMPARE(reader.binaryToMessage(data, &fromBinary, 0, &headers, KDSoap::SOAP1_1), KDSoapMessageReader::NoError);
+
+        const KDSoapValue xmlValue = fromXml.childValues().child(QLatin1String("bytes"));
+        const KDSoapValue binaryValue = fromBinary.childValues().child(QLatin1String("bytes"));
+        QVERIFY(!xmlValue.value().isNull());
+        QCOMPARE(binaryValue.value(), QVariant(QByteArray("\0\1\2KD", 5))); // no conversion to text
+        QVERIFY(!binaryValue.isEncodedBinaryValue());
+        if (type == QLatin1String("hexBinary")) {
+            QCOMPARE(KDSoapBinaryCodec::fromHexValue(binaryValue), KDSoapBinaryCodec::fromHexValue(xmlValue));
+        } else {
+            QCOMPARE(KDSoapBinaryCodec::fromBase64Value(binaryValue), KDSoapBinaryCodec::fromBase64Value(xmlValue));
+        }
+        QCOMPARE(binaryValue.typeNs(), xmlValue.typeNs());
+        QCOMPARE(binaryValue.type(), xmlValue.type());
+    }
 };
 
 QTEST_MAIN(TestMessageReader)
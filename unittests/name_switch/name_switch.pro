@@ -0,0 +1,11 @@
+include( $${TOP_SOURCE_DIR}/unittests/unittests.pri )
+QT += network xml
+SOURCES = \
+    test_name_switch.cpp
+test.target = test
+test.commands = ./$(TARGET)
+test.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += test
+
+KDWSDL = name_switch.wsdl
+OTHER_FILES += $$KDWSDL
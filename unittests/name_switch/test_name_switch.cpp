@@ -0,0 +1,132 @@
+/****************************************************************************
+** Copyright (C) 2010-2019 Klaralvdalens Datakonsult AB, a KDAB Group company, info@kdab.com.
+** All rights reserved.
+**
+** This file is part of the KD Soap library.
+**
+** Licensees holding valid commercial KD Soap licenses may use this file in
+** accordance with the KD Soap Commercial License Agreement provided with
+** the Software.
+**
+**
+** This file may be distributed and/or modified under the terms of the
+** GNU Lesser General Public License version 2.1 and version 3 as published by the
+** Free Software Foundation and appearing in the file LICENSE.LGPL.txt included.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+** Contact info@kdab.com if any conditions of this licensing are not
+** clear to you.
+**
+**********************************************************************/
+
+#include <QTest>
+#include "wsdl_name_switch.h"
+
+// Types with 8 names or more are dispatched by length and then by a single
+// character (see nameIndexSwitch in kdwsdl2cpp), so round-trip all of them.
+class TestNameSwitch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testEnumRoundTrip_data()
+    {
+        QTest::addColumn<int>("type");
+        QTest::addColumn<QString>("text");
+
+        QTest::newRow("red") << int(TNS__Colour::Red) << QString::fromLatin1("red");
+        QTest::newRow("green") << int(TNS__Colour::Green) << QString::fromLatin1("green");
+        QTest::newRow("blue") << int(TNS__Colour::Blue) << QString::fromLatin1("blue");
+        // same length, told apart by a single character
+        QTest::newRow("cyan") << int(TNS__Colour::Cyan) << QString::fromLatin1("cyan");
+        QTest::newRow("teal") << int(TNS__Colour::Teal) << QString::fromLatin1("teal");
+        QTest::newRow("pink") << int(TNS__Colour::Pink) << QString::fromLatin1("pink");
+        QTest::newRow("plum") << int(TNS__Colour::Plum) << QString::fromLatin1("plum");
+        QTest::newRow("gray") << int(TNS__Colour::Gray) << QString::fromLatin1("gray");
+        // characters that need escaping in the generated string literals
+        QTest::newRow("quote") << int(TNS__Colour::Say_hi) << QString::fromLatin1("say\"hi");
+        QTest::newRow("backslash") << int(TNS__Colour::Back_slash) << QString::fromLatin1("back\\slash");
+    }
+
+    void testEnumRoundTrip()
+    {
+        QFETCH(int, type);
+        QFETCH(QString, text);
+
+        TNS__Colour colour;
+        colour.setType(static_cast<TNS__Colour::Type>(type));
+        const KDSoapValue value = colour.serialize(QLatin1String("colour"));
+        QCOMPARE(value.value().toString(), text);
+
+        TNS__Colour parsed;
+        parsed.setType(type == TNS__Colour::Green ? TNS__Colour::Blue : TNS__Colour::Green);
+        parsed.deserialize(value);
+        QCOMPARE(int(parsed.type()), type);
+    }
+
+    void testEnumDuplicate()
+    {
+        // "red" is listed twice in the schema, it must only give one enumerator
+        TNS__Colour colour;
+        colour.deserialize(KDSoapValue(QLatin1String("colour"), QString::fromLatin1("red")));
+        QCOMPARE(colour.type(), TNS__Colour::Red);
+        QCOMPARE(int(TNS__Colour::Gray) + 1, int(TNS__Colour::Say_hi));
+    }
+
+    void testEnumUnknown_data()
+    {
+        QTest::addColumn<QString>("text");
+
+        QTest::newRow("unknown length") << QString::fromLatin1("purple");
+        QTest::newRow("same length as blue") << QString::fromLatin1("puce");
+        QTest::newRow("same length as gray") << QString::fromLatin1("pony");
+        QTest::newRow("empty") << QString();
+    }
+
+    void testEnumUnknown()
+    {
+        QFETCH(QString, text);
+
+        TNS__Colour colour;
+        colour.setType(TNS__Colour::Teal);
+        colour.deserialize(KDSoapValue(QLatin1String("colour"), text));
+        QCOMPARE(colour.type(), TNS__Colour::Teal);
+    }
+
+    void testRecordRoundTrip()
+    {
+        TNS__Record record;
+        record.setItemA(QString::fromLatin1("a"));
+        record.setItemB(QString::fromLatin1("b"));
+        record.setItemC(QString::fromLatin1("c"));
+        record.setValue1(1);
+        record.setValue2(2);
+        record.setLabel(QString::fromLatin1("label"));
+        record.setCount(42);
+        record.setStatus(QString::fromLatin1("ok"));
+        record.setColour(TNS__Colour::Plum);
+
+        KDSoapValue value = record.serialize(QLatin1String("record"));
+        QCOMPARE(value.childValues().count(), 9);
+        // an unknown child with the same length as itemA/itemB/itemC is skipped
+        value.childValues().append(KDSoapValue(QLatin1String("itemD"), QString::fromLatin1("d")));
+
+        TNS__Record parsed;
+        parsed.deserialize(value);
+        QCOMPARE(parsed.itemA(), QString::fromLatin1("a"));
+        QCOMPARE(parsed.itemB(), QString::fromLatin1("b"));
+        QCOMPARE(parsed.itemC(), QString::fromLatin1("c"));
+        QCOMPARE(parsed.value1(), 1);
+        QCOMPARE(parsed.value2(), 2);
+        QCOMPARE(parsed.label(), QString::fromLatin1("label"));
+        QCOMPARE(parsed.count(), 42);
+        QCOMPARE(parsed.status(), QString::fromLatin1("ok"));
+        QCOMPARE(parsed.colour().type(), TNS__Colour::Plum);
+    }
+};
+
+QTEST_MAIN(TestNameSwitch)
+
+#include "test_name_switch.moc"
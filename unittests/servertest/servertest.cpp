@@ -25,7 +25,10 @@
 #include "KDSoapMessage.h"
 #include "KDSoapValue.h"
 #include "KDSoapPendingCallWatcher.h"
+#include "KDSoapJob.h"
+#include "KDSoapJobQueue.h"
 #include "KDSoapNamespaceManager.h"
+#include "KDSoapBinaryCodec.h"
 #include "KDSoapAuthentication.h"
 #include "KDSoapServer.h"
 #include "KDSoapThreadPool.h"
@@ -37,6 +40,8 @@
 #include <QTest>
 #include <QDebug>
 #include <QFile>
+#include <QTemporaryFile>
+#include <QDir>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QAuthenticator>
@@ -45,6 +50,9 @@
 #endif
 #include <QSignalSpy>
 #include <QTimer>
+#include <QTcpServer>
+#include <QElapsedTimer>
+#include <algorithm>
 using namespace KDSoapUnitTestHelpers;
 
 Q_DECLARE_METATYPE(QFile::Permissions)
@@ -58,6 +66,44 @@ class CountryServerObject;
 typedef QMap<QThread *, CountryServerObject *> ServerObjectsMap;
 ServerObjectsMap s_serverObjects;
 QMutex s_serverObjectsMutex;
+QAtomicInt s_slowRequests; // the calls of getEmployeeCountry for "Slow"
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+QAtomicInt s_requestFileWarnings;
+static QtMessageHandler s_previousMessageHandler = 0;
+static void countRequestFileWarnings(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    if (type == QtWarningMsg && msg.contains(QLatin1String("could not create a temporary file"))) {
+        s_requestFileWarnings.ref();
+    }
+    s_previousMessageHandler(type, context, msg);
+}
+#endif
+
+// Points QDir::tempPath() somewhere else, and counts the warnings about the request file, for one test
+class TmpDirOverride
+{
+public:
+    explicit TmpDirOverride(const QString &path)
+        : m_oldTmpDir(qgetenv("TMPDIR"))
+    {
+        qputenv("TMPDIR", QFile::encodeName(path));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        s_requestFileWarnings.fetchAndStoreRelaxed(0);
+        s_previousMessageHandler = qInstallMessageHandler(countRequestFileWarnings);
+#endif
+    }
+    ~TmpDirOverride()
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        qInstallMessageHandler(s_previousMessageHandler);
+#endif
+        qputenv("TMPDIR", m_oldTmpDir); // empty means the default, /tmp
+    }
+
+private:
+    QByteArray m_oldTmpDir;
+};
 
 class PublicThread : public QThread
 {
@@ -199,6 +245,7 @@ public: // SOAP-accessible methods
         }
         //qDebug() << "getEmployeeCountry(" << employeeName << ") called";
         if (employeeName == QLatin1String("Slow")) {
+            s_slowRequests.ref();
             PublicThread::msleep(100);
         }
         return employeeName + QString::fromLatin1(" France");
@@ -284,6 +331,42 @@ private:
     bool m_useRawXML;
 };
 
+// Server object using registered handlers instead of reimplementing processRequest
+class HandlerServerObject : public QObject, public KDSoapServerObjectInterface
+{
+    Q_OBJECT
+    Q_INTERFACES(KDSoapServerObjectInterface)
+public:
+    HandlerServerObject()
+    {
+        registerRequestHandler(QLatin1String("getEmployeeCountry"), QByteArray(), &HandlerServerObject::handleGetEmployeeCountry);
+        registerRequestHandler(QLatin1String("getCount"), "http://www.kdab.com/xml/MyWsdl/getCount", &HandlerServerObject::handleGetCount);
+    }
+
+private:
+    void handleGetEmployeeCountry(const KDSoapMessage &request, KDSoapMessage &response)
+    {
+        setResponseNamespace(QLatin1String(myWsdlNamespace));
+        const QString employeeName = request.childValues().child(QLatin1String("employeeName")).value().toString();
+        response.setValue(QLatin1String("getEmployeeCountryResponse"));
+        response.addArgument(QLatin1String("employeeCountry"), QString(employeeName + QLatin1String(" France")));
+    }
+    void handleGetCount(const KDSoapMessage &, KDSoapMessage &response)
+    {
+        response.setValue(42);
+    }
+};
+
+class HandlerServer : public KDSoapServer
+{
+    Q_OBJECT
+public:
+    virtual QObject *createServerObject()
+    {
+        return new HandlerServerObject;
+    }
+};
+
 // We need to do the listening and socket handling in a separate thread,
 // so that the main thread can use synchronous calls. Note that this is
 // really specific to unit tests and doesn't need to be done in a real
@@ -314,176 +397,1272 @@ public:
         QMetaObject::invokeMethod(m_pServer, "suspend");
         m_semaphore.acquire();
     }
-    void resume()
+    void resume()
+    {
+        QMetaObject::invokeMethod(m_pServer, "resume");
+        m_semaphore.acquire();
+    }
+    // Call before startThread()
+    void setLocalSocketPath(const QString &path)
+    {
+        m_localSocketPath = path;
+    }
+
+protected:
+    void run()
+    {
+        CountryServer server;
+        if (m_threadPool) {
+            server.setThreadPool(m_threadPool);
+        }
+        if (server.listen() && (m_localSocketPath.isEmpty() || server.listenOnLocalSocket(m_localSocketPath))) {
+            m_pServer = &server;
+        }
+        connect(&server, SIGNAL(releaseSemaphore()), this, SLOT(slotReleaseSemaphore()), Qt::DirectConnection);
+        m_semaphore.release();
+        exec();
+        m_pServer = 0;
+    }
+private Q_SLOTS:
+    void slotReleaseSemaphore()
+    {
+        m_semaphore.release();
+    }
+
+private:
+    KDSoapThreadPool *m_threadPool;
+    QSemaphore m_semaphore;
+    CountryServer *m_pServer;
+    QString m_localSocketPath;
+};
+
+static QString localSocketPath()
+{
+    return QDir::tempPath() + QString::fromLatin1("/kdsoap-servertest-%1.sock").arg(QCoreApplication::applicationPid());
+}
+
+// to avoid a bit of duplication
+class ClientSocket : public QTcpSocket
+{
+public:
+    ClientSocket(CountryServer *server)
+    {
+        QUrl url(server->endPoint());
+        connectToHost(url.host(), server->serverPort());
+    }
+};
+
+// Reads exactly \p size bytes, or less if the server stops sending
+static QByteArray readFromSocket(QTcpSocket &socket, int size)
+{
+    QByteArray data;
+    while (data.size() < size) {
+        if (socket.bytesAvailable() == 0 && !socket.waitForReadyRead(5000)) {
+            break;
+        }
+        data += socket.read(size - data.size());
+    }
+    return data;
+}
+
+// What kdwsdl2cpp generates for getEmployeeCountry, more or less
+class CountryJob : public KDSoapJob
+{
+    Q_OBJECT
+public:
+    CountryJob(KDSoapClientInterface *client, int id)
+        : m_client(client), m_id(id)
+    {
+    }
+
+    int id() const
+    {
+        return m_id;
+    }
+
+protected:
+    void doStart()
+    {
+        KDSoapMessage message;
+        message.addArgument(QLatin1String("employeeName"), QString::fromUtf8("David Ä Faure"));
+        KDSoapPendingCall pendingCall = m_client->asyncCall(QLatin1String("getEmployeeCountry"), message, QString(), requestHeaders());
+        KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);
+        connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)), this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+    }
+
+private Q_SLOTS:
+    void slotFinished(KDSoapPendingCallWatcher *watcher)
+    {
+        watcher->deleteLater();
+        emitFinished(watcher->returnMessage(), watcher->returnHeaders());
+    }
+
+private:
+    KDSoapClientInterface *m_client;
+    int m_id;
+};
+
+// Records the signals of a KDSoapJobQueue
+class JobQueueRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    JobQueueRecorder(KDSoapJobQueue *queue)
+        : m_queue(queue), m_maxRunningJobs(0), m_lastProgress(0)
+    {
+        connect(queue, SIGNAL(progress(int,int)), this, SLOT(slotProgress(int,int)));
+        connect(queue, SIGNAL(jobsFinished(QList<KDSoapJob*>)), this, SLOT(slotJobsFinished(QList<KDSoapJob*>)));
+        connect(queue, SIGNAL(finished()), &m_eventLoop, SLOT(quit()));
+    }
+
+    void waitForFinished()
+    {
+        m_eventLoop.exec();
+    }
+
+    KDSoapJobQueue *m_queue;
+    QEventLoop m_eventLoop;
+    QList<int> m_batchSizes;
+    QList<int> m_finishedIds;
+    int m_maxRunningJobs;
+    int m_lastProgress;
+
+public Q_SLOTS:
+    void slotProgress(int finishedJobs, int totalJobs)
+    {
+        Q_UNUSED(totalJobs);
+        m_lastProgress = finishedJobs;
+        m_maxRunningJobs = qMax(m_maxRunningJobs, m_queue->runningJobs());
+    }
+
+    void slotJobsFinished(const QList<KDSoapJob *> &jobs)
+    {
+        m_batchSizes.append(jobs.count());
+        Q_FOREACH (KDSoapJob *job, jobs) {
+            QVERIFY(!job->isFault());
+            m_finishedIds.append(static_cast<CountryJob *>(job)->id());
+        }
+    }
+};
+
+class ServerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+#ifndef QT_NO_OPENSSL
+        if (!QSslSocket::supportsSsl()) {
+            qWarning("No SSL support on this machine, check that ssleay.so/ssleay32.dll is installed");
+        } else {
+            QVERIFY(KDSoapUnitTestHelpers::setSslConfiguration());
+            QSslConfiguration defaultConfig = QSslConfiguration::defaultConfiguration();
+            QFile certFile(QString::fromLatin1(":/certs/test-127.0.0.1-cert.pem"));
+            if (certFile.open(QIODevice::ReadOnly)) {
+                defaultConfig.setLocalCertificate(QSslCertificate(certFile.readAll()));
+            }
+            QFile keyFile(QString::fromLatin1(":/certs/test-127.0.0.1-key.pem"));
+            if (keyFile.open(QIODevice::ReadOnly)) {
+                defaultConfig.setPrivateKey(QSslKey(keyFile.readAll(), QSsl::Rsa));
+            }
+            QSslConfiguration::setDefaultConfiguration(defaultConfig);
+        }
+#endif
+    }
+
+    void testCall()
+    {
+        {
+            CountryServerThread serverThread;
+            CountryServer *server = serverThread.startThread();
+
+            //qDebug() << "server ready, proceeding" << server->endPoint();
+            KDSoapClientInterface *client = new KDSoapClientInterface(server->endPoint(), countryMessageNamespace());
+            const KDSoapMessage response = client->call(QLatin1String("getEmployeeCountry"), countryMessage());
+            QVERIFY(!response.isFault());
+            QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+
+            QCOMPARE(s_serverObjects.count(), 1);
+            QVERIFY(s_serverObjects.value(&serverThread)); // request handled by server thread itself (no thread pool)
+            QCOMPARE(server->totalConnectionCount(), 1);
+            delete client;
+            QTest::qWait(100);
+        }
+        QCOMPARE(s_serverObjects.count(), 0);
+    }
+
+    void testAuth()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        server->setRequireAuth(true);
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        KDSoapAuthentication auth;
+        auth.setUser(QLatin1String("kdab"));
+        auth.setPassword(QLatin1String("pass42"));
+        client.setAuthentication(auth);
+        const KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        if (response.isFault()) {
+            qDebug() << response.faultAsString();
+            QVERIFY(!response.isFault());
+        }
+        QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+    }
+
+    void testRefusedAuth()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        server->setRequireAuth(true);
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        KDSoapAuthentication auth;
+        auth.setUser(QLatin1String("kdab"));
+        auth.setPassword(QLatin1String("invalid"));
+        client.setAuthentication(auth);
+        const KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(response.isFault());
+    }
+
+    void testParamTypes()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        const KDSoapMessage response = client.call(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
+        if (response.isFault()) {
+            qDebug() << response.faultAsString();
+            QVERIFY(!response.isFault());
+        }
+        QCOMPARE(response.value().toDouble(), double(4 + 3.2 + 123456.789));
+        const KDSoapHeaders responseHeaders = client.lastResponseHeaders();
+        //qDebug() << responseHeaders;
+        QCOMPARE(responseHeaders.header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QString::fromLatin1("responseHeader"));
+    }
+
+    void testHeadersAsyncCall() // KDSOAP-45
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        m_returnMessages.clear();
+        m_expectedMessages = 1;
+        KDSoapPendingCall pendingCall = client.asyncCall(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
+        KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);
+        connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+        m_eventLoop.exec();
+        QCOMPARE(m_returnMessages.count(), 1);
+        QCOMPARE(m_returnMessages.at(0).value().toDouble(), double(4 + 3.2 + 123456.789));
+        QCOMPARE(m_returnHeaders.count(), 1);
+        QCOMPARE(m_returnHeaders.at(0).header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QLatin1String("responseHeader"));
+    }
+
+    void testBackgroundParsing()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        client.setBackgroundParsingEnabled(true);
+        QVERIFY(client.isBackgroundParsingEnabled());
+        m_returnMessages.clear();
+        m_returnHeaders.clear();
+        m_expectedMessages = 6;
+        QList<KDSoapPendingCall> calls;
+        for (int i = 0; i < 5; ++i) {
+            calls.append(client.asyncCall(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders()));
+        }
+        KDSoapMessage faultMessage;
+        faultMessage.addArgument(QLatin1String("employeeName"), QString());
+        calls.append(client.asyncCall(QLatin1String("getEmployeeCountry"), faultMessage));
+        Q_FOREACH (const KDSoapPendingCall &call, calls) {
+            KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(call, this);
+            connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                    this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+        }
+        m_eventLoop.exec();
+        QCOMPARE(m_returnMessages.count(), 6);
+        int faults = 0;
+        for (int i = 0; i < m_returnMessages.count(); ++i) {
+            if (m_returnMessages.at(i).isFault()) {
+                ++faults;
+                QCOMPARE(m_returnMessages.at(i).faultAsString(), QString::fromLatin1("Fault code Client.Data: Empty employee name (CountryServerObject). Error detail: Employee name must not be empty"));
+            } else {
+                QCOMPARE(m_returnMessages.at(i).value().toDouble(), double(4 + 3.2 + 123456.789));
+                QCOMPARE(m_returnHeaders.at(i).header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QLatin1String("responseHeader"));
+            }
+        }
+        QCOMPARE(faults, 1);
+        Q_FOREACH (const KDSoapPendingCall &call, calls) {
+            QVERIFY(call.isFinished());
+        }
+
+        // A call which times out has nothing to parse
+        client.setTimeout(10);
+        m_returnMessages.clear();
+        m_expectedMessages = 1;
+        KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(client.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage(true)), this);
+        connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+        m_eventLoop.exec();
+        QCOMPARE(m_returnMessages.count(), 1);
+        QCOMPARE(m_returnMessages.at(0).faultAsString(), QString::fromLatin1("Fault code 4: Operation timed out"));
+    }
+
+    void testResponseCache()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        QCOMPARE(client.responseCacheTimeToLive(QLatin1String("getEmployeeCountry")), 0);
+        client.setResponseCacheTimeToLive(QLatin1String("getEmployeeCountry"), 60000);
+        QCOMPARE(client.responseCacheTimeToLive(QLatin1String("getEmployeeCountry")), 60000);
+
+        // Blocking calls
+        for (int i = 0; i < 3; ++i) {
+            const KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+            QVERIFY(!response.isFault());
+            QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+        }
+        KDSoapClientInterface::ResponseCacheStatistics stats = client.responseCacheStatistics();
+        QCOMPARE(stats.misses, 1);
+        QCOMPARE(stats.hits, 2);
+        QCOMPARE(stats.coalesced, 0);
+        QCOMPARE(stats.entries, 1);
+        QVERIFY(stats.size > 0);
+
+        // Identical asynchronous calls in progress share the same response
+        m_returnMessages.clear();
+        m_returnHeaders.clear();
+        m_expectedMessages = 4;
+        for (int i = 0; i < 4; ++i) {
+            KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(client.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage(true)), this);
+            connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                    this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+        }
+        m_eventLoop.exec();
+        QCOMPARE(m_returnMessages.count(), 4);
+        Q_FOREACH (const KDSoapMessage &response, m_returnMessages) {
+            QCOMPARE(response.childValues().first().value().toString(), QString::fromLatin1("Slow France"));
+        }
+        stats = client.responseCacheStatistics();
+        QCOMPARE(stats.misses, 2);
+        QCOMPARE(stats.coalesced, 3);
+        QCOMPARE(stats.entries, 2);
+
+        // Faults are not cached, other methods neither
+        KDSoapMessage faultMessage;
+        faultMessage.addArgument(QLatin1String("employeeName"), QString());
+        QVERIFY(client.call(QLatin1String("getEmployeeCountry"), faultMessage).isFault());
+        QVERIFY(client.call(QLatin1String("getEmployeeCountry"), faultMessage).isFault());
+        QVERIFY(!client.call(QLatin1String("getStuff"), getStuffMessage()).isFault());
+        stats = client.responseCacheStatistics();
+        QCOMPARE(stats.misses, 4);
+        QCOMPARE(stats.hits, 2);
+        QCOMPARE(stats.entries, 2);
+
+        client.clearResponseCache();
+        QCOMPARE(client.responseCacheStatistics().entries, 0);
+        QVERIFY(!client.call(QLatin1String("getEmployeeCountry"), countryMessage()).isFault());
+        QCOMPARE(client.responseCacheStatistics().misses, 5);
+
+        // Least recently used responses go first
+        client.setResponseCacheMaxSize(0);
+        QVERIFY(!client.call(QLatin1String("getEmployeeCountry"), countryMessage()).isFault());
+        QCOMPARE(client.responseCacheStatistics().entries, 0);
+
+        // A blocking call doesn't wait for an identical asynchronous call: its response
+        // would need the event loop of this thread, which is blocked
+        client.setResponseCacheMaxSize(1024 * 1024);
+        client.setTimeout(10000); // a fault rather than hanging forever, if it did
+        const int coalescedBefore = client.responseCacheStatistics().coalesced;
+        KDSoapPendingCall pendingCall = client.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage(true /*slow*/));
+        const KDSoapMessage blockingResponse = client.call(QLatin1String("getEmployeeCountry"), countryMessage(true /*slow*/));
+        QVERIFY2(!blockingResponse.isFault(), qPrintable(blockingResponse.faultAsString()));
+        QCOMPARE(blockingResponse.childValues().first().value().toString(), QString::fromLatin1("Slow France"));
+        QCOMPARE(client.responseCacheStatistics().coalesced, coalescedBefore);
+#if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
+        QTRY_VERIFY(pendingCall.isFinished());
+#else
+        QTest::qWait(1000);
+        QVERIFY(pendingCall.isFinished());
+#endif
+        QCOMPARE(pendingCall.returnMessage().childValues().first().value().toString(), QString::fromLatin1("Slow France"));
+    }
+
+    void testLoadBalancing()
+    {
+        CountryServerThread serverThread1;
+        CountryServer *server1 = serverThread1.startThread();
+        CountryServerThread serverThread2;
+        CountryServer *server2 = serverThread2.startThread();
+        const QString endPoint1 = server1->endPoint();
+        const QString endPoint2 = server2->endPoint();
+
+        KDSoapClientInterface client(endPoint1, countryMessageNamespace());
+        client.setEndPoints(QStringList() << endPoint1 << endPoint2);
+        QCOMPARE(client.endPoints(), QStringList() << endPoint1 << endPoint2);
+        QCOMPARE(client.endPoint(), endPoint1);
+        QCOMPARE(client.loadBalancing(), KDSoapClientInterface::RoundRobin);
+
+        for (int i = 0; i < 4; ++i) {
+            QVERIFY(!client.call(QLatin1String("getEmployeeCountry"), countryMessage()).isFault());
+        }
+        QVERIFY(server1->totalConnectionCount() > 0);
+        QVERIFY(server2->totalConnectionCount() > 0);
+
+        // The second server goes away: it's ejected after two failures
+        client.setEndPointEjection(2, 500);
+        serverThread2.suspend();
+        int faults = 0;
+        for (int i = 0; i < 8; ++i) {
+            if (client.call(QLatin1String("getEmployeeCountry"), countryMessage()).isFault()) {
+                ++faults;
+            }
+        }
+        QCOMPARE(faults, 2);
+        QCOMPARE(client.ejectedEndPoints(), QStringList() << endPoint2);
+
+        // It's checked again after the ejection time
+        serverThread2.resume();
+        QTest::qWait(600);
+        for (int i = 0; i < 4; ++i) {
+            QVERIFY(!client.call(QLatin1String("getEmployeeCountry"), countryMessage()).isFault());
+        }
+        QVERIFY(client.ejectedEndPoints().isEmpty());
+
+        // The other strategies, with asynchronous calls in progress
+        const KDSoapClientInterface::LoadBalancing strategies[] = { KDSoapClientInterface::LeastOutstandingRequests, KDSoapClientInterface::LatencyEwma };
+        for (int s = 0; s < 2; ++s) {
+            client.setLoadBalancing(strategies[s]);
+            QCOMPARE(client.loadBalancing(), strategies[s]);
+            m_returnMessages.clear();
+            m_returnHeaders.clear();
+            m_expectedMessages = 6;
+            for (int i = 0; i < 6; ++i) {
+                KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(client.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage()), this);
+                connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                        this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+            }
+            m_eventLoop.exec();
+            Q_FOREACH (const KDSoapMessage &response, m_returnMessages) {
+                QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+            }
+        }
+
+        // Back to a single endpoint
+        client.setEndPoint(endPoint1);
+        QCOMPARE(client.endPoints(), QStringList() << endPoint1);
+    }
+
+    void testRetryPolicy()
+    {
+        CountryServerThread serverThread1;
+        CountryServer *server1 = serverThread1.startThread();
+        CountryServerThread serverThread2;
+        CountryServer *server2 = serverThread2.startThread();
+        const QString endPoint1 = server1->endPoint();
+        const QString endPoint2 = server2->endPoint();
+        const QString method = QLatin1String("getEmployeeCountry");
+
+        KDSoapClientInterface client(endPoint1, countryMessageNamespace());
+        client.setEndPoints(QStringList() << endPoint1 << endPoint2);
+        client.setEndPointEjection(100, 500); // no ejection, every other request goes to the second server
+        QVERIFY(!client.retryPolicy(method).idempotent);
+        QCOMPARE(client.retryPolicy(method).maxRetries, 0);
+        serverThread2.suspend();
+
+        // Not retried by default
+        int faults = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (client.call(method, countryMessage()).isFault()) {
+                ++faults;
+            }
+        }
+        QCOMPARE(faults, 2);
+
+        // Nor when the method isn't idempotent
+        KDSoapClientInterface::RetryPolicy policy;
+        policy.maxRetries = 2;
+        policy.initialBackoff = 10;
+        client.setRetryPolicy(method, policy);
+        faults = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (client.call(method, countryMessage()).isFault()) {
+                ++faults;
+            }
+        }
+        QCOMPARE(faults, 2);
+
+        // Retried on the other server
+        policy.idempotent = true;
+        client.setRetryPolicy(method, policy);
+        QVERIFY(client.retryPolicy(method).idempotent);
+        QCOMPARE(client.retryPolicy(method).initialBackoff, 10);
+        for (int i = 0; i < 4; ++i) {
+            QVERIFY(!client.call(method, countryMessage()).isFault());
+        }
+        m_returnMessages.clear();
+        m_returnHeaders.clear();
+        m_expectedMessages = 4;
+        makeAsyncCalls(client, 4);
+        m_eventLoop.exec();
+        Q_FOREACH (const KDSoapMessage &response, m_returnMessages) {
+            QVERIFY(!response.isFault());
+            QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+        }
+
+        // Hedging, once there are enough response times
+        serverThread2.resume();
+        policy.hedging = true;
+        policy.hedgingPercentile = 90;
+        client.setRetryPolicy(method, policy);
+        for (int i = 0; i < 20; ++i) {
+            QVERIFY(!client.call(method, countryMessage()).isFault());
+        }
+        // The slow call is sent again to the other server. Both take 100ms, the first one wins
+        // and the second one is aborted, which closes its connection
+        const int connectedSockets = server1->numConnectedSockets() + server2->numConnectedSockets();
+        const int slowRequests = s_slowRequests.fetchAndAddRelaxed(0);
+        const KDSoapMessage response = client.call(method, countryMessage(true /*slow*/));
+        QVERIFY(!response.isFault());
+        QCOMPARE(response.childValues().first().value().toString(), QString::fromLatin1("Slow France"));
+#if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
+        QTRY_COMPARE(s_slowRequests.fetchAndAddRelaxed(0), slowRequests + 2);
+        QTRY_COMPARE(server1->numConnectedSockets() + server2->numConnectedSockets(), connectedSockets - 1);
+#else
+        QTest::qWait(500);
+        QCOMPARE(s_slowRequests.fetchAndAddRelaxed(0), slowRequests + 2);
+        QCOMPARE(server1->numConnectedSockets() + server2->numConnectedSockets(), connectedSockets - 1);
+#endif
+    }
+
+    void testJobQueue()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+
+        KDSoapJobQueue queue;
+        queue.setMaxJobsPerEndPoint(2);
+        queue.setMaxQueuedJobs(8);
+        queue.setBatchSize(4);
+        JobQueueRecorder recorder(&queue);
+        QSignalSpy spaceAvailableSpy(&queue, SIGNAL(spaceAvailable()));
+
+        // 2 jobs start, 8 wait, the queue is then full
+        for (int i = 0; i < 10; ++i) {
+            QVERIFY(queue.enqueue(new CountryJob(&client, i), 0, server->endPoint()));
+        }
+        QCOMPARE(queue.runningJobs(), 2);
+        QCOMPARE(queue.queuedJobs(), 8);
+        CountryJob *extraJob = new CountryJob(&client, 10);
+        QVERIFY(!queue.enqueue(extraJob, 0, server->endPoint()));
+        QVERIFY(!queue.isIdle());
+
+        recorder.waitForFinished();
+        QVERIFY(queue.isIdle());
+        QCOMPARE(spaceAvailableSpy.count(), 1);
+        QCOMPARE(recorder.m_maxRunningJobs, 2);
+        QCOMPARE(recorder.m_lastProgress, 10);
+        QCOMPARE(queue.finishedJobs(), 10);
+        QCOMPARE(queue.totalJobs(), 10);
+        QCOMPARE(queue.faultedJobs(), 0);
+        QCOMPARE(recorder.m_batchSizes, QList<int>() << 4 << 4 << 2);
+        QCOMPARE(recorder.m_finishedIds.count(), 10);
+
+        // The highest priority first, one job at a time
+        queue.setMaxJobsPerEndPoint(1);
+        queue.setBatchSize(100);
+        recorder.m_finishedIds.clear();
+        QVERIFY(queue.enqueue(extraJob, 0, server->endPoint())); // starts right away
+        QVERIFY(queue.enqueue(new CountryJob(&client, 11), 0, server->endPoint()));
+        QVERIFY(queue.enqueue(new CountryJob(&client, 12), 5, server->endPoint()));
+        QVERIFY(queue.enqueue(new CountryJob(&client, 13), 0, server->endPoint()));
+        QVERIFY(queue.enqueue(new CountryJob(&client, 14), 1, server->endPoint()));
+        QCOMPARE(queue.totalJobs(), 5);
+        recorder.waitForFinished();
+        QCOMPARE(recorder.m_finishedIds, QList<int>() << 10 << 12 << 14 << 11 << 13);
+
+        // clear() drops the jobs not started yet
+        QVERIFY(queue.enqueue(new CountryJob(&client, 15), 0, server->endPoint()));
+        QVERIFY(queue.enqueue(new CountryJob(&client, 16), 0, server->endPoint()));
+        queue.clear();
+        QCOMPARE(queue.queuedJobs(), 0);
+        QCOMPARE(queue.totalJobs(), 1);
+        recorder.waitForFinished();
+        QCOMPARE(queue.finishedJobs(), 1);
+    }
+
+    void testCallTimings()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        const QString method = QLatin1String("getEmployeeCountry");
+        QCOMPARE(client.callStatistics(method).calls, 0);
+        QCOMPARE(client.callStatistics(method).averageTimings.parseTime, qint64(-1));
+
+        // The server takes 100ms
+        KDSoapPendingCall pendingCall = client.asyncCall(method, countryMessage(true /*slow*/));
+        KDSoapPendingCall::Timings timings = pendingCall.timings();
+        QVERIFY(timings.serializationTime >= 0);
+        QVERIFY(timings.requestSize > 0);
+        QCOMPARE(timings.timeToFirstByte, qint64(-1));
+#if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
+        QTRY_VERIFY(pendingCall.isFinished());
+#else
+        QTest::qWait(1000);
+        QVERIFY(pendingCall.isFinished());
+#endif
+        timings = pendingCall.timings();
+        QVERIFY(timings.timeToFirstByte + qMax<qint64>(timings.queueTime, 0) >= 90000);
+        QVERIFY(timings.downloadTime >= 0);
+        QCOMPARE(timings.parseTime, qint64(-1)); // not parsed yet
+        QCOMPARE(timings.responseSize, qint64(-1));
+        QCOMPARE(client.callStatistics(method).calls, 0);
+
+        QCOMPARE(pendingCall.returnMessage().childValues().first().value().toString(), QString::fromLatin1("Slow France"));
+        timings = pendingCall.timings();
+        QVERIFY(timings.parseTime >= 0);
+        QVERIFY(timings.responseSize > 0);
+
+        // Blocking calls, with both HTTP engines, and a fault
+        QVERIFY(!client.call(method, countryMessage()).isFault());
+        client.setHttpEngine(KDSoapClientInterface::NativeHttpEngine);
+        QVERIFY(!client.call(method, countryMessage()).isFault());
+        KDSoapMessage emptyName;
+        emptyName.addArgument(QLatin1String("employeeName"), QString());
+        QVERIFY(client.call(method, emptyName).isFault());
+
+        const KDSoapClientInterface::CallStatistics statistics = client.callStatistics(method);
+        QCOMPARE(statistics.calls, 4);
+        QCOMPARE(statistics.faults, 1);
+        QVERIFY(statistics.averageTimings.serializationTime >= 0);
+        QVERIFY(statistics.averageTimings.queueTime >= 0); // with the native engine, at least
+        QVERIFY(statistics.averageTimings.timeToFirstByte >= 0);
+        QVERIFY(statistics.averageTimings.downloadTime >= 0);
+        QVERIFY(statistics.averageTimings.parseTime >= 0);
+        QVERIFY(statistics.averageTimings.requestSize > 0);
+        QVERIFY(statistics.averageTimings.responseSize > 0);
+        QVERIFY(statistics.maximumTimings.timeToFirstByte >= 90000);
+        QVERIFY(statistics.maximumTimings.responseSize >= statistics.averageTimings.responseSize);
+        QCOMPARE(client.callStatistics(QLatin1String("getStuff")).calls, 0);
+
+        client.resetCallStatistics();
+        QCOMPARE(client.callStatistics(method).calls, 0);
+    }
+
+    void testHexBinary()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+
+        //qDebug() << "server ready, proceeding" << server->endPoint();
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        client.setSoapVersion(KDSoapClientInterface::SOAP1_2);
+        KDSoapMessage message;
+        message.addArgument(QLatin1String("a"), QByteArray("KD"), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
+        message.addArgument(QLatin1String("b"), QByteArray("Soap"), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("hexBinary"));
+        const KDSoapMessage response = client.call(QLatin1String("hexBinaryTest"), message, QString::fromLatin1("ActionHex"));
+        QCOMPARE(QString::fromLatin1(QByteArray::fromBase64(response.value().toByteArray()).constData()), QString::fromLatin1("KDSoap"));
+    }
+
+    void testMtom_data()
+    {
+        QTest::addColumn<bool>("mtom");
+        QTest::addColumn<int>("soapVersion");
+        QTest::newRow("inline") << false << int(KDSoapClientInterface::SOAP1_1);
+        QTest::newRow("mtom_soap11") << true << int(KDSoapClientInterface::SOAP1_1);
+        QTest::newRow("mtom_soap12") << true << int(KDSoapClientInterface::SOAP1_2);
+    }
+
+    void testMtom()
+    {
+        QFETCH(bool, mtom);
+        QFETCH(int, soapVersion);
+
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        client.setSoapVersion(static_cast<KDSoapClientInterface::SoapVersion>(soapVersion));
+        client.setMtomEnabled(mtom);
+        QCOMPARE(client.isMtomEnabled(), mtom);
+
+        // Binary payload including things that look like MIME boundaries
+        QByteArray data;
+        for (int i = 0; i < 100000; ++i) {
+            data.append(char(i * 7));
+        }
+        data.append("\r\n--MIMEBoundary_\r\n");
+        data.append('\0');
+
+        KDSoapMessage message;
+        KDSoapValue value(QLatin1String("data"), QVariant(data), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
+        value.setContentType(QLatin1String("application/octet-stream"));
+        message.childValues().append(value);
+        const KDSoapMessage response = client.call(QLatin1String("mtomTest"), message);
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+
+        QByteArray expected = data;
+        std::reverse(expected.begin(), expected.end());
+        const KDSoapValue ret = response.childValues().child(QLatin1String("data"));
+        QCOMPARE(KDSoapBinaryCodec::fromBase64Value(ret), expected);
+        QCOMPARE(response.childValues().child(QLatin1String("wasAttachment")).value().toString(), QString::fromLatin1(mtom ? "true" : "false"));
+        if (mtom) {
+            // The reply mirrors the request packaging
+            QVERIFY(!ret.isEncodedBinaryValue());
+            QCOMPARE(ret.contentType(), QString::fromLatin1("application/octet-stream"));
+        }
+    }
+
+    void testBinaryDevice_data()
+    {
+        QTest::addColumn<bool>("mtom");
+        QTest::newRow("inline") << false;
+        QTest::newRow("mtom") << true;
+    }
+
+    void testBinaryDevice()
+    {
+        QFETCH(bool, mtom);
+
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        client.setMtomEnabled(mtom);
+
+        QByteArray data;
+        for (int i = 0; i < 300000; ++i) {
+            data.append(char(i * 11));
+        }
+        QTemporaryFile file;
+        QVERIFY(file.open());
+        file.write(data);
+        QVERIFY(file.seek(0));
+
+        KDSoapMessage message;
+        KDSoapValue value(QLatin1String("data"), QVariant(), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
+        value.setBinaryDevice(&file);
+        message.childValues().append(value);
+        const KDSoapMessage response = client.call(QLatin1String("mtomTest"), message);
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+
+        QByteArray expected = data;
+        std::reverse(expected.begin(), expected.end());
+        QCOMPARE(KDSoapBinaryCodec::fromBase64Value(response.childValues().child(QLatin1String("data"))), expected);
+        QCOMPARE(response.childValues().child(QLatin1String("wasAttachment")).value().toString(), QString::fromLatin1(mtom ? "true" : "false"));
+    }
+
+    void testLargeRequestInFile_data()
+    {
+        QTest::addColumn<bool>("mtom");
+        QTest::newRow("inline") << false;
+        QTest::newRow("mtom") << true;
+    }
+
+    void testLargeRequestInFile()
+    {
+        QFETCH(bool, mtom);
+
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        QCOMPARE(server->maxInMemoryRequestSize(), qint64(-1));
+        server->setMaxInMemoryRequestSize(10000);
+
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        client.setMtomEnabled(mtom);
+
+        QByteArray data;
+        for (int i = 0; i < 200000; ++i) {
+            data.append(char(i * 3));
+        }
+        KDSoapMessage message;
+        message.addArgument(QLatin1String("data"), QVariant(data), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
+        const KDSoapMessage response = client.call(QLatin1String("mtomTest"), message);
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+
+        QByteArray expected = data;
+        std::reverse(expected.begin(), expected.end());
+        QCOMPARE(KDSoapBinaryCodec::fromBase64Value(response.childValues().child(QLatin1String("data"))), expected);
+        // Attachments of the request stored in a file are given to the server object as devices
+        QCOMPARE(response.childValues().child(QLatin1String("wasDevice")).value().toString(), QString::fromLatin1(mtom ? "true" : "false"));
+
+        // Small requests are still handled in memory
+        KDSoapMessage smallMessage;
+        smallMessage.addArgument(QLatin1String("data"), QVariant(QByteArray("KDSoap")), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
+        const KDSoapMessage smallResponse = client.call(QLatin1String("mtomTest"), smallMessage);
+        QCOMPARE(KDSoapBinaryCodec::fromBase64Value(smallResponse.childValues().child(QLatin1String("data"))), QByteArray("paoSDK"));
+        QCOMPARE(smallResponse.childValues().child(QLatin1String("wasDevice")).value().toString(), QString::fromLatin1("false"));
+    }
+
+    void testBinaryEncoding()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        QVERIFY(!client.isBinaryEncodingEnabled());
+        client.setBinaryEncodingEnabled(true);
+        QVERIFY(client.isBinaryEncodingEnabled());
+
+        QByteArray data;
+        for (int i = 0; i < 1000; ++i) {
+            data.append(char(i * 13));
+        }
+        KDSoapMessage message;
+        message.addArgument(QLatin1String("data"), QVariant(data), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
+        QByteArray expected = data;
+        std::reverse(expected.begin(), expected.end());
+
+        // The first request is XML, the server then replies in the binary encoding, so the second request uses it too
+        for (int i = 0; i < 2; ++i) {
+            const bool binaryRequest = i > 0;
+            const KDSoapMessage response = client.call(QLatin1String("mtomTest"), message);
+            QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+            const KDSoapValue ret = response.childValues().child(QLatin1String("data"));
+            QVERIFY(!ret.isEncodedBinaryValue());
+            QCOMPARE(ret.value().toByteArray(), expected);
+            QCOMPARE(response.childValues().child(QLatin1String("wasAttachment")).value().toBool(), binaryRequest);
+            QCOMPARE(response.childValues().child(QLatin1String("wasDevice")).value().toBool(), false);
+        }
+
+        // Typed values, headers and faults
+        KDSoapMessage response = client.call(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+        QCOMPARE(response.value().toDouble(), double(4 + 3.2 + 123456.789));
+        QCOMPARE(client.lastResponseHeaders().header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QString::fromLatin1("responseHeader"));
+        response = client.call(QLatin1String("getStuff"), KDSoapMessage(), QString::fromLatin1("MySoapAction"));
+        QVERIFY(response.isFault());
+        QCOMPARE(response.childValues().child(QLatin1String("faultcode")).value().toString(), QString::fromLatin1("Server.RequiredArgumentMissing"));
+
+        // Another server might not support it: back to XML, still accepting binary replies
+        client.setEndPoint(server->endPoint());
+        response = client.call(QLatin1String("mtomTest"), message);
+        QCOMPARE(response.childValues().child(QLatin1String("wasAttachment")).value().toBool(), false);
+    }
+
+    void testInProcess()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        QVERIFY(server->setInProcessName(QLatin1String("CountryServer")));
+        QCOMPARE(server->inProcessName(), QString::fromLatin1("CountryServer"));
+
+        KDSoapClientInterface client(QLatin1String("inproc://CountryServer"), countryMessageNamespace());
+        KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+        QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+
+        // Headers, in both directions
+        response = client.call(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+        QCOMPARE(response.value().toDouble(), double(4 + 3.2 + 123456.789));
+        QCOMPARE(client.lastResponseHeaders().header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QString::fromLatin1("responseHeader"));
+
+        // Faults
+        response = client.call(QLatin1String("doesNotExist"), KDSoapMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toString(), QString::fromLatin1("Server.MethodNotFound"));
+
+        // Asynchronous calls
+        m_returnMessages.clear();
+        m_expectedMessages = 1;
+        KDSoapPendingCall pendingCall = client.asyncCall(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
+        KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);
+        connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+        m_eventLoop.exec();
+        QCOMPARE(m_returnMessages.count(), 1);
+        QCOMPARE(m_returnMessages.at(0).value().toDouble(), double(4 + 3.2 + 123456.789));
+
+        // None of this went through a socket
+        QCOMPARE(server->totalConnectionCount(), 0);
+
+        // Unknown names, and names which were unregistered
+        KDSoapClientInterface otherClient(QLatin1String("inproc://countryserver"), countryMessageNamespace());
+        response = otherClient.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(response.isFault());
+        QVERIFY(server->setInProcessName(QString()));
+        response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(response.isFault());
+
+        // No HTTP authentication or raw XML: calls needing them fail (re-registering creates a new server object)
+        server->setRequireAuth(true);
+        QVERIFY(server->setInProcessName(QLatin1String("CountryServer")));
+        response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toString(), QString::fromLatin1("Server.NotSupported"));
+        QVERIFY(server->setInProcessName(QString()));
+        server->setRequireAuth(false);
+        server->setUseRawXML(true);
+        QVERIFY(server->setInProcessName(QLatin1String("CountryServer")));
+        response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toString(), QString::fromLatin1("Server.NotSupported"));
+        QVERIFY(server->setInProcessName(QString()));
+        server->setUseRawXML(false);
+    }
+
+    void testInProcessSameThread()
+    {
+        CountryServer server;
+        QVERIFY(server.setInProcessName(QLatin1String("SameThreadServer")));
+        KDSoapClientInterface client(QLatin1String("inproc://SameThreadServer"), countryMessageNamespace());
+
+        // The server would only get the call once this thread is back in its event loop
+        KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toString(), QString::fromLatin1("Client.Deadlock"));
+
+        m_returnMessages.clear();
+        m_expectedMessages = 1;
+        KDSoapPendingCall pendingCall = client.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage());
+        KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);
+        connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+        m_eventLoop.exec();
+        QCOMPARE(m_returnMessages.count(), 1);
+        QCOMPARE(m_returnMessages.at(0).childValues().first().value().toString(), expectedCountry());
+    }
+
+    void testLocalSocket()
+    {
+#ifndef Q_OS_UNIX
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+        QSKIP("Unix domain sockets are only supported on Unix");
+#else
+        QSKIP("Unix domain sockets are only supported on Unix", SkipSingle);
+#endif
+#endif
+        CountryServerThread serverThread;
+        serverThread.setLocalSocketPath(localSocketPath());
+        CountryServer *server = serverThread.startThread();
+        QVERIFY(server);
+        QCOMPARE(server->localSocketPath(), localSocketPath());
+        QCOMPARE(server->localEndPoint(), QString::fromLatin1("unix://") + localSocketPath());
+
+        KDSoapClientInterface client(server->localEndPoint(), countryMessageNamespace());
+        KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+        QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+
+        // Headers, and faults with an error HTTP status
+        response = client.call(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+        QCOMPARE(response.value().toDouble(), double(4 + 3.2 + 123456.789));
+        QCOMPARE(client.lastResponseHeaders().header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QString::fromLatin1("responseHeader"));
+        response = client.call(QLatin1String("doesNotExist"), KDSoapMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toString(), QString::fromLatin1("Server.MethodNotFound"));
+
+        // Asynchronous calls
+        m_returnMessages.clear();
+        m_expectedMessages = 1;
+        KDSoapPendingCall pendingCall = client.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage());
+        KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);
+        connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+        m_eventLoop.exec();
+        QCOMPARE(m_returnMessages.count(), 1);
+        QCOMPARE(m_returnMessages.at(0).childValues().first().value().toString(), expectedCountry());
+
+        QCOMPARE(server->totalConnectionCount(), 4); // one connection per call
+
+        // Nobody listening there
+        KDSoapClientInterface otherClient(QString::fromLatin1("unix://") + localSocketPath() + QLatin1String(".missing"), countryMessageNamespace());
+        response = otherClient.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toInt(), int(QNetworkReply::HostNotFoundError));
+
+        // Another server can't take over the socket while this one is listening
+        CountryServer otherServer;
+        QVERIFY(!otherServer.listenOnLocalSocket(localSocketPath()));
+        QVERIFY(otherServer.localSocketPath().isEmpty());
+        response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+
+        // ... but it replaces a file nobody listens on
+        const QString stalePath = localSocketPath() + QLatin1String(".stale");
+        {
+            QFile staleFile(stalePath);
+            QVERIFY(staleFile.open(QIODevice::WriteOnly));
+        }
+        QVERIFY(otherServer.listenOnLocalSocket(stalePath));
+        QCOMPARE(otherServer.localSocketPath(), stalePath);
+        otherServer.closeLocalSocket();
+        QVERIFY(!QFile::exists(stalePath));
+    }
+
+    // Latency of the same blocking call over TCP loopback and over a Unix domain socket
+    void benchmarkLocalSocket_data()
     {
-        QMetaObject::invokeMethod(m_pServer, "resume");
-        m_semaphore.acquire();
+        QTest::addColumn<bool>("localSocket");
+        QTest::newRow("tcp") << false;
+#ifdef Q_OS_UNIX
+        QTest::newRow("unix") << true;
+#endif
     }
 
-protected:
-    void run()
+    void benchmarkLocalSocket()
     {
-        CountryServer server;
-        if (m_threadPool) {
-            server.setThreadPool(m_threadPool);
+        QFETCH(bool, localSocket);
+        CountryServerThread serverThread;
+        if (localSocket) {
+            serverThread.setLocalSocketPath(localSocketPath());
         }
-        if (server.listen()) {
-            m_pServer = &server;
+        CountryServer *server = serverThread.startThread();
+        QVERIFY(server);
+
+        KDSoapClientInterface client(localSocket ? server->localEndPoint() : server->endPoint(), countryMessageNamespace());
+        const KDSoapMessage message = countryMessage();
+        QBENCHMARK {
+            const KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), message);
+            QVERIFY(!response.isFault());
         }
-        connect(&server, SIGNAL(releaseSemaphore()), this, SLOT(slotReleaseSemaphore()), Qt::DirectConnection);
-        m_semaphore.release();
-        exec();
-        m_pServer = 0;
-    }
-private Q_SLOTS:
-    void slotReleaseSemaphore()
-    {
-        m_semaphore.release();
     }
 
-private:
-    KDSoapThreadPool *m_threadPool;
-    QSemaphore m_semaphore;
-    CountryServer *m_pServer;
-};
-
-// to avoid a bit of duplication
-class ClientSocket : public QTcpSocket
-{
-public:
-    ClientSocket(CountryServer *server)
+    void testHttp2()
     {
-        QUrl url(server->endPoint());
-        connectToHost(url.host(), server->serverPort());
-    }
-};
+#if QT_VERSION < QT_VERSION_CHECK(5, 11, 0)
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+        QSKIP("HTTP/2 without TLS requires Qt 5.11");
+#else
+        QSKIP("HTTP/2 without TLS requires Qt 5.11", SkipSingle);
+#endif
+#endif
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        server->setFeatures(KDSoapServer::Http2);
 
-class ServerTest : public QObject
-{
-    Q_OBJECT
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        client.setHttp2Enabled(true);
+        QVERIFY(client.isHttp2Enabled());
 
-private Q_SLOTS:
-    void initTestCase()
-    {
-#ifndef QT_NO_OPENSSL
-        if (!QSslSocket::supportsSsl()) {
-            qWarning("No SSL support on this machine, check that ssleay.so/ssleay32.dll is installed");
-        } else {
-            QVERIFY(KDSoapUnitTestHelpers::setSslConfiguration());
-            QSslConfiguration defaultConfig = QSslConfiguration::defaultConfiguration();
-            QFile certFile(QString::fromLatin1(":/certs/test-127.0.0.1-cert.pem"));
-            if (certFile.open(QIODevice::ReadOnly)) {
-                defaultConfig.setLocalCertificate(QSslCertificate(certFile.readAll()));
-            }
-            QFile keyFile(QString::fromLatin1(":/certs/test-127.0.0.1-key.pem"));
-            if (keyFile.open(QIODevice::ReadOnly)) {
-                defaultConfig.setPrivateKey(QSslKey(keyFile.readAll(), QSsl::Rsa));
+        // Concurrent calls, a fault among them
+        m_returnMessages.clear();
+        m_expectedMessages = 5;
+        for (int i = 0; i < m_expectedMessages; ++i) {
+            KDSoapPendingCall pendingCall = i == 2 ? client.asyncCall(QLatin1String("doesNotExist"), KDSoapMessage())
+                                            : client.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage());
+            KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);
+            connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                    this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+        }
+        m_eventLoop.exec();
+        QCOMPARE(m_returnMessages.count(), m_expectedMessages);
+        int faults = 0;
+        Q_FOREACH (const KDSoapMessage &response, m_returnMessages) {
+            if (response.isFault()) {
+                ++faults;
+                QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toString(), QString::fromLatin1("Server.MethodNotFound"));
+            } else {
+                QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
             }
-            QSslConfiguration::setDefaultConfiguration(defaultConfig);
         }
-#endif
-    }
+        QCOMPARE(faults, 1);
 
-    void testCall()
-    {
-        {
-            CountryServerThread serverThread;
-            CountryServer *server = serverThread.startThread();
+        // Blocking calls, with headers
+        KDSoapMessage response = client.call(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+        QCOMPARE(response.value().toDouble(), double(4 + 3.2 + 123456.789));
+        QCOMPARE(client.lastResponseHeaders().header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QString::fromLatin1("responseHeader"));
 
-            //qDebug() << "server ready, proceeding" << server->endPoint();
-            KDSoapClientInterface *client = new KDSoapClientInterface(server->endPoint(), countryMessageNamespace());
-            const KDSoapMessage response = client->call(QLatin1String("getEmployeeCountry"), countryMessage());
-            QVERIFY(!response.isFault());
-            QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+        QCOMPARE(server->totalConnectionCount(), 1); // all streams shared one connection
 
-            QCOMPARE(s_serverObjects.count(), 1);
-            QVERIFY(s_serverObjects.value(&serverThread)); // request handled by server thread itself (no thread pool)
-            QCOMPARE(server->totalConnectionCount(), 1);
-            delete client;
-            QTest::qWait(100);
-        }
-        QCOMPARE(s_serverObjects.count(), 0);
+        // HTTP/1.1 clients still work
+        KDSoapClientInterface http1Client(server->endPoint(), countryMessageNamespace());
+        response = http1Client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+        QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
     }
 
-    void testAuth()
+    // Upgrade from HTTP/1.1 (which QNAM doesn't do without TLS), at the frame level
+    void testHttp2Upgrade()
     {
         CountryServerThread serverThread;
         CountryServer *server = serverThread.startThread();
-        server->setRequireAuth(true);
+        server->setFeatures(KDSoapServer::Http2);
+
+        ClientSocket socket(server);
+        QVERIFY(socket.waitForConnected());
+        socket.write("GET /notfound HTTP/1.1\r\n"
+                     "Host: 127.0.0.1\r\n"
+                     "Connection: Upgrade, HTTP2-Settings\r\n"
+                     "Upgrade: h2c\r\n"
+                     "HTTP2-Settings: \r\n"
+                     "\r\n");
+        QVERIFY(socket.waitForBytesWritten());
+
+        const QByteArray switching = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+        QCOMPARE(readFromSocket(socket, switching.size()), switching);
+        // Server SETTINGS: MAX_CONCURRENT_STREAMS
+        QCOMPARE(readFromSocket(socket, 9 + 6).left(9).toHex(), QByteArray("000006040000000000"));
+        // The response to the upgraded request, on stream 1: HEADERS with END_STREAM and END_HEADERS, ":status: 404" first
+        const QByteArray frameHeader = readFromSocket(socket, 9);
+        QCOMPARE(frameHeader.mid(3).toHex(), QByteArray("010500000001"));
+        const int length = (uchar(frameHeader.at(0)) << 16) | (uchar(frameHeader.at(1)) << 8) | uchar(frameHeader.at(2));
+        const QByteArray headerBlock = readFromSocket(socket, length);
+        QCOMPARE(uchar(headerBlock.at(0)), uchar(0x8d));
+
+        // Client preface and SETTINGS, acknowledged by the server
+        socket.write("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+        socket.write(QByteArray::fromHex("000000040000000000"));
+        QVERIFY(socket.waitForBytesWritten());
+        QCOMPARE(readFromSocket(socket, 9).toHex(), QByteArray("000000040100000000"));
+
+        // PING
+        socket.write(QByteArray::fromHex("0000080600000000000102030405060708"));
+        QVERIFY(socket.waitForBytesWritten());
+        QCOMPARE(readFromSocket(socket, 17).toHex(), QByteArray("0000080601000000000102030405060708"));
+    }
+
+    void testNativeHttpEngine()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+
         KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
-        KDSoapAuthentication auth;
-        auth.setUser(QLatin1String("kdab"));
-        auth.setPassword(QLatin1String("pass42"));
-        client.setAuthentication(auth);
-        const KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
-        if (response.isFault()) {
-            qDebug() << response.faultAsString();
-            QVERIFY(!response.isFault());
+        QCOMPARE(client.httpEngine(), KDSoapClientInterface::QNetworkAccessManagerEngine);
+        client.setHttpEngine(KDSoapClientInterface::NativeHttpEngine);
+        QCOMPARE(client.httpEngine(), KDSoapClientInterface::NativeHttpEngine);
+
+        // Blocking calls, on the same connection
+        for (int i = 0; i < 3; ++i) {
+            const KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+            QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+            QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
         }
-        QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+        QCOMPARE(server->numConnectedSockets(), 1);
+
+        // Headers, and faults with an error HTTP status
+        KDSoapMessage response = client.call(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
+        QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+        QCOMPARE(response.value().toDouble(), double(4 + 3.2 + 123456.789));
+        QCOMPARE(client.lastResponseHeaders().header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QString::fromLatin1("responseHeader"));
+        response = client.call(QLatin1String("doesNotExist"), KDSoapMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toString(), QString::fromLatin1("Server.MethodNotFound"));
+
+        // Concurrent asynchronous calls
+        m_returnMessages.clear();
+        m_expectedMessages = 3;
+        for (int i = 0; i < m_expectedMessages; ++i) {
+            KDSoapPendingCall pendingCall = client.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage());
+            KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);
+            connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                    this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+        }
+        m_eventLoop.exec();
+        QCOMPARE(m_returnMessages.count(), m_expectedMessages);
+        Q_FOREACH (const KDSoapMessage &message, m_returnMessages) {
+            QCOMPARE(message.childValues().first().value().toString(), expectedCountry());
+        }
+
+        // Timeout, for blocking and asynchronous calls
+        client.setTimeout(10);
+        response = client.call(QLatin1String("getEmployeeCountry"), countryMessage(true)); // the server object sleeps for 100ms
+        QCOMPARE(response.faultAsString(), QString::fromLatin1("Fault code 4: Operation timed out"));
+        KDSoapPendingCall pendingCall = client.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage(true));
+#if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
+        QTRY_VERIFY(pendingCall.isFinished());
+#else
+        QTest::qWait(50);
+        QVERIFY(pendingCall.isFinished());
+#endif
+        QCOMPARE(pendingCall.returnMessage().faultAsString(), QString::fromLatin1("Fault code 4: Operation timed out"));
+
+        // Nobody listening there
+        KDSoapClientInterface otherClient(QString::fromLatin1("http://127.0.0.1:1/"), countryMessageNamespace());
+        otherClient.setHttpEngine(KDSoapClientInterface::NativeHttpEngine);
+        response = otherClient.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toInt(), int(QNetworkReply::ConnectionRefusedError));
+
+#ifdef Q_OS_UNIX
+        // Balanced over a Unix domain socket as well, which the native engine doesn't handle
+        CountryServerThread localServerThread;
+        localServerThread.setLocalSocketPath(localSocketPath());
+        CountryServer *localServer = localServerThread.startThread();
+        KDSoapClientInterface balancedClient(server->endPoint(), countryMessageNamespace());
+        balancedClient.setHttpEngine(KDSoapClientInterface::NativeHttpEngine);
+        balancedClient.setEndPoints(QStringList() << localServer->localEndPoint() << server->endPoint());
+        for (int i = 0; i < 4; ++i) {
+            response = balancedClient.call(QLatin1String("getEmployeeCountry"), countryMessage());
+            QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+            QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+        }
+        QCOMPARE(localServer->totalConnectionCount(), 2); // round robin, one connection per call
+#endif
     }
 
-    void testRefusedAuth()
+    void testNativeHttpEngineAuth()
     {
         CountryServerThread serverThread;
         CountryServer *server = serverThread.startThread();
         server->setRequireAuth(true);
         KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+        client.setHttpEngine(KDSoapClientInterface::NativeHttpEngine);
+
+        KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toInt(), int(QNetworkReply::AuthenticationRequiredError));
+
         KDSoapAuthentication auth;
         auth.setUser(QLatin1String("kdab"));
         auth.setPassword(QLatin1String("invalid"));
         client.setAuthentication(auth);
-        const KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
         QVERIFY(response.isFault());
-    }
 
-    void testParamTypes()
-    {
-        CountryServerThread serverThread;
-        CountryServer *server = serverThread.startThread();
-        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
-        const KDSoapMessage response = client.call(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
-        if (response.isFault()) {
-            qDebug() << response.faultAsString();
-            QVERIFY(!response.isFault());
+        auth.setPassword(QLatin1String("pass42"));
+        client.setAuthentication(auth);
+        for (int i = 0; i < 2; ++i) { // the second time, without asking
+            response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+            QVERIFY2(!response.isFault(), qPrintable(response.faultAsString()));
+            QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
         }
-        QCOMPARE(response.value().toDouble(), double(4 + 3.2 + 123456.789));
-        const KDSoapHeaders responseHeaders = client.lastResponseHeaders();
-        //qDebug() << responseHeaders;
-        QCOMPARE(responseHeaders.header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QString::fromLatin1("responseHeader"));
     }
 
-    void testHeadersAsyncCall() // KDSOAP-45
+    // Cost of a call with each HTTP engine, blocking and asynchronous
+    void benchmarkHttpEngine_data()
     {
-        CountryServerThread serverThread;
-        CountryServer *server = serverThread.startThread();
-        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
-        m_returnMessages.clear();
-        m_expectedMessages = 1;
-        KDSoapPendingCall pendingCall = client.asyncCall(QLatin1String("getStuff"), getStuffMessage(), QString::fromLatin1("MySoapAction"), getStuffRequestHeaders());
-        KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(pendingCall, this);
-        connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
-                this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
-        m_eventLoop.exec();
-        QCOMPARE(m_returnMessages.count(), 1);
-        QCOMPARE(m_returnMessages.at(0).value().toDouble(), double(4 + 3.2 + 123456.789));
-        QCOMPARE(m_returnHeaders.count(), 1);
-        QCOMPARE(m_returnHeaders.at(0).header(QLatin1String("header2"), QLatin1String("http://foo")).value().toString(), QLatin1String("responseHeader"));
+        QTest::addColumn<int>("engine");
+        QTest::addColumn<bool>("async");
+        QTest::newRow("qnam-sync") << int(KDSoapClientInterface::QNetworkAccessManagerEngine) << false;
+        QTest::newRow("native-sync") << int(KDSoapClientInterface::NativeHttpEngine) << false;
+        QTest::newRow("qnam-async") << int(KDSoapClientInterface::QNetworkAccessManagerEngine) << true;
+        QTest::newRow("native-async") << int(KDSoapClientInterface::NativeHttpEngine) << true;
     }
 
-    void testHexBinary()
+    void benchmarkHttpEngine()
     {
+        QFETCH(int, engine);
+        QFETCH(bool, async);
         CountryServerThread serverThread;
         CountryServer *server = serverThread.startThread();
+        QVERIFY(server);
 
-        //qDebug() << "server ready, proceeding" << server->endPoint();
         KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
-        client.setSoapVersion(KDSoapClientInterface::SOAP1_2);
-        KDSoapMessage message;
-        message.addArgument(QLatin1String("a"), QByteArray("KD"), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
-        message.addArgument(QLatin1String("b"), QByteArray("Soap"), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("hexBinary"));
-        const KDSoapMessage response = client.call(QLatin1String("hexBinaryTest"), message, QString::fromLatin1("ActionHex"));
-        QCOMPARE(QString::fromLatin1(QByteArray::fromBase64(response.value().toByteArray()).constData()), QString::fromLatin1("KDSoap"));
+        client.setHttpEngine(static_cast<KDSoapClientInterface::HttpEngine>(engine));
+        const KDSoapMessage message = countryMessage();
+        QBENCHMARK {
+            if (async) {
+                m_returnMessages.clear();
+                m_expectedMessages = 10;
+                for (int i = 0; i < m_expectedMessages; ++i) {
+                    KDSoapPendingCallWatcher *watcher = new KDSoapPendingCallWatcher(client.asyncCall(QLatin1String("getEmployeeCountry"), message), this);
+                    connect(watcher, SIGNAL(finished(KDSoapPendingCallWatcher*)),
+                            this, SLOT(slotFinished(KDSoapPendingCallWatcher*)));
+                }
+                m_eventLoop.exec();
+            } else {
+                const KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), message);
+                QVERIFY(!response.isFault());
+            }
+        }
     }
 
     void testMethodNotFound()
@@ -500,6 +1679,28 @@ private Q_SLOTS:
         QCOMPARE(response.arguments().child(QLatin1String("faultstring")).value().toString(), QString::fromLatin1("doesNotExist not found"));
     }
 
+    void testRegisteredRequestHandlers()
+    {
+        TestServerThread<HandlerServer> serverThread;
+        HandlerServer *server = serverThread.startThread();
+        KDSoapClientInterface client(server->endPoint(), countryMessageNamespace());
+
+        // Dispatched by name
+        KDSoapMessage response = client.call(QLatin1String("getEmployeeCountry"), countryMessage());
+        QVERIFY(!response.isFault());
+        QCOMPARE(response.childValues().first().value().toString(), expectedCountry());
+
+        // Dispatched by soap action, the element name is unknown
+        response = client.call(QLatin1String("somethingElse"), KDSoapMessage(), QString::fromLatin1("http://www.kdab.com/xml/MyWsdl/getCount"));
+        QVERIFY(!response.isFault());
+        QCOMPARE(response.value().toInt(), 42);
+
+        // Not registered
+        response = client.call(QLatin1String("doesNotExist"), KDSoapMessage());
+        QVERIFY(response.isFault());
+        QCOMPARE(response.arguments().child(QLatin1String("faultcode")).value().toString(), QString::fromLatin1("Server.MethodNotFound"));
+    }
+
     void testMissingParams()
     {
         CountryServerThread serverThread;
@@ -1210,6 +2411,60 @@ private Q_SLOTS:
         }
     }
 
+    void testRequestFileFailure_data()
+    {
+        QTest::addColumn<bool>("chunked");
+        QTest::newRow("content-length") << false;
+        QTest::newRow("chunked") << true;
+    }
+
+    // When no temporary file can be created, the request is handled in memory
+    void testRequestFileFailure()
+    {
+#ifndef Q_OS_UNIX
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+        QSKIP("TMPDIR is only used on Unix");
+#else
+        QSKIP("TMPDIR is only used on Unix", SkipSingle);
+#endif
+#endif
+        QFETCH(bool, chunked);
+
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+        server->setMaxInMemoryRequestSize(100);
+
+        // Not even root can create files in a directory which doesn't exist
+        TmpDirOverride tmpDir(QDir::tempPath() + QLatin1String("/kdsoap_no_such_dir"));
+
+        ClientSocket socket(server);
+        QVERIFY(socket.waitForConnected());
+        const QByteArray message = rawCountryMessage(s_longEmployeeName);
+        QByteArray request =
+            "POST / HTTP/1.1\r\n"
+            "SoapAction: http://www.kdab.com/xml/MyWsdl/getEmployeeCountry\r\n"
+            "Content-Type: text/xml;charset=utf-8\r\n"
+            "Host: 127.0.0.1:12345\r\n"; // ignored
+        if (chunked) {
+            request += "Transfer-Encoding: chunked\r\n\r\n";
+            for (int pos = 0; pos < message.size(); pos += 50) {
+                const QByteArray thisChunk = message.mid(pos, 50);
+                request += QByteArray::number(thisChunk.size(), 16) + "\r\n" + thisChunk + "\r\n";
+            }
+            request += "0\r\n\r\n";
+        } else {
+            request += "Content-Length: " + QByteArray::number(message.size()) + "\r\n\r\n" + message;
+        }
+        socket.write(request);
+        QVERIFY(socket.waitForBytesWritten());
+        verifySocketResponse(socket, s_longEmployeeName);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        // Only one attempt per request, not one per chunk
+        QCOMPARE(s_requestFileWarnings.fetchAndAddRelaxed(0), 1);
+#endif
+    }
+
     void testContentTypeParsing() // SOAP 112
     {
         CountryServerThread serverThread;
@@ -1355,6 +2610,73 @@ private Q_SLOTS:
         QCOMPARE(pendingCall.returnMessage().faultAsString(), QString::fromLatin1("Fault code 4: Operation timed out"));
     }
 
+    void testManyTimeouts()
+    {
+        CountryServerThread serverThread;
+        CountryServer *server = serverThread.startThread();
+
+        // Calls which time out and calls which don't, sharing the same timer
+        KDSoapClientInterface slowClient(server->endPoint(), countryMessageNamespace());
+        slowClient.setTimeout(10);
+        KDSoapClientInterface fastClient(server->endPoint(), countryMessageNamespace());
+        fastClient.setTimeout(10000);
+        QList<KDSoapPendingCall> slowCalls;
+        QList<KDSoapPendingCall> fastCalls;
+        for (int i = 0; i < 20; ++i) {
+            slowCalls.append(slowClient.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage(true)));
+            fastCalls.append(fastClient.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage()));
+        }
+        for (int i = 0; i < slowCalls.count(); ++i) {
+#if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
+            QTRY_VERIFY(slowCalls.at(i).isFinished());
+            QTRY_VERIFY(fastCalls.at(i).isFinished());
+#else
+            QTest::qWait(200);
+            QVERIFY(slowCalls.at(i).isFinished());
+            QVERIFY(fastCalls.at(i).isFinished());
+#endif
+            QCOMPARE(slowCalls.at(i).returnMessage().faultAsString(), QString::fromLatin1("Fault code 4: Operation timed out"));
+            QVERIFY(!fastCalls.at(i).returnMessage().isFault());
+            QCOMPARE(fastCalls.at(i).returnMessage().childValues().first().value().toString(), expectedCountry());
+        }
+    }
+
+    // A timeout beyond the first level of the timing wheel (256 ticks of 10ms), which has to
+    // move down to the first level before expiring, while shorter timeouts come and go
+    void testLongTimeout()
+    {
+        QTcpServer silentServer; // the connections wait in its backlog, nothing ever replies
+        QVERIFY(silentServer.listen(QHostAddress::LocalHost));
+        const QString endPoint = QString::fromLatin1("http://127.0.0.1:%1/").arg(silentServer.serverPort());
+
+        QElapsedTimer elapsed;
+        elapsed.start();
+        KDSoapClientInterface longClient(endPoint, countryMessageNamespace());
+        longClient.setTimeout(3000);
+        KDSoapPendingCall longCall = longClient.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage());
+        KDSoapClientInterface shortClient(endPoint, countryMessageNamespace());
+        shortClient.setTimeout(100);
+        KDSoapPendingCall shortCall = shortClient.asyncCall(QLatin1String("getEmployeeCountry"), countryMessage());
+
+#if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
+        QTRY_VERIFY(shortCall.isFinished());
+#else
+        QTest::qWait(500);
+        QVERIFY(shortCall.isFinished());
+#endif
+        QCOMPARE(shortCall.returnMessage().faultAsString(), QString::fromLatin1("Fault code 4: Operation timed out"));
+        QVERIFY(!longCall.isFinished());
+
+#if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
+        QTRY_VERIFY_WITH_TIMEOUT(longCall.isFinished(), 6000);
+#else
+        QTest::qWait(3500);
+        QVERIFY(longCall.isFinished());
+#endif
+        QVERIFY(elapsed.elapsed() >= 3000); // never early
+        QCOMPARE(longCall.returnMessage().faultAsString(), QString::fromLatin1("Fault code 4: Operation timed out"));
+    }
+
 public Q_SLOTS:
     void slotFinished(KDSoapPendingCallWatcher *watcher)
     {
@@ -1566,6 +2888,17 @@ void CountryServerObject::processRequest(const KDSoapMessage &request, KDSoapMes
         if (!hasFault()) {
             response.setValue(QVariant(hex));
         }
+    } else if (method == "mtomTest") {
+        const KDSoapValue input = request.childValues().child(QLatin1String("data"));
+        // Attachments arrive as raw bytes, inline values as base64 text
+        const bool wasAttachment = input.binaryDevice() || (input.value().userType() == QVariant::ByteArray && !input.isEncodedBinaryValue());
+        QByteArray data = KDSoapBinaryCodec::fromBase64Value(input);
+        std::reverse(data.begin(), data.end());
+        KDSoapValue output(QLatin1String("data"), QVariant(data), KDSoapNamespaceManager::xmlSchema2001(), QString::fromLatin1("base64Binary"));
+        output.setContentType(input.contentType());
+        response.childValues().append(output);
+        response.childValues().append(KDSoapValue(QLatin1String("wasAttachment"), wasAttachment));
+        response.childValues().append(KDSoapValue(QLatin1String("wasDevice"), input.binaryDevice() != 0));
     } else {
         KDSoapServerObjectInterface::processRequest(request, response, soapAction);
     }
@@ -25,6 +25,7 @@ SUBDIRS = \
   optionaltype_regular \
   optionaltype_pointer \
   enum_escape \
+  name_switch \
   clearbooks \
   soap12 \
   literal_true_false \
@@ -48,7 +49,8 @@ SUBDIRS = \
   test_calc \
   ws_addressing_support \
   ws_usernametoken_support \
-  list_restriction
+  list_restriction \
+  direct_parsing
 
 # These need internet access
 SUBDIRS += webcalls webcalls_wsdl